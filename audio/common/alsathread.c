@@ -28,11 +28,9 @@ void alsa_thread_free_info_members(alsa_thread_info_t *info)
          sthread_join(info->worker_thread);
       }
       if (info->buffer)
-         fifo_free(info->buffer);
+         spsc_ring_free(info->buffer);
       if (info->cond)
          scond_free(info->cond);
-      if (info->fifo_lock)
-         slock_free(info->fifo_lock);
       if (info->cond_lock)
          slock_free(info->cond_lock);
       if (info->pcm)
@@ -19,16 +19,17 @@
 
 #include <alsa/asoundlib.h>
 #include <boolean.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_ring.h>
 #include <rthreads/rthreads.h>
 #include "alsa.h"
 
 typedef struct alsa_thread_info
 {
    snd_pcm_t *pcm;
-   fifo_buffer_t *buffer;
+   /* Written by one thread and read by the other without a lock */
+   spsc_ring_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
+   /* Only for waiting on a full or empty buffer */
    scond_t *cond;
    slock_t *cond_lock;
    alsa_stream_info_t stream_info;
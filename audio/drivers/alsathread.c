@@ -19,7 +19,7 @@
 #include <alsa/asoundlib.h>
 
 #include <rthreads/rthreads.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_ring.h>
 #include <string/stdstring.h>
 #include <asm-generic/errno.h>
 
@@ -50,15 +50,15 @@ static void alsa_worker_thread(void *data)
    RARCH_DBG("[ALSA] [playback thread %p]: Beginning playback worker thread\n", thread_id);
    while (!alsa->info.thread_dead)
    {
-      size_t avail;
       size_t fifo_size;
       snd_pcm_sframes_t frames;
-      slock_lock(alsa->info.fifo_lock);
-      avail     = FIFO_READ_AVAIL(alsa->info.buffer);
-      fifo_size = MIN(alsa->info.stream_info.period_size, avail);
-      fifo_read(alsa->info.buffer, buf, fifo_size);
+      fifo_size = spsc_ring_read(alsa->info.buffer, buf,
+            alsa->info.stream_info.period_size);
+
+      /* Wake up a writer waiting for room */
+      slock_lock(alsa->info.cond_lock);
       scond_signal(alsa->info.cond);
-      slock_unlock(alsa->info.fifo_lock);
+      slock_unlock(alsa->info.cond_lock);
 
       /* If underrun, fill rest with silence. */
       memset(buf + fifo_size, 0, alsa->info.stream_info.period_size - fifo_size);
@@ -133,11 +133,10 @@ static void *alsa_thread_init(const char *device,
       goto error;
    }
 
-   alsa->info.fifo_lock = slock_new();
    alsa->info.cond_lock = slock_new();
    alsa->info.cond = scond_new();
-   alsa->info.buffer = fifo_new(alsa->info.stream_info.buffer_size);
-   if (!alsa->info.fifo_lock || !alsa->info.cond_lock || !alsa->info.cond || !alsa->info.buffer)
+   alsa->info.buffer = spsc_ring_new(alsa->info.stream_info.buffer_size);
+   if (!alsa->info.cond_lock || !alsa->info.cond || !alsa->info.buffer)
       goto error;
 
    alsa->info.worker_thread = sthread_create(alsa_worker_thread, alsa);
@@ -165,44 +164,26 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
       return -1;
 
    if (alsa->nonblock)
-   {
-      size_t avail;
-      size_t write_amt;
-
-      slock_lock(alsa->info.fifo_lock);
-      avail           = FIFO_WRITE_AVAIL(alsa->info.buffer);
-      write_amt       = MIN(avail, size);
-
-      fifo_write(alsa->info.buffer, buf, write_amt);
-      slock_unlock(alsa->info.fifo_lock);
-
-      return write_amt;
-   }
+      return spsc_ring_write(alsa->info.buffer, buf, size);
    else
    {
       size_t written = 0;
       while (written < size && !alsa->info.thread_dead)
       {
-         size_t avail;
-         slock_lock(alsa->info.fifo_lock);
-         avail = FIFO_WRITE_AVAIL(alsa->info.buffer);
+         size_t write_amt = spsc_ring_write(alsa->info.buffer,
+               (const char*)buf + written, size - written);
 
-         if (avail == 0)
+         if (write_amt == 0)
          {
-            slock_unlock(alsa->info.fifo_lock);
+            /* Only lock to sleep; checking again under the lock
+             * means the worker's signal cannot be missed */
             slock_lock(alsa->info.cond_lock);
-            if (!alsa->info.thread_dead)
+            if (    !alsa->info.thread_dead
+                  && spsc_ring_write_avail(alsa->info.buffer) == 0)
                scond_wait(alsa->info.cond, alsa->info.cond_lock);
             slock_unlock(alsa->info.cond_lock);
          }
-         else
-         {
-            size_t write_amt = MIN(size - written, avail);
-            fifo_write(alsa->info.buffer,
-                  (const char*)buf + written, write_amt);
-            slock_unlock(alsa->info.fifo_lock);
-            written += write_amt;
-         }
+         written += write_amt;
       }
       return written;
    }
@@ -243,14 +224,10 @@ static bool alsa_thread_start(void *data, bool is_shutdown)
 static size_t alsa_thread_write_avail(void *data)
 {
    alsa_thread_t *alsa = (alsa_thread_t*)data;
-   size_t val;
 
    if (alsa->info.thread_dead)
       return 0;
-   slock_lock(alsa->info.fifo_lock);
-   val = FIFO_WRITE_AVAIL(alsa->info.buffer);
-   slock_unlock(alsa->info.fifo_lock);
-   return val;
+   return spsc_ring_write_avail(alsa->info.buffer);
 }
 
 static size_t alsa_thread_buffer_size(void *data)
@@ -21,7 +21,7 @@
 
 #include <boolean.h>
 #include <rthreads/rthreads.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_ring.h>
 #include <retro_inline.h>
 #include <retro_math.h>
 
@@ -64,6 +64,7 @@ typedef Uint32 SDL_AudioDeviceID;
 typedef struct sdl_audio
 {
 #ifdef HAVE_THREADS
+   /* Only for waiting on a full queue */
    slock_t *lock;
    scond_t *cond;
 #endif
@@ -71,8 +72,10 @@ typedef struct sdl_audio
     * The queue used to store outgoing samples to be played by the driver.
     * Audio from the core ultimately makes its way here,
     * the last stop before the driver plays it.
+    * Written by the emulation thread and read by SDL's audio thread,
+    * neither of which locks it.
     */
-   fifo_buffer_t *speaker_buffer;
+   spsc_ring_t *speaker_buffer;
    bool nonblock;
    bool is_paused;
    SDL_AudioDeviceID speaker_device;
@@ -81,12 +84,12 @@ typedef struct sdl_audio
 static void sdl_audio_playback_cb(void *data, Uint8 *stream, int len)
 {
    sdl_audio_t  *sdl = (sdl_audio_t*)data;
-   size_t      avail = FIFO_READ_AVAIL(sdl->speaker_buffer);
-   size_t write_size = (len > (int)avail) ? avail : (size_t)len;
+   size_t write_size = spsc_ring_read(sdl->speaker_buffer, stream, len);
 
-   fifo_read(sdl->speaker_buffer, stream, write_size);
 #ifdef HAVE_THREADS
+   slock_lock(sdl->lock);
    scond_signal(sdl->cond);
+   slock_unlock(sdl->lock);
 #endif
 
    /* If underrun, fill rest with silence. */
@@ -196,11 +199,20 @@ static void *sdl_audio_init(const char *device,
    /* Create a buffer twice as big as needed and prefill the buffer. */
    bufsize             = out.samples * 4 * sizeof(int16_t);
    tmp                 = calloc(1, bufsize);
-   sdl->speaker_buffer = fifo_new(bufsize);
+   if (!(sdl->speaker_buffer = spsc_ring_new(bufsize)))
+   {
+      free(tmp);
+      SDL_CloseAudioDevice(sdl->speaker_device);
+#ifdef HAVE_THREADS
+      slock_free(sdl->lock);
+      scond_free(sdl->cond);
+#endif
+      goto error;
+   }
 
    if (tmp)
    {
-      fifo_write(sdl->speaker_buffer, tmp, bufsize);
+      spsc_ring_write(sdl->speaker_buffer, tmp, bufsize);
       free(tmp);
    }
 
@@ -222,14 +234,8 @@ static ssize_t sdl_audio_write(void *data, const void *buf, size_t size)
 
    if (sdl->nonblock)
    { /* If we shouldn't wait for space in a full outgoing sample queue... */
-      size_t avail, write_amt;
-
-      SDL_LockAudioDevice(sdl->speaker_device); /* Stop the SDL speaker thread from running */
-      avail = FIFO_WRITE_AVAIL(sdl->speaker_buffer);
-      write_amt = avail > size ? size : avail; /* Enqueue as much data as we can */
-      fifo_write(sdl->speaker_buffer, buf, write_amt);
-      SDL_UnlockAudioDevice(sdl->speaker_device); /* Let the speaker thread run again */
-      ret = write_amt; /* If the queue was full...well, too bad. */
+      /* Enqueue as much data as we can. If the queue was full...well, too bad. */
+      ret = spsc_ring_write(sdl->speaker_buffer, buf, size);
    }
    else
    {
@@ -237,35 +243,22 @@ static ssize_t sdl_audio_write(void *data, const void *buf, size_t size)
 
       while (written < size)
       { /* Until we've written all the sample data we have available... */
-         size_t avail;
-
-         SDL_LockAudioDevice(sdl->speaker_device); /* Stop the SDL speaker thread from running */
-         avail = FIFO_WRITE_AVAIL(sdl->speaker_buffer);
+         size_t write_amt = spsc_ring_write(sdl->speaker_buffer,
+               (const char*)buf + written, size - written);
+         /* Enqueue as many samples as fit without overflowing the queue */
 
-         if (avail == 0)
+         if (write_amt == 0)
          { /* If the outgoing sample queue is full... */
-            SDL_UnlockAudioDevice(sdl->speaker_device);
-            /* Let the SDL speaker thread run so it can play the enqueued samples,
-             * which will free up space for us to write new ones. */
 #ifdef HAVE_THREADS
             slock_lock(sdl->lock);
-            /* Let *only* the SDL speaker thread touch the outgoing sample queue */
-
-            scond_wait(sdl->cond, sdl->lock);
-            /* Block until SDL tells us that it's made room for new samples */
-
+            /* Block until SDL tells us that it's made room for new samples,
+             * unless it already did since we looked */
+            if (spsc_ring_write_avail(sdl->speaker_buffer) == 0)
+               scond_wait(sdl->cond, sdl->lock);
             slock_unlock(sdl->lock);
-            /* Now let this thread use the outgoing sample queue (which we'll do next iteration) */
 #endif
          }
-         else
-         {
-            size_t write_amt = size - written > avail ? avail : size - written;
-            fifo_write(sdl->speaker_buffer, (const char*)buf + written, write_amt);
-            /* Enqueue as many samples as we have available without overflowing the queue */
-            SDL_UnlockAudioDevice(sdl->speaker_device); /* Let the SDL speaker thread run again */
-            written += write_amt;
-         }
+         written += write_amt;
       }
       ret = written;
    }
@@ -320,7 +313,7 @@ static void sdl_audio_free(void *data)
 
       if (sdl->speaker_buffer)
       {
-         fifo_free(sdl->speaker_buffer);
+         spsc_ring_free(sdl->speaker_buffer);
       }
 
 #ifdef HAVE_THREADS
@@ -341,9 +334,14 @@ static bool sdl_audio_use_float(void *data)
 
 static size_t sdl_audio_write_avail(void *data)
 {
-   /* stub */
-   (void)data;
-   return 0;
+   sdl_audio_t *sdl = (sdl_audio_t*)data;
+   return spsc_ring_write_avail(sdl->speaker_buffer);
+}
+
+static size_t sdl_audio_buffer_size(void *data)
+{
+   sdl_audio_t *sdl = (sdl_audio_t*)data;
+   return sdl->speaker_buffer->capacity;
 }
 
 audio_driver_t audio_sdl = {
@@ -363,5 +361,5 @@ audio_driver_t audio_sdl = {
    NULL,
    NULL,
    sdl_audio_write_avail,
-   NULL
+   sdl_audio_buffer_size
 };
@@ -20,19 +20,22 @@
 #include "retro_math.h"
 #include "audio/microphone_driver.h"
 #include <rthreads/rthreads.h>
-#include <queues/fifo_queue.h>
+#include <queues/spsc_ring.h>
 
 typedef struct sdl_microphone_handle
 {
 #ifdef HAVE_THREADS
+   /* Only for waiting on an empty queue */
    slock_t *lock;
    scond_t *cond;
 #endif
 
    /**
     * The queue used to store incoming samples from the driver.
+    * Written by SDL's audio thread and read by the emulation thread,
+    * neither of which locks it.
     */
-   fifo_buffer_t *sample_buffer;
+   spsc_ring_t *sample_buffer;
    SDL_AudioDeviceID device_id;
    SDL_AudioSpec device_spec;
 } sdl_microphone_handle_t;
@@ -84,7 +87,7 @@ static void sdl_microphone_close_mic(void *driver_context, void *microphone_cont
       if (microphone->device_id > 0)
          SDL_CloseAudioDevice(microphone->device_id);
 
-      fifo_free(microphone->sample_buffer);
+      spsc_ring_free(microphone->sample_buffer);
 
 #ifdef HAVE_THREADS
       slock_free(microphone->lock);
@@ -110,13 +113,13 @@ static void sdl_microphone_free(void *data)
 static void sdl_audio_record_cb(void *data, Uint8 *stream, int len)
 {
    sdl_microphone_handle_t *microphone = (sdl_microphone_handle_t*)data;
-   size_t      avail                   = FIFO_WRITE_AVAIL(microphone->sample_buffer);
-   size_t read_size                    = MIN(len, (int)avail);
-   /* If the sample buffer is almost full, just write as much as we can into it*/
 
-   fifo_write(microphone->sample_buffer, stream, read_size);
+   /* If the sample buffer is almost full, just write as much as we can into it*/
+   spsc_ring_write(microphone->sample_buffer, stream, len);
 #ifdef HAVE_THREADS
+   slock_lock(microphone->lock);
    scond_signal(microphone->cond);
+   slock_unlock(microphone->lock);
 #endif
 }
 
@@ -223,13 +226,20 @@ static void *sdl_microphone_open_mic(void *driver_context,
    /* Create a buffer twice as big as needed and prefill the buffer. */
    bufsize                   = microphone->device_spec.samples * 2 * (SDL_AUDIO_BITSIZE(microphone->device_spec.format) / 8);
    tmp                       = calloc(1, bufsize);
-   microphone->sample_buffer = fifo_new(bufsize);
+   microphone->sample_buffer = spsc_ring_new(bufsize);
+
+   if (!microphone->sample_buffer)
+   {
+      free(tmp);
+      sdl_microphone_close_mic(driver_context, microphone);
+      return NULL;
+   }
 
    RARCH_DBG("[SDL audio]: Initialized microphone sample queue with %u bytes\n", bufsize);
 
    if (tmp)
    {
-      fifo_write(microphone->sample_buffer, tmp, bufsize);
+      spsc_ring_write(microphone->sample_buffer, tmp, bufsize);
       free(tmp);
    }
 
@@ -315,18 +325,8 @@ static int sdl_microphone_read(void *driver_context, void *microphone_context, v
 
    if (sdl->nonblock)
    { /* If we shouldn't block on an empty queue... */
-      size_t avail, read_amt;
-
-      SDL_LockAudioDevice(microphone->device_id); /* Stop the SDL mic thread */
-      avail = FIFO_READ_AVAIL(microphone->sample_buffer);
-      read_amt = avail > size ? size : avail;
-      if (read_amt > 0)
-      {  /* If the incoming queue isn't empty... */
-         fifo_read(microphone->sample_buffer, buf, read_amt);
-         /* ...then read as much data as will fit in buf */
-      }
-      SDL_UnlockAudioDevice(microphone->device_id); /* Let the mic thread run again */
-      ret = (int)read_amt;
+      /* Read as much data as will fit in buf, if there is any */
+      ret = (int)spsc_ring_read(microphone->sample_buffer, buf, size);
    }
    else
    {
@@ -334,37 +334,22 @@ static int sdl_microphone_read(void *driver_context, void *microphone_context, v
 
       while (read < size)
       { /* Until we've given the caller as much data as they've asked for... */
-         size_t avail;
-
-         SDL_LockAudioDevice(microphone->device_id);
-         /* Stop the SDL microphone thread from running */
-         avail = FIFO_READ_AVAIL(microphone->sample_buffer);
+         size_t read_amt = spsc_ring_read(microphone->sample_buffer,
+               (uint8_t*)buf + read, size - read);
+         /* Read as many samples as we have available without underflowing the queue */
 
-         if (avail == 0)
+         if (read_amt == 0)
          { /* If the incoming sample queue is empty... */
-            SDL_UnlockAudioDevice(microphone->device_id);
-            /* Let the SDL microphone thread run so it can push some incoming samples */
 #ifdef HAVE_THREADS
             slock_lock(microphone->lock);
-            /* Let *only* the SDL microphone thread access the incoming sample queue. */
-
-            scond_wait(microphone->cond, microphone->lock);
-            /* Wait until the SDL microphone thread tells us it's added some samples. */
-
+            /* Wait until the SDL microphone thread tells us it's added some samples,
+             * unless it already did since we looked */
+            if (spsc_ring_read_avail(microphone->sample_buffer) == 0)
+               scond_wait(microphone->cond, microphone->lock);
             slock_unlock(microphone->lock);
-            /* Allow this thread to access the incoming sample queue, which we'll do next iteration */
 #endif
          }
-         else
-         {
-            size_t read_amt = MIN(size - read, avail);
-            fifo_read(microphone->sample_buffer, buf + read, read_amt);
-            /* Read as many samples as we have available without underflowing the queue */
-
-            SDL_UnlockAudioDevice(microphone->device_id);
-            /* Let the SDL microphone thread run again */
-            read += read_amt;
-         }
+         read += read_amt;
       }
       ret = (int)read;
    }
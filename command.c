@@ -28,6 +28,7 @@
 #include <streams/stdin_stream.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
+#include <queues/task_queue.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -127,7 +128,7 @@ static bool command_get_arg(const char *tok,
             return false;
 
          if (arg)
-            *arg = argument + 1;
+            *arg = (*argument) ? argument + 1 : argument;
 
          if (index)
             *index = i;
@@ -954,6 +955,96 @@ bool command_get_status(command_t *cmd, const char* arg)
    return true;
 }
 
+static size_t command_task_stats_hist(char *s, size_t len,
+      const char *label, const task_stats_histogram_t *hist)
+{
+   return snprintf(s, len, " %s=%lld/%lld/%lld", label,
+         (long long)task_stats_percentile(hist, 50),
+         (long long)task_stats_percentile(hist, 99),
+         (long long)hist->max);
+}
+
+/* One line per kind of task, with the 50th and 99th percentiles
+ * and the maximum of each timing in microseconds */
+bool command_get_task_stats(command_t *cmd, const char *arg)
+{
+   size_t i, count;
+   size_t _len         = 0;
+   size_t reply_size   = 0;
+   char *reply         = NULL;
+   task_stats_t *stats = NULL;
+
+   count      = task_queue_get_stats(NULL, 0);
+   reply_size = 32 + count * 512;
+   if (!(reply = (char*)malloc(reply_size)))
+      return false;
+   if (count && !(stats = (task_stats_t*)malloc(count * sizeof(*stats))))
+   {
+      free(reply);
+      return false;
+   }
+
+   count = MIN(count, task_queue_get_stats(stats, count));
+   _len  = strlcpy(reply, "GET_TASK_STATS\n", reply_size);
+
+   for (i = 0; i < count; i++)
+   {
+      const task_stats_t *st = &stats[i];
+
+      if (st->name)
+         _len += snprintf(reply + _len, reply_size - _len, "%.64s", st->name);
+      else
+         _len += snprintf(reply + _len, reply_size - _len, "handler_%p",
+               (void*)(uintptr_t)st->handler);
+      _len += snprintf(reply + _len, reply_size - _len,
+            " pushed=%u finished=%u",
+            (unsigned)st->pushed, (unsigned)st->finished);
+      _len += command_task_stats_hist(reply + _len, reply_size - _len,
+            "wait_us",      &st->wait);
+      _len += command_task_stats_hist(reply + _len, reply_size - _len,
+            "iteration_us", &st->iteration);
+      _len += command_task_stats_hist(reply + _len, reply_size - _len,
+            "runtime_us",   &st->runtime);
+      _len += strlcpy(reply + _len, "\n", reply_size - _len);
+   }
+
+   cmd->replier(cmd, reply, MIN(_len, reply_size - 1));
+
+   if (string_is_equal(arg, "RESET"))
+      task_queue_reset_stats();
+
+   free(stats);
+   free(reply);
+   return true;
+}
+
+bool command_task_trace(command_t *cmd, const char *arg)
+{
+   char reply[64];
+   size_t _len = strlcpy(reply, "TASK_TRACE ", sizeof(reply));
+
+   if (string_is_empty(arg))
+      return false;
+
+   if (string_is_equal(arg, "STOP"))
+   {
+      if (!task_queue_trace_stop())
+         return false;
+      RARCH_LOG("[Tasks]: Trace written.\n");
+   }
+   else
+   {
+      if (!task_queue_trace_start(arg, 0))
+         return false;
+      RARCH_LOG("[Tasks]: Tracing to \"%s\".\n", arg);
+   }
+
+   _len += strlcpy(reply + _len, arg, sizeof(reply) - _len);
+   _len += strlcpy(reply + _len, "\n", sizeof(reply) - _len);
+   cmd->replier(cmd, reply, MIN(_len, sizeof(reply) - 1));
+   return true;
+}
+
 bool command_read_memory(command_t *cmd, const char *arg)
 {
    unsigned i;
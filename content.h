@@ -141,6 +141,15 @@ void content_get_subsystem_friendly_name(const char* subsystem_name, char* subsy
  * specific content file types */
 bool content_file_override_set(const struct retro_system_content_info_override *overrides);
 
+/* Hands a content buffer that is already resident in memory
+ * (e.g. received over the network) to the next load of @path.
+ * Ownership of @data (allocated with malloc()) passes to the
+ * content loader, which uses it instead of reading @path and
+ * takes @crc as the content CRC32. Cores that require a full
+ * path get @data written to @path first. */
+bool content_set_memory_buffer(const char *path,
+      void *data, size_t size, uint32_t crc);
+
 RETRO_END_DECLS
 
 #endif
@@ -20,15 +20,21 @@
 #include <file/config_file.h>
 #include <file/file_path.h>
 #include <streams/file_stream.h>
-#include <streams/interface_stream.h>
-#include <formats/rjson.h>
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
+#include <array/rbuf.h>
+#include <array/rhmap.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
 #include "retroarch.h"
 #include "verbosity.h"
 
@@ -47,1192 +53,689 @@
 /* Core Info Cache START */
 /*************************/
 
-#define CORE_INFO_CACHE_VERSION "1.2"
-#define CORE_INFO_CACHE_DEFAULT_CAPACITY 8
+/* Binary core info cache
+ * > Describes every installed core, so that the .info
+ *   files need not be parsed on startup. It is rewritten
+ *   whenever a core is found that it does not describe,
+ *   or a core it describes has been uninstalled
+ * > Fixed size core and firmware records, followed by a
+ *   table of NUL terminated strings that the records
+ *   refer to by offset. Each distinct string is stored
+ *   only once - cores share a great many system names,
+ *   manufacturers, licenses and databases
+ * > Core info strings point straight into the table.
+ *   With HAVE_MMAP the file is mapped, so only the pages
+ *   holding strings that are actually read are loaded
+ * > Of the string lists, only the supported extensions
+ *   are split on load. The others and the firmware are
+ *   decoded when a core is first looked up, once,
+ *   under the list's lock, see
+ *   core_info_resolve_lazy_fields() */
+
+#define CORE_INFO_CACHE_MAGIC   0x43494352 /* "RCIC" */
+#define CORE_INFO_CACHE_VERSION 2
+
+enum core_info_cache_flags
+{
+   CORE_INFO_CACHE_FLG_HAS_INFO                      = (1 << 0),
+   CORE_INFO_CACHE_FLG_SUPPORTS_NO_GAME              = (1 << 1),
+   CORE_INFO_CACHE_FLG_SINGLE_PURPOSE                = (1 << 2),
+   CORE_INFO_CACHE_FLG_DATABASE_MATCH_ARCHIVE_MEMBER = (1 << 3),
+   CORE_INFO_CACHE_FLG_IS_EXPERIMENTAL               = (1 << 4)
+};
 
-/* TODO/FIXME: Apparently rzip compression is an issue on UWP */
-#if defined(HAVE_ZLIB) && !(defined(__WINRT__) || defined(WINAPI_FAMILY) && WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
-#define CORE_INFO_CACHE_COMPRESS
-#endif
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_cores;
+   uint32_t core_size;
+   uint32_t num_firmware;
+   uint32_t firmware_size;
+   uint32_t strings_size;
+   uint32_t reserved;
+} core_info_cache_header_t;
+
+/* String fields hold offsets into the string
+ * table, 0 standing for a NULL string. Records
+ * are sorted by core file id hash */
+typedef struct
+{
+   uint32_t core_file_id_hash;
+   uint32_t core_file_id;
+   uint32_t display_name;
+   uint32_t display_version;
+   uint32_t core_name;
+   uint32_t system_manufacturer;
+   uint32_t systemname;
+   uint32_t system_id;
+   uint32_t supported_extensions;
+   uint32_t authors;
+   uint32_t permissions;
+   uint32_t licenses;
+   uint32_t categories;
+   uint32_t databases;
+   uint32_t notes;
+   uint32_t required_hw_api;
+   uint32_t description;
+   uint32_t firmware; /* First of 'firmware_count' records */
+   uint32_t firmware_count;
+   uint32_t savestate_support_level;
+   uint32_t flags;
+   uint32_t reserved;
+} core_info_cache_core_t;
 
 typedef struct
 {
-   core_info_t *items;
-   size_t length;
-   size_t capacity;
-   char *version;
-   bool refresh;
-} core_info_cache_list_t;
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+   uint32_t reserved;
+} core_info_cache_firmware_t;
+
+struct core_info_cache
+{
+   uint8_t *data;
+   const core_info_cache_core_t *cores;
+   const core_info_cache_firmware_t *firmware;
+   const char *strings;
+   size_t size;
+   size_t num_cores;
+   size_t num_firmware;
+   size_t strings_size;
+   bool mapped;
+};
 
 typedef struct
 {
-   core_info_t *core_info;
-   core_info_cache_list_t *core_info_cache_list;
-   char **current_string_val;
-   struct string_list **current_string_list_val;
-   uint32_t *current_entry_uint_val;
-   bool *current_entry_bool_val;
-   unsigned array_depth;
-   unsigned object_depth;
-   bool to_core_file_id;
-   bool to_firmware;
-} CCJSONContext;
+   char *data;
+   uint32_t *map; /* String -> offset */
+   size_t size;
+   size_t capacity;
+   bool oom;
+} core_info_cache_strings_t;
+
+/* Cores listing a given extension or database, as
+ * the addresses of their core file id strings (which
+ * stay put when the core list is sorted), in address
+ * order */
+typedef struct core_info_index
+{
+   const char **cores;
+   bool match_archive_member;
+} core_info_index_t;
 
 /* Forward declarations */
-static void core_info_free(core_info_t* info);
+static void core_info_free(core_info_list_t *list, core_info_t *info);
 static uint32_t core_info_hash_string(const char *str);
-#ifdef HAVE_CORE_INFO_CACHE
-static core_info_cache_list_t *core_info_cache_list_new(void);
-#endif
-static void core_info_cache_add(core_info_cache_list_t *list,
-      core_info_t *info, bool transfer);
 
 static core_info_state_t core_info_st = {
 #ifdef HAVE_COMPRESSION
    NULL,
 #endif
+   NULL,
    NULL,
    NULL,
    NULL
 };
 
-#ifdef HAVE_CORE_INFO_CACHE
-/* JSON Handlers START */
-
-static bool CCJSONObjectMemberHandler(void *context,
-      const char *pValue, size_t length)
+static void core_info_cache_get_path(char *s,
+      const char *info_dir, const char *filename, size_t len)
 {
-   CCJSONContext *pCtx = (CCJSONContext *)context;
-
-   if (length)
-   {
-      switch (pCtx->array_depth)
-      {
-         case 0:
-            if (pCtx->object_depth == 1)
-            {
-               pCtx->current_string_val     = NULL;
-
-               if (string_is_equal(pValue, "version"))
-                  pCtx->current_string_val  = &pCtx->core_info_cache_list->version;
-            }
-            break;
-         case 1:
-            if (pCtx->object_depth == 2)
-            {
-               pCtx->current_string_val      = NULL;
-               pCtx->current_string_list_val = NULL;
-               pCtx->current_entry_uint_val  = NULL;
-               pCtx->current_entry_bool_val  = NULL;
-               pCtx->to_core_file_id         = false;
-               pCtx->to_firmware             = false;
-
-               switch (pValue[0])
-               {
-                  case 'a':
-                     if (string_is_equal(pValue, "authors"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->authors;
-                        pCtx->current_string_list_val = &pCtx->core_info->authors_list;
-                     }
-                     break;
-                  case 'c':
-                     if (string_is_equal(pValue, "categories"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->categories;
-                        pCtx->current_string_list_val = &pCtx->core_info->categories_list;
-                     }
-                     else if (string_is_equal(pValue, "core_name"))
-                        pCtx->current_string_val      = &pCtx->core_info->core_name;
-                     else if (string_is_equal(pValue, "core_file_id"))
-                        pCtx->to_core_file_id         = true;
-                     break;
-                  case 'd':
-                     if (string_is_equal(pValue, "display_name"))
-                        pCtx->current_string_val      = &pCtx->core_info->display_name;
-                     else if (string_is_equal(pValue, "display_version"))
-                        pCtx->current_string_val      = &pCtx->core_info->display_version;
-                     else if (string_is_equal(pValue, "databases"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->databases;
-                        pCtx->current_string_list_val = &pCtx->core_info->databases_list;
-                     }
-                     else if (string_is_equal(pValue, "description"))
-                        pCtx->current_string_val      = &pCtx->core_info->description;
-                     else if (string_is_equal(pValue, "database_match_archive_member"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->database_match_archive_member;
-                     break;
-                  case 'f':
-                     if (string_is_equal(pValue, "firmware"))
-                        pCtx->to_firmware             = true;
-                     break;
-                  case 'h':
-                     if (string_is_equal(pValue, "has_info"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->has_info;
-                     break;
-                  case 'l':
-                     if (string_is_equal(pValue, "licenses"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->licenses;
-                        pCtx->current_string_list_val = &pCtx->core_info->licenses_list;
-                     }
-                     else if (string_is_equal(pValue, "is_experimental"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->is_experimental;
-                     break;
-                  case 'n':
-                     if (string_is_equal(pValue, "notes"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->notes;
-                        pCtx->current_string_list_val = &pCtx->core_info->note_list;
-                     }
-                     break;
-                  case 'p':
-                     if (string_is_equal(pValue, "permissions"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->permissions;
-                        pCtx->current_string_list_val = &pCtx->core_info->permissions_list;
-                     }
-                     break;
-                  case 'r':
-                     if (string_is_equal(pValue, "required_hw_api"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->required_hw_api;
-                        pCtx->current_string_list_val = &pCtx->core_info->required_hw_api_list;
-                     }
-                     break;
-                  case 's':
-                     if (string_is_equal(pValue, "system_manufacturer"))
-                        pCtx->current_string_val      = &pCtx->core_info->system_manufacturer;
-                     else if (string_is_equal(pValue, "systemname"))
-                        pCtx->current_string_val      = &pCtx->core_info->systemname;
-                     else if (string_is_equal(pValue, "system_id"))
-                        pCtx->current_string_val      = &pCtx->core_info->system_id;
-                     else if (string_is_equal(pValue, "supported_extensions"))
-                     {
-                        pCtx->current_string_val      = &pCtx->core_info->supported_extensions;
-                        pCtx->current_string_list_val = &pCtx->core_info->supported_extensions_list;
-                     }
-                     else if (string_is_equal(pValue, "supports_no_game"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->supports_no_game;
-                     else if (string_is_equal(pValue, "single_purpose"))
-                        pCtx->current_entry_bool_val  = &pCtx->core_info->single_purpose;
-                     else if (string_is_equal(pValue, "savestate_support_level"))
-                        pCtx->current_entry_uint_val  = &pCtx->core_info->savestate_support_level;
-                     break;
-               }
-            }
-            else if (pCtx->object_depth == 3)
-            {
-               pCtx->current_string_val      = NULL;
-               pCtx->current_entry_uint_val  = NULL;
-
-               if (pCtx->to_core_file_id)
-               {
-                  if (string_is_equal(pValue, "str"))
-                     pCtx->current_string_val      = &pCtx->core_info->core_file_id.str;
-                  else if (string_is_equal(pValue, "hash"))
-                     pCtx->current_entry_uint_val  = &pCtx->core_info->core_file_id.hash;
-               }
-            }
-            break;
-         case 2:
-            if (pCtx->object_depth == 3)
-            {
-               pCtx->current_string_val            = NULL;
-               pCtx->current_entry_bool_val        = NULL;
-
-               if (pCtx->to_firmware && (pCtx->core_info->firmware_count > 0))
-               {
-                  size_t firmware_idx              = pCtx->core_info->firmware_count - 1;
-
-                  if (string_is_equal(pValue, "path"))
-                     pCtx->current_string_val      = &pCtx->core_info->firmware[firmware_idx].path;
-                  else if (string_is_equal(pValue, "desc"))
-                     pCtx->current_string_val      = &pCtx->core_info->firmware[firmware_idx].desc;
-                  else if (string_is_equal(pValue, "optional"))
-                     pCtx->current_entry_bool_val  = &pCtx->core_info->firmware[firmware_idx].optional;
-               }
-            }
-            break;
-      }
-
-   }
-
-   return true;
+   if (string_is_empty(info_dir))
+      strlcpy(s, filename, len);
+   else
+      fill_pathname_join_special(s, info_dir, filename, len);
 }
 
-static bool CCJSONStringHandler(void *context,
-      const char *pValue, size_t length)
+static char *core_info_cache_get_string(
+      const struct core_info_cache *cache, uint32_t offset)
 {
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-
-   if (     pCtx->current_string_val
-         && length
-         && !string_is_empty(pValue))
-   {
-      if (*pCtx->current_string_val)
-         free(*pCtx->current_string_val);
-      *pCtx->current_string_val = strdup(pValue);
-
-      if (pCtx->current_string_list_val)
-      {
-         if (*pCtx->current_string_list_val)
-            string_list_free(*pCtx->current_string_list_val);
-         *pCtx->current_string_list_val =
-            string_split(*pCtx->current_string_val, "|");
-      }
-   }
-
-   pCtx->current_string_val      = NULL;
-   pCtx->current_string_list_val = NULL;
-
-   return true;
+   if (!offset || offset >= cache->strings_size)
+      return NULL;
+   return (char*)cache->strings + offset;
 }
 
-static bool CCJSONNumberHandler(void *context,
-      const char *pValue, size_t length)
+/* Frees a core info string, unless it lives in
+ * the string table of the core info cache */
+static void core_info_free_string(
+      const struct core_info_cache *cache, char *str)
 {
-   CCJSONContext *pCtx              = (CCJSONContext*)context;
-
-   if (pCtx->current_entry_uint_val)
-      *pCtx->current_entry_uint_val = string_to_unsigned(pValue);
-
-   pCtx->current_entry_uint_val     = NULL;
-
-   return true;
+   if (     str
+         && !(   cache
+              && (str >= cache->strings)
+              && (str <  cache->strings + cache->strings_size)))
+      free(str);
 }
 
-static bool CCJSONBoolHandler(void *context, bool value)
+static void core_info_cache_free(struct core_info_cache *cache)
 {
-   CCJSONContext *pCtx              = (CCJSONContext *)context;
-
-   if (pCtx->current_entry_bool_val)
-      *pCtx->current_entry_bool_val = value;
+   if (!cache)
+      return;
 
-   pCtx->current_entry_bool_val     = NULL;
+#ifdef HAVE_MMAP
+   if (cache->mapped)
+      munmap(cache->data, cache->size);
+   else
+#endif
+      free(cache->data);
 
-   return true;
+   free(cache);
 }
 
-static bool CCJSONStartObjectHandler(void *context)
+static const core_info_cache_core_t *core_info_cache_find(
+      const struct core_info_cache *cache,
+      uint32_t hash, const char *core_file_id)
 {
-   CCJSONContext *pCtx = (CCJSONContext*)context;
+   size_t lo = 0;
+   size_t hi;
 
-   pCtx->object_depth++;
+   if (!cache || string_is_empty(core_file_id))
+      return NULL;
 
-   switch (pCtx->array_depth)
+   /* First record with a hash not below 'hash' */
+   hi = cache->num_cores;
+   while (lo < hi)
    {
-      case 0:
-         if (pCtx->object_depth == 1)
-         {
-            if (pCtx->core_info_cache_list)
-               return false;
-            if (!(pCtx->core_info_cache_list = core_info_cache_list_new()))
-               return false;
-         }
-         break;
-      case 1:
-         if (pCtx->object_depth == 2)
-         {
-            if (pCtx->core_info)
-            {
-               core_info_free(pCtx->core_info);
-               free(pCtx->core_info);
-               pCtx->core_info = NULL;
-            }
-
-            if (!(pCtx->core_info = (core_info_t*)calloc(1, sizeof(core_info_t))))
-               return false;
-
-            /* Assume all cores have 'full' savestate support
-             * by default */
-            pCtx->core_info->savestate_support_level =
-               CORE_INFO_SAVESTATE_DETERMINISTIC;
-         }
-         break;
-      case 2:
-         if (pCtx->object_depth == 3 && pCtx->to_firmware)
-         {
-            size_t new_idx            = pCtx->core_info->firmware_count;
-            core_info_firmware_t *tmp = (core_info_firmware_t*)
-               realloc(pCtx->core_info->firmware,
-                     (pCtx->core_info->firmware_count + 1)
-                     * sizeof(core_info_firmware_t));
-
-            if (!tmp)
-               return false;
-
-            tmp[new_idx].path              = NULL;
-            tmp[new_idx].desc              = NULL;
-            tmp[new_idx].missing           = false;
-            tmp[new_idx].optional          = false;
-
-            pCtx->core_info->firmware      = tmp;
-            pCtx->core_info->firmware_count++;
-         }
-         break;
+      size_t mid = lo + ((hi - lo) >> 1);
+      if (cache->cores[mid].core_file_id_hash < hash)
+         lo = mid + 1;
+      else
+         hi = mid;
    }
 
+   for (; lo < cache->num_cores; lo++)
+   {
+      const core_info_cache_core_t *record = &cache->cores[lo];
 
-   return true;
-}
-
-static bool CCJSONEndObjectHandler(void *context)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
+      if (record->core_file_id_hash != hash)
+         break;
 
-   if (pCtx->array_depth == 1)
-   {
-      switch (pCtx->object_depth)
-      {
-         case 2:
-            if (pCtx->core_info)
-            {
-               core_info_cache_add(
-                     pCtx->core_info_cache_list, pCtx->core_info, true);
-               free(pCtx->core_info);
-               pCtx->core_info = NULL;
-            }
-            break;
-         case 3:
-            pCtx->to_core_file_id = false;
-            break;
-         default:
-            break;
-      }
+      if (string_is_equal(core_info_cache_get_string(
+               cache, record->core_file_id), core_file_id))
+         return record;
    }
 
-   pCtx->object_depth--;
-
-   return true;
+   return NULL;
 }
 
-static bool CCJSONStartArrayHandler(void *context)
+#ifdef HAVE_CORE_INFO_CACHE
+/**
+ * core_info_cache_read:
+ * @info_dir            : Core info directory.
+ *
+ * Opens the core info cache in @info_dir.
+ *
+ * Returns NULL if there is no valid cache, or if
+ * a refresh has been forced.
+ **/
+static struct core_info_cache *core_info_cache_read(const char *info_dir)
 {
-   CCJSONContext *pCtx = (CCJSONContext*)context;
-   pCtx->array_depth++;
-   return true;
-}
+   const core_info_cache_header_t *header = NULL;
+   struct core_info_cache *cache          = NULL;
+   char file_path[PATH_MAX_LENGTH];
 
-static bool CCJSONEndArrayHandler(void *context)
-{
-   CCJSONContext *pCtx = (CCJSONContext*)context;
+   /* Check whether a 'force refresh' file
+    * is present */
+   core_info_cache_get_path(file_path, info_dir,
+         FILE_PATH_CORE_INFO_CACHE_REFRESH, sizeof(file_path));
 
-   if ((pCtx->object_depth == 2) && (pCtx->array_depth == 2))
-      pCtx->to_firmware = false;
+   if (path_is_valid(file_path))
+      return NULL;
 
-   pCtx->array_depth--;
+   if (!(cache = (struct core_info_cache*)calloc(1, sizeof(*cache))))
+      return NULL;
 
-   return true;
-}
+   core_info_cache_get_path(file_path, info_dir,
+         FILE_PATH_CORE_INFO_CACHE, sizeof(file_path));
 
-/* JSON Handlers END */
-#endif
+#ifdef HAVE_MMAP
+   {
+      int fd = open(file_path, O_RDONLY);
 
-/* Note: 'dst' must be zero initialised, or memory
- * leaks will occur */
-static void core_info_copy(core_info_t *src, core_info_t *dst)
-{
-   dst->path                      = src->path                 ? strdup(src->path)                 : NULL;
-   dst->display_name              = src->display_name         ? strdup(src->display_name)         : NULL;
-   dst->display_version           = src->display_version      ? strdup(src->display_version)      : NULL;
-   dst->core_name                 = src->core_name            ? strdup(src->core_name)            : NULL;
-   dst->system_manufacturer       = src->system_manufacturer  ? strdup(src->system_manufacturer)  : NULL;
-   dst->systemname                = src->systemname           ? strdup(src->systemname)           : NULL;
-   dst->system_id                 = src->system_id            ? strdup(src->system_id)            : NULL;
-   dst->supported_extensions      = src->supported_extensions ? strdup(src->supported_extensions) : NULL;
-   dst->authors                   = src->authors              ? strdup(src->authors)              : NULL;
-   dst->permissions               = src->permissions          ? strdup(src->permissions)          : NULL;
-   dst->licenses                  = src->licenses             ? strdup(src->licenses)             : NULL;
-   dst->categories                = src->categories           ? strdup(src->categories)           : NULL;
-   dst->databases                 = src->databases            ? strdup(src->databases)            : NULL;
-   dst->notes                     = src->notes                ? strdup(src->notes)                : NULL;
-   dst->required_hw_api           = src->required_hw_api      ? strdup(src->required_hw_api)      : NULL;
-   dst->description               = src->description          ? strdup(src->description)          : NULL;
-
-   dst->categories_list           = src->categories_list           ? string_list_clone(src->categories_list)           : NULL;
-   dst->databases_list            = src->databases_list            ? string_list_clone(src->databases_list)            : NULL;
-   dst->note_list                 = src->note_list                 ? string_list_clone(src->note_list)                 : NULL;
-   dst->supported_extensions_list = src->supported_extensions_list ? string_list_clone(src->supported_extensions_list) : NULL;
-   dst->authors_list              = src->authors_list              ? string_list_clone(src->authors_list)              : NULL;
-   dst->permissions_list          = src->permissions_list          ? string_list_clone(src->permissions_list)          : NULL;
-   dst->licenses_list             = src->licenses_list             ? string_list_clone(src->licenses_list)             : NULL;
-   dst->required_hw_api_list      = src->required_hw_api_list      ? string_list_clone(src->required_hw_api_list)      : NULL;
-
-   if (src->firmware_count > 0)
-   {
-      dst->firmware = (core_info_firmware_t*)calloc(src->firmware_count,
-            sizeof(core_info_firmware_t));
-
-      if (dst->firmware)
+      if (fd >= 0)
       {
-         size_t i;
-
-         dst->firmware_count = src->firmware_count;
+         off_t size = lseek(fd, 0, SEEK_END);
 
-         for (i = 0; i < src->firmware_count; i++)
+         if (size >= (off_t)sizeof(*header))
          {
-            dst->firmware[i].path     = src->firmware[i].path ? strdup(src->firmware[i].path) : NULL;
-            dst->firmware[i].desc     = src->firmware[i].desc ? strdup(src->firmware[i].desc) : NULL;
-            dst->firmware[i].missing  = src->firmware[i].missing;
-            dst->firmware[i].optional = src->firmware[i].optional;
+            void *data = mmap(NULL, (size_t)size, PROT_READ,
+                  MAP_SHARED, fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+               cache->data   = (uint8_t*)data;
+               cache->size   = (size_t)size;
+               cache->mapped = true;
+            }
          }
+
+         close(fd);
       }
-      else
-         dst->firmware_count = 0;
    }
+#endif
 
-   dst->core_file_id.str              = src->core_file_id.str
-      ? strdup(src->core_file_id.str) : NULL;
-   dst->core_file_id.hash             = src->core_file_id.hash;
-
-   dst->savestate_support_level       = src->savestate_support_level;
-   dst->has_info                      = src->has_info;
-   dst->supports_no_game              = src->supports_no_game;
-   dst->single_purpose                = src->single_purpose;
-   dst->database_match_archive_member = src->database_match_archive_member;
-   dst->is_experimental               = src->is_experimental;
-   dst->is_locked                     = src->is_locked;
-   dst->is_standalone_exempt          = src->is_standalone_exempt;
-   dst->is_installed                  = src->is_installed;
-}
-
-/* Like core_info_copy, but transfers 'ownership'
- * of internal objects/data structures from 'src'
- * to 'dst' */
-static void core_info_transfer(core_info_t *src, core_info_t *dst)
-{
-   dst->path                      = src->path;
-   src->path                      = NULL;
-
-   dst->display_name              = src->display_name;
-   src->display_name              = NULL;
-
-   dst->display_version           = src->display_version;
-   src->display_version           = NULL;
-
-   dst->core_name                 = src->core_name;
-   src->core_name                 = NULL;
-
-   dst->system_manufacturer       = src->system_manufacturer;
-   src->system_manufacturer       = NULL;
-
-   dst->systemname                = src->systemname;
-   src->systemname                = NULL;
-
-   dst->system_id                 = src->system_id;
-   src->system_id                 = NULL;
-
-   dst->supported_extensions      = src->supported_extensions;
-   src->supported_extensions      = NULL;
-
-   dst->authors                   = src->authors;
-   src->authors                   = NULL;
-
-   dst->permissions               = src->permissions;
-   src->permissions               = NULL;
-
-   dst->licenses                  = src->licenses;
-   src->licenses                  = NULL;
-
-   dst->categories                = src->categories;
-   src->categories                = NULL;
-
-   dst->databases                 = src->databases;
-   src->databases                 = NULL;
-
-   dst->notes                     = src->notes;
-   src->notes                     = NULL;
-
-   dst->required_hw_api           = src->required_hw_api;
-   src->required_hw_api           = NULL;
-
-   dst->description               = src->description;
-   src->description               = NULL;
-
-   dst->categories_list           = src->categories_list;
-   src->categories_list           = NULL;
+   if (!cache->data)
+   {
+      void *data  = NULL;
+      int64_t len = 0;
 
-   dst->databases_list            = src->databases_list;
-   src->databases_list            = NULL;
+      if (     !path_is_valid(file_path)
+            || !filestream_read_file(file_path, &data, &len))
+         goto error;
 
-   dst->note_list                 = src->note_list;
-   src->note_list                 = NULL;
+      cache->data = (uint8_t*)data;
+      cache->size = (size_t)len;
+   }
 
-   dst->supported_extensions_list = src->supported_extensions_list;
-   src->supported_extensions_list = NULL;
+   /* Validate */
+   header = (const core_info_cache_header_t*)cache->data;
 
-   dst->authors_list              = src->authors_list;
-   src->authors_list              = NULL;
+   if (     (cache->size < sizeof(*header))
+         || (header->magic         != CORE_INFO_CACHE_MAGIC)
+         || (header->version       != CORE_INFO_CACHE_VERSION)
+         || (header->core_size     != sizeof(core_info_cache_core_t))
+         || (header->firmware_size != sizeof(core_info_cache_firmware_t))
+         || (header->strings_size  == 0)
+         || (cache->size != sizeof(*header)
+               + (size_t)header->num_cores    * sizeof(core_info_cache_core_t)
+               + (size_t)header->num_firmware * sizeof(core_info_cache_firmware_t)
+               + header->strings_size))
+   {
+      RARCH_WARN("[Core Info]: Core info cache is invalid - forcing refresh.\n");
+      goto error;
+   }
 
-   dst->permissions_list          = src->permissions_list;
-   src->permissions_list          = NULL;
+   cache->num_cores    = header->num_cores;
+   cache->num_firmware = header->num_firmware;
+   cache->strings_size = header->strings_size;
+   cache->cores        = (const core_info_cache_core_t*)(header + 1);
+   cache->firmware     = (const core_info_cache_firmware_t*)
+      (cache->cores + cache->num_cores);
+   cache->strings      = (const char*)(cache->firmware + cache->num_firmware);
 
-   dst->licenses_list             = src->licenses_list;
-   src->licenses_list             = NULL;
+   if (cache->strings[cache->strings_size - 1] != '\0')
+      goto error;
 
-   dst->required_hw_api_list      = src->required_hw_api_list;
-   src->required_hw_api_list      = NULL;
+   return cache;
 
-   dst->firmware                  = src->firmware;
-   dst->firmware_count            = src->firmware_count;
-   src->firmware                  = NULL;
-   src->firmware_count            = 0;
+error:
+   core_info_cache_free(cache);
+   return NULL;
+}
+#endif
 
-   dst->core_file_id.str              = src->core_file_id.str;
-   src->core_file_id.str              = NULL;
-   dst->core_file_id.hash             = src->core_file_id.hash;
+/* Fills 'info' from a cache record. Strings are
+ * not duplicated, and the fields that are decoded
+ * lazily are left unset */
+static void core_info_cache_load_core(
+      const struct core_info_cache *cache,
+      const core_info_cache_core_t *record, core_info_t *info)
+{
+   info->core_file_id.str              = core_info_cache_get_string(cache, record->core_file_id);
+   info->core_file_id.hash             = record->core_file_id_hash;
+   info->display_name                  = core_info_cache_get_string(cache, record->display_name);
+   info->display_version               = core_info_cache_get_string(cache, record->display_version);
+   info->core_name                     = core_info_cache_get_string(cache, record->core_name);
+   info->system_manufacturer           = core_info_cache_get_string(cache, record->system_manufacturer);
+   info->systemname                    = core_info_cache_get_string(cache, record->systemname);
+   info->system_id                     = core_info_cache_get_string(cache, record->system_id);
+   info->supported_extensions          = core_info_cache_get_string(cache, record->supported_extensions);
+   info->authors                       = core_info_cache_get_string(cache, record->authors);
+   info->permissions                   = core_info_cache_get_string(cache, record->permissions);
+   info->licenses                      = core_info_cache_get_string(cache, record->licenses);
+   info->categories                    = core_info_cache_get_string(cache, record->categories);
+   info->databases                     = core_info_cache_get_string(cache, record->databases);
+   info->notes                         = core_info_cache_get_string(cache, record->notes);
+   info->required_hw_api               = core_info_cache_get_string(cache, record->required_hw_api);
+   info->description                   = core_info_cache_get_string(cache, record->description);
+
+   /* Needed to match content against cores, which
+    * happens long before most cores are looked up */
+   if (info->supported_extensions)
+      info->supported_extensions_list  =
+            string_split(info->supported_extensions, "|");
 
-   dst->savestate_support_level       = src->savestate_support_level;
-   dst->has_info                      = src->has_info;
-   dst->supports_no_game              = src->supports_no_game;
-   dst->single_purpose                = src->single_purpose;
-   dst->database_match_archive_member = src->database_match_archive_member;
-   dst->is_experimental               = src->is_experimental;
-   dst->is_locked                     = src->is_locked;
-   dst->is_standalone_exempt          = src->is_standalone_exempt;
-   dst->is_installed                  = src->is_installed;
+   info->savestate_support_level       = record->savestate_support_level;
+   info->has_info                      = (record->flags & CORE_INFO_CACHE_FLG_HAS_INFO)                      != 0;
+   info->supports_no_game              = (record->flags & CORE_INFO_CACHE_FLG_SUPPORTS_NO_GAME)              != 0;
+   info->single_purpose                = (record->flags & CORE_INFO_CACHE_FLG_SINGLE_PURPOSE)                != 0;
+   info->database_match_archive_member = (record->flags & CORE_INFO_CACHE_FLG_DATABASE_MATCH_ARCHIVE_MEMBER) != 0;
+   info->is_experimental               = (record->flags & CORE_INFO_CACHE_FLG_IS_EXPERIMENTAL)               != 0;
+   info->lazy_fields_pending           = true;
 }
 
-static void core_info_cache_list_free(
-      core_info_cache_list_t *core_info_cache_list)
+/**
+ * core_info_resolve_lazy_fields:
+ * @list                : Core info list holding @info.
+ * @info                : Core info entry.
+ *
+ * Decodes the fields of a core that was loaded from
+ * the core info cache which are only needed once the
+ * core is looked up - the string lists other than the
+ * supported extensions, and the firmware. Every
+ * function that hands out core info entries calls
+ * this first, so that callers always see them.
+ *
+ * Lookups run on task threads too, so the check and
+ * the decoding happen with the list's 'lazy_lock'
+ * held. Whoever gets the lock first decodes; any
+ * other caller waits, then sees the finished fields.
+ **/
+static void core_info_resolve_lazy_fields(
+      core_info_list_t *list, core_info_t *info)
 {
-   size_t i;
+   const core_info_cache_core_t *record = NULL;
 
-   if (!core_info_cache_list)
+   if (!info)
       return;
 
-   for (i = 0; i < core_info_cache_list->length; i++)
-   {
-      core_info_t* info = (core_info_t*)&core_info_cache_list->items[i];
-      core_info_free(info);
-   }
-
-   free(core_info_cache_list->items);
-
-   if (core_info_cache_list->version)
-      free(core_info_cache_list->version);
-
-   free(core_info_cache_list);
-}
+#ifdef HAVE_THREADS
+   if (list)
+      slock_lock(list->lazy_lock);
+#endif
 
-static core_info_t *core_info_cache_find(
-      core_info_cache_list_t *list, char *core_file_id)
-{
-   uint32_t hash;
-   size_t i;
+   if (!info->lazy_fields_pending)
+      goto end;
 
-   if (  !list
-       || string_is_empty(core_file_id))
-      return NULL;
+   info->lazy_fields_pending = false;
 
-   hash = core_info_hash_string(core_file_id);
+   if (info->authors)
+      info->authors_list         = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list     = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list        = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list      = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list       = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list            = string_split(info->notes, "|");
+   if (info->required_hw_api)
+      info->required_hw_api_list = string_split(info->required_hw_api, "|");
+
+   if (     list
+         && (record = core_info_cache_find(list->cache,
+               info->core_file_id.hash, info->core_file_id.str))
+         && record->firmware_count
+         && ((size_t)record->firmware + record->firmware_count
+               <= list->cache->num_firmware))
+   {
+      core_info_firmware_t *firmware = (core_info_firmware_t*)calloc(
+            record->firmware_count, sizeof(*firmware));
+
+      if (firmware)
+      {
+         uint32_t i;
 
-   for (i = 0; i < list->length; i++)
-   {
-      core_info_t *info = (core_info_t*)&list->items[i];
+         for (i = 0; i < record->firmware_count; i++)
+         {
+            const core_info_cache_firmware_t *fw =
+               &list->cache->firmware[record->firmware + i];
 
-      if (!info)
-         continue;
+            firmware[i].path     = core_info_cache_get_string(list->cache, fw->path);
+            firmware[i].desc     = core_info_cache_get_string(list->cache, fw->desc);
+            firmware[i].optional = (fw->optional != 0);
+         }
 
-      if (  (info->core_file_id.hash == hash)
-          && string_is_equal(info->core_file_id.str, core_file_id))
-      {
-         info->is_installed = true;
-         return info;
+         info->firmware       = firmware;
+         info->firmware_count = record->firmware_count;
       }
    }
 
-   return NULL;
+end:
+#ifdef HAVE_THREADS
+   if (list)
+      slock_unlock(list->lazy_lock);
+#endif
+   return;
 }
 
-static void core_info_cache_add(
-      core_info_cache_list_t *list, core_info_t *info,
-      bool transfer)
+#ifdef HAVE_CORE_INFO_CACHE
+/* Adds 'str' to the string table, unless it is
+ * already there. Returns its offset */
+static uint32_t core_info_cache_add_string(
+      core_info_cache_strings_t *strings, const char *str)
 {
-   core_info_t *info_cache = NULL;
+   size_t len;
+   uint32_t offset;
 
-   if (   !list
-       || !info
-       || (info->core_file_id.hash == 0)
-       || string_is_empty(info->core_file_id.str))
-      return;
+   if (!str)
+      return 0;
+
+   if ((offset = RHMAP_GET_STR(strings->map, str)))
+      return offset;
+
+   len = strlen(str) + 1;
 
-   if (list->length >= list->capacity)
+   if (strings->size + len > strings->capacity)
    {
-      size_t prev_capacity   = list->capacity;
-      core_info_t *items_tmp = (core_info_t*)realloc(list->items,
-            (list->capacity << 1) * sizeof(core_info_t));
+      size_t capacity = strings->capacity;
+      char *data      = NULL;
 
-      if (!items_tmp)
-         return;
+      while (strings->size + len > capacity)
+         capacity <<= 1;
 
-      list->capacity         = list->capacity << 1;
-      list->items            = items_tmp;
+      if (!(data = (char*)realloc(strings->data, capacity)))
+      {
+         strings->oom = true;
+         return 0;
+      }
 
-      memset(&list->items[prev_capacity], 0,
-            (list->capacity - prev_capacity) * sizeof(core_info_t));
+      strings->data     = data;
+      strings->capacity = capacity;
    }
 
-   info_cache = (core_info_t*)&list->items[list->length];
+   offset         = (uint32_t)strings->size;
+   memcpy(strings->data + strings->size, str, len);
+   strings->size += len;
 
-   if (transfer)
-      core_info_transfer(info, info_cache);
-   else
-      core_info_copy(info, info_cache);
+   RHMAP_SET_STR(strings->map, str, offset);
 
-   list->length++;
+   return offset;
 }
 
-#ifdef HAVE_CORE_INFO_CACHE
-static core_info_cache_list_t *core_info_cache_list_new(void)
+static int core_info_cache_cmp(const void *a_, const void *b_)
 {
-   core_info_cache_list_t *core_info_cache_list =
-      (core_info_cache_list_t *)malloc(sizeof(*core_info_cache_list));
-   if (!core_info_cache_list)
-      return NULL;
-
-   core_info_cache_list->length = 0;
-   core_info_cache_list->items  = (core_info_t *)
-      calloc(CORE_INFO_CACHE_DEFAULT_CAPACITY,
-            sizeof(core_info_t));
-
-   if (!core_info_cache_list->items)
-   {
-      core_info_cache_list_free(core_info_cache_list);
-      return NULL;
-   }
+   const core_info_t *a = *(const core_info_t**)a_;
+   const core_info_t *b = *(const core_info_t**)b_;
 
-   core_info_cache_list->capacity = CORE_INFO_CACHE_DEFAULT_CAPACITY;
-   core_info_cache_list->refresh  = false;
-   core_info_cache_list->version  = NULL;
-
-   return core_info_cache_list;
+   if (a->core_file_id.hash != b->core_file_id.hash)
+      return (a->core_file_id.hash < b->core_file_id.hash) ? -1 : 1;
+   return strcmp(a->core_file_id.str, b->core_file_id.str);
 }
 
-static core_info_cache_list_t *core_info_cache_read(const char *info_dir)
+/**
+ * core_info_cache_write:
+ * @list                : Core info list.
+ * @info_dir            : Core info directory.
+ *
+ * (Re)generates the core info cache in @info_dir from
+ * the installed cores of @list. The cache is written
+ * under a temporary name first, then renamed over the
+ * old one - which @list may still have mapped.
+ *
+ * Returns true if successful.
+ **/
+static bool core_info_cache_write(core_info_list_t *list,
+      const char *info_dir)
 {
-   intfstream_t *file                           = NULL;
-   rjson_t *parser                              = NULL;
-   CCJSONContext context                        = {0};
-   core_info_cache_list_t *core_info_cache_list = NULL;
+   size_t i, num_cores;
+   core_info_cache_header_t header;
    char file_path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   core_info_cache_strings_t strings     = {0};
+   core_info_t **sorted                  = NULL;
+   core_info_cache_core_t *records       = NULL;
+   core_info_cache_firmware_t *firmware  = NULL;
+   RFILE *file                           = NULL;
+   bool success                          = false;
 
-   /* Check whether a 'force refresh' file
-    * is present */
-   if (string_is_empty(info_dir))
-      strlcpy(file_path,
-            FILE_PATH_CORE_INFO_CACHE_REFRESH, sizeof(file_path));
-   else
-      fill_pathname_join_special(file_path,
-            info_dir, FILE_PATH_CORE_INFO_CACHE_REFRESH,
-            sizeof(file_path));
-
-   if (path_is_valid(file_path))
-      return core_info_cache_list_new();
+   if (!list)
+      return false;
 
-   /* Open info cache file */
-   if (string_is_empty(info_dir))
-      strlcpy(file_path, FILE_PATH_CORE_INFO_CACHE, sizeof(file_path));
-   else
-      fill_pathname_join_special(file_path, info_dir,
-            FILE_PATH_CORE_INFO_CACHE,
-            sizeof(file_path));
+   memset(&header, 0, sizeof(header));
 
-#if defined(HAVE_ZLIB)
-   file = intfstream_open_rzip_file(file_path,
-         RETRO_VFS_FILE_ACCESS_READ);
-#else
-   file = intfstream_open_file(file_path,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-#endif
+   if (     list->count
+         && (!(sorted  = (core_info_t**)malloc(list->count * sizeof(*sorted)))
+          || !(records = (core_info_cache_core_t*)calloc(list->count, sizeof(*records)))))
+      goto end;
 
-   if (!file)
-      return core_info_cache_list_new();
+   /* Offset 0 stands for 'no string' */
+   if (!(strings.data = (char*)malloc(16384)))
+      goto end;
+   strings.data[0]  = '\0';
+   strings.size     = 1;
+   strings.capacity = 16384;
 
-   /* Parse info cache file */
-   if (!(parser = rjson_open_stream(file)))
+   /* Records are looked up by core file id hash */
+   for (i = 0, num_cores = 0; i < list->count; i++)
    {
-      RARCH_ERR("[Core Info]: Failed to create JSON parser.\n");
-      goto end;
-   }
+      core_info_t *info = &list->list[i];
 
-   rjson_set_options(parser,
-           RJSON_OPTION_ALLOW_UTF8BOM
-         | RJSON_OPTION_ALLOW_COMMENTS
-         | RJSON_OPTION_ALLOW_UNESCAPED_CONTROL_CHARACTERS
-         | RJSON_OPTION_REPLACE_INVALID_ENCODING);
-
-   if (rjson_parse(parser, &context,
-         CCJSONObjectMemberHandler,
-         CCJSONStringHandler,
-         CCJSONNumberHandler,
-         CCJSONStartObjectHandler,
-         CCJSONEndObjectHandler,
-         CCJSONStartArrayHandler,
-         CCJSONEndArrayHandler,
-         CCJSONBoolHandler,
-         NULL) /* Unused null handler */
-         != RJSON_DONE)
-   {
-      RARCH_WARN("[Core Info]: Error parsing chunk:\n---snip---\n%.*s\n---snip---\n",
-            rjson_get_source_context_len(parser),
-            rjson_get_source_context_buf(parser));
-      RARCH_WARN("[Core Info]: Error: Invalid JSON at line %d, column %d - %s.\n",
-            (int)rjson_get_source_line(parser),
-            (int)rjson_get_source_column(parser),
-            (*rjson_get_error(parser)
-             ? rjson_get_error(parser)
-             : "format error"));
-
-      /* Info cache is corrupt - discard it */
-      core_info_cache_list_free(context.core_info_cache_list);
-      core_info_cache_list = core_info_cache_list_new();
+      if (     info->is_installed
+            && !string_is_empty(info->core_file_id.str))
+         sorted[num_cores++] = info;
    }
-   else
-      core_info_cache_list = context.core_info_cache_list;
 
-   rjson_free(parser);
+   if (num_cores > 1)
+      qsort(sorted, num_cores, sizeof(*sorted), core_info_cache_cmp);
 
-   /* Clean up leftovers in the event of
-    * a parsing error */
-   if (context.core_info)
+   for (i = 0; i < num_cores; i++)
    {
-      core_info_free(context.core_info);
-      free(context.core_info);
-   }
+      size_t j;
+      core_info_t *info               = sorted[i];
+      core_info_cache_core_t *record  = &records[header.num_cores];
 
-   if (!core_info_cache_list)
-      goto end;
+      /* Several core files may share one id */
+      if (i && core_info_cache_cmp(&sorted[i - 1], &sorted[i]) == 0)
+         continue;
 
-   /* If info cache file has the wrong version
-    * number, discard it */
-   if (    string_is_empty(core_info_cache_list->version)
-       || !string_is_equal(core_info_cache_list->version,
-            CORE_INFO_CACHE_VERSION))
-   {
-      RARCH_WARN("[Core Info]: Core info cache has invalid version"
-            " - forcing refresh (required v%s, found v%s).\n",
-            CORE_INFO_CACHE_VERSION,
-            core_info_cache_list->version);
+      core_info_resolve_lazy_fields(list, info);
+
+      record->core_file_id_hash       = info->core_file_id.hash;
+      record->core_file_id            = core_info_cache_add_string(&strings, info->core_file_id.str);
+      record->display_name            = core_info_cache_add_string(&strings, info->display_name);
+      record->display_version         = core_info_cache_add_string(&strings, info->display_version);
+      record->core_name               = core_info_cache_add_string(&strings, info->core_name);
+      record->system_manufacturer     = core_info_cache_add_string(&strings, info->system_manufacturer);
+      record->systemname              = core_info_cache_add_string(&strings, info->systemname);
+      record->system_id               = core_info_cache_add_string(&strings, info->system_id);
+      record->supported_extensions    = core_info_cache_add_string(&strings, info->supported_extensions);
+      record->authors                 = core_info_cache_add_string(&strings, info->authors);
+      record->permissions             = core_info_cache_add_string(&strings, info->permissions);
+      record->licenses                = core_info_cache_add_string(&strings, info->licenses);
+      record->categories              = core_info_cache_add_string(&strings, info->categories);
+      record->databases               = core_info_cache_add_string(&strings, info->databases);
+      record->notes                   = core_info_cache_add_string(&strings, info->notes);
+      record->required_hw_api         = core_info_cache_add_string(&strings, info->required_hw_api);
+      record->description             = core_info_cache_add_string(&strings, info->description);
+      record->savestate_support_level = info->savestate_support_level;
+      record->firmware                = header.num_firmware;
+      record->firmware_count          = (uint32_t)info->firmware_count;
+
+      if (info->has_info)
+         record->flags |= CORE_INFO_CACHE_FLG_HAS_INFO;
+      if (info->supports_no_game)
+         record->flags |= CORE_INFO_CACHE_FLG_SUPPORTS_NO_GAME;
+      if (info->single_purpose)
+         record->flags |= CORE_INFO_CACHE_FLG_SINGLE_PURPOSE;
+      if (info->database_match_archive_member)
+         record->flags |= CORE_INFO_CACHE_FLG_DATABASE_MATCH_ARCHIVE_MEMBER;
+      if (info->is_experimental)
+         record->flags |= CORE_INFO_CACHE_FLG_IS_EXPERIMENTAL;
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         core_info_cache_firmware_t fw;
 
-      core_info_cache_list_free(context.core_info_cache_list);
-      core_info_cache_list = core_info_cache_list_new();
-   }
+         fw.path     = core_info_cache_add_string(&strings, info->firmware[j].path);
+         fw.desc     = core_info_cache_add_string(&strings, info->firmware[j].desc);
+         fw.optional = info->firmware[j].optional ? 1 : 0;
+         fw.reserved = 0;
 
-end:
-   intfstream_close(file);
-   free(file);
+         if (!RBUF_TRYFIT(firmware, RBUF_LEN(firmware) + 1))
+            goto end;
+         RBUF_PUSH(firmware, fw);
+      }
 
-   return core_info_cache_list;
-}
-#endif
+      header.num_firmware += (uint32_t)info->firmware_count;
+      header.num_cores++;
+   }
 
-static bool core_info_cache_write(core_info_cache_list_t *list, const char *info_dir)
-{
-   intfstream_t *file    = NULL;
-   rjsonwriter_t *writer = NULL;
-   bool success          = false;
-   char file_path[PATH_MAX_LENGTH];
-   size_t i, j;
+   header.magic         = CORE_INFO_CACHE_MAGIC;
+   header.version       = CORE_INFO_CACHE_VERSION;
+   header.core_size     = sizeof(core_info_cache_core_t);
+   header.firmware_size = sizeof(core_info_cache_firmware_t);
+   header.strings_size  = (uint32_t)strings.size;
 
-   if (!list)
-      return false;
+   /* Offsets are 32 bit */
+   if (strings.oom || ((uint64_t)strings.size != header.strings_size))
+      goto end;
 
-   /* Open info cache file */
-   if (string_is_empty(info_dir))
-      strlcpy(file_path, FILE_PATH_CORE_INFO_CACHE, sizeof(file_path));
-   else
-      fill_pathname_join_special(file_path, info_dir,
-            FILE_PATH_CORE_INFO_CACHE,
-            sizeof(file_path));
+   core_info_cache_get_path(file_path, info_dir,
+         FILE_PATH_CORE_INFO_CACHE, sizeof(file_path));
+   strlcpy(tmp_path, file_path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp",    sizeof(tmp_path));
 
-#if defined(CORE_INFO_CACHE_COMPRESS)
-   file = intfstream_open_rzip_file(file_path,
-         RETRO_VFS_FILE_ACCESS_WRITE);
-#else
-   file = intfstream_open_file(file_path,
-         RETRO_VFS_FILE_ACCESS_WRITE,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE);
-#endif
-
-   if (!file)
+   if (!(file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
    {
       RARCH_ERR("[Core Info]: Failed to write core info cache file: \"%s\".\n", file_path);
-      return false;
-   }
-
-   /* Write info cache */
-   if (!(writer = rjsonwriter_open_stream(file)))
-   {
-      RARCH_ERR("[Core Info]: Failed to create JSON writer.\n");
       goto end;
    }
 
-#if defined(CORE_INFO_CACHE_COMPRESS)
-   /* When compressing info cache, human readability
-    * is not a factor - can skip all indentation
-    * and new line characters */
-   rjsonwriter_set_options(writer, RJSONWRITER_OPTION_SKIP_WHITESPACE);
-#endif
-
-   rjsonwriter_raw(writer, "{", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_add_spaces(writer, 2);
-   rjsonwriter_add_string(writer, "version");
-   rjsonwriter_raw(writer, ":", 1);
-   rjsonwriter_raw(writer, " ", 1);
-   rjsonwriter_add_string(writer, CORE_INFO_CACHE_VERSION);
-   rjsonwriter_raw(writer, ",", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_add_spaces(writer, 2);
-   rjsonwriter_add_string(writer, "items");
-   rjsonwriter_raw(writer, ":", 1);
-   rjsonwriter_raw(writer, " ", 1);
-   rjsonwriter_raw(writer, "[", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-
-   for (i = 0; i < list->length; i++)
-   {
-      core_info_t* info = &list->items[i];
-
-      if (!info || !info->is_installed)
-         continue;
-
-      if (i > 0)
-      {
-         rjsonwriter_raw(writer, ",", 1);
-         rjsonwriter_raw(writer, "\n", 1);
-      }
-
-      rjsonwriter_add_spaces(writer, 4);
-      rjsonwriter_raw(writer, "{", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "display_name");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->display_name);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "display_version");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->display_version);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "core_name");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->core_name);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "system_manufacturer");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->system_manufacturer);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "systemname");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->systemname);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "system_id");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->system_id);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "supported_extensions");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->supported_extensions);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "authors");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->authors);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "permissions");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->permissions);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "licenses");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->licenses);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "categories");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->categories);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "databases");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->databases);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "notes");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->notes);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "required_hw_api");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->required_hw_api);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "description");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->description);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      if (info->firmware_count > 0)
-      {
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_add_string(writer, "firmware");
-         rjsonwriter_raw(writer, ":", 1);
-         rjsonwriter_raw(writer, " ", 1);
-         rjsonwriter_raw(writer, "[", 1);
-         rjsonwriter_raw(writer, "\n", 1);
-
-         for (j = 0; j < info->firmware_count; j++)
-         {
-            rjsonwriter_add_spaces(writer, 8);
-            rjsonwriter_raw(writer, "{", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 10);
-            rjsonwriter_add_string(writer, "path");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_add_string(writer, info->firmware[j].path);
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 10);
-            rjsonwriter_add_string(writer, "desc");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            rjsonwriter_add_string(writer, info->firmware[j].desc);
-            rjsonwriter_raw(writer, ",", 1);
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 10);
-            rjsonwriter_add_string(writer, "optional");
-            rjsonwriter_raw(writer, ":", 1);
-            rjsonwriter_raw(writer, " ", 1);
-            {
-               bool value = info->firmware[j].optional;
-               rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-            }
-            rjsonwriter_raw(writer, "\n", 1);
-            rjsonwriter_add_spaces(writer, 8);
-            rjsonwriter_raw(writer, "}", 1);
-
-            if (j < info->firmware_count - 1)
-               rjsonwriter_raw(writer, ",", 1);
-
-            rjsonwriter_raw(writer, "\n", 1);
-         }
-
-         rjsonwriter_add_spaces(writer, 6);
-         rjsonwriter_raw(writer, "]", 1);
-         rjsonwriter_raw(writer, ",", 1);
-         rjsonwriter_raw(writer, "\n", 1);
-      }
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "core_file_id");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_raw(writer, "{", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 8);
-      rjsonwriter_add_string(writer, "str");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_add_string(writer, info->core_file_id.str);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 8);
-      rjsonwriter_add_string(writer, "hash");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_rawf(writer, "%u", info->core_file_id.hash);
-      rjsonwriter_raw(writer, "\n", 1);
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_raw(writer, "}", 1);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "firmware_count");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_rawf(writer, "%u", info->firmware_count);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "savestate_support_level");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      rjsonwriter_rawf(writer, "%u", info->savestate_support_level);
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "has_info");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->has_info;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "supports_no_game");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->supports_no_game;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
+   success =
+         (filestream_write(file, &header, sizeof(header))
+            == (int64_t)sizeof(header))
+      && (filestream_write(file, records,
+               header.num_cores * sizeof(*records))
+            == (int64_t)(header.num_cores * sizeof(*records)))
+      && (filestream_write(file, firmware, RBUF_SIZEOF(firmware))
+            == (int64_t)RBUF_SIZEOF(firmware))
+      && (filestream_write(file, strings.data, strings.size)
+            == (int64_t)strings.size);
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "single_purpose");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->single_purpose;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "database_match_archive_member");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
-      {
-         bool value = info->database_match_archive_member;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
-      }
-      rjsonwriter_raw(writer, ",", 1);
-      rjsonwriter_raw(writer, "\n", 1);
+   if (filestream_close(file) != 0)
+      success = false;
 
-      rjsonwriter_add_spaces(writer, 6);
-      rjsonwriter_add_string(writer, "is_experimental");
-      rjsonwriter_raw(writer, ":", 1);
-      rjsonwriter_raw(writer, " ", 1);
+   if (success)
+   {
+      /* Renaming over an existing file fails on some
+       * platforms - fall back to deleting it first */
+      if (filestream_rename(tmp_path, file_path) != 0)
       {
-         bool value = info->is_experimental;
-         rjsonwriter_raw(writer, (value ? "true" : "false"), (value ? 4 : 5));
+         filestream_delete(file_path);
+         success = (filestream_rename(tmp_path, file_path) == 0);
       }
-      rjsonwriter_raw(writer, "\n", 1);
-
-      rjsonwriter_add_spaces(writer, 4);
-      rjsonwriter_raw(writer, "}", 1);
    }
 
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_add_spaces(writer, 2);
-   rjsonwriter_raw(writer, "]", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_raw(writer, "}", 1);
-   rjsonwriter_raw(writer, "\n", 1);
-   rjsonwriter_free(writer);
+   if (!success)
+   {
+      RARCH_ERR("[Core Info]: Failed to write core info cache file: \"%s\".\n", file_path);
+      filestream_delete(tmp_path);
+      goto end;
+   }
 
    RARCH_LOG("[Core Info]: Wrote to cache file: \"%s\".\n", file_path);
-   success = true;
 
    /* Remove 'force refresh' file, if required */
-   if (string_is_empty(info_dir))
-      strlcpy(file_path,
-            FILE_PATH_CORE_INFO_CACHE_REFRESH, sizeof(file_path));
-   else
-      fill_pathname_join_special(file_path,
-            info_dir, FILE_PATH_CORE_INFO_CACHE_REFRESH,
-            sizeof(file_path));
+   core_info_cache_get_path(file_path, info_dir,
+         FILE_PATH_CORE_INFO_CACHE_REFRESH, sizeof(file_path));
 
    if (path_is_valid(file_path))
       filestream_delete(file_path);
 
 end:
-   intfstream_close(file);
-   free(file);
-
-   list->refresh = false;
+   RHMAP_FREE(strings.map);
+   RBUF_FREE(firmware);
+   free(strings.data);
+   free(records);
+   free(sorted);
    return success;
 }
-
-static void core_info_check_uninstalled(core_info_cache_list_t *list)
-{
-   size_t i;
-
-   if (!list)
-      return;
-
-   for (i = 0; i < list->length; i++)
-   {
-      core_info_t *info = (core_info_t *)&list->items[i];
-
-      if (!info)
-         continue;
-
-      if (!info->is_installed)
-      {
-         list->refresh = true;
-         return;
-      }
-   }
-}
+#endif
 
 /* When called, generates a temporary file
  * that will force an info cache refresh the
@@ -1881,6 +1384,9 @@ static void core_info_parse_config_file(
             else if (string_is_equal(entry->value, "serialized"))
                info->savestate_support_level =
                      CORE_INFO_SAVESTATE_SERIALIZED;
+            else if (string_is_equal(entry->value, "snapshot"))
+               info->savestate_support_level =
+                     CORE_INFO_SAVESTATE_SNAPSHOT;
          }
       }
       else
@@ -1932,26 +1438,27 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_free(core_info_t* info)
+static void core_info_free(core_info_list_t *list, core_info_t *info)
 {
    size_t i;
+   const struct core_info_cache *cache = list ? list->cache : NULL;
 
    free(info->path);
-   free(info->core_name);
-   free(info->systemname);
-   free(info->system_id);
-   free(info->system_manufacturer);
-   free(info->display_name);
-   free(info->display_version);
-   free(info->supported_extensions);
-   free(info->authors);
-   free(info->permissions);
-   free(info->licenses);
-   free(info->categories);
-   free(info->databases);
-   free(info->notes);
-   free(info->required_hw_api);
-   free(info->description);
+   core_info_free_string(cache, info->core_name);
+   core_info_free_string(cache, info->systemname);
+   core_info_free_string(cache, info->system_id);
+   core_info_free_string(cache, info->system_manufacturer);
+   core_info_free_string(cache, info->display_name);
+   core_info_free_string(cache, info->display_version);
+   core_info_free_string(cache, info->supported_extensions);
+   core_info_free_string(cache, info->authors);
+   core_info_free_string(cache, info->permissions);
+   core_info_free_string(cache, info->licenses);
+   core_info_free_string(cache, info->categories);
+   core_info_free_string(cache, info->databases);
+   core_info_free_string(cache, info->notes);
+   core_info_free_string(cache, info->required_hw_api);
+   core_info_free_string(cache, info->description);
    string_list_free(info->supported_extensions_list);
    string_list_free(info->authors_list);
    string_list_free(info->note_list);
@@ -1963,16 +1470,25 @@ static void core_info_free(core_info_t* info)
 
    for (i = 0; i < info->firmware_count; i++)
    {
-      if (info->firmware[i].path)
-         free(info->firmware[i].path);
-      if (info->firmware[i].desc)
-         free(info->firmware[i].desc);
+      core_info_free_string(cache, info->firmware[i].path);
+      core_info_free_string(cache, info->firmware[i].desc);
       info->firmware[i].path = NULL;
       info->firmware[i].desc = NULL;
    }
    free(info->firmware);
 
-   free(info->core_file_id.str);
+   core_info_free_string(cache, info->core_file_id.str);
+}
+
+static void core_info_index_free(core_info_index_t *map)
+{
+   size_t i;
+
+   for (i = 0; i < RHMAP_CAP(map); i++)
+      if (RHMAP_KEY(map, i))
+         RBUF_FREE(map[i].cores);
+
+   RHMAP_FREE(map);
 }
 
 static void core_info_list_free(core_info_list_t *core_info_list)
@@ -1985,14 +1501,148 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    for (i = 0; i < core_info_list->count; i++)
    {
       core_info_t *info = (core_info_t*)&core_info_list->list[i];
-      core_info_free(info);
+      core_info_free(core_info_list, info);
    }
 
+   core_info_index_free(core_info_list->ext_map);
+   core_info_index_free(core_info_list->db_map);
+   core_info_cache_free(core_info_list->cache);
+#ifdef HAVE_THREADS
+   slock_free(core_info_list->lazy_lock);
+#endif
    free(core_info_list->all_ext);
    free(core_info_list->list);
    free(core_info_list);
 }
 
+/* Adds 'core_file_id' to the entry of 'map' for
+ * each of the '|' separated 'values'. Returns the
+ * (possibly reallocated) map */
+static core_info_index_t *core_info_index_add(core_info_index_t *map,
+      const char *values, const char *core_file_id,
+      bool match_archive_member)
+{
+   const char *s = values;
+
+   if (string_is_empty(s))
+      return map;
+
+   while (*s)
+   {
+      size_t _len              = 0;
+      core_info_index_t *entry = NULL;
+      char key[NAME_MAX_LENGTH];
+
+      while (*s && *s != '|')
+      {
+         if (_len < sizeof(key) - 1)
+            key[_len++] = *s;
+         s++;
+      }
+      key[_len] = '\0';
+
+      if (*s == '|')
+         s++;
+
+      if (!_len)
+         continue;
+
+      string_to_lower(key);
+
+      if (RHMAP_IDX_STR(map, key) == -1)
+      {
+         core_info_index_t empty;
+         empty.cores                = NULL;
+         empty.match_archive_member = false;
+         RHMAP_SET_STR(map, key, empty);
+      }
+
+      entry = RHMAP_PTR_STR(map, key);
+
+      /* A core may list the same value twice */
+      if (     !RBUF_LEN(entry->cores)
+            || (entry->cores[RBUF_LEN(entry->cores) - 1] != core_file_id))
+         RBUF_PUSH(entry->cores, core_file_id);
+
+      if (match_archive_member)
+         entry->match_archive_member = true;
+   }
+
+   return map;
+}
+
+static int core_info_index_cmp(const void *a_, const void *b_)
+{
+   uintptr_t a = (uintptr_t)*(const char**)a_;
+   uintptr_t b = (uintptr_t)*(const char**)b_;
+   return (a < b) ? -1 : (a > b);
+}
+
+static void core_info_index_sort(core_info_index_t *map)
+{
+   size_t i;
+
+   for (i = 0; i < RHMAP_CAP(map); i++)
+      if (RHMAP_KEY(map, i) && RBUF_LEN(map[i].cores) > 1)
+         qsort(map[i].cores, RBUF_LEN(map[i].cores),
+               sizeof(*map[i].cores), core_info_index_cmp);
+}
+
+/* Indexes the cores of the list by supported extension
+ * and database, so that matching content against them
+ * takes a couple of hash lookups instead of a search
+ * through the string lists of every core. Works off the
+ * '|' separated strings, leaving lazily decoded string
+ * lists alone */
+static void core_info_list_build_index(core_info_list_t *core_info_list)
+{
+   size_t i;
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const core_info_t *info = &core_info_list->list[i];
+
+      if (string_is_empty(info->core_file_id.str))
+         continue;
+
+      core_info_list->ext_map = core_info_index_add(core_info_list->ext_map,
+            info->supported_extensions, info->core_file_id.str, false);
+      core_info_list->db_map  = core_info_index_add(core_info_list->db_map,
+            info->databases, info->core_file_id.str,
+            info->database_match_archive_member);
+   }
+
+   core_info_index_sort(core_info_list->ext_map);
+   core_info_index_sort(core_info_list->db_map);
+}
+
+/* Returns the index entry for 'key', or NULL */
+static const core_info_index_t *core_info_index_find(
+      core_info_index_t *map, const char *key)
+{
+   ptrdiff_t idx;
+   char key_lower[NAME_MAX_LENGTH];
+
+   if (!map || !key)
+      return NULL;
+
+   strlcpy(key_lower, key, sizeof(key_lower));
+   string_to_lower(key_lower);
+
+   if ((idx = RHMAP_IDX_STR(map, key_lower)) < 0)
+      return NULL;
+   return &map[idx];
+}
+
+static bool core_info_index_has_core(const core_info_index_t *entry,
+      const char *core_file_id)
+{
+   return     entry
+          &&  core_file_id
+          &&  bsearch(&core_file_id, entry->cores, RBUF_LEN(entry->cores),
+                   sizeof(*entry->cores), core_info_index_cmp);
+}
+
 static core_info_list_t *core_info_list_new(const char *path,
       const char *libretro_info_dir,
       const char *exts,
@@ -2003,8 +1653,12 @@ static core_info_list_t *core_info_list_new(const char *path,
    size_t i;
    core_info_t *core_info                       = NULL;
    core_info_list_t *core_info_list             = NULL;
-   core_info_cache_list_t *core_info_cache_list = NULL;
    const char *info_dir                         = libretro_info_dir;
+   uint8_t *cache_used                          = NULL;
+   size_t num_cache_used                        = 0;
+#ifdef HAVE_CORE_INFO_CACHE
+   bool cache_refresh                           = false;
+#endif
    core_path_list_t *path_list                  = core_info_path_list_new(
          path, exts, dir_show_hidden_files);
    if (!path_list)
@@ -2017,6 +1671,16 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->count      = 0;
    core_info_list->info_count = 0;
    core_info_list->all_ext    = NULL;
+   core_info_list->cache      = NULL;
+   core_info_list->ext_map    = NULL;
+   core_info_list->db_map     = NULL;
+#ifdef HAVE_THREADS
+   if (!(core_info_list->lazy_lock = slock_new()))
+   {
+      core_info_list_free(core_info_list);
+      goto error;
+   }
+#endif
 
    if (!(core_info = (core_info_t*)calloc(path_list->core_list->size,
          sizeof(*core_info))))
@@ -2032,8 +1696,14 @@ static core_info_list_t *core_info_list_new(const char *path,
    /* Read core info cache, if enabled */
    if (enable_cache)
    {
-      if (!(core_info_cache_list = core_info_cache_read(info_dir)))
-         goto error;
+      if ((core_info_list->cache = core_info_cache_read(info_dir)))
+         cache_used = (uint8_t*)calloc(
+               core_info_list->cache->num_cores + 1, sizeof(*cache_used));
+      if (!cache_used)
+      {
+         core_info_cache_free(core_info_list->cache);
+         core_info_list->cache = NULL;
+      }
    }
 #endif
 
@@ -2044,28 +1714,38 @@ static core_info_list_t *core_info_list_new(const char *path,
       const char *base_path       = core_file->path;
       const char *core_filename   = core_file->filename;
       config_file_t *conf         = NULL;
+      uint32_t hash;
       char core_file_id[256];
 
       if (!core_info_get_file_id(core_filename, core_file_id,
                sizeof(core_file_id)))
          continue;
 
+      hash = core_info_hash_string(core_file_id);
+
       /* If info cache is available, search for
        * current core */
-      if (core_info_cache_list)
+      if (core_info_list->cache)
       {
-         core_info_t *info_cache = core_info_cache_find(
-               core_info_cache_list, core_file_id);
+         const core_info_cache_core_t *record = core_info_cache_find(
+               core_info_list->cache, hash, core_file_id);
 
-         if (info_cache)
+         if (record)
          {
-            core_info_copy(info_cache, info);
+            size_t idx = record - core_info_list->cache->cores;
+
+            core_info_cache_load_core(core_info_list->cache,
+                  record, info);
+
+            if (!cache_used[idx])
+            {
+               cache_used[idx] = 1;
+               num_cache_used++;
+            }
 
             /* Core path is 'dynamic', and cannot
              * be cached (i.e. core directory may
              * change between runs) */
-            if (info->path)
-               free(info->path);
             info->path = strdup(base_path);
 
             /* Core lock status is 'dynamic', and
@@ -2089,6 +1769,7 @@ static core_info_list_t *core_info_list_new(const char *path,
             if (info->has_info)
                core_info_list->info_count++;
 
+            info->is_installed = true;
             continue;
          }
       }
@@ -2102,7 +1783,7 @@ static core_info_list_t *core_info_list_new(const char *path,
 
       /* Cache core file 'id' */
       info->core_file_id.str  = strdup(core_file_id);
-      info->core_file_id.hash = core_info_hash_string(core_file_id);
+      info->core_file_id.hash = hash;
 
       strlcat(core_file_id, ".info", sizeof(core_file_id));
 
@@ -2125,18 +1806,16 @@ static core_info_list_t *core_info_list_new(const char *path,
 
       info->is_installed = true;
 
+#ifdef HAVE_CORE_INFO_CACHE
       /* If info cache is enabled and we reach this
-       * point, current core is uncached
-       * > Add it to the list, and trigger a cache
-       *   refresh */
-      if (core_info_cache_list)
-      {
-         core_info_cache_add(core_info_cache_list, info, false);
-         core_info_cache_list->refresh = true;
-      }
+       * point, current core is uncached - trigger
+       * a cache refresh */
+      cache_refresh      = true;
+#endif
    }
 
    core_info_list_resolve_all_extensions(core_info_list);
+   core_info_list_build_index(core_info_list);
 
    /* If info cache is enabled
     * > Check whether any cached cores have been
@@ -2145,17 +1824,20 @@ static core_info_list_t *core_info_list_new(const char *path,
     * > Write new cache to disk if updates are
     *   required */
    *cache_supported = true;
-   if (core_info_cache_list)
+#ifdef HAVE_CORE_INFO_CACHE
+   if (enable_cache)
    {
-      core_info_check_uninstalled(core_info_cache_list);
+      if (     !core_info_list->cache
+            || (num_cache_used != core_info_list->cache->num_cores))
+         cache_refresh = true;
 
-      if (core_info_cache_list->refresh)
+      if (cache_refresh)
          *cache_supported = core_info_cache_write(
-               core_info_cache_list, info_dir);
-
-      core_info_cache_list_free(core_info_cache_list);
+               core_info_list, info_dir);
    }
+#endif
 
+   free(cache_used);
    core_info_path_list_free(path_list);
    return core_info_list;
 
@@ -2180,6 +1862,7 @@ bool core_info_list_get_info(core_info_list_t *core_info_list,
 
       if (info)
       {
+         core_info_resolve_lazy_fields(core_info_list, info);
          *out_info = *info;
          return true;
       }
@@ -2204,26 +1887,26 @@ static bool core_info_does_support_any_file(const core_info_t *core,
 }
 #endif
 
-static bool core_info_does_support_file(
-      const core_info_t *core, const char *path)
+/* Returns the index entry of the cores supporting
+ * 'path' (a directory if it ends with a slash) by its
+ * extension, or NULL if there are none */
+static const core_info_index_t *core_info_list_find_ext_cores(
+      core_info_list_t *list, const char *path)
 {
    const char *basename, *ext;
 
-   if (!core || !core->supported_extensions_list)
-      return false;
-   if (string_is_empty(path))
-      return false;
+   if (!list || string_is_empty(path))
+      return NULL;
 
    basename = path_basename(path);
 
    /* if a core has / in its list of supported extensions, the core
       supports loading of directories on the host file system */
    if (string_is_empty(basename))
-      return string_list_find_elem(core->supported_extensions_list, "/");
+      return core_info_index_find(list->ext_map, "/");
 
    ext = strrchr(basename, '.');
-   return string_list_find_elem_prefix(
-         core->supported_extensions_list, ".", (ext ? ext + 1 : ""));
+   return core_info_index_find(list->ext_map, (ext ? ext + 1 : ""));
 }
 
 /* qsort_r() is not in standard C, sadly. */
@@ -2233,10 +1916,10 @@ static int core_info_qsort_cmp(const void *a_, const void *b_)
    core_info_state_t *p_coreinfo = &core_info_st;
    const core_info_t          *a = (const core_info_t*)a_;
    const core_info_t          *b = (const core_info_t*)b_;
-   int support_a                 = core_info_does_support_file(a,
-         p_coreinfo->tmp_path);
-   int support_b                 = core_info_does_support_file(b,
-         p_coreinfo->tmp_path);
+   int support_a                 = core_info_index_has_core(
+         p_coreinfo->tmp_index, a->core_file_id.str);
+   int support_b                 = core_info_index_has_core(
+         p_coreinfo->tmp_index, b->core_file_id.str);
 #ifdef HAVE_COMPRESSION
    support_a            = support_a ||
       core_info_does_support_any_file(a, p_coreinfo->tmp_list);
@@ -2266,6 +1949,8 @@ static bool core_info_list_update_missing_firmware_internal(
          core_info_list, core_path)))
       return false;
 
+   core_info_resolve_lazy_fields(core_info_list, info);
+
    for (i = 0; i < info->firmware_count; i++)
    {
       if (string_is_empty(info->firmware[i].path))
@@ -2304,6 +1989,7 @@ bool core_info_init_current_core(void)
    current->is_locked                     = false;
    current->is_standalone_exempt          = false;
    current->is_installed                  = false;
+   current->lazy_fields_pending           = false;
    current->firmware_count                = 0;
    current->savestate_support_level       = CORE_INFO_SAVESTATE_DETERMINISTIC;
    current->path                          = NULL;
@@ -2436,6 +2122,7 @@ bool core_info_find(const char *core_path,
    if (!(info = core_info_find_internal(p_coreinfo->curr_list, core_path)))
       return false;
 
+   core_info_resolve_lazy_fields(p_coreinfo->curr_list, info);
    *core_info = info;
    return true;
 }
@@ -2450,6 +2137,7 @@ core_info_t *core_info_get(core_info_list_t *list, size_t i)
    if (!info || !info->path)
       return NULL;
 
+   core_info_resolve_lazy_fields(list, info);
    return info;
 }
 
@@ -2469,13 +2157,15 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
 
    if (path_is_directory(path))
    {
-      /* Add a slash so core_info_does_support_file can know it is
+      /* Add a slash so core_info_list_find_ext_cores can know it is
          a directory without having to check the file system again. */
       fill_pathname_join_special(dir_path, path, "", sizeof(dir_path));
       path = dir_path;
    }
 
    p_coreinfo->tmp_path          = path;
+   p_coreinfo->tmp_index         = core_info_list_find_ext_cores(
+         core_info_list, path);
 
 #ifdef HAVE_COMPRESSION
    if (path_is_compressed_file(path))
@@ -2492,7 +2182,8 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
    {
       const core_info_t *core = &core_info_list->list[i];
 
-      if (core_info_does_support_file(core, path))
+      if (core_info_index_has_core(p_coreinfo->tmp_index,
+               core->core_file_id.str))
          continue;
 
 #ifdef HAVE_COMPRESSION
@@ -2506,7 +2197,9 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
 #ifdef HAVE_COMPRESSION
    if (list)
       string_list_free(list);
+   p_coreinfo->tmp_list          = NULL;
 #endif
+   p_coreinfo->tmp_index         = NULL;
 
    *infos     = core_info_list->list;
    *num_infos = supported;
@@ -2541,80 +2234,64 @@ bool core_info_core_file_id_is_equal(const char *core_path_a,
 
 bool core_info_database_match_archive_member(const char *database_path)
 {
-   char      *database           = NULL;
-   const char      *new_path     = path_basename_nocompression(
+   const core_info_index_t *entry = NULL;
+   const char      *new_path      = path_basename_nocompression(
          database_path);
-   core_info_state_t *p_coreinfo = NULL;
+   core_info_state_t *p_coreinfo  = &core_info_st;
+   char database[NAME_MAX_LENGTH];
 
-   if (string_is_empty(new_path))
-      return false;
-   if (!(database = strdup(new_path)))
+   if (string_is_empty(new_path) || !p_coreinfo->curr_list)
       return false;
 
+   strlcpy(database, new_path, sizeof(database));
    path_remove_extension(database);
 
-   p_coreinfo                     = &core_info_st;
-
-   if (p_coreinfo->curr_list)
-   {
-      size_t i;
-
-      for (i = 0; i < p_coreinfo->curr_list->count; i++)
-      {
-         const core_info_t *info = &p_coreinfo->curr_list->list[i];
-
-         if (!info->database_match_archive_member)
-             continue;
-
-         if (!string_list_find_elem(info->databases_list, database))
-             continue;
+   entry = core_info_index_find(p_coreinfo->curr_list->db_map, database);
 
-         free(database);
-         return true;
-      }
-   }
-
-   free(database);
-   return false;
+   return entry && entry->match_archive_member;
 }
 
 bool core_info_database_supports_content_path(
       const char *database_path, const char *path)
 {
-   char      *database           = NULL;
-   const char      *new_path     = path_basename(database_path);
-   core_info_state_t *p_coreinfo = NULL;
-
-   if (string_is_empty(new_path))
-      return false;
-   if (!(database = strdup(new_path)))
+   size_t i = 0, j = 0;
+   const core_info_index_t *db_entry  = NULL;
+   const core_info_index_t *ext_entry = NULL;
+   const char      *new_path          = path_basename(database_path);
+   const char      *ext               = NULL;
+   core_info_state_t *p_coreinfo      = &core_info_st;
+   char database[NAME_MAX_LENGTH];
+
+   if (     string_is_empty(new_path)
+         || !p_coreinfo->curr_list
+         || !(ext = path_get_extension(path)))
       return false;
 
+   strlcpy(database, new_path, sizeof(database));
    path_remove_extension(database);
 
-   p_coreinfo                    = &core_info_st;
+   if (   !(db_entry  = core_info_index_find(
+               p_coreinfo->curr_list->db_map, database))
+       || !(ext_entry = core_info_index_find(
+               p_coreinfo->curr_list->ext_map, ext)))
+      return false;
 
-   if (p_coreinfo->curr_list)
+   /* Is there a core listing both? Both entries
+    * are in core file id address order */
+   while (   (i < RBUF_LEN(db_entry->cores))
+          && (j < RBUF_LEN(ext_entry->cores)))
    {
-      size_t i;
-
-      for (i = 0; i < p_coreinfo->curr_list->count; i++)
-      {
-         const core_info_t *info = &p_coreinfo->curr_list->list[i];
-
-         if (!string_list_find_elem(info->supported_extensions_list,
-                  path_get_extension(path)))
-            continue;
+      uintptr_t a = (uintptr_t)db_entry->cores[i];
+      uintptr_t b = (uintptr_t)ext_entry->cores[j];
 
-         if (!string_list_find_elem(info->databases_list, database))
-            continue;
-
-         free(database);
+      if (a == b)
          return true;
-      }
+      if (a < b)
+         i++;
+      else
+         j++;
    }
 
-   free(database);
    return false;
 }
 
@@ -2886,6 +2563,19 @@ bool core_info_current_supports_runahead(void)
          CORE_INFO_SAVESTATE_DETERMINISTIC;
 }
 
+bool core_info_current_supports_runahead_snapshot(void)
+{
+   core_info_state_t *p_coreinfo = &core_info_st;
+
+   /* Unlike the above, this is neither bypassed
+    * nor assumed without a core info file */
+   if (!p_coreinfo->current)
+      return false;
+
+   return p_coreinfo->current->savestate_support_level >=
+         CORE_INFO_SAVESTATE_SNAPSHOT;
+}
+
 static bool core_info_update_core_aux_file(const char *path, bool create)
 {
    bool aux_file_exists = false;
@@ -22,6 +22,9 @@
 
 #include <lists/string_list.h>
 #include <retro_common_api.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 RETRO_BEGIN_DECLS
 
@@ -29,6 +32,13 @@ RETRO_BEGIN_DECLS
  * that may be offered by a core:
  *   - serialized:    rewind
  *   - deterministic: netplay/runahead
+ *   - snapshot:      deterministic, and the whole emulated
+ *                    state lives in the writable regions the
+ *                    core exposes with SET_MEMORY_MAPS
+ *                    (runahead may snapshot those directly;
+ *                    the core must not have the kernel write
+ *                    into them, e.g. read() straight into RAM,
+ *                    since that bypasses dirty page tracking)
  * Thus:
  *   (level < CORE_INFO_SAVESTATE_BASIC)
  *      -> no savestate support
@@ -36,11 +46,14 @@ RETRO_BEGIN_DECLS
  *      -> no rewind/netplay/runahead
  *   (level < CORE_INFO_SAVESTATE_DETERMINISTIC)
  *      -> no netplay/runahead
+ *   (level < CORE_INFO_SAVESTATE_SNAPSHOT)
+ *      -> runahead has to serialize
  */
 #define CORE_INFO_SAVESTATE_DISABLED      0
 #define CORE_INFO_SAVESTATE_BASIC         1
 #define CORE_INFO_SAVESTATE_SERIALIZED    2
 #define CORE_INFO_SAVESTATE_DETERMINISTIC 3
+#define CORE_INFO_SAVESTATE_SNAPSHOT      4
 
 enum core_info_list_qsort_type
 {
@@ -110,6 +123,13 @@ typedef struct
    bool is_locked;
    bool is_standalone_exempt;
    bool is_installed;
+   /* Loaded from the core info cache, with the string
+    * lists other than 'supported_extensions_list' and
+    * the firmware not decoded yet. Entries handed out
+    * by core_info_find(), core_info_get() and friends
+    * never have this set. Only touched with the list's
+    * 'lazy_lock' held */
+   bool lazy_fields_pending;
 } core_info_t;
 
 /* A subset of core_info parameters required for
@@ -126,6 +146,17 @@ typedef struct
 {
    core_info_t *list;
    char *all_ext;
+   /* Core info cache the entries were loaded from */
+   struct core_info_cache *cache;
+   /* Cores by (lowercase) supported extension and
+    * database name */
+   struct core_info_index *ext_map;
+   struct core_info_index *db_map;
+#ifdef HAVE_THREADS
+   /* Lookups may run on several task threads at once;
+    * held while an entry's lazy fields are decoded */
+   slock_t *lazy_lock;
+#endif
    size_t count;
    size_t info_count;
 } core_info_list_t;
@@ -147,6 +178,7 @@ struct core_info_state
    const char *tmp_path;
    core_info_t *current;
    core_info_list_t *curr_list;
+   const struct core_info_index *tmp_index;
 };
 
 typedef struct core_info_state core_info_state_t;
@@ -212,6 +244,11 @@ bool core_info_current_supports_rewind(void);
 bool core_info_current_supports_netplay(void);
 bool core_info_current_supports_runahead(void);
 
+/* Whether runahead may restore the current core by
+ * snapshotting its memory maps instead of serializing.
+ * Never assumed: the core info file has to say so. */
+bool core_info_current_supports_runahead_snapshot(void);
+
 /* Sets 'locked' status of specified core
  * > Returns true if successful
  * > Like all functions that access the cached
@@ -24,11 +24,16 @@
 #include <lists/string_list.h>
 #include <lists/dir_list.h>
 #include <string/stdstring.h>
+#include <array/rbuf.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <streams/file_stream.h>
 
 #include "libretro-db/libretrodb.h"
 
 #include "core_info.h"
 #include "database_info.h"
+#include "verbosity.h"
 
 int database_info_build_query_enum(char *s, size_t len,
       enum database_query_type type,
@@ -466,19 +471,17 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
    return ret;
 }
 
-static int database_cursor_iterate(libretrodb_cursor_t *cur,
+/* Fills in 'db_info' from a database item,
+ * which is freed */
+static int database_info_parse_item(struct rmsgpack_dom_value *item,
       database_info_t *db_info)
 {
    unsigned i;
-   struct rmsgpack_dom_value item;
    const char* str                = NULL;
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
-      return -1;
-
-   if (item.type != RDT_MAP)
+   if (item->type != RDT_MAP)
    {
-      rmsgpack_dom_value_free(&item);
+      rmsgpack_dom_value_free(item);
       return 1;
    }
 
@@ -486,10 +489,10 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   for (i = 0; i < item->val.map.len; i++)
    {
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
+      struct rmsgpack_dom_value *key = &item->val.map.items[i].key;
+      struct rmsgpack_dom_value *val = &item->val.map.items[i].value;
       const char *val_string         = NULL;
 
       if (!key || !val)
@@ -709,11 +712,22 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
                (uint8_t*)val->val.binary.buff, val->val.binary.len);
    }
 
-   rmsgpack_dom_value_free(&item);
+   rmsgpack_dom_value_free(item);
 
    return 0;
 }
 
+static int database_cursor_iterate(libretrodb_cursor_t *cur,
+      database_info_t *db_info)
+{
+   struct rmsgpack_dom_value item;
+
+   if (libretrodb_cursor_read_item(cur, &item) != 0)
+      return -1;
+
+   return database_info_parse_item(&item, db_info);
+}
+
 static int database_cursor_open(libretrodb_t *db,
       libretrodb_cursor_t *cur, const char *path, const char *query)
 {
@@ -1083,3 +1097,583 @@ void database_info_list_free(database_info_list_t *database_info_list)
 
    free(database_info_list->list);
 }
+
+/* Database index
+ * > Maps the CRC32 and serial of every item in a set of
+ *   databases to the database and the offset of the item,
+ *   so content is matched with a hash table probe instead
+ *   of a query walking each database in turn
+ * > Saved to disk and reused as long as the size and
+ *   modification time of each database are unchanged;
+ *   only the databases that did change are read again
+ * > Serials are keyed by their CRC32, so a hit only
+ *   means the item has to be read and compared */
+
+#define DATABASE_INDEX_MAGIC   0x58444952 /* "RIDX" */
+#define DATABASE_INDEX_VERSION 1
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_dbs;
+   uint32_t reserved;
+} database_index_header_t;
+
+/* Followed by the 'name_len' bytes of the database file
+ * name, then 'num_crcs' and 'num_serials' keys */
+typedef struct
+{
+   int64_t rdb_size;
+   int64_t rdb_mtime;
+   uint32_t name_len;
+   uint32_t num_crcs;
+   uint32_t num_serials;
+   uint32_t reserved;
+} database_index_db_header_t;
+
+typedef struct
+{
+   uint32_t key;
+   uint32_t offset;
+} database_index_key_t;
+
+typedef struct
+{
+   uint32_t key;
+   uint32_t offset;
+   uint32_t db;
+   uint32_t next;
+} database_index_entry_t;
+
+typedef struct
+{
+   database_index_entry_t *entries; /* RBUF, grouped by database */
+   uint32_t *buckets;
+   unsigned bits;
+} database_index_table_t;
+
+typedef struct
+{
+   char *path;
+   int64_t rdb_size;
+   int64_t rdb_mtime;
+   size_t first_crc;
+   size_t first_serial;
+} database_index_db_t;
+
+struct database_info_index
+{
+   database_index_db_t *dbs;
+   size_t num_dbs;
+   database_index_table_t crcs;
+   database_index_table_t serials;
+};
+
+#define DATABASE_INDEX_EMPTY 0xFFFFFFFF
+
+static uint32_t database_info_index_hash(uint32_t key, unsigned bits)
+{
+   return (key * 0x9E3779B1) >> (32 - bits);
+}
+
+static bool database_info_index_add(database_index_table_t *table,
+      uint32_t key, uint32_t offset, uint32_t db)
+{
+   database_index_entry_t entry;
+
+   if (!RBUF_TRYFIT(table->entries, RBUF_LEN(table->entries) + 1))
+      return false;
+
+   entry.key    = key;
+   entry.offset = offset;
+   entry.db     = db;
+   entry.next   = DATABASE_INDEX_EMPTY;
+   RBUF_PUSH(table->entries, entry);
+   return true;
+}
+
+static bool database_info_index_build_table(database_index_table_t *table)
+{
+   size_t i;
+   size_t count       = RBUF_LEN(table->entries);
+   unsigned bits      = 4;
+
+   while (((size_t)1 << bits) < count && bits < 31)
+      bits++;
+
+   if (!(table->buckets = (uint32_t*)malloc(
+               ((size_t)1 << bits) * sizeof(*table->buckets))))
+      return false;
+
+   table->bits = bits;
+   memset(table->buckets, 0xFF, ((size_t)1 << bits) * sizeof(*table->buckets));
+
+   /* Inserted backwards so that each chain lists
+    * its entries in database order */
+   for (i = count; i-- > 0; )
+   {
+      uint32_t *bucket = &table->buckets[
+         database_info_index_hash(table->entries[i].key, bits)];
+      table->entries[i].next = *bucket;
+      *bucket                = (uint32_t)i;
+   }
+
+   return true;
+}
+
+static size_t database_info_index_find(const database_index_table_t *table,
+      uint32_t key, database_info_index_hit_t *hits, size_t len)
+{
+   uint32_t i;
+   size_t count = 0;
+
+   if (!table->buckets)
+      return 0;
+
+   for (i  = table->buckets[database_info_index_hash(key, table->bits)];
+        i != DATABASE_INDEX_EMPTY;
+        i  = table->entries[i].next)
+   {
+      if (table->entries[i].key != key)
+         continue;
+      if (count < len)
+      {
+         hits[count].db     = table->entries[i].db;
+         hits[count].offset = table->entries[i].offset;
+      }
+      count++;
+   }
+
+   return count;
+}
+
+/* Reads the CRC32s and serials of every item of a database */
+static bool database_info_index_scan(database_info_index_t *index,
+      uint32_t db_id)
+{
+   struct rmsgpack_dom_value crc_key, serial_key, item;
+   database_index_db_t *db  = &index->dbs[db_id];
+   libretrodb_t *rdb        = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   bool ret                 = false;
+
+   crc_key.type                = RDT_STRING;
+   crc_key.val.string.len      = STRLEN_CONST("crc");
+   crc_key.val.string.buff     = (char*)"crc";
+   serial_key.type             = RDT_STRING;
+   serial_key.val.string.len   = STRLEN_CONST("serial");
+   serial_key.val.string.buff  = (char*)"serial";
+
+   if (     !rdb || !cur
+         || libretrodb_open(db->path, rdb, false) != 0)
+      goto end;
+
+   if (libretrodb_cursor_open(rdb, cur, NULL) != 0)
+   {
+      libretrodb_close(rdb);
+      goto end;
+   }
+
+   for (;;)
+   {
+      const struct rmsgpack_dom_value *val;
+      uint64_t offset = libretrodb_cursor_tell(cur);
+
+      if (libretrodb_cursor_read_item(cur, &item) != 0)
+         break;
+
+      /* Offsets are kept in 32 bits */
+      if (offset > 0xFFFFFFFF)
+      {
+         rmsgpack_dom_value_free(&item);
+         goto close;
+      }
+
+      /* Queries match the CRC as 4 bytes of binary,
+       * and the serial as binary too */
+      if (     (val = rmsgpack_dom_value_map_value(&item, &crc_key))
+            && val->type           == RDT_BINARY
+            && val->val.binary.len == 4)
+      {
+         uint32_t crc;
+         memcpy(&crc, val->val.binary.buff, sizeof(crc));
+         if (!database_info_index_add(&index->crcs,
+                  swap_if_little32(crc), (uint32_t)offset, db_id))
+            goto free_item;
+      }
+
+      if (     (val = rmsgpack_dom_value_map_value(&item, &serial_key))
+            && val->type           == RDT_BINARY
+            && val->val.binary.len  > 0)
+      {
+         if (!database_info_index_add(&index->serials,
+                  encoding_crc32(0, (const uint8_t*)val->val.binary.buff,
+                     val->val.binary.len), (uint32_t)offset, db_id))
+            goto free_item;
+      }
+
+      rmsgpack_dom_value_free(&item);
+   }
+
+   ret = true;
+   goto close;
+
+free_item:
+   rmsgpack_dom_value_free(&item);
+close:
+   libretrodb_cursor_close(cur);
+   libretrodb_close(rdb);
+end:
+   libretrodb_cursor_free(cur);
+   libretrodb_free(rdb);
+   return ret;
+}
+
+typedef struct
+{
+   const uint8_t *keys;
+   uint32_t num_crcs;
+   uint32_t num_serials;
+} database_index_saved_t;
+
+/* Looks up the databases that did not change in the index
+ * saved to 'path', whose keys 'saved' then points to in
+ * the returned buffer. 'num_saved' is set to the number of
+ * databases that were saved. */
+static void *database_info_index_read(const database_info_index_t *index,
+      const char *path, database_index_saved_t *saved, size_t *num_saved)
+{
+   database_index_header_t header;
+   void *data      = NULL;
+   int64_t len     = 0;
+   size_t pos      = sizeof(header);
+   uint32_t i;
+
+   *num_saved      = 0;
+
+   if (     string_is_empty(path)
+         || !path_is_valid(path)
+         || !filestream_read_file(path, &data, &len))
+      return NULL;
+
+   if ((size_t)len < sizeof(header))
+      return data;
+
+   memcpy(&header, data, sizeof(header));
+   if (     header.magic   != DATABASE_INDEX_MAGIC
+         || header.version != DATABASE_INDEX_VERSION)
+      return data;
+
+   for (i = 0; i < header.num_dbs; i++)
+   {
+      database_index_db_header_t db_header;
+      const char *name;
+      size_t keys_size;
+      size_t j;
+
+      if ((size_t)len - pos < sizeof(db_header))
+         break;
+      memcpy(&db_header, (const uint8_t*)data + pos, sizeof(db_header));
+      pos      += sizeof(db_header);
+      name      = (const char*)data + pos;
+      keys_size = ((size_t)db_header.num_crcs + db_header.num_serials)
+         * sizeof(database_index_key_t);
+
+      if (     (size_t)len - pos < db_header.name_len
+            || (size_t)len - pos - db_header.name_len < keys_size)
+         break;
+      pos      += db_header.name_len;
+
+      for (j = 0; j < index->num_dbs; j++)
+      {
+         const database_index_db_t *db = &index->dbs[j];
+         const char *db_name           = path_basename(db->path);
+
+         if (     !saved[j].keys
+               && db->rdb_size      == db_header.rdb_size
+               && db->rdb_mtime     == db_header.rdb_mtime
+               && strlen(db_name)   == db_header.name_len
+               && !strncmp(db_name, name, db_header.name_len))
+         {
+            saved[j].keys        = (const uint8_t*)data + pos;
+            saved[j].num_crcs    = db_header.num_crcs;
+            saved[j].num_serials = db_header.num_serials;
+            break;
+         }
+      }
+
+      pos += keys_size;
+      (*num_saved)++;
+   }
+
+   return data;
+}
+
+static bool database_info_index_write_keys(RFILE *file,
+      const database_index_table_t *table, size_t first, size_t end)
+{
+   size_t i;
+
+   for (i = first; i < end; i++)
+   {
+      database_index_key_t key;
+      key.key    = table->entries[i].key;
+      key.offset = table->entries[i].offset;
+      if (filestream_write(file, &key, sizeof(key)) != sizeof(key))
+         return false;
+   }
+
+   return true;
+}
+
+static bool database_info_index_write(const database_info_index_t *index,
+      const char *path)
+{
+   database_index_header_t header;
+   size_t i;
+   bool ret    = false;
+   RFILE *file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   header.magic    = DATABASE_INDEX_MAGIC;
+   header.version  = DATABASE_INDEX_VERSION;
+   header.num_dbs  = (uint32_t)index->num_dbs;
+   header.reserved = 0;
+
+   if (filestream_write(file, &header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   for (i = 0; i < index->num_dbs; i++)
+   {
+      database_index_db_header_t db_header;
+      const database_index_db_t *db = &index->dbs[i];
+      const char *name              = path_basename(db->path);
+      size_t crcs_end               = (i + 1 < index->num_dbs)
+         ? index->dbs[i + 1].first_crc
+         : RBUF_LEN(index->crcs.entries);
+      size_t serials_end            = (i + 1 < index->num_dbs)
+         ? index->dbs[i + 1].first_serial
+         : RBUF_LEN(index->serials.entries);
+
+      db_header.rdb_size    = db->rdb_size;
+      db_header.rdb_mtime   = db->rdb_mtime;
+      db_header.name_len    = (uint32_t)strlen(name);
+      db_header.num_crcs    = (uint32_t)(crcs_end    - db->first_crc);
+      db_header.num_serials = (uint32_t)(serials_end - db->first_serial);
+      db_header.reserved    = 0;
+
+      if (     filestream_write(file, &db_header, sizeof(db_header))
+               != sizeof(db_header)
+            || filestream_write(file, name, db_header.name_len)
+               != db_header.name_len
+            || !database_info_index_write_keys(file, &index->crcs,
+               db->first_crc, crcs_end)
+            || !database_info_index_write_keys(file, &index->serials,
+               db->first_serial, serials_end))
+         goto end;
+   }
+
+   ret = true;
+
+end:
+   filestream_close(file);
+   if (!ret)
+      filestream_delete(path);
+   return ret;
+}
+
+/**
+ * database_info_index_new:
+ * @rdb_list            : Paths of the databases.
+ * @path                : File the index is saved to.
+ *
+ * Loads the index of the databases in @rdb_list from @path,
+ * reading again (and saving) the databases that are not in it
+ * or changed since it was saved.
+ *
+ * Returns: the index, or NULL if a database could not be read.
+ **/
+database_info_index_t *database_info_index_new(
+      const struct string_list *rdb_list, const char *path)
+{
+   size_t i;
+   size_t num_saved              = 0;
+   void *saved_data              = NULL;
+   database_index_saved_t *saved = NULL;
+   bool changed                  = false;
+   retro_time_t start            = cpu_features_get_time_usec();
+   database_info_index_t *index  = (database_info_index_t*)
+      calloc(1, sizeof(*index));
+
+   if (!index || !rdb_list)
+      goto error;
+
+   if (rdb_list->size)
+   {
+      if (     !(index->dbs = (database_index_db_t*)calloc(
+                  rdb_list->size, sizeof(*index->dbs)))
+            || !(saved      = (database_index_saved_t*)calloc(
+                  rdb_list->size, sizeof(*saved))))
+         goto error;
+   }
+
+   index->num_dbs = rdb_list->size;
+   for (i = 0; i < rdb_list->size; i++)
+   {
+      database_index_db_t *db = &index->dbs[i];
+      if (!(db->path = strdup(rdb_list->elems[i].data)))
+         goto error;
+      db->rdb_size            = path_get_size(db->path);
+      db->rdb_mtime           = path_get_mtime(db->path);
+   }
+
+   saved_data = database_info_index_read(index, path, saved, &num_saved);
+   changed    = (num_saved != index->num_dbs);
+
+   for (i = 0; i < index->num_dbs; i++)
+   {
+      database_index_db_t *db = &index->dbs[i];
+
+      db->first_crc           = RBUF_LEN(index->crcs.entries);
+      db->first_serial        = RBUF_LEN(index->serials.entries);
+
+      if (saved[i].keys)
+      {
+         size_t j;
+         size_t num_keys = (size_t)saved[i].num_crcs + saved[i].num_serials;
+
+         for (j = 0; j < num_keys; j++)
+         {
+            database_index_key_t key;
+            memcpy(&key, saved[i].keys + j * sizeof(key), sizeof(key));
+            if (!database_info_index_add(j < saved[i].num_crcs
+                     ? &index->crcs : &index->serials,
+                     key.key, key.offset, (uint32_t)i))
+               goto error;
+         }
+      }
+      else
+      {
+         if (!database_info_index_scan(index, (uint32_t)i))
+         {
+            RARCH_ERR("[Database]: Could not index \"%s\".\n", db->path);
+            goto error;
+         }
+         changed = true;
+      }
+   }
+
+   if (     !database_info_index_build_table(&index->crcs)
+         || !database_info_index_build_table(&index->serials))
+      goto error;
+
+   if (changed && !string_is_empty(path))
+   {
+      if (database_info_index_write(index, path))
+         RARCH_LOG("[Database]: Indexed %u databases in %u ms: \"%s\".\n",
+               (unsigned)index->num_dbs,
+               (unsigned)((cpu_features_get_time_usec() - start) / 1000),
+               path);
+      else
+         RARCH_WARN("[Database]: Could not save index: \"%s\".\n", path);
+   }
+
+   free(saved_data);
+   free(saved);
+   return index;
+
+error:
+   free(saved_data);
+   free(saved);
+   database_info_index_free(index);
+   return NULL;
+}
+
+void database_info_index_free(database_info_index_t *index)
+{
+   size_t i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i < index->num_dbs; i++)
+      free(index->dbs[i].path);
+   free(index->dbs);
+   RBUF_FREE(index->crcs.entries);
+   RBUF_FREE(index->serials.entries);
+   free(index->crcs.buckets);
+   free(index->serials.buckets);
+   free(index);
+}
+
+size_t database_info_index_find_crc(const database_info_index_t *index,
+      uint32_t crc, database_info_index_hit_t *hits, size_t len)
+{
+   return database_info_index_find(&index->crcs, crc, hits, len);
+}
+
+size_t database_info_index_find_serial(const database_info_index_t *index,
+      const char *serial, database_info_index_hit_t *hits, size_t len)
+{
+   return database_info_index_find(&index->serials,
+         encoding_crc32(0, (const uint8_t*)serial, strlen(serial)),
+         hits, len);
+}
+
+database_info_list_t *database_info_index_list_new(
+      const database_info_index_t *index, unsigned db,
+      const database_info_index_hit_t *hits, size_t num_hits)
+{
+   size_t i;
+   database_info_list_t *database_info_list = NULL;
+   libretrodb_t *rdb                        = NULL;
+
+   if (db >= index->num_dbs)
+      return NULL;
+
+   if (!(database_info_list = (database_info_list_t*)
+            calloc(1, sizeof(*database_info_list))))
+      return NULL;
+
+   for (i = 0; i < num_hits; i++)
+   {
+      struct rmsgpack_dom_value item;
+
+      if (hits[i].db != db)
+         continue;
+
+      if (!rdb)
+      {
+         if (     !(rdb = libretrodb_new())
+               || libretrodb_open(index->dbs[db].path, rdb, false) != 0
+               || !(database_info_list->list = (database_info_t*)
+                  calloc(num_hits, sizeof(database_info_t))))
+            goto error;
+      }
+
+      if (libretrodb_read_item_at(rdb, hits[i].offset, &item) == 0
+            && database_info_parse_item(&item,
+               &database_info_list->list[database_info_list->count]) == 0)
+         database_info_list->count++;
+   }
+
+   if (rdb)
+   {
+      libretrodb_close(rdb);
+      libretrodb_free(rdb);
+   }
+   return database_info_list;
+
+error:
+   if (rdb)
+   {
+      libretrodb_close(rdb);
+      libretrodb_free(rdb);
+   }
+   free(database_info_list);
+   return NULL;
+}
@@ -136,11 +136,41 @@ typedef struct
    size_t count;
 } database_info_list_t;
 
+typedef struct database_info_index database_info_index_t;
+
+/* An item of the database at position 'db' in the
+ * list the index was created from */
+typedef struct
+{
+   uint32_t db;
+   uint32_t offset;
+} database_info_index_hit_t;
+
 database_info_list_t *database_info_list_new(const char *rdb_path,
       const char *query);
 
 void database_info_list_free(database_info_list_t *list);
 
+database_info_index_t *database_info_index_new(
+      const struct string_list *rdb_list, const char *path);
+
+void database_info_index_free(database_info_index_t *index);
+
+/* Write up to 'len' of the items holding a CRC32 or
+ * serial to 'hits', and return how many there are.
+ * Serials are matched by hash, so items found by
+ * serial have to be compared again. */
+size_t database_info_index_find_crc(const database_info_index_t *index,
+      uint32_t crc, database_info_index_hit_t *hits, size_t len);
+
+size_t database_info_index_find_serial(const database_info_index_t *index,
+      const char *serial, database_info_index_hit_t *hits, size_t len);
+
+/* Reads the items of 'hits' that are in database 'db' */
+database_info_list_t *database_info_index_list_new(
+      const database_info_index_t *index, unsigned db,
+      const database_info_index_hit_t *hits, size_t num_hits);
+
 database_info_handle_t *database_info_dir_init(const char *dir,
       enum database_type type, retro_task_t *task,
       bool show_hidden_files);
@@ -111,6 +111,8 @@ RETRO_BEGIN_DECLS
 #endif
 #define FILE_PATH_CORE_INFO_CACHE "core_info.cache"
 #define FILE_PATH_CORE_INFO_CACHE_REFRESH "core_info.refresh"
+#define FILE_PATH_DATABASE_INDEX "database_index.cache"
+#define FILE_PATH_CONTENT_SCAN_CACHE "content_scan.cache"
 
 #ifdef HAVE_LAKKA
  #ifdef HAVE_LAKKA_SERVER
@@ -20,6 +20,10 @@
 
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
+#ifdef HAVE_THREADS
+#include <features/features_cpu.h>
+#include <rthreads/tpool.h>
+#endif
 #include "../../verbosity.h"
 
 #ifdef HAVE_CONFIG_H
@@ -77,6 +81,10 @@ static void sdl_gfx_free(void *data)
 
    scaler_ctx_gen_reset(&vid->scaler);
    scaler_ctx_gen_reset(&vid->menu.scaler);
+#ifdef HAVE_THREADS
+   if (vid->scaler.pool)
+      tpool_destroy(vid->scaler.pool);
+#endif
 
    free(vid);
 }
@@ -327,6 +335,19 @@ static void *sdl_gfx_init(const video_info_t *video,
    vid->menu.scaler             = vid->scaler;
    vid->menu.scaler.scaler_type = SCALER_TYPE_BILINEAR;
 
+#ifdef HAVE_THREADS
+   /* Scale the core frame in slices; the menu
+    * texture is small enough to stay on this thread. */
+   {
+      unsigned cores = cpu_features_get_core_amount();
+      if (cores > 1)
+      {
+         vid->scaler.pool    = tpool_create(cores);
+         vid->scaler.threads = cores;
+      }
+   }
+#endif
+
    vid->menu.frame              = SDL_ConvertSurface(
          vid->screen, vid->screen->format, vid->screen->flags | SDL_SRCALPHA);
 
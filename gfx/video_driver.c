@@ -4035,6 +4035,7 @@ void video_driver_frame(const void *data, unsigned width,
       audio_statistics_t audio_stats;
       char tmp[256];
       char latency_stats[256];
+      char thread_stats[192];
       size_t len;
       double stddev                          = 0.0;
       float font_size_scale                  = (float)video_info.font_size / 100;
@@ -4082,9 +4083,31 @@ void video_driver_frame(const void *data, unsigned width,
       audio_compute_buffer_statistics(&audio_stats);
 
       latency_stats[0]  = '\0';
+      thread_stats[0]   = '\0';
       tmp[0]            = '\0';
       len               = 0;
 
+#ifdef HAVE_THREADS
+      if (VIDEO_DRIVER_IS_THREADED_INTERNAL(video_st))
+      {
+         video_thread_stats_t thr_stats;
+         /* TODO/FIXME - localize */
+         if (video_thread_get_stats(video_st->data, &thr_stats))
+            snprintf(thread_stats, sizeof(thread_stats),
+                  "THREADED VIDEO\n"
+                  " Frame Age:   %5.2f ms\n"
+                  " - Max:       %5.2f ms\n"
+                  " Pushed:   %8u\n"
+                  " - Dropped:   %5u\n"
+                  " - Zero-Copy: %5u\n",
+                  thr_stats.frame_age_avg / 1000.0f,
+                  thr_stats.frame_age_max / 1000.0f,
+                  thr_stats.frames_pushed,
+                  thr_stats.frames_dropped,
+                  thr_stats.frames_zero_copy);
+      }
+#endif
+
       /* TODO/FIXME - localize */
       if (video_st->frame_delay_target > 0)
          len = snprintf(tmp, sizeof(latency_stats),
@@ -4142,6 +4165,7 @@ void video_driver_frame(const void *data, unsigned width,
             " - Deviation: %5.2f %%\n"
             " Frames:   %8" PRIu64"\n"
             " - Dropped:   %5u\n"
+            "%s"
             "AUDIO: %s\n"
             " Saturation:  %5.2f %%\n"
             " Deviation:   %5.2f %%\n"
@@ -4171,6 +4195,7 @@ void video_driver_frame(const void *data, unsigned width,
             100.0f * stddev,
             video_st->frame_count,
             video_st->frame_drop_count,
+            thread_stats,
             audio_state_get_ptr()->current_audio->ident,
             audio_stats.average_buffer_saturation,
             audio_stats.std_deviation_percentage,
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <compat/strl.h>
 #include <file/file_path.h>
@@ -36,6 +37,14 @@
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <retro_atomic.h>
+#ifdef HAVE_RETRO_ATOMIC
+#include <memalign.h>
+#endif
+#endif
+
 struct rarch_soft_plug
 {
 #ifdef HAVE_DYLIB
@@ -61,13 +70,369 @@ struct rarch_softfilter
    unsigned threads;
 
 #ifdef HAVE_THREADS
+#ifdef HAVE_RETRO_ATOMIC
+   struct filter_pool *pool;
+#else
    struct filter_thread_data *thread_data;
 #endif
+#endif
 };
 
-#ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+/* Workers stay alive for the lifetime of the filter. Each frame the
+ * caller bumps a generation counter; workers (and the caller itself)
+ * then claim packets off a shared counter until none are left. Both
+ * sides busy-wait for a while before parking on a condition variable,
+ * so back-to-back frames never touch the kernel. Workers that tuning
+ * left out sleep on a condition of their own until they are needed.
+ *
+ * Every word another thread writes lives on its own cache line. */
+
+#define FILTER_CACHE_LINE 64
+
+/* How many times to poll before parking. */
+#define FILTER_SPIN_COUNT 2048
+
+/* A worker is only worth waking if it gets at least
+ * this much work per frame. */
+#define FILTER_MIN_WORK_USEC 50
+
+/* Frames of measured packet cost between re-tuning
+ * how many workers take part. */
+#define FILTER_TUNE_FRAMES 32
+
+typedef struct filter_counter
+{
+   retro_atomic_uint_t val;
+   uint8_t pad[FILTER_CACHE_LINE - sizeof(retro_atomic_uint_t)];
+} filter_counter_t;
+
+struct filter_worker
+{
+   sthread_t *thread;
+   struct filter_pool *pool;
+   retro_time_t busy_usec;    /* Time spent in packets, reset on tune */
+   unsigned index;
+   uint8_t pad[FILTER_CACHE_LINE - 2 * sizeof(void*)
+      - sizeof(retro_time_t) - sizeof(unsigned)];
+};
+
+struct filter_pool
+{
+   filter_counter_t generation;  /* Bumped by the caller to start a frame */
+   filter_counter_t next_packet; /* Next unclaimed packet */
+   filter_counter_t pending;     /* Packets not finished yet */
+   filter_counter_t parked;      /* Active workers asleep in park_cond */
+   filter_counter_t waiting;     /* Caller asleep in done_cond */
+   filter_counter_t active;      /* Workers taking part in a frame */
+   filter_counter_t die;
+
+   const struct softfilter_work_packet *packets;
+   void *userdata;
+   struct filter_worker *workers;
+   slock_t *lock;
+   scond_t *park_cond;
+   scond_t *idle_cond;           /* Workers at or above 'active' */
+   scond_t *done_cond;
+   unsigned num_workers;
+   unsigned num_packets;
+
+   /* Only touched by the caller */
+   retro_time_t work_usec;
+   unsigned frames;
+};
+
+static void filter_pool_run(struct filter_pool *pool,
+      retro_time_t *busy_usec)
+{
+   for (;;)
+   {
+      retro_time_t start;
+      const struct softfilter_work_packet *packet;
+      uint32_t i = retro_atomic_fetch_add(&pool->next_packet.val, 1);
+
+      if (i >= pool->num_packets)
+         break;
+
+      packet = &pool->packets[i];
+      start  = cpu_features_get_time_usec();
+      if (packet->work)
+         packet->work(pool->userdata, packet->thread_data);
+      *busy_usec += cpu_features_get_time_usec() - start;
+
+      /* Last packet of the frame: wake the caller if it gave up
+       * spinning. Pairs with the fence in filter_pool_wait_done(). */
+      if (retro_atomic_fetch_add(&pool->pending.val, (uint32_t)-1) == 1)
+      {
+         retro_atomic_fence();
+         if (retro_atomic_load_acquire(&pool->waiting.val))
+         {
+            slock_lock(pool->lock);
+            scond_signal(pool->done_cond);
+            slock_unlock(pool->lock);
+         }
+      }
+   }
+}
+
+static uint32_t filter_pool_wait_generation(struct filter_pool *pool,
+      uint32_t seen)
+{
+   unsigned spins;
+   uint32_t gen;
+
+   for (spins = 0; spins < FILTER_SPIN_COUNT; spins++)
+   {
+      if ((gen = retro_atomic_load_acquire(&pool->generation.val)) != seen)
+         return gen;
+      retro_cpu_relax();
+   }
+
+   slock_lock(pool->lock);
+   retro_atomic_fetch_add(&pool->parked.val, 1);
+   /* Pairs with the fence in filter_pool_kick(). */
+   retro_atomic_fence();
+   while ((gen = retro_atomic_load_acquire(&pool->generation.val)) == seen)
+      scond_wait(pool->park_cond, pool->lock);
+   retro_atomic_fetch_add(&pool->parked.val, (uint32_t)-1);
+   slock_unlock(pool->lock);
+
+   return gen;
+}
+
+static void filter_pool_kick(struct filter_pool *pool)
+{
+   retro_atomic_fetch_add(&pool->generation.val, 1);
+   retro_atomic_fence();
+   if (retro_atomic_load_acquire(&pool->parked.val))
+   {
+      slock_lock(pool->lock);
+      scond_broadcast(pool->park_cond);
+      slock_unlock(pool->lock);
+   }
+}
+
+/* Sleeps until tuning lets worker 'index' take part again,
+ * so idle workers neither spin nor wake every frame. */
+static void filter_pool_wait_active(struct filter_pool *pool,
+      unsigned index)
+{
+   slock_lock(pool->lock);
+   while (     index >= retro_atomic_load_acquire(&pool->active.val)
+         && !retro_atomic_load_acquire(&pool->die.val))
+      scond_wait(pool->idle_cond, pool->lock);
+   slock_unlock(pool->lock);
+}
+
+/* Changes how many workers take part, waking any it adds. */
+static void filter_pool_set_active(struct filter_pool *pool,
+      unsigned active)
+{
+   if (active <= retro_atomic_load_acquire(&pool->active.val))
+   {
+      retro_atomic_store_release(&pool->active.val, active);
+      return;
+   }
+
+   slock_lock(pool->lock);
+   retro_atomic_store_release(&pool->active.val, active);
+   scond_broadcast(pool->idle_cond);
+   slock_unlock(pool->lock);
+}
+
+static void filter_pool_wait_done(struct filter_pool *pool)
+{
+   unsigned spins;
+
+   for (spins = 0; spins < FILTER_SPIN_COUNT; spins++)
+   {
+      if (!retro_atomic_load_acquire(&pool->pending.val))
+         return;
+      retro_cpu_relax();
+   }
+
+   slock_lock(pool->lock);
+   retro_atomic_store_release(&pool->waiting.val, 1);
+   retro_atomic_fence();
+   while (retro_atomic_load_acquire(&pool->pending.val))
+      scond_wait(pool->done_cond, pool->lock);
+   retro_atomic_store_release(&pool->waiting.val, 0);
+   slock_unlock(pool->lock);
+}
+
+static void filter_worker_loop(void *data)
+{
+   struct filter_worker *worker = (struct filter_worker*)data;
+   struct filter_pool   *pool   = worker->pool;
+   uint32_t seen                = 0;
+
+   for (;;)
+   {
+      if (worker->index >= retro_atomic_load_acquire(&pool->active.val))
+         filter_pool_wait_active(pool, worker->index);
+
+      seen = filter_pool_wait_generation(pool, seen);
+
+      if (retro_atomic_load_acquire(&pool->die.val))
+         break;
 
+      if (worker->index < retro_atomic_load_acquire(&pool->active.val))
+         filter_pool_run(pool, &worker->busy_usec);
+   }
+}
+
+/* Picks how many workers to wake from the average packet
+ * cost over the last FILTER_TUNE_FRAMES frames, so cheap
+ * filters stop paying for wakeups they cannot amortize. */
+static void filter_pool_tune(struct filter_pool *pool,
+      retro_time_t caller_usec)
+{
+   unsigned i;
+   retro_time_t slice_usec;
+   unsigned threads;
+
+   pool->work_usec += caller_usec;
+   for (i = 0; i < pool->num_workers; i++)
+   {
+      pool->work_usec               += pool->workers[i].busy_usec;
+      pool->workers[i].busy_usec     = 0;
+   }
+
+   if (++pool->frames < FILTER_TUNE_FRAMES)
+      return;
+
+   slice_usec = pool->work_usec / (pool->frames * pool->num_packets);
+   threads    = (unsigned)(slice_usec * pool->num_packets
+         / FILTER_MIN_WORK_USEC);
+   if (threads < 1)
+      threads = 1;
+   if (threads > pool->num_workers + 1)
+      threads = pool->num_workers + 1;
+
+   filter_pool_set_active(pool, threads - 1);
+   pool->work_usec = 0;
+   pool->frames    = 0;
+}
+
+static void filter_pool_process(struct filter_pool *pool,
+      const struct softfilter_work_packet *packets)
+{
+   retro_time_t caller_usec = 0;
+
+   pool->packets = packets;
+
+   if (!retro_atomic_load_acquire(&pool->active.val))
+   {
+      unsigned i;
+      /* Not worth waking anyone; keep timing so
+       * a heavier workload can bring them back. */
+      for (i = 0; i < pool->num_packets; i++)
+      {
+         retro_time_t start = cpu_features_get_time_usec();
+         if (packets[i].work)
+            packets[i].work(pool->userdata, packets[i].thread_data);
+         caller_usec += cpu_features_get_time_usec() - start;
+      }
+   }
+   else
+   {
+      /* Workers that lost the race for the previous frame may still
+       * bump next_packet, so the packets are published first. */
+      retro_atomic_store_release(&pool->pending.val, pool->num_packets);
+      retro_atomic_store_release(&pool->next_packet.val, 0);
+      filter_pool_kick(pool);
+
+      filter_pool_run(pool, &caller_usec);
+      filter_pool_wait_done(pool);
+   }
+
+   filter_pool_tune(pool, caller_usec);
+}
+
+static void filter_pool_free(struct filter_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->num_workers)
+   {
+      retro_atomic_store_release(&pool->die.val, 1);
+      filter_pool_kick(pool);
+      slock_lock(pool->lock);
+      scond_broadcast(pool->idle_cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_workers; i++)
+   {
+      if (pool->workers[i].thread)
+         sthread_join(pool->workers[i].thread);
+   }
+
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->idle_cond)
+      scond_free(pool->idle_cond);
+   if (pool->park_cond)
+      scond_free(pool->park_cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+   if (pool->workers)
+      memalign_free(pool->workers);
+   memalign_free(pool);
+}
+
+/* The caller takes a share of the packets itself,
+ * so only threads - 1 workers are spawned. */
+static struct filter_pool *filter_pool_new(void *userdata, unsigned threads)
+{
+   unsigned i;
+   struct filter_pool *pool = (struct filter_pool*)
+      memalign_alloc(FILTER_CACHE_LINE, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   memset(pool, 0, sizeof(*pool));
+   pool->userdata    = userdata;
+   pool->num_packets = threads;
+
+   if (!(pool->lock      = slock_new()))
+      goto error;
+   if (!(pool->park_cond = scond_new()))
+      goto error;
+   if (!(pool->idle_cond = scond_new()))
+      goto error;
+   if (!(pool->done_cond = scond_new()))
+      goto error;
+   if (!(pool->workers   = (struct filter_worker*)memalign_alloc(
+               FILTER_CACHE_LINE, (threads - 1) * sizeof(*pool->workers))))
+      goto error;
+
+   memset(pool->workers, 0, (threads - 1) * sizeof(*pool->workers));
+   retro_atomic_store_release(&pool->active.val, threads - 1);
+
+   for (i = 0; i < threads - 1; i++)
+   {
+      pool->workers[i].pool   = pool;
+      pool->workers[i].index  = i;
+      if (!(pool->workers[i].thread = sthread_create(
+                  filter_worker_loop, &pool->workers[i])))
+         goto error;
+      pool->num_workers++;
+   }
+
+   return pool;
+
+error:
+   filter_pool_free(pool);
+   return NULL;
+}
+#elif defined(HAVE_THREADS)
+/* No atomics on this toolchain; one lock and
+ * condition variable per thread instead. */
 struct filter_thread_data
 {
    sthread_t *thread;
@@ -233,7 +598,13 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       return false;
    }
 
-#ifdef HAVE_THREADS
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+   if (filt->threads > 1)
+   {
+      if (!(filt->pool = filter_pool_new(filt->impl_data, threads)))
+         return false;
+   }
+#elif defined(HAVE_THREADS)
    if (filt->threads > 1)
    {
       unsigned i;
@@ -496,8 +867,10 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    free(filt->plugs);
 #endif
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+   filter_pool_free(filt->pool);
+#elif defined(HAVE_THREADS)
+   if (filt->thread_data)
    {
       for (i = 0; i < filt->threads; i++)
       {
@@ -557,8 +930,14 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       filt->impl->get_work_packets(filt->impl_data, filt->packets,
             output, output_stride, input, width, height, input_stride);
 
-#ifdef HAVE_THREADS
-   if (filt->threads > 1)
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+   if (filt->pool)
+   {
+      filter_pool_process(filt->pool, filt->packets);
+      return;
+   }
+#elif defined(HAVE_THREADS)
+   if (filt->thread_data)
    {
       /* Fire off workers */
       for (i = 0; i < filt->threads; i++)
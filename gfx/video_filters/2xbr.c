@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <boolean.h>
 #include <retro_endianness.h>
 
 #ifdef RARCH_INTERNAL
@@ -47,6 +48,41 @@
 
 #define TWOXBR_SCALE 2
 
+/* Vectorized RGB565 rows (see twoxbr_simd_row_rgb565). They are
+ * built regardless of the target flags (per-function target
+ * attribute) and only picked when the CPU reports the extension. */
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__)) \
+   && (defined(__clang__) || (defined(__GNUC__) \
+   && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define TWOXBR_SIMD
+#define TWOXBR_X86
+#define TWOXBR_SSE41_TARGET __attribute__((target("sse4.1")))
+#define TWOXBR_AVX2_TARGET  __attribute__((target("avx2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define TWOXBR_SIMD
+#define TWOXBR_X86
+#define TWOXBR_SSE41_TARGET
+#define TWOXBR_AVX2_TARGET
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TWOXBR_SIMD
+#define TWOXBR_NEON
+#endif
+
+#ifdef TWOXBR_X86
+#include <immintrin.h>
+#endif
+
+#ifdef TWOXBR_NEON
+#include <arm_neon.h>
+#endif
+
+/* Filters as many leading pixels of a row as it has whole
+ * vectors for and returns how many that was. yuv[k] holds
+ * RGBtoYUV of the row k - 2 lines down, from column -2. */
+typedef unsigned (*twoxbr_row_t)(const uint16_t *in, uint16_t *out,
+      unsigned width, unsigned nextline, unsigned dst_stride,
+      const uint16_t *const *yuv);
+
 struct softfilter_thread_data
 {
    void *out_data;
@@ -58,6 +94,10 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   /* Five RGBtoYUV rows for the vector path and
+    * the input line each one was made from. */
+   uint16_t *yuv;
+   const uint16_t *yuv_line[5];
 };
 
 struct filter_data
@@ -65,11 +105,15 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   unsigned max_width;
+   twoxbr_row_t row_rgb565;
    uint16_t RGBtoYUV[65536];
    uint16_t tbl_5_to_8[32];
    uint16_t tbl_6_to_8[64];
 };
 
+static twoxbr_row_t twoxbr_simd_row_rgb565(softfilter_simd_mask_t simd);
+
 static unsigned twoxbr_generic_input_fmts(void)
 {
    return SOFTFILTER_FMT_RGB565 | SOFTFILTER_FMT_XRGB8888;
@@ -225,22 +269,33 @@ static void *twoxbr_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
-   filt->in_fmt  = in_fmt;
+   filt->threads   = 1;
+   filt->in_fmt    = in_fmt;
+   filt->max_width = max_width;
    if (!filt->workers)
    {
       free(filt);
       return NULL;
    }
 
+   if (in_fmt == SOFTFILTER_FMT_RGB565)
+      filt->row_rgb565 = twoxbr_simd_row_rgb565(simd);
+
+   /* The vector path falls back to plain C per
+    * worker if its rows could not be allocated. */
+   if (filt->row_rgb565)
+      for (i = 0; i < filt->threads; i++)
+         filt->workers[i].yuv = (uint16_t*)
+            malloc(5 * (max_width + 4) * sizeof(uint16_t));
+
    SetupFormat(filt);
 
    return filt;
@@ -256,11 +311,14 @@ static void twoxbr_generic_output(void *data,
 
 static void twoxbr_generic_destroy(void *data)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)data;
 
    if (!filt)
       return;
 
+   for (i = 0; i < filt->threads; i++)
+      free(filt->workers[i].yuv);
    free(filt->workers);
    free(filt);
 }
@@ -535,6 +593,318 @@ int eq8(uint32_t A, uint32_t B,
          out += 2
 #endif
 
+#ifdef TWOXBR_SIMD
+/*
+ * Vector form of FILTRO_RGB565/twoxbr_function: every lane
+ * runs the same four rotations as the scalar loop, with each
+ * branch turned into a lane mask, so the result is identical.
+ * Lanes are 16 bits wide, which is what the scalar code
+ * stores e, i, ke and ki in:
+ * - df() is the absolute difference of two RGBtoYUV values.
+ * - (ke<<1) <= ki is tested as ke <= ki>>1, so it cannot wrap.
+ * - The ALPHA_BLEND_*_W macros reduce to
+ *   c + (((c' - c) * w) >> 8) on each 5/6-bit channel.
+ *
+ * The outer ring of the 5x5 window only enters df(), so
+ * only its RGBtoYUV values are loaded. Each ISA defines
+ * the TWOXBR_V* primitives and instantiates TWOXBR_SIMD_ROW.
+ */
+
+#define TWOXBR_VDF(A, B)  TWOXBR_VABSDIFF(y##A, y##B)
+#define TWOXBR_VEQ(A, B)  TWOXBR_VLEU(TWOXBR_VDF(A, B), eq_max)
+#define TWOXBR_VNE(A, B)  TWOXBR_VNOT(TWOXBR_VCMPEQ(A, B))
+
+#define TWOXBR_VBLEND(dst, w) TWOXBR_VOR(TWOXBR_VOR( \
+      TWOXBR_VSLLI(TWOXBR_VADD(TWOXBR_VSRLI(dst, 11), TWOXBR_VSRAI(TWOXBR_VMUL( \
+         TWOXBR_VSUB(px_r, TWOXBR_VSRLI(dst, 11)), w), 8)), 11), \
+      TWOXBR_VSLLI(TWOXBR_VADD(TWOXBR_VAND(TWOXBR_VSRLI(dst, 5), mask_g), \
+         TWOXBR_VSRAI(TWOXBR_VMUL(TWOXBR_VSUB(px_g, \
+         TWOXBR_VAND(TWOXBR_VSRLI(dst, 5), mask_g)), w), 8)), 5)), \
+      TWOXBR_VADD(TWOXBR_VAND(dst, mask_b), TWOXBR_VSRAI(TWOXBR_VMUL( \
+         TWOXBR_VSUB(px_b, TWOXBR_VAND(dst, mask_b)), w), 8)))
+
+#define TWOXBR_VBLEND_128(dst) TWOXBR_VADD( \
+      TWOXBR_VSRLI(TWOXBR_VAND(px, lbmask), 1), \
+      TWOXBR_VSRLI(TWOXBR_VAND(dst, lbmask), 1))
+
+#define TWOXBR_VFILTRO(PE, _PI, PH, PF, PG, PC, PD, PB, PA, G5, C4, G0, D0, C1, B1, F4, I4, H5, I5, A0, A1, N0, N1, N2, N3) \
+   ex = TWOXBR_VAND(TWOXBR_VNE(PE, PH), TWOXBR_VNE(PE, PF)); \
+   if (TWOXBR_VANY(ex)) \
+   { \
+      e  = TWOXBR_VADD(TWOXBR_VADD( \
+               TWOXBR_VADD(TWOXBR_VDF(PE, PC), TWOXBR_VDF(PE, PG)), \
+               TWOXBR_VADD(TWOXBR_VDF(_PI, H5), TWOXBR_VDF(_PI, F4))), \
+            TWOXBR_VSLLI(TWOXBR_VDF(PH, PF), 2)); \
+      i  = TWOXBR_VADD(TWOXBR_VADD( \
+               TWOXBR_VADD(TWOXBR_VDF(PH, PD), TWOXBR_VDF(PH, I5)), \
+               TWOXBR_VADD(TWOXBR_VDF(PF, I4), TWOXBR_VDF(PF, PB))), \
+            TWOXBR_VSLLI(TWOXBR_VDF(PE, _PI), 2)); \
+      /* if ((e<i) && (...)) */ \
+      hit = TWOXBR_VOR(TWOXBR_VOR( \
+               TWOXBR_VNOT(TWOXBR_VOR(TWOXBR_VEQ(PF, PB), TWOXBR_VEQ(PF, PC))), \
+               TWOXBR_VNOT(TWOXBR_VOR(TWOXBR_VEQ(PH, PD), TWOXBR_VEQ(PH, PG)))), \
+            TWOXBR_VOR(TWOXBR_VOR(TWOXBR_VEQ(PE, PG), TWOXBR_VEQ(PE, PC)), \
+               TWOXBR_VAND(TWOXBR_VEQ(PE, _PI), TWOXBR_VOR( \
+                  TWOXBR_VNOT(TWOXBR_VOR(TWOXBR_VEQ(PF, F4), TWOXBR_VEQ(PF, I4))), \
+                  TWOXBR_VNOT(TWOXBR_VOR(TWOXBR_VEQ(PH, H5), TWOXBR_VEQ(PH, I5))))))); \
+      hit = TWOXBR_VAND(ex, TWOXBR_VAND(hit, TWOXBR_VNOT(TWOXBR_VLEU(i, e)))); \
+      /* else if (e<=i) */ \
+      dia = TWOXBR_VAND(TWOXBR_VAND(ex, TWOXBR_VNOT(hit)), TWOXBR_VLEU(e, i)); \
+      ke = TWOXBR_VDF(PF, PG); \
+      ki = TWOXBR_VDF(PH, PC); \
+      left = TWOXBR_VAND(hit, TWOXBR_VAND(TWOXBR_VLEU(ke, TWOXBR_VSRLI(ki, 1)), \
+            TWOXBR_VAND(TWOXBR_VNE(PE, PG), TWOXBR_VNE(PD, PG)))); \
+      up   = TWOXBR_VAND(hit, TWOXBR_VAND(TWOXBR_VLEU(ki, TWOXBR_VSRLI(ke, 1)), \
+            TWOXBR_VAND(TWOXBR_VNE(PE, PC), TWOXBR_VNE(PB, PC)))); \
+      px   = TWOXBR_VSEL(TWOXBR_VLEU(TWOXBR_VDF(PE, PF), TWOXBR_VDF(PE, PH)), PF, PH); \
+      px_r = TWOXBR_VSRLI(px, 11); \
+      px_g = TWOXBR_VAND(TWOXBR_VSRLI(px, 5), mask_g); \
+      px_b = TWOXBR_VAND(px, mask_b); \
+      /* DIA_2X, UP_2_2X/LEFT_2_2X, LEFT_UP_2_2X */ \
+      E##N3 = TWOXBR_VSEL(TWOXBR_VAND(left, up), TWOXBR_VBLEND(E##N3, w224), \
+            TWOXBR_VSEL(TWOXBR_VOR(left, up), TWOXBR_VBLEND(E##N3, w192), \
+            TWOXBR_VSEL(TWOXBR_VOR(hit, dia), TWOXBR_VBLEND_128(E##N3), E##N3))); \
+      E##N2 = TWOXBR_VSEL(left, TWOXBR_VBLEND(E##N2, w64), E##N2); \
+      E##N1 = TWOXBR_VSEL(TWOXBR_VAND(left, up), E##N2, \
+            TWOXBR_VSEL(up, TWOXBR_VBLEND(E##N1, w64), E##N1)); \
+   }
+
+#define TWOXBR_SIMD_ROW(name, TARGET, LANES) \
+static TARGET unsigned name(const uint16_t *in, uint16_t *out, \
+      unsigned width, unsigned nextline, unsigned dst_stride, \
+      const uint16_t *const *yuv) \
+{ \
+   unsigned x; \
+   const TWOXBR_V eq_max = TWOXBR_VSET1(154); \
+   const TWOXBR_V lbmask = TWOXBR_VSET1(PG_LBMASK565); \
+   const TWOXBR_V mask_g = TWOXBR_VSET1(0x3f); \
+   const TWOXBR_V mask_b = TWOXBR_VSET1(0x1f); \
+   const TWOXBR_V w64    = TWOXBR_VSET1(64); \
+   const TWOXBR_V w192   = TWOXBR_VSET1(192); \
+   const TWOXBR_V w224   = TWOXBR_VSET1(224); \
+   TWOXBR_VONES_DECL; \
+ \
+   for (x = 0; x + LANES <= width; x += LANES) \
+   { \
+      TWOXBR_V ex, e, i, hit, dia, ke, ki, left, up; \
+      TWOXBR_V px, px_r, px_g, px_b; \
+      TWOXBR_V E0, E1, E2, E3; \
+      const uint16_t *p   = in + x; \
+      const TWOXBR_V PA   = TWOXBR_VLOAD(p - nextline - 1); \
+      const TWOXBR_V PB   = TWOXBR_VLOAD(p - nextline); \
+      const TWOXBR_V PC   = TWOXBR_VLOAD(p - nextline + 1); \
+      const TWOXBR_V PD   = TWOXBR_VLOAD(p - 1); \
+      const TWOXBR_V PE   = TWOXBR_VLOAD(p); \
+      const TWOXBR_V PF   = TWOXBR_VLOAD(p + 1); \
+      const TWOXBR_V PG   = TWOXBR_VLOAD(p + nextline - 1); \
+      const TWOXBR_V PH   = TWOXBR_VLOAD(p + nextline); \
+      const TWOXBR_V _PI  = TWOXBR_VLOAD(p + nextline + 1); \
+      const TWOXBR_V yA1  = TWOXBR_VLOAD(yuv[0] + x - 1); \
+      const TWOXBR_V yB1  = TWOXBR_VLOAD(yuv[0] + x); \
+      const TWOXBR_V yC1  = TWOXBR_VLOAD(yuv[0] + x + 1); \
+      const TWOXBR_V yA0  = TWOXBR_VLOAD(yuv[1] + x - 2); \
+      const TWOXBR_V yPA  = TWOXBR_VLOAD(yuv[1] + x - 1); \
+      const TWOXBR_V yPB  = TWOXBR_VLOAD(yuv[1] + x); \
+      const TWOXBR_V yPC  = TWOXBR_VLOAD(yuv[1] + x + 1); \
+      const TWOXBR_V yC4  = TWOXBR_VLOAD(yuv[1] + x + 2); \
+      const TWOXBR_V yD0  = TWOXBR_VLOAD(yuv[2] + x - 2); \
+      const TWOXBR_V yPD  = TWOXBR_VLOAD(yuv[2] + x - 1); \
+      const TWOXBR_V yPE  = TWOXBR_VLOAD(yuv[2] + x); \
+      const TWOXBR_V yPF  = TWOXBR_VLOAD(yuv[2] + x + 1); \
+      const TWOXBR_V yF4  = TWOXBR_VLOAD(yuv[2] + x + 2); \
+      const TWOXBR_V yG0  = TWOXBR_VLOAD(yuv[3] + x - 2); \
+      const TWOXBR_V yPG  = TWOXBR_VLOAD(yuv[3] + x - 1); \
+      const TWOXBR_V yPH  = TWOXBR_VLOAD(yuv[3] + x); \
+      const TWOXBR_V y_PI = TWOXBR_VLOAD(yuv[3] + x + 1); \
+      const TWOXBR_V yI4  = TWOXBR_VLOAD(yuv[3] + x + 2); \
+      const TWOXBR_V yG5  = TWOXBR_VLOAD(yuv[4] + x - 1); \
+      const TWOXBR_V yH5  = TWOXBR_VLOAD(yuv[4] + x); \
+      const TWOXBR_V yI5  = TWOXBR_VLOAD(yuv[4] + x + 1); \
+ \
+      E0 = E1 = E2 = E3 = PE; \
+      TWOXBR_VFILTRO(PE, _PI, PH, PF, PG, PC, PD, PB, PA, G5, C4, G0, D0, C1, B1, F4, I4, H5, I5, A0, A1, 0, 1, 2, 3) \
+      TWOXBR_VFILTRO(PE, PC, PF, PB, _PI, PA, PH, PD, PG, I4, A1, I5, H5, A0, D0, B1, C1, F4, C4, G5, G0, 2, 0, 3, 1) \
+      TWOXBR_VFILTRO(PE, PA, PB, PD, PC, PG, PF, PH, _PI, C1, G0, C4, F4, G5, H5, D0, A0, B1, A1, I4, I5, 3, 2, 1, 0) \
+      TWOXBR_VFILTRO(PE, PG, PD, PH, PA, _PI, PB, PF, PC, A0, I5, A1, B1, I4, F4, H5, G5, D0, G0, C1, C4, 1, 3, 0, 2) \
+ \
+      TWOXBR_VSTORE_PAIR(out + 2 * x, E0, E1); \
+      TWOXBR_VSTORE_PAIR(out + dst_stride + 2 * x, E2, E3); \
+   } \
+ \
+   return x; \
+}
+
+#ifdef TWOXBR_X86
+#define TWOXBR_V                 __m128i
+#define TWOXBR_VONES_DECL        const __m128i ones = _mm_set1_epi32(-1)
+#define TWOXBR_VLOAD(p)          _mm_loadu_si128((const __m128i*)(p))
+#define TWOXBR_VSET1(x)          _mm_set1_epi16(x)
+#define TWOXBR_VAND(a, b)        _mm_and_si128(a, b)
+#define TWOXBR_VOR(a, b)         _mm_or_si128(a, b)
+#define TWOXBR_VNOT(a)           _mm_xor_si128(a, ones)
+#define TWOXBR_VADD(a, b)        _mm_add_epi16(a, b)
+#define TWOXBR_VSUB(a, b)        _mm_sub_epi16(a, b)
+#define TWOXBR_VMUL(a, b)        _mm_mullo_epi16(a, b)
+#define TWOXBR_VSLLI(a, n)       _mm_slli_epi16(a, n)
+#define TWOXBR_VSRLI(a, n)       _mm_srli_epi16(a, n)
+#define TWOXBR_VSRAI(a, n)       _mm_srai_epi16(a, n)
+#define TWOXBR_VCMPEQ(a, b)      _mm_cmpeq_epi16(a, b)
+#define TWOXBR_VABSDIFF(a, b)    _mm_sub_epi16(_mm_max_epu16(a, b), _mm_min_epu16(a, b))
+#define TWOXBR_VLEU(a, b)        _mm_cmpeq_epi16(_mm_max_epu16(a, b), b)
+#define TWOXBR_VSEL(m, a, b)     _mm_blendv_epi8(b, a, m)
+#define TWOXBR_VANY(m)           (!_mm_testz_si128(m, m))
+#define TWOXBR_VSTORE_PAIR(p, a, b) \
+   _mm_storeu_si128((__m128i*)(p),     _mm_unpacklo_epi16(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi16(a, b))
+
+TWOXBR_SIMD_ROW(twoxbr_row_rgb565_sse41, TWOXBR_SSE41_TARGET, 8)
+
+#undef TWOXBR_V
+#undef TWOXBR_VONES_DECL
+#undef TWOXBR_VLOAD
+#undef TWOXBR_VSET1
+#undef TWOXBR_VAND
+#undef TWOXBR_VOR
+#undef TWOXBR_VNOT
+#undef TWOXBR_VADD
+#undef TWOXBR_VSUB
+#undef TWOXBR_VMUL
+#undef TWOXBR_VSLLI
+#undef TWOXBR_VSRLI
+#undef TWOXBR_VSRAI
+#undef TWOXBR_VCMPEQ
+#undef TWOXBR_VABSDIFF
+#undef TWOXBR_VLEU
+#undef TWOXBR_VSEL
+#undef TWOXBR_VANY
+#undef TWOXBR_VSTORE_PAIR
+
+#define TWOXBR_V                 __m256i
+#define TWOXBR_VONES_DECL        const __m256i ones = _mm256_set1_epi32(-1)
+#define TWOXBR_VLOAD(p)          _mm256_loadu_si256((const __m256i*)(p))
+#define TWOXBR_VSET1(x)          _mm256_set1_epi16(x)
+#define TWOXBR_VAND(a, b)        _mm256_and_si256(a, b)
+#define TWOXBR_VOR(a, b)         _mm256_or_si256(a, b)
+#define TWOXBR_VNOT(a)           _mm256_xor_si256(a, ones)
+#define TWOXBR_VADD(a, b)        _mm256_add_epi16(a, b)
+#define TWOXBR_VSUB(a, b)        _mm256_sub_epi16(a, b)
+#define TWOXBR_VMUL(a, b)        _mm256_mullo_epi16(a, b)
+#define TWOXBR_VSLLI(a, n)       _mm256_slli_epi16(a, n)
+#define TWOXBR_VSRLI(a, n)       _mm256_srli_epi16(a, n)
+#define TWOXBR_VSRAI(a, n)       _mm256_srai_epi16(a, n)
+#define TWOXBR_VCMPEQ(a, b)      _mm256_cmpeq_epi16(a, b)
+#define TWOXBR_VABSDIFF(a, b)    _mm256_sub_epi16(_mm256_max_epu16(a, b), _mm256_min_epu16(a, b))
+#define TWOXBR_VLEU(a, b)        _mm256_cmpeq_epi16(_mm256_max_epu16(a, b), b)
+#define TWOXBR_VSEL(m, a, b)     _mm256_blendv_epi8(b, a, m)
+#define TWOXBR_VANY(m)           (!_mm256_testz_si256(m, m))
+/* unpack works within 128-bit halves, so swap the middle quarters */
+#define TWOXBR_VSTORE_PAIR(p, a, b) \
+   _mm256_storeu_si256((__m256i*)(p), _mm256_permute2x128_si256( \
+         _mm256_unpacklo_epi16(a, b), _mm256_unpackhi_epi16(a, b), 0x20)); \
+   _mm256_storeu_si256((__m256i*)(p) + 1, _mm256_permute2x128_si256( \
+         _mm256_unpacklo_epi16(a, b), _mm256_unpackhi_epi16(a, b), 0x31))
+
+TWOXBR_SIMD_ROW(twoxbr_row_rgb565_avx2, TWOXBR_AVX2_TARGET, 16)
+#endif
+
+#ifdef TWOXBR_NEON
+#define TWOXBR_V                 uint16x8_t
+#define TWOXBR_VONES_DECL        (void)0
+#define TWOXBR_VLOAD(p)          vld1q_u16(p)
+#define TWOXBR_VSET1(x)          vdupq_n_u16(x)
+#define TWOXBR_VAND(a, b)        vandq_u16(a, b)
+#define TWOXBR_VOR(a, b)         vorrq_u16(a, b)
+#define TWOXBR_VNOT(a)           vmvnq_u16(a)
+#define TWOXBR_VADD(a, b)        vaddq_u16(a, b)
+#define TWOXBR_VSUB(a, b)        vsubq_u16(a, b)
+#define TWOXBR_VMUL(a, b)        vmulq_u16(a, b)
+#define TWOXBR_VSLLI(a, n)       vshlq_n_u16(a, n)
+#define TWOXBR_VSRLI(a, n)       vshrq_n_u16(a, n)
+#define TWOXBR_VSRAI(a, n)       vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(a), n))
+#define TWOXBR_VCMPEQ(a, b)      vceqq_u16(a, b)
+#define TWOXBR_VABSDIFF(a, b)    vabdq_u16(a, b)
+#define TWOXBR_VLEU(a, b)        vcleq_u16(a, b)
+#define TWOXBR_VSEL(m, a, b)     vbslq_u16(m, a, b)
+#define TWOXBR_VANY(m)           (vget_lane_u64(vreinterpret_u64_u16( \
+         vorr_u16(vget_low_u16(m), vget_high_u16(m))), 0) != 0)
+#define TWOXBR_VSTORE_PAIR(p, a, b) { \
+   uint16x8x2_t pair_; \
+   pair_.val[0] = a; \
+   pair_.val[1] = b; \
+   vst2q_u16(p, pair_); \
+}
+
+TWOXBR_SIMD_ROW(twoxbr_row_rgb565_neon, , 8)
+#endif
+
+/* Points yuv[k] at RGBtoYUV of the input line k - 2 lines
+ * down, converting only the lines the worker does not hold
+ * yet. With nextline == 0 all five are the same line. */
+static void twoxbr_yuv_rows(const struct filter_data *filt,
+      struct softfilter_thread_data *thr, const uint16_t **yuv,
+      const uint16_t *in, unsigned width, unsigned nextline)
+{
+   unsigned k, j;
+   const uint16_t *line[5];
+   unsigned stride = filt->max_width + 4;
+
+   line[0] = in - nextline - nextline;
+   line[1] = in - nextline;
+   line[2] = in;
+   line[3] = in + nextline;
+   line[4] = in + nextline + nextline;
+
+   for (k = 0; k < 5; k++)
+   {
+      for (j = 0; j < 5; j++)
+         if (thr->yuv_line[j] == line[k])
+            break;
+
+      if (j == 5)
+      {
+         int x;
+         uint16_t *row;
+
+         /* Take a slot none of the five lines is using */
+         for (j = 0; j < 5; j++)
+            if (     thr->yuv_line[j] != line[0]
+                  && thr->yuv_line[j] != line[1]
+                  && thr->yuv_line[j] != line[2]
+                  && thr->yuv_line[j] != line[3]
+                  && thr->yuv_line[j] != line[4])
+               break;
+
+         row = thr->yuv + j * stride + 2;
+         for (x = -2; x < (int)width + 2; x++)
+            row[x] = filt->RGBtoYUV[line[k][x]];
+         thr->yuv_line[j] = line[k];
+      }
+
+      yuv[k] = thr->yuv + j * stride + 2;
+   }
+}
+
+static twoxbr_row_t twoxbr_simd_row_rgb565(softfilter_simd_mask_t simd)
+{
+#ifdef TWOXBR_X86
+   if (simd & SOFTFILTER_SIMD_AVX2)
+      return twoxbr_row_rgb565_avx2;
+   if (simd & SOFTFILTER_SIMD_SSE4)
+      return twoxbr_row_rgb565_sse41;
+#endif
+#ifdef TWOXBR_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+      return twoxbr_row_rgb565_neon;
+#endif
+   return NULL;
+}
+#else
+static twoxbr_row_t twoxbr_simd_row_rgb565(softfilter_simd_mask_t simd)
+{
+   return NULL;
+}
+#endif
+
 static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
       int first, int last, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
@@ -598,7 +968,9 @@ static void twoxbr_generic_xrgb8888(void *data, unsigned width, unsigned height,
    }
 }
 
-static void twoxbr_generic_rgb565(void *data, unsigned width, unsigned height,
+static void twoxbr_generic_rgb565(void *data,
+      struct softfilter_thread_data *thr,
+      unsigned width, unsigned height,
       int first, int last, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
@@ -609,13 +981,37 @@ static void twoxbr_generic_rgb565(void *data, unsigned width, unsigned height,
    uint16_t pg_blue_mask    = BLUE_MASK565;
    uint16_t pg_lbmask       = PG_LBMASK565;
    unsigned nextline        = (last) ? 0 : src_stride;
+#ifdef TWOXBR_SIMD
+   bool simd                = filt->row_rgb565 && thr->yuv
+      && width <= filt->max_width;
+
+   /* The input changes every frame */
+   memset(thr->yuv_line, 0, sizeof(thr->yuv_line));
+#endif
 
    for (; height; height--)
    {
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish        = width;
+
+#ifdef TWOXBR_SIMD
+      if (simd)
+      {
+         unsigned done;
+         const uint16_t *yuv[5];
+
+         twoxbr_yuv_rows(filt, thr, yuv, in, width, nextline);
+         done    = filt->row_rgb565(in, out, width, nextline,
+               dst_stride, yuv);
+         in     += done;
+         out    += 2 * done;
+         finish -= done;
+      }
+#endif
+
+      for (; finish; finish -= 1)
       {
          uint16_t E[4];
          uint16_t ex, e, i, ke, ki, ex2, ex3, px;
@@ -666,7 +1062,7 @@ static void twoxbr_work_cb_rgb565(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   twoxbr_generic_rgb565(data, width, height,
+   twoxbr_generic_rgb565(data, thr, width, height,
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
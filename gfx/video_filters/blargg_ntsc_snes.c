@@ -44,10 +44,17 @@ struct softfilter_thread_data
    int last;
 };
 
+typedef void (*blargg_ntsc_snes_blit_t)(snes_ntsc_t const *ntsc,
+      SNES_NTSC_IN_T const *input, long in_row_width,
+      int burst_phase, int in_width, int in_height,
+      void *rgb_out, long out_pitch, int first, int last);
+
 struct filter_data
 {
    struct softfilter_thread_data *workers;
    struct snes_ntsc_t *ntsc;
+   blargg_ntsc_snes_blit_t blit;
+   blargg_ntsc_snes_blit_t blit_hires;
    unsigned threads;
    unsigned in_fmt;
    int burst;
@@ -172,8 +179,34 @@ static void *blargg_ntsc_snes_generic_create(const struct softfilter_config *con
    }
    /* Apparently the code is not thread-safe,
     * so force single threaded operation... */
-   filt->threads = 1;
-   filt->in_fmt  = in_fmt;
+   filt->threads    = 1;
+   filt->in_fmt     = in_fmt;
+   filt->blit       = retroarch_snes_ntsc_blit;
+   filt->blit_hires = retroarch_snes_ntsc_blit_hires;
+
+   /* The vectorized blitters produce the exact same output. */
+#ifdef SNES_NTSC_AVX2
+   if (simd & SOFTFILTER_SIMD_AVX2)
+   {
+      filt->blit       = retroarch_snes_ntsc_blit_avx2;
+      filt->blit_hires = retroarch_snes_ntsc_blit_hires_avx2;
+   }
+   else
+#endif
+#ifdef SNES_NTSC_SSE41
+   if (simd & SOFTFILTER_SIMD_SSE4)
+   {
+      filt->blit       = retroarch_snes_ntsc_blit_sse41;
+      filt->blit_hires = retroarch_snes_ntsc_blit_hires_sse41;
+   }
+#endif
+#ifdef SNES_NTSC_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+   {
+      filt->blit       = retroarch_snes_ntsc_blit_neon;
+      filt->blit_hires = retroarch_snes_ntsc_blit_hires_neon;
+   }
+#endif
 
    blargg_ntsc_snes_initialize(filt, config, userdata);
 
@@ -208,10 +241,10 @@ static void blargg_ntsc_snes_render_rgb565(void *data, int width, int height,
 {
    struct filter_data *filt = (struct filter_data*)data;
    if (width <= 256 || !hires_blit)
-      retroarch_snes_ntsc_blit(filt->ntsc, input, pitch, filt->burst,
+      filt->blit(filt->ntsc, input, pitch, filt->burst,
             width, height, output, outpitch * 2, first, last);
    else
-      retroarch_snes_ntsc_blit_hires(filt->ntsc, input, pitch, filt->burst,
+      filt->blit_hires(filt->ntsc, input, pitch, filt->burst,
             width, height, output, outpitch * 2, first, last);
 
    filt->burst ^= filt->burst_toggle;
@@ -120,6 +120,43 @@ void retroarch_snes_ntsc_init( snes_ntsc_t* ntsc, snes_ntsc_setup_t const* setup
 
 #ifndef SNES_NTSC_NO_BLITTERS
 
+/* Flushes the last chunk of a row through black input pixels */
+#define SNES_NTSC_FINISH_ROW_( line_out ) {\
+	SNES_NTSC_COLOR_IN( 0, snes_ntsc_black );\
+	SNES_NTSC_RGB_OUT( 0, line_out [0], SNES_NTSC_OUT_DEPTH );\
+	SNES_NTSC_RGB_OUT( 1, line_out [1], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 1, snes_ntsc_black );\
+	SNES_NTSC_RGB_OUT( 2, line_out [2], SNES_NTSC_OUT_DEPTH );\
+	SNES_NTSC_RGB_OUT( 3, line_out [3], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 2, snes_ntsc_black );\
+	SNES_NTSC_RGB_OUT( 4, line_out [4], SNES_NTSC_OUT_DEPTH );\
+	SNES_NTSC_RGB_OUT( 5, line_out [5], SNES_NTSC_OUT_DEPTH );\
+	SNES_NTSC_RGB_OUT( 6, line_out [6], SNES_NTSC_OUT_DEPTH );\
+}
+
+#define SNES_NTSC_FINISH_HIRES_ROW_( line_out ) {\
+	SNES_NTSC_COLOR_IN( 0, snes_ntsc_black );\
+	SNES_NTSC_HIRES_OUT( 0, line_out [0], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 1, snes_ntsc_black );\
+	SNES_NTSC_HIRES_OUT( 1, line_out [1], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 2, snes_ntsc_black );\
+	SNES_NTSC_HIRES_OUT( 2, line_out [2], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 3, snes_ntsc_black );\
+	SNES_NTSC_HIRES_OUT( 3, line_out [3], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 4, snes_ntsc_black );\
+	SNES_NTSC_HIRES_OUT( 4, line_out [4], SNES_NTSC_OUT_DEPTH );\
+\
+	SNES_NTSC_COLOR_IN( 5, snes_ntsc_black );\
+	SNES_NTSC_HIRES_OUT( 5, line_out [5], SNES_NTSC_OUT_DEPTH );\
+	SNES_NTSC_HIRES_OUT( 6, line_out [6], SNES_NTSC_OUT_DEPTH );\
+}
+
 void retroarch_snes_ntsc_blit( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
 		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
 {
@@ -154,18 +191,7 @@ void retroarch_snes_ntsc_blit( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* in
 		}
 
 		/* finish final pixels */
-		SNES_NTSC_COLOR_IN( 0, snes_ntsc_black );
-		SNES_NTSC_RGB_OUT( 0, line_out [0], SNES_NTSC_OUT_DEPTH );
-		SNES_NTSC_RGB_OUT( 1, line_out [1], SNES_NTSC_OUT_DEPTH );
-
-		SNES_NTSC_COLOR_IN( 1, snes_ntsc_black );
-		SNES_NTSC_RGB_OUT( 2, line_out [2], SNES_NTSC_OUT_DEPTH );
-		SNES_NTSC_RGB_OUT( 3, line_out [3], SNES_NTSC_OUT_DEPTH );
-
-		SNES_NTSC_COLOR_IN( 2, snes_ntsc_black );
-		SNES_NTSC_RGB_OUT( 4, line_out [4], SNES_NTSC_OUT_DEPTH );
-		SNES_NTSC_RGB_OUT( 5, line_out [5], SNES_NTSC_OUT_DEPTH );
-		SNES_NTSC_RGB_OUT( 6, line_out [6], SNES_NTSC_OUT_DEPTH );
+		SNES_NTSC_FINISH_ROW_( line_out );
 
 		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
 		input += in_row_width;
@@ -214,24 +240,492 @@ void retroarch_snes_ntsc_blit_hires( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T con
 			line_out += 7;
 		}
 
-		SNES_NTSC_COLOR_IN( 0, snes_ntsc_black );
-		SNES_NTSC_HIRES_OUT( 0, line_out [0], SNES_NTSC_OUT_DEPTH );
+		SNES_NTSC_FINISH_HIRES_ROW_( line_out );
+
+		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+
+/* The SIMD blitters compute a whole chunk at once, one output pixel per
+32-bit lane. Once the chunk's input pixels are in, output pixel x of a
+low-res chunk is the sum of
+
+	kernel0 [x] + kernelx0 [x+7] + kernelx1 [x+19] + kernelx2 [x+31]
+	+ (x < 2 ? kernelp1 [x+26] : kernel1 [x+12])
+	+ (x < 4 ? kernelp2 [x+38] : kernel2 [x+24])
+
+where kernelpN is kernelxN as it was before the chunk (the hires terms are
+listed in retroarch_snes_ntsc_blit_hires_sse41). Each chunk stores 8 pixels;
+the 8th is overwritten by the next chunk or by the scalar row tail, so the
+output matches the plain C blitters bit for bit. */
+
+#define SNES_NTSC_CLAMP_MASK_ ((snes_ntsc_rgb_t) snes_ntsc_clamp_mask)
+#define SNES_NTSC_CLAMP_ADD_  ((snes_ntsc_rgb_t) snes_ntsc_clamp_add)
+
+#if defined(SNES_NTSC_SSE41) || defined(SNES_NTSC_AVX2)
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+	#define SNES_NTSC_SSE41_TARGET
+	#define SNES_NTSC_AVX2_TARGET
+#else
+	#define SNES_NTSC_SSE41_TARGET __attribute__((target("sse4.1")))
+	#define SNES_NTSC_AVX2_TARGET  __attribute__((target("avx2")))
+#endif
+#endif
+
+#ifdef SNES_NTSC_SSE41
+
+#define SNES_NTSC_LOAD_SSE_( p ) _mm_loadu_si128( (__m128i const*) (p) )
+
+/* SNES_NTSC_CLAMP_ and 16-bit SNES_NTSC_RGB_OUT_ on four lanes */
+#define SNES_NTSC_PACK_SSE_( io, shift ) {\
+	__m128i sub_   = _mm_and_si128( _mm_srli_epi32( io, 9 - (shift) ), clamp_mask );\
+	__m128i clamp_ = _mm_sub_epi32( clamp_add, sub_ );\
+	io     = _mm_or_si128( io, clamp_ );\
+	clamp_ = _mm_sub_epi32( clamp_, sub_ );\
+	io     = _mm_and_si128( io, clamp_ );\
+	io     = _mm_or_si128( _mm_or_si128(\
+			_mm_and_si128( _mm_srli_epi32( io, 13 - (shift) ), mask_r ),\
+			_mm_and_si128( _mm_srli_epi32( io,  8 - (shift) ), mask_g ) ),\
+			_mm_and_si128( _mm_srli_epi32( io,  4 - (shift) ), mask_b ) );\
+}
+
+#define SNES_NTSC_CONSTS_SSE_ \
+	__m128i const clamp_mask = _mm_set1_epi32( (int) SNES_NTSC_CLAMP_MASK_ );\
+	__m128i const clamp_add  = _mm_set1_epi32( (int) SNES_NTSC_CLAMP_ADD_ );\
+	__m128i const mask_r     = _mm_set1_epi32( 0xF800 );\
+	__m128i const mask_g     = _mm_set1_epi32( 0x07E0 );\
+	__m128i const mask_b     = _mm_set1_epi32( 0x001F )
+
+SNES_NTSC_SSE41_TARGET
+void retroarch_snes_ntsc_blit_sse41( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
+{
+	int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
+	SNES_NTSC_CONSTS_SSE_;
+	for ( ; in_height; --in_height )
+	{
+		SNES_NTSC_IN_T const* line_in = input;
+		SNES_NTSC_BEGIN_ROW( ntsc, burst_phase,
+				snes_ntsc_black, snes_ntsc_black, SNES_NTSC_ADJ_IN( *line_in ) );
+		snes_ntsc_out_t* line_out = (snes_ntsc_out_t*) rgb_out;
+		int n;
+		++line_in;
+
+		for ( n = chunk_count; n; --n )
+		{
+			snes_ntsc_rgb_t const* kernelp1 = kernelx1;
+			snes_ntsc_rgb_t const* kernelp2 = kernelx2;
+			__m128i lo, hi;
+
+			SNES_NTSC_COLOR_IN( 0, SNES_NTSC_ADJ_IN( line_in [0] ) );
+			SNES_NTSC_COLOR_IN( 1, SNES_NTSC_ADJ_IN( line_in [1] ) );
+			SNES_NTSC_COLOR_IN( 2, SNES_NTSC_ADJ_IN( line_in [2] ) );
+
+			lo = _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernel0 ), SNES_NTSC_LOAD_SSE_( kernelx0 + 7 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx1 + 19 ), SNES_NTSC_LOAD_SSE_( kernelx2 + 31 ) ) );
+			lo = _mm_add_epi32( lo, _mm_add_epi32(
+					_mm_blend_epi16( SNES_NTSC_LOAD_SSE_( kernelp1 + 26 ), SNES_NTSC_LOAD_SSE_( kernel1 + 12 ), 0xF0 ),
+					SNES_NTSC_LOAD_SSE_( kernelp2 + 38 ) ) );
+			hi = _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernel0 + 4 ), SNES_NTSC_LOAD_SSE_( kernelx0 + 11 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx1 + 23 ), SNES_NTSC_LOAD_SSE_( kernelx2 + 35 ) ) );
+			hi = _mm_add_epi32( hi, _mm_add_epi32(
+					SNES_NTSC_LOAD_SSE_( kernel1 + 16 ), SNES_NTSC_LOAD_SSE_( kernel2 + 28 ) ) );
+
+			SNES_NTSC_PACK_SSE_( lo, 1 );
+			SNES_NTSC_PACK_SSE_( hi, 1 );
+			_mm_storeu_si128( (__m128i*) line_out, _mm_packus_epi32( lo, hi ) );
+
+			line_in  += 3;
+			line_out += 7;
+		}
+
+		SNES_NTSC_FINISH_ROW_( line_out );
+
+		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+
+SNES_NTSC_SSE41_TARGET
+void retroarch_snes_ntsc_blit_hires_sse41( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
+{
+	int chunk_count = (in_width - 2) / (snes_ntsc_in_chunk * 2);
+	SNES_NTSC_CONSTS_SSE_;
+	for ( ; in_height; --in_height )
+	{
+		SNES_NTSC_IN_T const* line_in = input;
+		SNES_NTSC_HIRES_ROW( ntsc, burst_phase,
+				snes_ntsc_black, snes_ntsc_black, snes_ntsc_black,
+				SNES_NTSC_ADJ_IN( line_in [0] ),
+				SNES_NTSC_ADJ_IN( line_in [1] ) );
+		snes_ntsc_out_t* line_out = (snes_ntsc_out_t*) rgb_out;
+		int n;
+		line_in += 2;
+
+		for ( n = chunk_count; n; --n )
+		{
+			snes_ntsc_rgb_t const* kernelp1 = kernelx1;
+			snes_ntsc_rgb_t const* kernelp2 = kernelx2;
+			snes_ntsc_rgb_t const* kernelp3 = kernelx3;
+			snes_ntsc_rgb_t const* kernelp4 = kernelx4;
+			snes_ntsc_rgb_t const* kernelp5 = kernelx5;
+			__m128i lo, hi;
+
+			SNES_NTSC_COLOR_IN( 0, SNES_NTSC_ADJ_IN( line_in [0] ) );
+			SNES_NTSC_COLOR_IN( 1, SNES_NTSC_ADJ_IN( line_in [1] ) );
+			SNES_NTSC_COLOR_IN( 2, SNES_NTSC_ADJ_IN( line_in [2] ) );
+			SNES_NTSC_COLOR_IN( 3, SNES_NTSC_ADJ_IN( line_in [3] ) );
+			SNES_NTSC_COLOR_IN( 4, SNES_NTSC_ADJ_IN( line_in [4] ) );
+			SNES_NTSC_COLOR_IN( 5, SNES_NTSC_ADJ_IN( line_in [5] ) );
+
+			/* pixel x:     kernel0 [x] + kernelx0 [x+7]
+			   + kernelx1 [x+6]  + (x < 1 ? kernelp1 [x+13] : kernel1 [x-1])
+			   + kernelx2 [x+19] + (x < 2 ? kernelp2 [x+26] : kernel2 [x+12])
+			   + kernelx3 [x+18] + (x < 3 ? kernelp3 [x+25] : kernel3 [x+11])
+			   + kernelx4 [x+31] + (x < 4 ? kernelp4 [x+38] : kernel4 [x+24])
+			   + kernelx5 [x+30] + (x < 5 ? kernelp5 [x+37] : kernel5 [x+23]) */
+			lo = _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernel0 ), SNES_NTSC_LOAD_SSE_( kernelx0 + 7 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx1 + 6 ), SNES_NTSC_LOAD_SSE_( kernelx2 + 19 ) ) );
+			lo = _mm_add_epi32( lo, _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx3 + 18 ), SNES_NTSC_LOAD_SSE_( kernelx4 + 31 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx5 + 30 ),
+						_mm_alignr_epi8( SNES_NTSC_LOAD_SSE_( kernel1 ), SNES_NTSC_LOAD_SSE_( kernelp1 + 10 ), 12 ) ) ) );
+			lo = _mm_add_epi32( lo, _mm_add_epi32(
+					_mm_add_epi32(
+						_mm_blend_epi16( SNES_NTSC_LOAD_SSE_( kernelp2 + 26 ), SNES_NTSC_LOAD_SSE_( kernel2 + 12 ), 0xF0 ),
+						_mm_blend_epi16( SNES_NTSC_LOAD_SSE_( kernelp3 + 25 ), SNES_NTSC_LOAD_SSE_( kernel3 + 11 ), 0xC0 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelp4 + 38 ), SNES_NTSC_LOAD_SSE_( kernelp5 + 37 ) ) ) );
+
+			hi = _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernel0 + 4 ), SNES_NTSC_LOAD_SSE_( kernelx0 + 11 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx1 + 10 ), SNES_NTSC_LOAD_SSE_( kernelx2 + 23 ) ) );
+			hi = _mm_add_epi32( hi, _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx3 + 22 ), SNES_NTSC_LOAD_SSE_( kernelx4 + 35 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernelx5 + 34 ), SNES_NTSC_LOAD_SSE_( kernel1 + 3 ) ) ) );
+			hi = _mm_add_epi32( hi, _mm_add_epi32(
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernel2 + 16 ), SNES_NTSC_LOAD_SSE_( kernel3 + 15 ) ),
+					_mm_add_epi32( SNES_NTSC_LOAD_SSE_( kernel4 + 28 ),
+						_mm_blend_epi16( SNES_NTSC_LOAD_SSE_( kernelp5 + 41 ), SNES_NTSC_LOAD_SSE_( kernel5 + 27 ), 0xFC ) ) ) );
+
+			SNES_NTSC_PACK_SSE_( lo, 0 );
+			SNES_NTSC_PACK_SSE_( hi, 0 );
+			_mm_storeu_si128( (__m128i*) line_out, _mm_packus_epi32( lo, hi ) );
+
+			line_in  += 6;
+			line_out += 7;
+		}
+
+		SNES_NTSC_FINISH_HIRES_ROW_( line_out );
+
+		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+
+#endif /* SNES_NTSC_SSE41 */
+
+#ifdef SNES_NTSC_AVX2
+
+#define SNES_NTSC_LOAD_AVX_( p ) _mm256_loadu_si256( (__m256i const*) (p) )
+
+#define SNES_NTSC_STORE_AVX_( io, shift, out ) {\
+	__m256i sub_   = _mm256_and_si256( _mm256_srli_epi32( io, 9 - (shift) ), clamp_mask );\
+	__m256i clamp_ = _mm256_sub_epi32( clamp_add, sub_ );\
+	io     = _mm256_or_si256( io, clamp_ );\
+	clamp_ = _mm256_sub_epi32( clamp_, sub_ );\
+	io     = _mm256_and_si256( io, clamp_ );\
+	io     = _mm256_or_si256( _mm256_or_si256(\
+			_mm256_and_si256( _mm256_srli_epi32( io, 13 - (shift) ), mask_r ),\
+			_mm256_and_si256( _mm256_srli_epi32( io,  8 - (shift) ), mask_g ) ),\
+			_mm256_and_si256( _mm256_srli_epi32( io,  4 - (shift) ), mask_b ) );\
+	_mm_storeu_si128( (__m128i*) (out), _mm_packus_epi32(\
+			_mm256_castsi256_si128( io ), _mm256_extracti128_si256( io, 1 ) ) );\
+}
+
+#define SNES_NTSC_CONSTS_AVX_ \
+	__m256i const clamp_mask = _mm256_set1_epi32( (int) SNES_NTSC_CLAMP_MASK_ );\
+	__m256i const clamp_add  = _mm256_set1_epi32( (int) SNES_NTSC_CLAMP_ADD_ );\
+	__m256i const mask_r     = _mm256_set1_epi32( 0xF800 );\
+	__m256i const mask_g     = _mm256_set1_epi32( 0x07E0 );\
+	__m256i const mask_b     = _mm256_set1_epi32( 0x001F )
+
+SNES_NTSC_AVX2_TARGET
+void retroarch_snes_ntsc_blit_avx2( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
+{
+	int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
+	SNES_NTSC_CONSTS_AVX_;
+	for ( ; in_height; --in_height )
+	{
+		SNES_NTSC_IN_T const* line_in = input;
+		SNES_NTSC_BEGIN_ROW( ntsc, burst_phase,
+				snes_ntsc_black, snes_ntsc_black, SNES_NTSC_ADJ_IN( *line_in ) );
+		snes_ntsc_out_t* line_out = (snes_ntsc_out_t*) rgb_out;
+		int n;
+		++line_in;
+
+		for ( n = chunk_count; n; --n )
+		{
+			snes_ntsc_rgb_t const* kernelp1 = kernelx1;
+			snes_ntsc_rgb_t const* kernelp2 = kernelx2;
+			__m256i sum;
+
+			SNES_NTSC_COLOR_IN( 0, SNES_NTSC_ADJ_IN( line_in [0] ) );
+			SNES_NTSC_COLOR_IN( 1, SNES_NTSC_ADJ_IN( line_in [1] ) );
+			SNES_NTSC_COLOR_IN( 2, SNES_NTSC_ADJ_IN( line_in [2] ) );
+
+			sum = _mm256_add_epi32(
+					_mm256_add_epi32( SNES_NTSC_LOAD_AVX_( kernel0 ), SNES_NTSC_LOAD_AVX_( kernelx0 + 7 ) ),
+					_mm256_add_epi32( SNES_NTSC_LOAD_AVX_( kernelx1 + 19 ), SNES_NTSC_LOAD_AVX_( kernelx2 + 31 ) ) );
+			sum = _mm256_add_epi32( sum, _mm256_add_epi32(
+					_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp1 + 26 ), SNES_NTSC_LOAD_AVX_( kernel1 + 12 ), 0xFC ),
+					_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp2 + 38 ), SNES_NTSC_LOAD_AVX_( kernel2 + 24 ), 0xF0 ) ) );
+
+			SNES_NTSC_STORE_AVX_( sum, 1, line_out );
+
+			line_in  += 3;
+			line_out += 7;
+		}
+
+		SNES_NTSC_FINISH_ROW_( line_out );
+
+		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+
+SNES_NTSC_AVX2_TARGET
+void retroarch_snes_ntsc_blit_hires_avx2( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
+{
+	int chunk_count = (in_width - 2) / (snes_ntsc_in_chunk * 2);
+	__m256i const rotate = _mm256_setr_epi32( 7, 0, 1, 2, 3, 4, 5, 6 );
+	SNES_NTSC_CONSTS_AVX_;
+	for ( ; in_height; --in_height )
+	{
+		SNES_NTSC_IN_T const* line_in = input;
+		SNES_NTSC_HIRES_ROW( ntsc, burst_phase,
+				snes_ntsc_black, snes_ntsc_black, snes_ntsc_black,
+				SNES_NTSC_ADJ_IN( line_in [0] ),
+				SNES_NTSC_ADJ_IN( line_in [1] ) );
+		snes_ntsc_out_t* line_out = (snes_ntsc_out_t*) rgb_out;
+		int n;
+		line_in += 2;
+
+		for ( n = chunk_count; n; --n )
+		{
+			snes_ntsc_rgb_t const* kernelp1 = kernelx1;
+			snes_ntsc_rgb_t const* kernelp2 = kernelx2;
+			snes_ntsc_rgb_t const* kernelp3 = kernelx3;
+			snes_ntsc_rgb_t const* kernelp4 = kernelx4;
+			snes_ntsc_rgb_t const* kernelp5 = kernelx5;
+			__m256i sum;
+
+			SNES_NTSC_COLOR_IN( 0, SNES_NTSC_ADJ_IN( line_in [0] ) );
+			SNES_NTSC_COLOR_IN( 1, SNES_NTSC_ADJ_IN( line_in [1] ) );
+			SNES_NTSC_COLOR_IN( 2, SNES_NTSC_ADJ_IN( line_in [2] ) );
+			SNES_NTSC_COLOR_IN( 3, SNES_NTSC_ADJ_IN( line_in [3] ) );
+			SNES_NTSC_COLOR_IN( 4, SNES_NTSC_ADJ_IN( line_in [4] ) );
+			SNES_NTSC_COLOR_IN( 5, SNES_NTSC_ADJ_IN( line_in [5] ) );
+
+			/* same terms as the SSE4.1 version; kernel1 [x-1] is
+			   loaded at kernel1 and rotated up one lane */
+			sum = _mm256_add_epi32(
+					_mm256_add_epi32( SNES_NTSC_LOAD_AVX_( kernel0 ), SNES_NTSC_LOAD_AVX_( kernelx0 + 7 ) ),
+					_mm256_add_epi32( SNES_NTSC_LOAD_AVX_( kernelx1 + 6 ), SNES_NTSC_LOAD_AVX_( kernelx2 + 19 ) ) );
+			sum = _mm256_add_epi32( sum, _mm256_add_epi32(
+					_mm256_add_epi32( SNES_NTSC_LOAD_AVX_( kernelx3 + 18 ), SNES_NTSC_LOAD_AVX_( kernelx4 + 31 ) ),
+					_mm256_add_epi32( SNES_NTSC_LOAD_AVX_( kernelx5 + 30 ),
+						_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp1 + 13 ),
+							_mm256_permutevar8x32_epi32( SNES_NTSC_LOAD_AVX_( kernel1 ), rotate ), 0xFE ) ) ) );
+			sum = _mm256_add_epi32( sum, _mm256_add_epi32(
+					_mm256_add_epi32(
+						_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp2 + 26 ), SNES_NTSC_LOAD_AVX_( kernel2 + 12 ), 0xFC ),
+						_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp3 + 25 ), SNES_NTSC_LOAD_AVX_( kernel3 + 11 ), 0xF8 ) ),
+					_mm256_add_epi32(
+						_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp4 + 38 ), SNES_NTSC_LOAD_AVX_( kernel4 + 24 ), 0xF0 ),
+						_mm256_blend_epi32( SNES_NTSC_LOAD_AVX_( kernelp5 + 37 ), SNES_NTSC_LOAD_AVX_( kernel5 + 23 ), 0xE0 ) ) ) );
+
+			SNES_NTSC_STORE_AVX_( sum, 0, line_out );
+
+			line_in  += 6;
+			line_out += 7;
+		}
+
+		SNES_NTSC_FINISH_HIRES_ROW_( line_out );
+
+		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+
+#endif /* SNES_NTSC_AVX2 */
+
+#ifdef SNES_NTSC_NEON
+#include <arm_neon.h>
+
+#define SNES_NTSC_LOAD_NEON_( p ) vld1q_u32( (p) )
+
+#define SNES_NTSC_PACK_NEON_( io, shift ) {\
+	uint32x4_t sub_   = vandq_u32( vshrq_n_u32( io, 9 - (shift) ), clamp_mask );\
+	uint32x4_t clamp_ = vsubq_u32( clamp_add, sub_ );\
+	io     = vorrq_u32( io, clamp_ );\
+	clamp_ = vsubq_u32( clamp_, sub_ );\
+	io     = vandq_u32( io, clamp_ );\
+	io     = vorrq_u32( vorrq_u32(\
+			vandq_u32( vshrq_n_u32( io, 13 - (shift) ), mask_r ),\
+			vandq_u32( vshrq_n_u32( io,  8 - (shift) ), mask_g ) ),\
+			vandq_u32( vshrq_n_u32( io,  4 - (shift) ), mask_b ) );\
+}
+
+#define SNES_NTSC_CONSTS_NEON_ \
+	uint32x4_t const clamp_mask = vdupq_n_u32( SNES_NTSC_CLAMP_MASK_ );\
+	uint32x4_t const clamp_add  = vdupq_n_u32( SNES_NTSC_CLAMP_ADD_ );\
+	uint32x4_t const mask_r     = vdupq_n_u32( 0xF800 );\
+	uint32x4_t const mask_g     = vdupq_n_u32( 0x07E0 );\
+	uint32x4_t const mask_b     = vdupq_n_u32( 0x001F )
+
+/* lane selects: all-ones picks the second operand of vbslq_u32 */
+static uint32_t const snes_ntsc_neon_lanes [3] [4] = {
+	{ 0, 0, ~0u, ~0u }, /* x >= 2 */
+	{ 0, 0, 0, ~0u },   /* x >= 3 */
+	{ 0, ~0u, ~0u, ~0u } /* x >= 1 (second half: x >= 5) */
+};
+
+void retroarch_snes_ntsc_blit_neon( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
+{
+	int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
+	uint32x4_t const from2 = vld1q_u32( snes_ntsc_neon_lanes [0] );
+	SNES_NTSC_CONSTS_NEON_;
+	for ( ; in_height; --in_height )
+	{
+		SNES_NTSC_IN_T const* line_in = input;
+		SNES_NTSC_BEGIN_ROW( ntsc, burst_phase,
+				snes_ntsc_black, snes_ntsc_black, SNES_NTSC_ADJ_IN( *line_in ) );
+		snes_ntsc_out_t* line_out = (snes_ntsc_out_t*) rgb_out;
+		int n;
+		++line_in;
+
+		for ( n = chunk_count; n; --n )
+		{
+			snes_ntsc_rgb_t const* kernelp1 = kernelx1;
+			snes_ntsc_rgb_t const* kernelp2 = kernelx2;
+			uint32x4_t lo, hi;
+
+			SNES_NTSC_COLOR_IN( 0, SNES_NTSC_ADJ_IN( line_in [0] ) );
+			SNES_NTSC_COLOR_IN( 1, SNES_NTSC_ADJ_IN( line_in [1] ) );
+			SNES_NTSC_COLOR_IN( 2, SNES_NTSC_ADJ_IN( line_in [2] ) );
+
+			lo = vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernel0 ), SNES_NTSC_LOAD_NEON_( kernelx0 + 7 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx1 + 19 ), SNES_NTSC_LOAD_NEON_( kernelx2 + 31 ) ) );
+			lo = vaddq_u32( lo, vaddq_u32(
+					vbslq_u32( from2, SNES_NTSC_LOAD_NEON_( kernel1 + 12 ), SNES_NTSC_LOAD_NEON_( kernelp1 + 26 ) ),
+					SNES_NTSC_LOAD_NEON_( kernelp2 + 38 ) ) );
+			hi = vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernel0 + 4 ), SNES_NTSC_LOAD_NEON_( kernelx0 + 11 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx1 + 23 ), SNES_NTSC_LOAD_NEON_( kernelx2 + 35 ) ) );
+			hi = vaddq_u32( hi, vaddq_u32(
+					SNES_NTSC_LOAD_NEON_( kernel1 + 16 ), SNES_NTSC_LOAD_NEON_( kernel2 + 28 ) ) );
+
+			SNES_NTSC_PACK_NEON_( lo, 1 );
+			SNES_NTSC_PACK_NEON_( hi, 1 );
+			vst1q_u16( line_out, vcombine_u16( vmovn_u32( lo ), vmovn_u32( hi ) ) );
+
+			line_in  += 3;
+			line_out += 7;
+		}
+
+		SNES_NTSC_FINISH_ROW_( line_out );
 
-		SNES_NTSC_COLOR_IN( 1, snes_ntsc_black );
-		SNES_NTSC_HIRES_OUT( 1, line_out [1], SNES_NTSC_OUT_DEPTH );
+		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
+		input += in_row_width;
+		rgb_out = (char*) rgb_out + out_pitch;
+	}
+}
+
+void retroarch_snes_ntsc_blit_hires_neon( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input, long in_row_width,
+		int burst_phase, int in_width, int in_height, void* rgb_out, long out_pitch, int first, int last )
+{
+	int chunk_count = (in_width - 2) / (snes_ntsc_in_chunk * 2);
+	uint32x4_t const from2 = vld1q_u32( snes_ntsc_neon_lanes [0] );
+	uint32x4_t const from3 = vld1q_u32( snes_ntsc_neon_lanes [1] );
+	uint32x4_t const from5 = vld1q_u32( snes_ntsc_neon_lanes [2] );
+	SNES_NTSC_CONSTS_NEON_;
+	for ( ; in_height; --in_height )
+	{
+		SNES_NTSC_IN_T const* line_in = input;
+		SNES_NTSC_HIRES_ROW( ntsc, burst_phase,
+				snes_ntsc_black, snes_ntsc_black, snes_ntsc_black,
+				SNES_NTSC_ADJ_IN( line_in [0] ),
+				SNES_NTSC_ADJ_IN( line_in [1] ) );
+		snes_ntsc_out_t* line_out = (snes_ntsc_out_t*) rgb_out;
+		int n;
+		line_in += 2;
+
+		for ( n = chunk_count; n; --n )
+		{
+			snes_ntsc_rgb_t const* kernelp1 = kernelx1;
+			snes_ntsc_rgb_t const* kernelp2 = kernelx2;
+			snes_ntsc_rgb_t const* kernelp3 = kernelx3;
+			snes_ntsc_rgb_t const* kernelp4 = kernelx4;
+			snes_ntsc_rgb_t const* kernelp5 = kernelx5;
+			uint32x4_t lo, hi;
 
-		SNES_NTSC_COLOR_IN( 2, snes_ntsc_black );
-		SNES_NTSC_HIRES_OUT( 2, line_out [2], SNES_NTSC_OUT_DEPTH );
+			SNES_NTSC_COLOR_IN( 0, SNES_NTSC_ADJ_IN( line_in [0] ) );
+			SNES_NTSC_COLOR_IN( 1, SNES_NTSC_ADJ_IN( line_in [1] ) );
+			SNES_NTSC_COLOR_IN( 2, SNES_NTSC_ADJ_IN( line_in [2] ) );
+			SNES_NTSC_COLOR_IN( 3, SNES_NTSC_ADJ_IN( line_in [3] ) );
+			SNES_NTSC_COLOR_IN( 4, SNES_NTSC_ADJ_IN( line_in [4] ) );
+			SNES_NTSC_COLOR_IN( 5, SNES_NTSC_ADJ_IN( line_in [5] ) );
 
-		SNES_NTSC_COLOR_IN( 3, snes_ntsc_black );
-		SNES_NTSC_HIRES_OUT( 3, line_out [3], SNES_NTSC_OUT_DEPTH );
+			/* same terms as the SSE4.1 version */
+			lo = vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernel0 ), SNES_NTSC_LOAD_NEON_( kernelx0 + 7 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx1 + 6 ), SNES_NTSC_LOAD_NEON_( kernelx2 + 19 ) ) );
+			lo = vaddq_u32( lo, vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx3 + 18 ), SNES_NTSC_LOAD_NEON_( kernelx4 + 31 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx5 + 30 ),
+						vextq_u32( SNES_NTSC_LOAD_NEON_( kernelp1 + 10 ), SNES_NTSC_LOAD_NEON_( kernel1 ), 3 ) ) ) );
+			lo = vaddq_u32( lo, vaddq_u32(
+					vaddq_u32(
+						vbslq_u32( from2, SNES_NTSC_LOAD_NEON_( kernel2 + 12 ), SNES_NTSC_LOAD_NEON_( kernelp2 + 26 ) ),
+						vbslq_u32( from3, SNES_NTSC_LOAD_NEON_( kernel3 + 11 ), SNES_NTSC_LOAD_NEON_( kernelp3 + 25 ) ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelp4 + 38 ), SNES_NTSC_LOAD_NEON_( kernelp5 + 37 ) ) ) );
+
+			hi = vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernel0 + 4 ), SNES_NTSC_LOAD_NEON_( kernelx0 + 11 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx1 + 10 ), SNES_NTSC_LOAD_NEON_( kernelx2 + 23 ) ) );
+			hi = vaddq_u32( hi, vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx3 + 22 ), SNES_NTSC_LOAD_NEON_( kernelx4 + 35 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernelx5 + 34 ), SNES_NTSC_LOAD_NEON_( kernel1 + 3 ) ) ) );
+			hi = vaddq_u32( hi, vaddq_u32(
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernel2 + 16 ), SNES_NTSC_LOAD_NEON_( kernel3 + 15 ) ),
+					vaddq_u32( SNES_NTSC_LOAD_NEON_( kernel4 + 28 ),
+						vbslq_u32( from5, SNES_NTSC_LOAD_NEON_( kernel5 + 27 ), SNES_NTSC_LOAD_NEON_( kernelp5 + 41 ) ) ) ) );
+
+			SNES_NTSC_PACK_NEON_( lo, 0 );
+			SNES_NTSC_PACK_NEON_( hi, 0 );
+			vst1q_u16( line_out, vcombine_u16( vmovn_u32( lo ), vmovn_u32( hi ) ) );
 
-		SNES_NTSC_COLOR_IN( 4, snes_ntsc_black );
-		SNES_NTSC_HIRES_OUT( 4, line_out [4], SNES_NTSC_OUT_DEPTH );
+			line_in  += 6;
+			line_out += 7;
+		}
 
-		SNES_NTSC_COLOR_IN( 5, snes_ntsc_black );
-		SNES_NTSC_HIRES_OUT( 5, line_out [5], SNES_NTSC_OUT_DEPTH );
-		SNES_NTSC_HIRES_OUT( 6, line_out [6], SNES_NTSC_OUT_DEPTH );
+		SNES_NTSC_FINISH_HIRES_ROW_( line_out );
 
 		burst_phase = (burst_phase + 1) % snes_ntsc_burst_count;
 		input += in_row_width;
@@ -239,6 +733,8 @@ void retroarch_snes_ntsc_blit_hires( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T con
 	}
 }
 
+#endif /* SNES_NTSC_NEON */
+
 #endif
 
 #endif
@@ -4,6 +4,8 @@
 #ifndef SNES_NTSC_H
 #define SNES_NTSC_H
 
+#include <stdint.h>
+
 #include "snes_ntsc_config.h"
 
 #ifdef __cplusplus
@@ -59,6 +61,49 @@ void retroarch_snes_ntsc_blit_hires( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T con
 		long in_row_width, int burst_phase, int in_width, int in_height,
 		void* rgb_out, long out_pitch, int first, int last);
 
+/* Vectorized versions of the two blitters above, with identical output. The
+caller picks one for the CPU it runs on. Only built for 16-bit output. */
+#if SNES_NTSC_OUT_DEPTH == 16
+	#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__)) \
+		&& (defined(__clang__) || (defined(__GNUC__) \
+		&& (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+		#define SNES_NTSC_SSE41
+		#define SNES_NTSC_AVX2
+	#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		#define SNES_NTSC_SSE41
+		#define SNES_NTSC_AVX2
+	#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+		#define SNES_NTSC_NEON
+	#endif
+#endif
+
+#ifdef SNES_NTSC_SSE41
+void retroarch_snes_ntsc_blit_sse41( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+		long in_row_width, int burst_phase, int in_width, int in_height,
+		void* rgb_out, long out_pitch, int first, int last);
+void retroarch_snes_ntsc_blit_hires_sse41( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+		long in_row_width, int burst_phase, int in_width, int in_height,
+		void* rgb_out, long out_pitch, int first, int last);
+#endif
+
+#ifdef SNES_NTSC_AVX2
+void retroarch_snes_ntsc_blit_avx2( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+		long in_row_width, int burst_phase, int in_width, int in_height,
+		void* rgb_out, long out_pitch, int first, int last);
+void retroarch_snes_ntsc_blit_hires_avx2( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+		long in_row_width, int burst_phase, int in_width, int in_height,
+		void* rgb_out, long out_pitch, int first, int last);
+#endif
+
+#ifdef SNES_NTSC_NEON
+void retroarch_snes_ntsc_blit_neon( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+		long in_row_width, int burst_phase, int in_width, int in_height,
+		void* rgb_out, long out_pitch, int first, int last);
+void retroarch_snes_ntsc_blit_hires_neon( snes_ntsc_t const* ntsc, SNES_NTSC_IN_T const* input,
+		long in_row_width, int burst_phase, int in_width, int in_height,
+		void* rgb_out, long out_pitch, int first, int last);
+#endif
+
 /* Number of output pixels written by low-res blitter for given input width. Width
 might be rounded down slightly; use SNES_NTSC_IN_WIDTH() on result to find rounded
 value. Guaranteed not to round 256 down at all. */
@@ -134,9 +179,13 @@ statement in a block (unless you're using C++). */
 /* private */
 enum { snes_ntsc_entry_size = 128 };
 enum { snes_ntsc_palette_size = 0x2000 };
-typedef unsigned long snes_ntsc_rgb_t;
+/* Only the low 30 bits of a kernel value reach the output, so 32 bits
+are enough and halve the table (and let the SIMD blitters use 32-bit lanes) */
+typedef uint32_t snes_ntsc_rgb_t;
 struct snes_ntsc_t {
 	snes_ntsc_rgb_t table [snes_ntsc_palette_size] [snes_ntsc_entry_size];
+	/* 8-lane blitters read up to 2 values past the last entry */
+	snes_ntsc_rgb_t pad [8];
 };
 enum { snes_ntsc_burst_size = snes_ntsc_entry_size / snes_ntsc_burst_count };
 
@@ -412,16 +412,40 @@ static bool video_thread_handle_packet(
 static void video_thread_loop(void *data)
 {
    thread_packet_t pkt;
+   thread_frame_buffer_t buf;
    bool updated;
    thread_video_t *thr = (thread_video_t*)data;
 
    for (;;)
    {
       slock_lock(thr->lock);
-      while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
+      while (thr->send_cmd == CMD_VIDEO_NONE && thr->frame.pending < 0)
          scond_wait(thr->cond_thread, thr->lock);
 
-      updated = thr->frame.updated;
+      updated = (thr->frame.pending >= 0);
+
+      /* Take ownership of the queued frame. The previously
+       * displayed buffer goes back to the pool, and the
+       * producer may queue the next frame while this one
+       * is being rendered. The metadata is copied since
+       * a dupe may requeue this buffer with a new message. */
+      if (updated)
+      {
+         retro_time_t age        = cpu_features_get_time_usec()
+            - thr->frame.buffers[thr->frame.pending].time;
+
+         thr->frame.display      = thr->frame.pending;
+         thr->frame.pending      = -1;
+         thr->frame.busy         = true;
+         buf                     = thr->frame.buffers[thr->frame.display];
+
+         thr->frame.age_sum     += age;
+         thr->frame.age_samples++;
+         if (age > thr->frame.age_max)
+            thr->frame.age_max   = age;
+
+         scond_signal(thr->cond_cmd);
+      }
 
       /* To avoid race condition where send_cmd is updated
        * right after the switch is checked. */
@@ -462,9 +486,9 @@ static void video_thread_loop(void *data)
                video_driver_build_info(&video_info);
 
                ret = thr->driver->frame(thr->driver_data,
-                  thr->frame.buffer, thr->frame.width, thr->frame.height,
-                  thr->frame.count, thr->frame.pitch,
-                  *thr->frame.msg ? thr->frame.msg : NULL,
+                  buf.data, buf.width, buf.height,
+                  buf.count, buf.pitch,
+                  *buf.msg ? buf.msg : NULL,
                   &video_info);
 
                slock_unlock(thr->frame.lock);
@@ -493,7 +517,7 @@ static void video_thread_loop(void *data)
          thr->focus         = focus;
          thr->has_windowed  = has_windowed;
          thr->vp            = vp;
-         thr->frame.updated = false;
+         thr->frame.busy    = false;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
       }
@@ -573,10 +597,29 @@ static bool video_thread_has_windowed(void *data)
    return ret;
 }
 
+/* Returns a buffer that is neither rendered, queued nor
+ * handed out to the core. With three buffers there is
+ * always one. Must be called with thr->lock held. */
+static int video_thread_frame_free_buffer(const thread_video_t *thr)
+{
+   int i;
+   for (i = 0; i < VIDEO_THREAD_FRAME_BUFFERS; i++)
+   {
+      if (     i != thr->frame.display
+            && i != thr->frame.pending
+            && i != thr->frame.writing)
+         return i;
+   }
+   return -1;
+}
+
 static bool video_thread_frame(void *data, const void *frame_,
       unsigned width, unsigned height, uint64_t frame_count,
       unsigned pitch, const char *msg, video_frame_info_t *video_info)
 {
+   thread_frame_buffer_t *buf;
+   int idx;
+   int last;
    thread_video_t *thr = (thread_video_t*)data;
 
    if (!thr)
@@ -604,7 +647,7 @@ static bool video_thread_frame(void *data, const void *frame_,
       retro_time_t target            = thr->last_time + target_frame_time;
 
       /* Ideally, use absolute time, but that is only a good idea on POSIX. */
-      while (thr->frame.updated)
+      while (thr->frame.pending >= 0)
       {
          retro_time_t current = cpu_features_get_time_usec();
          retro_time_t delta   = target - current;
@@ -617,48 +660,93 @@ static bool video_thread_frame(void *data, const void *frame_,
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is
-    * still working on last frame. */
-   if (!thr->frame.updated)
+   /* Most recently queued frame, which is never given
+    * back to the pool while it is the newest one. */
+   last = (thr->frame.pending >= 0)
+      ? thr->frame.pending
+      : thr->frame.display;
+
+   if (     frame_
+         && thr->frame.writing >= 0
+         && frame_ == thr->frame.buffers[thr->frame.writing].data)
+   {
+      /* The core rendered straight into the buffer from
+       * GET_CURRENT_SOFTWARE_FRAMEBUFFER - hand it over. */
+      idx                 = thr->frame.writing;
+      thr->frame.writing  = -1;
+      thr->frame.zero_copy_count++;
+      thr->frame.buffers[idx].pitch = pitch;
+   }
+   else if (last >= 0
+         && (!frame_ || frame_ == thr->frame.buffers[last].data))
+   {
+      /* Dupe, or the cached frame being pushed again -
+       * show the last buffer once more. */
+      idx                 = last;
+   }
+   else
    {
       const uint8_t *src   = (const uint8_t*)frame_;
-      uint8_t       *dst   = thr->frame.buffer;
       unsigned copy_stride = width *
          (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
 
+      /* A buffer handed out to the core but not used
+       * this frame is simply recycled. */
+      idx                 = (thr->frame.writing >= 0)
+         ? thr->frame.writing
+         : video_thread_frame_free_buffer(thr);
+      thr->frame.writing  = -1;
+
+      if (copy_stride && height > thr->frame.size / copy_stride)
+         height           = (unsigned)(thr->frame.size / copy_stride);
+
+      /* Nothing but this thread can reach a buffer that is
+       * neither queued nor displayed, so copy unlocked. */
       if (src)
       {
-         int i; /* TODO/FIXME - increment counter never meaningfully used */
-         for (i = 0; i < (int)height; i++, src += pitch, dst += copy_stride)
+         unsigned i;
+         uint8_t *dst     = thr->frame.buffers[idx].data;
+
+         slock_unlock(thr->lock);
+         for (i = 0; i < height; i++, src += pitch, dst += copy_stride)
             memcpy(dst, src, copy_stride);
+         slock_lock(thr->lock);
       }
 
-      thr->frame.updated = true;
-      thr->frame.width   = width;
-      thr->frame.height  = height;
-      thr->frame.count   = frame_count;
-      thr->frame.pitch   = copy_stride;
+      thr->frame.buffers[idx].pitch = copy_stride;
+   }
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   /* A queued frame the video thread has not picked up
+    * yet is replaced by the newer one. */
+   if (thr->frame.pending >= 0)
+      thr->miss_count++;
 
-      scond_signal(thr->cond_thread);
+   buf                    = &thr->frame.buffers[idx];
+   if (idx != last)
+   {
+      buf->width          = width;
+      buf->height         = height;
+   }
+   buf->count             = frame_count;
+   buf->time              = cpu_features_get_time_usec();
+
+   if (msg)
+      strlcpy(buf->msg, msg, sizeof(buf->msg));
+   else
+      *buf->msg           = '\0';
+
+   thr->frame.pending     = idx;
+   thr->hit_count++;
+
+   scond_signal(thr->cond_thread);
 
 #ifdef HAVE_MENU
-      if (thr->texture.enable)
-      {
-         do
-         {
-            scond_wait(thr->cond_cmd, thr->lock);
-         } while (thr->frame.updated);
-      }
-#endif
-      thr->hit_count++;
+   if (thr->texture.enable)
+   {
+      while (thr->frame.pending >= 0 || thr->frame.busy)
+         scond_wait(thr->cond_cmd, thr->lock);
    }
-   else
-      thr->miss_count++;
+#endif
 
    slock_unlock(thr->lock);
 
@@ -695,20 +783,30 @@ static bool video_thread_init(thread_video_t *thr,
       return false;
 
    {
+      int i;
       size_t max_size        = info.input_scale * RARCH_SCALE_BASE;
       max_size              *= max_size;
       max_size              *= info.rgb32 ?
          sizeof(uint32_t) : sizeof(uint16_t);
 
+      for (i = 0; i < VIDEO_THREAD_FRAME_BUFFERS; i++)
+      {
 #ifdef _3DS
-      thr->frame.buffer      = linearMemAlign(max_size, 0x80);
+         uint8_t *buffer     = (uint8_t*)linearMemAlign(max_size, 0x80);
 #else
-      thr->frame.buffer      = (uint8_t*)malloc(max_size);
+         uint8_t *buffer     = (uint8_t*)malloc(max_size);
 #endif
-      if (!thr->frame.buffer)
-         return false;
+         if (!buffer)
+            return false;
+
+         memset(buffer, 0x80, max_size);
+         thr->frame.buffers[i].data = buffer;
+      }
 
-      memset(thr->frame.buffer, 0x80, max_size);
+      thr->frame.size        = max_size;
+      thr->frame.pending     = -1;
+      thr->frame.display     = -1;
+      thr->frame.writing     = -1;
    }
 
    thr->input                = input;
@@ -822,6 +920,8 @@ static void video_thread_free(void *data)
 
    if (thr)
    {
+      int i;
+
       if (thr->thread)
       {
          thread_packet_t pkt;
@@ -840,11 +940,14 @@ static void video_thread_free(void *data)
       }
 
       free(thr->texture.frame);
+      for (i = 0; i < VIDEO_THREAD_FRAME_BUFFERS; i++)
+      {
 #ifdef _3DS
-      linearFree(thr->frame.buffer);
+         linearFree(thr->frame.buffers[i].data);
 #else
-      free(thr->frame.buffer);
+         free(thr->frame.buffers[i].data);
 #endif
+      }
       free(thr->alpha_mod);
 
       slock_free(thr->frame.lock);
@@ -854,8 +957,8 @@ static void video_thread_free(void *data)
       scond_free(thr->cond_thread);
 
       RARCH_LOG(
-         "Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
-         thr->hit_count, thr->miss_count);
+         "Threaded video stats: Frames pushed: %u, Frames dropped: %u, Zero-copy: %u.\n",
+         thr->hit_count, thr->miss_count, thr->frame.zero_copy_count);
 
       free(thr);
    }
@@ -1258,6 +1361,50 @@ static uint32_t thread_get_flags(void *data)
    return 0;
 }
 
+/* Hands the core a buffer from the frame pool so that
+ * video_thread_frame() can queue it without a copy. Only
+ * offered when the core's pixel format reaches the driver
+ * unconverted; the buffer stays with the core until the
+ * next frame is pushed. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   size_t pitch;
+   enum retro_pixel_format format;
+   thread_video_t       *thr      = (thread_video_t*)data;
+   video_driver_state_t *video_st = video_state_get_ptr();
+
+   if (!thr || !framebuffer)
+      return false;
+
+   format = thr->info.rgb32
+      ? RETRO_PIXEL_FORMAT_XRGB8888
+      : RETRO_PIXEL_FORMAT_RGB565;
+
+   if (video_st->pix_fmt != format)
+      return false;
+
+   pitch  = framebuffer->width *
+      (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
+
+   if (     !pitch
+         || !framebuffer->height
+         || framebuffer->height > thr->frame.size / pitch)
+      return false;
+
+   slock_lock(thr->lock);
+   if (thr->frame.writing < 0)
+      thr->frame.writing = video_thread_frame_free_buffer(thr);
+   framebuffer->data     = thr->frame.buffers[thr->frame.writing].data;
+   slock_unlock(thr->lock);
+
+   framebuffer->pitch        = pitch;
+   framebuffer->format       = format;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+   return true;
+}
+
 static const video_poke_interface_t thread_poke = {
    thread_get_flags,
    thread_load_texture,
@@ -1278,7 +1425,7 @@ static const video_poke_interface_t thread_poke = {
    thread_show_mouse,
    thread_grab_mouse_toggle,
    thread_get_current_shader,
-   NULL, /* get_current_software_framebuffer */
+   thread_get_current_software_framebuffer,
    NULL, /* get_hw_render_interface */
    thread_set_hdr_max_nits,
    thread_set_hdr_paper_white_nits,
@@ -1445,3 +1592,26 @@ unsigned video_thread_texture_handle(void *data, custom_command_method_t func)
 
    return pkt.data.custom_command.return_value;
 }
+
+bool video_thread_get_stats(void *data, video_thread_stats_t *stats)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+
+   if (!thr || !stats)
+      return false;
+
+   slock_lock(thr->lock);
+   stats->frame_age_avg     = thr->frame.age_samples
+      ? thr->frame.age_sum / thr->frame.age_samples
+      : 0;
+   stats->frame_age_max     = thr->frame.age_max;
+   stats->frames_pushed     = thr->hit_count;
+   stats->frames_dropped    = thr->miss_count;
+   stats->frames_zero_copy  = thr->frame.zero_copy_count;
+   thr->frame.age_sum       = 0;
+   thr->frame.age_max       = 0;
+   thr->frame.age_samples   = 0;
+   slock_unlock(thr->lock);
+
+   return true;
+}
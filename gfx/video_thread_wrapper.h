@@ -73,6 +73,32 @@ typedef bool (*custom_font_command_method_t)(const void **font_driver,
       float font_size, enum font_driver_render_api api,
       bool is_threaded);
 
+/* Frames are handed to the video thread by pointer from a
+ * small pool: at any time one buffer is being rendered, one
+ * may be queued and one is free for the core (or the copy
+ * of a frame that did not come from the pool). */
+#define VIDEO_THREAD_FRAME_BUFFERS 3
+
+typedef struct thread_frame_buffer
+{
+   retro_time_t time; /* When the frame was queued */
+   uint64_t count;
+   uint8_t *data;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   char msg[NAME_MAX_LENGTH];
+} thread_frame_buffer_t;
+
+typedef struct video_thread_stats
+{
+   retro_time_t frame_age_avg;
+   retro_time_t frame_age_max;
+   unsigned frames_pushed;
+   unsigned frames_dropped;
+   unsigned frames_zero_copy;
+} video_thread_stats_t;
+
 typedef struct thread_packet
 {
    union
@@ -220,14 +246,17 @@ typedef struct thread_video
 
    struct
    {
-      uint64_t count;
+      thread_frame_buffer_t buffers[VIDEO_THREAD_FRAME_BUFFERS];
+      retro_time_t age_sum;
+      retro_time_t age_max;
       slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
-      char msg[NAME_MAX_LENGTH];
-      bool updated;
+      size_t size;        /* Capacity of each buffer */
+      unsigned age_samples;
+      unsigned zero_copy_count;
+      int pending;        /* Queued for the video thread, -1 if none */
+      int display;        /* Being (or last) rendered, -1 if none */
+      int writing;        /* Handed out to the core, -1 if none */
+      bool busy;          /* Video thread is rendering 'display' */
       bool within_thread;
    } frame;
 
@@ -273,6 +302,19 @@ bool video_thread_font_init(
 unsigned video_thread_texture_handle(void *data,
       custom_command_method_t func);
 
+/**
+ * video_thread_get_stats:
+ * @data                      : Threaded video driver handle.
+ * @stats                     : Output statistics.
+ *
+ * Reports frame handoff counters and the average/maximum
+ * time frames spent queued since the previous call.
+ *
+ * Returns: true (1) if @data is a threaded video driver,
+ * otherwise false (0).
+ **/
+bool video_thread_get_stats(void *data, video_thread_stats_t *stats);
+
 RETRO_END_DECLS
 
 #endif
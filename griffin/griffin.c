@@ -789,6 +789,7 @@ INPUT (HID)
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_ring.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -1238,6 +1239,7 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #endif
@@ -1657,7 +1659,6 @@ FFMPEG
 #ifdef HAVE_FFMPEG
 #include "../cores/libretro-ffmpeg/packet_buffer.c"
 #include "../cores/libretro-ffmpeg/video_buffer.c"
-#include "../libretro-common/rthreads/tpool.c"
 #endif
 
 /*============================================================
@@ -1318,6 +1318,7 @@ error:
 void input_remote_free(input_remote_t *handle, unsigned max_users)
 {
    int user;
+   eapine_deinit();
    for (user = 0; user < (int)max_users; user ++)
       socket_close(handle->net_fd[user]);
    free(handle);
@@ -1345,29 +1346,9 @@ static input_remote_t *input_remote_new(
          }
    }
 
-   return handle;
-}
+   eapine_init(handle, max_users);
 
-static void input_remote_parse_packet(
-      input_remote_state_t *input_state,
-      struct remote_message *msg, unsigned user)
-{
-   /* Parse message */
-   switch (msg->device)
-   {
-      case RETRO_DEVICE_JOYPAD:
-         if (msg->id < 16)
-         {
-            input_state->buttons[user] &= ~(1 << msg->id);
-            if (msg->state)
-               input_state->buttons[user] |= 1 << msg->id;
-         }
-         break;
-      case RETRO_DEVICE_ANALOG:
-         if (msg->id<2 && msg->index<2)
-            input_state->analog[msg->index * 2 + msg->id][user] = msg->state;
-         break;
-   }
+   return handle;
 }
 
 input_remote_t *input_driver_init_remote(
@@ -6538,50 +6519,9 @@ void input_driver_poll(void)
    /* Poll remote */
    if (input_st->remote)
    {
-      unsigned user;
-
-      for (user = 0; user < max_users; user++)
-      {
-         if (settings->bools.network_remote_enable_user[user])
-         {
 #if defined(HAVE_NETWORKING) && defined(HAVE_NETWORKGAMEPAD)
-            //Eapine Code Begin
-            if (true)
-            {
-               eapine_message_parse(input_st, user);
-               eapine_check_input_valid(&input_st->remote_st_ptr, user);
-               continue;
-            }
-            //Eapine Code End
-
-            fd_set fds;
-            ssize_t ret;
-            struct remote_message msg;
-
-            if (input_st->remote->net_fd[user] < 0)
-               return;
-
-            FD_ZERO(&fds);
-            FD_SET(input_st->remote->net_fd[user], &fds);
-
-            ret = recvfrom(input_st->remote->net_fd[user],
-                  (char*)&msg,
-                  sizeof(msg), 0, NULL, NULL);
-
-            if (ret == sizeof(msg))
-               input_remote_parse_packet(&input_st->remote_st_ptr, &msg, user);
-            else if ((ret != -1) || ((errno != EAGAIN) && (errno != ENOENT)))
+      eapine_poll(input_st, max_users);
 #endif
-            {
-               input_remote_state_t *input_state  = &input_st->remote_st_ptr;
-               input_state->buttons[user]         = 0;
-               input_state->analog[0][user]       = 0;
-               input_state->analog[1][user]       = 0;
-               input_state->analog[2][user]       = 0;
-               input_state->analog[3][user]       = 0;
-            }
-         }
-      }
    }
 #endif
 #ifdef HAVE_BSV_MOVIE
@@ -1,127 +1,682 @@
+#include <string.h>
+
+#include <retro_atomic.h>
+#include <retro_endianness.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include "input_driver_eapine.h"
+#include "../configuration.h"
+#include "../content.h"
+#include "../core_info.h"
+#include "../paths.h"
 #include "../menu/menu_cbs.h"
+#include "../tasks/task_content.h"
 #include "../tasks/task_file_transfer.h"
+#include "../verbosity.h"
 
-const char* eapine_message_to_string(uint16_t e_type)
+/* 接收线程需要 rthreads 与原子操作, 否则退回到在 poll 中直接读取 socket */
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+#define EAPINE_THREADED
+#endif
+
+/* 接收线程 select() 超时, 决定 eapine_deinit() 的最长等待时间 */
+#define EAPINE_SELECT_TIMEOUT_USEC  50000
+
+/* 序列号回退超过该值时认为发送端已重启 */
+#define EAPINE_SEQUENCE_WINDOW      1024
+
+/* 等待主线程处理的控制消息数量 */
+#define EAPINE_CTRL_QUEUE_SIZE      8
+
+/**
+ * 单个端口的最新状态.
+ * 只由接收线程写入; 主线程通过 sequence lock 读取, 双方都不会阻塞.
+ */
+typedef struct eapine_slot
 {
-   switch (e_type) {
-   case SearchHost: return "SearchHost";
-   case JoypadStates: return "JoypadStates";
-   case DownloadGameRom: return "DownloadGameRom";
-   case UploadGameData: return "UploadGameData";
-   default: return "UNKNOWN";
-   }
-}
+   eapine_port_state_t state;
+   uint32_t packets;
+   uint32_t dropped;
+#ifdef EAPINE_THREADED
+   retro_atomic_uint_t lock_seq;  /* 写入过程中为奇数 */
+#endif
+   uint32_t last_sequence;        /* 仅接收线程访问 */
+   bool has_sequence;             /* 仅接收线程访问 */
+} eapine_slot_t;
 
-void eapine_message_parse(input_driver_state_t* input_st, unsigned user)
+/**
+ * 从接收线程转交给主线程处理的控制消息 (DownloadGameRom/UploadGameData)
+ */
+typedef struct eapine_ctrl_msg
 {
-   fd_set fds;
-   ssize_t ret;
-   char buffer[1024];
+   size_t len;
+   uint8_t data[EAPINE_MAX_DATAGRAM_SIZE + 1]; /* +1 预留 '\0' */
+} eapine_ctrl_msg_t;
 
-   struct sockaddr_storage addr = { 0 };
-   socklen_t addr_size = sizeof(addr);
+/**
+ * 正在接收的游戏文件.
+ * data 在 UploadBegin 时按文件大小一次性分配, 之后每个分块直接复制进去,
+ * CRC32 随接收增量计算.
+ */
+typedef struct eapine_upload
+{
+   uint8_t *data;
+   uint32_t id;
+   uint32_t size;
+   uint32_t received;       /* 已连续收到的字节数 */
+   uint32_t crc;            /* data[0, received) 的 CRC32 */
+   uint32_t expected_crc;   /* 发送端提供的 CRC32, 0 表示不校验 */
+   uint16_t console_type;
+   char name[NAME_MAX_LENGTH];
+} eapine_upload_t;
 
-   if (input_st->remote->net_fd[user] < 0)
-      return;
+typedef struct eapine_state
+{
+   eapine_slot_t slots[MAX_USERS];
+   eapine_ctrl_msg_t ctrl[EAPINE_CTRL_QUEUE_SIZE];
+   eapine_latency_stats_t stats;
+   eapine_upload_t upload;                /* 仅接收线程访问 */
+   eapine_upload_t upload_done;           /* 等待主线程加载, 受 ctrl_lock 保护 */
+   retro_time_t consumed_time[MAX_USERS]; /* 主线程已处理的 recv_time */
+   input_remote_t *remote;
+#ifdef EAPINE_THREADED
+   sthread_t *thread;
+   slock_t *ctrl_lock;
+   retro_atomic_uint_t quit;
+#endif
+   unsigned ctrl_first;
+   unsigned ctrl_count;
+   unsigned max_users;
+} eapine_state_t;
 
-   FD_ZERO(&fds);
-   FD_SET(input_st->remote->net_fd[user], &fds);
+static eapine_state_t eapine_st;
 
-   ret = recvfrom(input_st->remote->net_fd[user], buffer, sizeof(buffer), 0, (struct sockaddr*)&addr, &addr_size);
+const char* eapine_message_to_string(uint16_t e_type)
+{
+   switch (e_type)
+   {
+      case SearchHost:
+         return "SearchHost";
+      case JoypadStates:
+         return "JoypadStates";
+      case DownloadGameRom:
+         return "DownloadGameRom";
+      case UploadGameData:
+         return "UploadGameData";
+      case JoypadBatch:
+         return "JoypadBatch";
+      default:
+         break;
+   }
+   return "UNKNOWN";
+}
 
-   if (ret != -1)
+static void eapine_slot_publish(eapine_slot_t *slot,
+      const eapine_port_state_t *state, bool check_sequence)
+{
+   if (check_sequence && slot->has_sequence)
    {
-      if (ret < 2)
+      int32_t delta = (int32_t)(state->sequence - slot->last_sequence);
+      bool stale    = (state->recv_time - slot->state.recv_time)
+         > EAPINE_INPUT_TIMEOUT_USEC;
+
+      /* 乱序或重复的报文直接丢弃, 除非发送端看起来已经重启 */
+      if (delta <= 0 && delta > -EAPINE_SEQUENCE_WINDOW && !stale)
       {
-         RARCH_ERR("[Eapine] eapine_message_parse length:%d too short.\n", ret);
+#ifdef EAPINE_THREADED
+         retro_atomic_store_release(&slot->lock_seq, slot->lock_seq + 1);
+         retro_atomic_fence();
+#endif
+         slot->dropped++;
+#ifdef EAPINE_THREADED
+         retro_atomic_store_release(&slot->lock_seq, slot->lock_seq + 1);
+#endif
          return;
       }
+   }
+
+   if (check_sequence)
+   {
+      slot->last_sequence = state->sequence;
+      slot->has_sequence  = true;
+   }
 
-      uint16_t* key = &buffer[0];
-      uint16_t offset = sizeof(uint16_t);
+#ifdef EAPINE_THREADED
+   retro_atomic_store_release(&slot->lock_seq, slot->lock_seq + 1);
+   retro_atomic_fence();
+#endif
+   slot->state = *state;
+   slot->packets++;
+#ifdef EAPINE_THREADED
+   retro_atomic_store_release(&slot->lock_seq, slot->lock_seq + 1);
+#endif
+}
 
-      RARCH_LOG("[Eapine] MSG:%d %s\n", *key, eapine_message_to_string(*key));
+static void eapine_slot_read(eapine_slot_t *slot,
+      eapine_port_state_t *state, uint32_t *packets, uint32_t *dropped)
+{
+#ifdef EAPINE_THREADED
+   for (;;)
+   {
+      uint32_t begin = retro_atomic_load_acquire(&slot->lock_seq);
 
-      switch (*key)
+      if (!(begin & 1))
       {
+         *state   = slot->state;
+         *packets = slot->packets;
+         *dropped = slot->dropped;
+         retro_atomic_fence();
+         if (retro_atomic_load_acquire(&slot->lock_seq) == begin)
+            return;
+      }
+
+      retro_cpu_relax();
+   }
+#else
+   *state   = slot->state;
+   *packets = slot->packets;
+   *dropped = slot->dropped;
+#endif
+}
+
+static int eapine_decode_batch(uint8_t *buf, size_t len,
+      uint8_t *ports, eapine_port_state_t *states, retro_time_t recv_time)
+{
+   unsigned i;
+   unsigned count;
+   uint32_t sequence;
+   retro_time_t sent_time;
+
+   if (len < EAPINE_BATCH_HEADER_SIZE)
+      return -1;
+   if (buf[2] != EAPINE_PROTOCOL_VERSION)
+      return -1;
+
+   count     = buf[3];
+   sequence  = retro_get_unaligned_32le(buf + 4);
+   sent_time = (retro_time_t)retro_get_unaligned_64le(buf + 8);
+
+   if (     count > EAPINE_BATCH_MAX_RECORDS
+         || len < EAPINE_BATCH_HEADER_SIZE
+                + (size_t)count * EAPINE_BATCH_RECORD_SIZE)
+      return -1;
+
+   buf += EAPINE_BATCH_HEADER_SIZE;
+
+   for (i = 0; i < count; i++, buf += EAPINE_BATCH_RECORD_SIZE)
+   {
+      eapine_port_state_t *state = &states[i];
+
+      ports[i]         = buf[0];
+      state->buttons   = retro_get_unaligned_64le(buf + 4);
+      state->analog[0] = (int16_t)retro_get_unaligned_16le(buf + 12);
+      state->analog[1] = (int16_t)retro_get_unaligned_16le(buf + 14);
+      state->analog[2] = (int16_t)retro_get_unaligned_16le(buf + 16);
+      state->analog[3] = (int16_t)retro_get_unaligned_16le(buf + 18);
+      state->sequence  = sequence;
+      state->sent_time = sent_time;
+      state->recv_time = recv_time;
+   }
+
+   return (int)count;
+}
+
+static void eapine_handle_control(uint8_t *data, size_t len)
+{
+   uint16_t key = retro_get_unaligned_16le(data);
+
+   RARCH_LOG("[Eapine] MSG:%d %s\n", key, eapine_message_to_string(key));
+
+   /* 保证字符串参数以 '\0' 结尾 */
+   data[len] = '\0';
+
+   switch (key)
+   {
+      case DownloadGameRom:
+         {
+            /* url '\0' ? path '\0' */
+            size_t url_len = strlen((char*)data + sizeof(uint16_t));
+            if (sizeof(uint16_t) + url_len + 2 > len)
+            {
+               RARCH_ERR("[Eapine] Malformed DownloadGameRom message.\n");
+               break;
+            }
+         }
+         CS_DownloadGameRom_handle((char*)data + sizeof(uint16_t));
+         break;
+      default:
+         break;
+   }
+}
+
+static void eapine_queue_control(eapine_state_t *st,
+      const uint8_t *data, size_t len)
+{
+#ifdef EAPINE_THREADED
+   slock_lock(st->ctrl_lock);
+   if (st->ctrl_count < EAPINE_CTRL_QUEUE_SIZE)
+   {
+      eapine_ctrl_msg_t *msg = &st->ctrl[
+         (st->ctrl_first + st->ctrl_count) % EAPINE_CTRL_QUEUE_SIZE];
+      memcpy(msg->data, data, len);
+      msg->len = len;
+      st->ctrl_count++;
+   }
+   else
+      RARCH_WARN("[Eapine] Control queue full, dropping message.\n");
+   slock_unlock(st->ctrl_lock);
+#else
+   eapine_ctrl_msg_t *msg = &st->ctrl[0];
+   memcpy(msg->data, data, len);
+   msg->len = len;
+   eapine_handle_control(msg->data, msg->len);
+#endif
+}
+
+static void eapine_handle_datagram(eapine_state_t *st, int fd,
+      unsigned user, uint8_t *buf, size_t len,
+      struct sockaddr *addr, socklen_t addr_size)
+{
+   uint16_t key;
+   retro_time_t now;
+
+   if (len < sizeof(uint16_t))
+   {
+      RARCH_ERR("[Eapine] Message length %u too short.\n", (unsigned)len);
+      return;
+   }
+
+   key = retro_get_unaligned_16le(buf);
+   now = cpu_features_get_time_usec();
+
+   switch (key)
+   {
       case SearchHost:
-      {
-         CS_SearchHost_handle(input_st->remote->net_fd[user], (struct sockaddr*)&addr, addr_size);
+         CS_SearchHost_handle(fd, addr, addr_size);
          break;
-      }
       case JoypadStates:
-      {
-         CS_JoypadStates_handle(&buffer[offset], &input_st->remote_st_ptr, user);
+         /* v1: 只有一个16位按键掩码, 没有序列号与摇杆 */
+         if (len >= sizeof(uint16_t) * 2)
+         {
+            eapine_port_state_t state;
+            memset(&state, 0, sizeof(state));
+            state.buttons   = retro_get_unaligned_16le(buf + 2);
+            state.recv_time = now;
+            eapine_slot_publish(&st->slots[user], &state, false);
+         }
+         break;
+      case JoypadBatch:
+         {
+            uint8_t ports[EAPINE_BATCH_MAX_RECORDS];
+            eapine_port_state_t states[EAPINE_BATCH_MAX_RECORDS];
+            int i;
+            int count = eapine_decode_batch(buf, len, ports, states, now);
+
+            if (count < 0)
+            {
+               RARCH_ERR("[Eapine] Malformed JoypadBatch (%u bytes).\n",
+                     (unsigned)len);
+               break;
+            }
+
+            for (i = 0; i < count; i++)
+               if (ports[i] < st->max_users)
+                  eapine_slot_publish(&st->slots[ports[i]], &states[i], true);
+         }
          break;
-      }
       case DownloadGameRom:
-      {
-         CS_DownloadGameRom_handle(&buffer[offset]);
+         eapine_queue_control(st, buf, len);
          break;
-      }
       case UploadGameData:
-      {
-         CS_UploadGameData_handle(&buffer[offset]);
+         CS_UploadGameData_handle(fd, buf, len, addr, addr_size);
          break;
-      }
       default:
          break;
+   }
+}
+
+/* 读取 socket 上所有待处理的 datagram */
+static void eapine_drain_socket(eapine_state_t *st, unsigned user)
+{
+   /* +1 预留给控制消息的 '\0' */
+   uint8_t buffer[EAPINE_MAX_DATAGRAM_SIZE + 1];
+   int fd = st->remote->net_fd[user];
+
+   for (;;)
+   {
+      struct sockaddr_storage addr;
+      socklen_t addr_size = sizeof(addr);
+      ssize_t ret         = recvfrom(fd, (char*)buffer,
+            EAPINE_MAX_DATAGRAM_SIZE, 0,
+            (struct sockaddr*)&addr, &addr_size);
+
+      if (ret < 0)
+         break;
+
+      eapine_handle_datagram(st, fd, user, buffer, (size_t)ret,
+            (struct sockaddr*)&addr, addr_size);
+   }
+}
+
+#ifdef EAPINE_THREADED
+static void eapine_thread_loop(void *data)
+{
+   eapine_state_t *st = (eapine_state_t*)data;
+
+   while (!retro_atomic_load_acquire(&st->quit))
+   {
+      unsigned user;
+      struct timeval tv;
+      fd_set fds;
+      int max_fd = -1;
+
+      FD_ZERO(&fds);
+      for (user = 0; user < st->max_users; user++)
+      {
+         int fd = st->remote->net_fd[user];
+         if (fd < 0)
+            continue;
+         FD_SET(fd, &fds);
+         if (fd > max_fd)
+            max_fd = fd;
+      }
+
+      if (max_fd < 0)
+         break;
+
+      tv.tv_sec  = 0;
+      tv.tv_usec = EAPINE_SELECT_TIMEOUT_USEC;
+
+      if (socket_select(max_fd + 1, &fds, NULL, NULL, &tv) <= 0)
+         continue;
+
+      for (user = 0; user < st->max_users; user++)
+      {
+         int fd = st->remote->net_fd[user];
+         if (fd >= 0 && FD_ISSET(fd, &fds))
+            eapine_drain_socket(st, user);
       }
    }
 }
+#endif
 
-void eapine_check_input_valid(input_remote_state_t* input_state, unsigned user)
+/* 把接收完成的游戏文件交给 content loader, 不经过临时文件 */
+static void eapine_load_upload(eapine_upload_t *upload)
 {
-   //Joypad
-   if (input_state->buttons[user] != 0)
+   char path[PATH_MAX_LENGTH];
+   char crc_str[16];
+   size_t list_size                 = 0;
+   content_ctx_info_t content_info  = { 0 };
+   core_info_list_t *core_info_list = NULL;
+   const core_info_t *core_info     = NULL;
+   settings_t *settings             = config_get_ptr();
+   const char *dir                  = settings->paths.directory_core_assets;
+
+   if (string_is_empty(dir))
+      dir = settings->paths.directory_menu_content;
+
+   fill_pathname_join_special(path, dir,
+         path_basename(upload->name), sizeof(path));
+   snprintf(crc_str, sizeof(crc_str), "%08X|crc", (unsigned)upload->crc);
+
+   RARCH_LOG("[Eapine] Loading uploaded content \"%s\" (%u bytes, CRC32 0x%08x).\n",
+         path, (unsigned)upload->size, (unsigned)upload->crc);
+
+   core_info_get_list(&core_info_list);
+   if (core_info_list)
+      core_info_list_get_supported_cores(core_info_list,
+            path, &core_info, &list_size);
+
+   if (!list_size)
+   {
+      RARCH_ERR("[Eapine] No core supports \"%s\".\n", path);
+      free(upload->data);
+      upload->data = NULL;
+      return;
+   }
+
+   /* content loader 接管 upload->data */
+   content_set_memory_buffer(path, upload->data, upload->size, upload->crc);
+   upload->data = NULL;
+
+   if (!path_is_empty(RARCH_PATH_CORE))
    {
-      retro_time_t delta = cpu_features_get_time_usec() - eapine_input_timer_ptr.joypads[user];
-      
-      if (delta > 3000000)//超过3秒没有输入,认为断线
+      size_t i;
+      for (i = 0; i < list_size; i++)
       {
-         input_state->buttons[user] = 0;
+         if (string_is_equal(path_get(RARCH_PATH_CORE), core_info[i].path))
+         {
+            task_push_load_content_with_current_core_from_companion_ui(
+                  path, &content_info, CORE_TYPE_PLAIN, NULL, NULL);
+            return;
+         }
       }
    }
+
+   task_push_load_content_with_new_core_from_companion_ui(
+         core_info[0].path, path, NULL, NULL, crc_str,
+         &content_info, NULL, NULL);
 }
 
-void CS_SearchHost_handle(int socket, struct sockaddr* addr, socklen_t addr_size)
+void eapine_init(input_remote_t *remote, unsigned max_users)
 {
-   struct sockaddr_in* addr_in = addr;
-   RARCH_LOG("[Eapine] CS_SearchHost_handle %s %d.\n", inet_ntoa(addr_in->sin_addr), addr_in->sin_port);
+   eapine_state_t *st = &eapine_st;
 
-   struct eapine_joypad_slot_states msg;
-   msg.key = SearchHost;
-   
-   msg.platform = 1;
-   msg.length = 4;
-   msg.state = 2;
-   
-   sendto(socket, (char*)&msg, sizeof(msg), 0, addr, addr_size);
+   memset(st, 0, sizeof(*st));
+   st->remote    = remote;
+   st->max_users = MIN(max_users, MAX_USERS);
+
+#ifdef EAPINE_THREADED
+   if (!(st->ctrl_lock = slock_new()))
+      return;
+   if (!(st->thread = sthread_create(eapine_thread_loop, st)))
+   {
+      RARCH_ERR("[Eapine] Failed to start receive thread.\n");
+      slock_free(st->ctrl_lock);
+      st->ctrl_lock = NULL;
+      return;
+   }
+#endif
+
+   RARCH_LOG("[Eapine] Listening for protocol v%d on %u port(s).\n",
+         EAPINE_PROTOCOL_VERSION, st->max_users);
+}
+
+void eapine_deinit(void)
+{
+   eapine_state_t *st = &eapine_st;
+   eapine_latency_stats_t stats;
+
+   if (!st->remote)
+      return;
+
+#ifdef EAPINE_THREADED
+   if (st->thread)
+   {
+      retro_atomic_store_release(&st->quit, 1);
+      sthread_join(st->thread);
+      st->thread = NULL;
+   }
+   if (st->ctrl_lock)
+      slock_free(st->ctrl_lock);
+   st->ctrl_lock = NULL;
+#endif
+
+   if (st->upload.data)
+      free(st->upload.data);
+   if (st->upload_done.data)
+      free(st->upload_done.data);
+   st->upload.data      = NULL;
+   st->upload_done.data = NULL;
+
+   eapine_get_latency_stats(&stats);
+   if (stats.packets)
+      RARCH_LOG("[Eapine] %u packets, %u dropped, "
+            "recv->poll avg %u us (max %u us), "
+            "sent->poll avg %u us (max %u us).\n",
+            (unsigned)stats.packets, (unsigned)stats.dropped,
+            stats.samples
+            ? (unsigned)(stats.recv_to_poll_total / stats.samples) : 0,
+            (unsigned)stats.recv_to_poll_max,
+            stats.sent_samples
+            ? (unsigned)(stats.sent_to_poll_total / stats.sent_samples) : 0,
+            (unsigned)stats.sent_to_poll_max);
+
+   st->remote = NULL;
+}
+
+void eapine_poll(input_driver_state_t *input_st, unsigned max_users)
+{
+   unsigned user;
+   eapine_state_t *st                = &eapine_st;
+   input_remote_state_t *input_state = &input_st->remote_st_ptr;
+   retro_time_t now;
+
+   if (!st->remote)
+      return;
+
+#ifndef EAPINE_THREADED
+   for (user = 0; user < st->max_users; user++)
+      if (st->remote->net_fd[user] >= 0)
+         eapine_drain_socket(st, user);
+#endif
+
+   now = cpu_features_get_time_usec();
+   st->stats.packets = 0;
+   st->stats.dropped = 0;
+
+   for (user = 0; user < max_users && user < st->max_users; user++)
+   {
+      eapine_port_state_t state;
+      uint32_t packets;
+      uint32_t dropped;
+
+      if (st->remote->net_fd[user] < 0)
+         continue;
+
+      eapine_slot_read(&st->slots[user], &state, &packets, &dropped);
+      st->stats.packets += packets;
+      st->stats.dropped += dropped;
+
+      if (!state.recv_time)
+         continue;
+
+      /* 超时则重置输入状态 */
+      if (now - state.recv_time > EAPINE_INPUT_TIMEOUT_USEC)
+      {
+         input_state->buttons[user]   = 0;
+         input_state->analog[0][user] = 0;
+         input_state->analog[1][user] = 0;
+         input_state->analog[2][user] = 0;
+         input_state->analog[3][user] = 0;
+         continue;
+      }
+
+      input_state->buttons[user]   = state.buttons;
+      input_state->analog[0][user] = state.analog[0];
+      input_state->analog[1][user] = state.analog[1];
+      input_state->analog[2][user] = state.analog[2];
+      input_state->analog[3][user] = state.analog[3];
+
+      if (state.recv_time != st->consumed_time[user])
+      {
+         retro_time_t latency        = now - state.recv_time;
+
+         st->consumed_time[user]     = state.recv_time;
+         st->stats.recv_to_poll_total += latency;
+         if (latency > st->stats.recv_to_poll_max)
+            st->stats.recv_to_poll_max = latency;
+         st->stats.samples++;
+
+         if (state.sent_time && state.sent_time <= now)
+         {
+            latency = now - state.sent_time;
+            st->stats.sent_to_poll_total += latency;
+            if (latency > st->stats.sent_to_poll_max)
+               st->stats.sent_to_poll_max = latency;
+            st->stats.sent_samples++;
+         }
+      }
+   }
+
+#ifdef EAPINE_THREADED
+   if (st->ctrl_count)
+   {
+      eapine_ctrl_msg_t msg;
+
+      for (;;)
+      {
+         slock_lock(st->ctrl_lock);
+         if (!st->ctrl_count)
+         {
+            slock_unlock(st->ctrl_lock);
+            break;
+         }
+         msg           = st->ctrl[st->ctrl_first];
+         st->ctrl_first = (st->ctrl_first + 1) % EAPINE_CTRL_QUEUE_SIZE;
+         st->ctrl_count--;
+         slock_unlock(st->ctrl_lock);
+
+         eapine_handle_control(msg.data, msg.len);
+      }
+   }
+#endif
+
+   if (st->upload_done.data)
+   {
+      eapine_upload_t upload;
+#ifdef EAPINE_THREADED
+      slock_lock(st->ctrl_lock);
+#endif
+      upload               = st->upload_done;
+      st->upload_done.data = NULL;
+#ifdef EAPINE_THREADED
+      slock_unlock(st->ctrl_lock);
+#endif
+      if (upload.data)
+         eapine_load_upload(&upload);
+   }
 }
 
+void eapine_get_latency_stats(eapine_latency_stats_t *stats)
+{
+   *stats = eapine_st.stats;
+}
 
-void CS_JoypadStates_handle(eapine_joypad_states_t* msg, input_remote_state_t* input_state, unsigned user)
+void CS_SearchHost_handle(int socket, struct sockaddr* addr, socklen_t addr_size)
 {
-   input_state->buttons[user] = msg->joypad_states;
-   eapine_input_timer_ptr.joypads[user] = cpu_features_get_time_usec();
+   struct eapine_joypad_slot_states msg;
+   struct sockaddr_in *addr_in = (struct sockaddr_in*)addr;
+
+   RARCH_LOG("[Eapine] CS_SearchHost_handle %s %d.\n",
+         inet_ntoa(addr_in->sin_addr), ntohs(addr_in->sin_port));
+
+   msg.key      = SearchHost;
+   msg.platform = 1;
+   msg.length   = 4;
+   msg.state    = 2;
 
-   RARCH_LOG("[Eapine] JoypadStates_handle %d.\n", msg->joypad_states);
+   sendto(socket, (char*)&msg, sizeof(msg), 0, addr, addr_size);
 }
 
 void CS_DownloadGameRom_handle(char* buffer)
 {
-   char* url = buffer;
-
-   uint16_t offset = strlen(url) + 2;
-   buffer += offset;
+   file_transfer_t *transf = NULL;
+   char *url               = buffer;
+   /* 全路径就放在具体路径，只有文件名就放在Download文件夹下 */
+   char *path              = buffer + strlen(url) + 2;
 
-   char* path = buffer;//全路径就放在具体路径，只有文件名就放在Download文件夹下
-   
    RARCH_LOG("[Eapine] CS_DownloadGameRom_handle %s %s.\n", url, path);
 
-   file_transfer_t* transf = NULL;
-   transf           = (file_transfer_t*)malloc(sizeof(*transf));
+   if (!(transf = (file_transfer_t*)malloc(sizeof(*transf))))
+      return;
    transf->enum_idx = MENU_ENUM_LABEL_CB_CORE_CONTENT_DOWNLOAD;
    strlcpy(transf->path, path, sizeof(transf->path));
 
@@ -134,18 +689,155 @@ void cb_game_rom_download(retro_task_t* task, void* task_data, void* user_data,
    RARCH_LOG("[Eapine] cb_game_rom_download.\n");
 }
 
-void CS_UploadGameData_handle(char* buffer)
+static void eapine_upload_ack(int socket, uint32_t id,
+      uint8_t status, uint32_t received,
+      struct sockaddr* addr, socklen_t addr_size)
+{
+   uint8_t msg[EAPINE_UPLOAD_HEADER_SIZE + sizeof(uint32_t)];
+
+   retro_set_unaligned_16le(msg, UploadGameData);
+   msg[2] = UploadAck;
+   msg[3] = status;
+   retro_set_unaligned_32le(msg + 4, id);
+   retro_set_unaligned_32le(msg + 8, received);
+
+   sendto(socket, (char*)msg, sizeof(msg), 0, addr, addr_size);
+}
+
+static void eapine_upload_free(eapine_upload_t *upload)
+{
+   if (upload->data)
+      free(upload->data);
+   memset(upload, 0, sizeof(*upload));
+}
+
+void CS_UploadGameData_handle(int socket, const uint8_t *buffer, size_t len,
+      struct sockaddr* addr, socklen_t addr_size)
 {
-   // 游戏文件数据
-   uint16_t consoleType = buffer;
+   eapine_state_t *st      = &eapine_st;
+   eapine_upload_t *upload = &st->upload;
+   uint8_t op;
+   uint32_t id;
+   uint8_t status          = UploadStatusOk;
+
+   if (len < EAPINE_UPLOAD_HEADER_SIZE)
+      return;
+
+   op      = buffer[2];
+   id      = retro_get_unaligned_32le((void*)(buffer + 4));
+   buffer += EAPINE_UPLOAD_HEADER_SIZE;
+   len    -= EAPINE_UPLOAD_HEADER_SIZE;
+
+   switch (op)
+   {
+      case UploadBegin:
+         {
+            uint32_t size;
+            size_t name_len;
 
-   RARCH_LOG("[Eapine] CS_UploadGameData_handle %d.\n", consoleType);
+            if (len < 11)
+               return;
 
-   //buffer += sizeof(uint16_t);
-   //uint16_t platform = buffer;
+            size = retro_get_unaligned_32le((void*)buffer);
+
+            /* 同一个上传重新开始时从已收到的位置续传 */
+            if (upload->data && upload->id == id && upload->size == size)
+               break;
+
+            if (size == 0 || size > EAPINE_UPLOAD_MAX_SIZE)
+            {
+               status = UploadStatusTooLarge;
+               break;
+            }
+
+            eapine_upload_free(upload);
+
+            if (!(upload->data = (uint8_t*)malloc(size)))
+            {
+               status = UploadStatusTooLarge;
+               break;
+            }
+
+            upload->id           = id;
+            upload->size         = size;
+            upload->expected_crc = retro_get_unaligned_32le((void*)(buffer + 4));
+            upload->console_type = retro_get_unaligned_16le((void*)(buffer + 8));
+            name_len             = MIN(sizeof(upload->name) - 1, len - 10);
+            memcpy(upload->name, buffer + 10, name_len);
+            upload->name[name_len] = '\0';
+
+            RARCH_LOG("[Eapine] Upload %u started: \"%s\", %u bytes, console %d.\n",
+                  (unsigned)id, upload->name, (unsigned)size,
+                  upload->console_type);
+         }
+         break;
+      case UploadChunk:
+         {
+            uint32_t offset;
+
+            if (!upload->data || upload->id != id)
+            {
+               status = UploadStatusUnknownId;
+               break;
+            }
+            if (len < sizeof(uint32_t))
+               return;
+
+            offset  = retro_get_unaligned_32le((void*)buffer);
+            buffer += sizeof(uint32_t);
+            len    -= sizeof(uint32_t);
+
+            /* 只接受连续的分块; 乱序或重复的分块由 Ack 中的
+             * received 触发发送端重传 */
+            if (     offset != upload->received
+                  || len > upload->size - upload->received)
+               break;
+
+            memcpy(upload->data + offset, buffer, len);
+            upload->crc       = encoding_crc32(upload->crc, buffer, len);
+            upload->received += (uint32_t)len;
+
+            if (upload->received < upload->size)
+               break;
+
+            if (upload->expected_crc && upload->expected_crc != upload->crc)
+            {
+               RARCH_ERR("[Eapine] Upload %u CRC32 mismatch (0x%08x != 0x%08x).\n",
+                     (unsigned)id, (unsigned)upload->crc,
+                     (unsigned)upload->expected_crc);
+               upload->received = 0;
+               upload->crc      = 0;
+               status           = UploadStatusCrcMismatch;
+               break;
+            }
+
+            /* 完成: 交给主线程加载 */
+            offset = upload->size;
+#ifdef EAPINE_THREADED
+            slock_lock(st->ctrl_lock);
+#endif
+            eapine_upload_free(&st->upload_done);
+            st->upload_done = *upload;
+#ifdef EAPINE_THREADED
+            slock_unlock(st->ctrl_lock);
+#endif
+            memset(upload, 0, sizeof(*upload));
+            eapine_upload_ack(socket, id, UploadStatusComplete,
+                  offset, addr, addr_size);
+         }
+         return;
+      case UploadQuery:
+         if (!upload->data || upload->id != id)
+            status = UploadStatusUnknownId;
+         break;
+      case UploadAbort:
+         if (upload->id == id)
+            eapine_upload_free(upload);
+         return;
+      default:
+         return;
+   }
 
-   //public ConsoleEnum consoleType;//游戏机类型
-      //public string fileName;//游戏文件名
-      //public string extension;//游戏文件扩展名
-      //public byte[] fileData;//游戏数据
+   eapine_upload_ack(socket, id, status,
+         upload->id == id ? upload->received : 0, addr, addr_size);
 }
@@ -1,85 +1,177 @@
 #ifndef __EAPINE_DRIVER__H
 #define __EAPINE_DRIVER__H
 
-/// <summary>
-/// Message 枚举
-/// </summary>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+#include <net/net_compat.h>
+#include <queues/task_queue.h>
+
+#include "input_driver.h"
+
+RETRO_BEGIN_DECLS
+
+/* Eapine 协议版本 (v2: 批量/序列号/时间戳) */
+#define EAPINE_PROTOCOL_VERSION     2
+
+/* 单个 datagram 最大长度 */
+#define EAPINE_MAX_DATAGRAM_SIZE    1024
+
+/* 超过3秒没有输入, 认为断线 */
+#define EAPINE_INPUT_TIMEOUT_USEC   3000000
+
+/* v2 JoypadBatch 报文头:
+ *   uint16_t key       (JoypadBatch)
+ *   uint8_t  version   (EAPINE_PROTOCOL_VERSION)
+ *   uint8_t  count     (端口记录数)
+ *   uint32_t sequence  (发送端序列号)
+ *   uint64_t timestamp (发送端时间戳, usec)
+ * 之后是 count 个端口记录:
+ *   uint8_t  port
+ *   uint8_t  flags     (保留)
+ *   uint16_t reserved
+ *   uint64_t buttons   (1 << RETRO_DEVICE_ID_JOYPAD_*)
+ *   int16_t  analog[4] (Left X, Left Y, Right X, Right Y)
+ * 所有字段均为 little-endian.
+ */
+#define EAPINE_BATCH_HEADER_SIZE    16
+#define EAPINE_BATCH_RECORD_SIZE    20
+#define EAPINE_BATCH_MAX_RECORDS    ((EAPINE_MAX_DATAGRAM_SIZE - EAPINE_BATCH_HEADER_SIZE) / EAPINE_BATCH_RECORD_SIZE)
+
+/* UploadGameData (分块/可续传上传, 直接写入内存后交给 content loader):
+ *   uint16_t key       (UploadGameData)
+ *   uint8_t  op        (enum eapine_upload_op)
+ *   uint8_t  status    (仅 Ack 使用, enum eapine_upload_status)
+ *   uint32_t upload_id
+ * Begin: uint32_t size, uint32_t crc32 (0 表示不校验), uint16_t 游戏机类型, 文件名 '\0'
+ * Chunk: uint32_t offset, 数据
+ * Query/Abort: 无
+ * Ack (SC): uint32_t received (已连续收到的字节数, 客户端从这里续传)
+ */
+#define EAPINE_UPLOAD_HEADER_SIZE   8
+#define EAPINE_UPLOAD_MAX_SIZE      (256 * 1024 * 1024)
+
+enum eapine_upload_op
+{
+   UploadBegin = 0,
+   UploadChunk,
+   UploadQuery,
+   UploadAbort,
+   UploadAck
+};
+
+enum eapine_upload_status
+{
+   UploadStatusOk = 0,
+   UploadStatusComplete,
+   UploadStatusUnknownId,
+   UploadStatusTooLarge,
+   UploadStatusCrcMismatch
+};
+
+/**
+ * Message 枚举
+ */
 enum eapine_message
 {
-   SearchHost = 1,         //搜索主机 CS SC
-   JoypadStates = 2,       //同步虚拟手柄Joypad的状态 CS
-   DownloadGameRom = 3,    //下载游戏Rom
-   UploadGameData = 4,     //上传游戏数据 CS
+   SearchHost      = 1, /* 搜索主机 CS SC */
+   JoypadStates    = 2, /* 同步虚拟手柄Joypad的状态 CS (v1) */
+   DownloadGameRom = 3, /* 下载游戏Rom */
+   UploadGameData  = 4, /* 上传游戏数据 CS */
+   JoypadBatch     = 5  /* 批量同步多个端口的手柄状态 CS (v2) */
 };
 
-/// <summary>
-/// 插槽绑定状态
-/// </summary>
-struct eapine_joypad_slot_states {
-   uint16_t key;     //msg key
+/**
+ * 插槽绑定状态
+ */
+struct eapine_joypad_slot_states
+{
+   uint16_t key;      /* msg key */
 
-   uint16_t platform; //平台
-   uint16_t length;  //插槽数量
-   uint16_t state;   //插槽状态
+   uint16_t platform; /* 平台 */
+   uint16_t length;   /* 插槽数量 */
+   uint16_t state;    /* 插槽状态 */
 };
 
-/// <summary>
-/// 同步虚拟手柄Joypad的状态
-/// </summary>
-typedef struct eapine_joypad_states
+/**
+ * 解码后的单个端口手柄状态
+ */
+typedef struct eapine_port_state
 {
-   uint16_t joypad_states;
-} eapine_joypad_states_t;
+   uint64_t buttons;
+   retro_time_t sent_time;     /* 发送端时间戳, 0 表示未知 */
+   retro_time_t recv_time;     /* 本地接收时间 */
+   uint32_t sequence;
+   int16_t analog[4];
+} eapine_port_state_t;
 
-/// <summary>
-/// 虚拟手柄输入计时器
-/// </summary>
-typedef struct eapine_input_timer
+/**
+ * 输入延迟统计 (接收 -> input_driver_poll)
+ */
+typedef struct eapine_latency_stats
 {
-   retro_time_t joypads[MAX_USERS];
-   retro_time_t analog[MAX_USERS];
+   retro_time_t recv_to_poll_total;
+   retro_time_t recv_to_poll_max;
+   retro_time_t sent_to_poll_total; /* 仅在发送端与本机共用时钟时有意义 (loopback) */
+   retro_time_t sent_to_poll_max;
+   uint64_t samples;
+   uint64_t sent_samples;
+   uint64_t packets;
+   uint64_t dropped;                /* 乱序或重复的报文 */
+} eapine_latency_stats_t;
 
-} eapine_input_timer_t;
+/**
+ * 获取 Message 枚举 对应字符串
+ */
+const char* eapine_message_to_string(uint16_t e_type);
 
-/// <summary>
-/// 虚拟手柄输入计时器
-/// </summary>
-eapine_input_timer_t eapine_input_timer_ptr;
+/**
+ * eapine_init:
+ * @remote    : remote handle whose sockets are serviced.
+ * @max_users : number of user sockets in @remote.
+ *
+ * Starts the Eapine receive thread (when threads are available).
+ * Must be paired with eapine_deinit() before @remote is freed.
+ **/
+void eapine_init(input_remote_t *remote, unsigned max_users);
 
-/// <summary>
-/// 获取 Message 枚举 对应字符串
-/// </summary>
-const char* eapine_message_to_string(uint16_t e_type);
+void eapine_deinit(void);
 
-/// <summary>
-/// 解析收到的Message数据
-/// </summary>
-void eapine_message_parse(input_driver_state_t* input_st, unsigned user);
+/**
+ * eapine_poll:
+ * @input_st  : input driver state.
+ * @max_users : number of users to update.
+ *
+ * Publishes the latest received state of every port into
+ * input_st->remote_st_ptr and services queued control messages.
+ * Called once per input_driver_poll().
+ **/
+void eapine_poll(input_driver_state_t *input_st, unsigned max_users);
 
-/// <summary>
-/// 检查当前虚拟手柄输入是否在时效内, 若超时则重置输入状态
-/// </summary>
-void eapine_check_input_valid(input_remote_state_t* input_state, unsigned user);
+/**
+ * 获取输入延迟统计
+ */
+void eapine_get_latency_stats(eapine_latency_stats_t *stats);
 
-/// <summary>
-/// 处理 CS_SearchHost
-/// </summary>
+/**
+ * 处理 CS_SearchHost
+ */
 void CS_SearchHost_handle(int socket, struct sockaddr* addr, socklen_t addr_size);
 
-/// <summary>
-/// 处理 CS_JoypadStates
-/// </summary>
-void CS_JoypadStates_handle(eapine_joypad_states_t* msg, input_remote_state_t* input_state, unsigned user);
-
-/// <summary>
-/// 处理 CS_DownloadGameRom
-/// </summary>
+/**
+ * 处理 CS_DownloadGameRom
+ */
 void CS_DownloadGameRom_handle(char* buffer);
 void cb_game_rom_download(retro_task_t* task, void* task_data, void* user_data, const char* err);
 
-/// <summary>
-/// 处理 CS_UploadGameData
-/// </summary>
-void CS_UploadGameData_handle(char* buffer);
+/**
+ * 处理 CS_UploadGameData
+ */
+void CS_UploadGameData_handle(int socket, const uint8_t *buffer, size_t len,
+      struct sockaddr* addr, socklen_t addr_size);
+
+RETRO_END_DECLS
 
 #endif /* __EAPINE_DRIVER__H */
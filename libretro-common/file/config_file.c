@@ -269,47 +269,25 @@ static void config_file_add_child_list(config_file_t *parent,
       config_file_t *child)
 {
    struct config_entry_list *list = child->entries;
-   bool merge_hash_map            = false;
+   bool merge_hash_map            = (parent->entries != NULL);
 
-   if (parent->entries)
+   /* set list readonly */
+   while (list)
    {
-      struct config_entry_list *head = parent->entries;
-      while (head->next)
-         head = head->next;
-
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      head->next        = child->entries;
-
-      merge_hash_map    = true;
-   }
-   else
-   {
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      parent->entries   = child->entries;
+      list->readonly = true;
+      list           = list->next;
    }
 
-   /* Rebase tail. */
-   if (parent->entries)
+   /* Append child list, and rebase tail */
+   if (child->entries)
    {
-      struct config_entry_list *head =
-         (struct config_entry_list*)parent->entries;
+      if (parent->tail)
+         parent->tail->next = child->entries;
+      else
+         parent->entries    = child->entries;
 
-      while (head->next)
-         head = head->next;
-      parent->tail = head;
+      parent->tail          = child->tail;
    }
-   else
-      parent->tail = NULL;
 
    /* Update hash map */
    if (merge_hash_map)
@@ -350,6 +328,7 @@ static void config_file_add_child_list(config_file_t *parent,
    }
 
    child->entries = NULL;
+   child->tail    = NULL;
 }
 
 static void config_file_get_realpath(char *s, size_t len,
@@ -419,97 +398,113 @@ size_t config_file_add_reference(config_file_t *conf, char *path)
    return len;
 }
 
-static int config_file_load_internal(
-      struct config_file *conf,
-      const char *path, unsigned depth, config_file_cb_t *cb)
+/**
+ * config_file_parse_buffer:
+ *
+ * Parses the NUL-terminated contents of a config file in
+ * place, splitting it into lines as it goes. Only lines
+ * that hold an entry allocate anything - the key, the value
+ * and the list node.
+ *
+ * NOTE: This will modify @buf.
+ **/
+static int config_file_parse_buffer(struct config_file *conf,
+      char *buf, config_file_cb_t *cb)
 {
-   RFILE         *file = NULL;
-   char      *new_path = strdup(path);
-   if (!new_path)
-      return 1;
+   char *line = buf;
 
-   conf->path          = new_path;
-   conf->include_depth = depth;
-
-   if (!(file = filestream_open(path,
-         RETRO_VFS_FILE_ACCESS_READ,
-         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   while (*line)
    {
-      free(conf->path);
-      return 1;
-   }
+      struct config_entry_list entry;
+      char *next        = strchr(line, '\n');
 
-   while (!filestream_eof(file))
-   {
-      char *line                     = NULL;
-      struct config_entry_list *list = (struct config_entry_list*)
-         malloc(sizeof(*list));
+      if (next)
+         *next++        = '\0';
+      else
+         next           = line + strlen(line);
 
-      if (!list)
+      entry.readonly    = false;
+      entry.key         = NULL;
+      entry.value       = NULL;
+      entry.next        = NULL;
+
+      if (     *line
+            && config_file_parse_line(conf, &entry, line, cb)
+            && entry.key)
       {
-         filestream_close(file);
-         return -1;
-      }
+         uint32_t hash;
+         struct config_entry_list *list = (struct config_entry_list*)
+            malloc(sizeof(*list));
 
-      list->readonly  = false;
-      list->key       = NULL;
-      list->value     = NULL;
-      list->next      = NULL;
+         if (!list)
+         {
+            free(entry.key);
+            free(entry.value);
+            return -1;
+         }
 
-      line            = filestream_getline(file);
+         *list = entry;
 
-      if (!line)
-      {
-         free(list);
-         continue;
-      }
-
-      if (
-              !string_is_empty(line)
-            && config_file_parse_line(conf, list, line, cb))
-      {
-         if (conf->entries)
+         if (conf->tail)
             conf->tail->next = list;
          else
             conf->entries    = list;
 
-         conf->tail = list;
+         conf->tail          = list;
 
-         if (list->key)
+         /* Only add entry to the map if an entry
+          * with the specified value does not
+          * already exist */
+         hash                = rhmap_hash_string(list->key);
+
+         if (!RHMAP_HAS_FULL(conf->entries_map, hash, list->key))
          {
-            /* Only add entry to the map if an entry
-             * with the specified value does not
-             * already exist */
-            uint32_t hash = rhmap_hash_string(list->key);
-
-            if (!RHMAP_HAS_FULL(conf->entries_map, hash, list->key))
-            {
-               RHMAP_SET_FULL(conf->entries_map, hash, list->key, list);
-
-               if (cb && list->value)
-                  cb->config_file_new_entry_cb(list->key, list->value);
-            }
+            RHMAP_SET_FULL(conf->entries_map, hash, list->key, list);
+
+            if (cb && list->value)
+               cb->config_file_new_entry_cb(list->key, list->value);
          }
       }
 
-      free(line);
+      line = next;
+   }
+
+   return 0;
+}
+
+static int config_file_load_internal(
+      struct config_file *conf,
+      const char *path, unsigned depth, config_file_cb_t *cb)
+{
+   int ret;
+   void *buf           = NULL;
+   char      *new_path = strdup(path);
+   if (!new_path)
+      return 1;
+
+   conf->path          = new_path;
+   conf->include_depth = depth;
 
-      if (list != conf->tail)
-         free(list);
+   /* Read the whole file in one go, rather
+    * than a character at a time */
+   if (!filestream_read_file(path, &buf, NULL))
+   {
+      free(conf->path);
+      conf->path       = NULL;
+      return 1;
    }
 
-   filestream_close(file);
+   ret = config_file_parse_buffer(conf, (char*)buf, cb);
+   free(buf);
 
-   return 0;
+   return ret;
 }
 
 static bool config_file_parse_line(config_file_t *conf,
       struct config_entry_list *list, char *line, config_file_cb_t *cb)
 {
-   size_t cur_size       = 32;
    size_t idx            = 0;
    char *key             = NULL;
-   char *key_tmp         = NULL;
    /* Remove any comment text */
    char *comment         = config_file_strip_comment(line);
 
@@ -595,31 +590,17 @@ static bool config_file_parse_line(config_file_t *conf,
    while (ISSPACE((int)*line))
       line++;
 
+   /* The key runs until the next space character */
+   while (isgraph((int)line[idx]))
+      idx++;
+
    /* Allocate storage for key */
-   if (!(key = (char*)malloc(cur_size + 1)))
+   if (!(key = (char*)malloc(idx + 1)))
       return false;
 
-   /* Copy line contents into key until we
-    * reach the next space character */
-   while (isgraph((int)*line))
-   {
-      /* If current key storage is too small,
-       * double its size */
-      if (idx == cur_size)
-      {
-         cur_size *= 2;
-         if (!(key_tmp   = (char*)realloc(key, cur_size + 1)))
-         {
-            free(key);
-            return false;
-         }
-
-         key     = key_tmp;
-      }
-
-      key[idx++] = *line++;
-   }
+   memcpy(key, line, idx);
    key[idx]      = '\0';
+   line         += idx;
 
    /* Add key and value entries to list */
    list->key     = key;
@@ -654,62 +635,12 @@ static int config_file_from_string_internal(
       char *from_string,
       const char *path)
 {
-   char *lines                    = from_string;
-   char *save_ptr                 = NULL;
-   char *line                     = NULL;
-
    if (!string_is_empty(path))
       conf->path                  = strdup(path);
-   if (string_is_empty(lines))
+   if (string_is_empty(from_string))
       return 0;
 
-   /* Get first line of config file */
-   line = strtok_r(lines, "\n", &save_ptr);
-
-   while (line)
-   {
-      struct config_entry_list *list = (struct config_entry_list*)
-            malloc(sizeof(*list));
-
-      if (!list)
-         return -1;
-
-      list->readonly  = false;
-      list->key       = NULL;
-      list->value     = NULL;
-      list->next      = NULL;
-
-      /* Parse current line */
-      if (
-              !string_is_empty(line)
-            && config_file_parse_line(conf, list, line, NULL))
-      {
-         if (conf->entries)
-            conf->tail->next = list;
-         else
-            conf->entries    = list;
-
-         conf->tail          = list;
-
-         if (list->key)
-         {
-            /* Only add entry to the map if an entry
-             * with the specified value does not
-             * already exist */
-            uint32_t hash = rhmap_hash_string(list->key);
-            if (!RHMAP_HAS_FULL(conf->entries_map, hash, list->key))
-               RHMAP_SET_FULL(conf->entries_map, hash, list->key, list);
-         }
-      }
-
-      if (list != conf->tail)
-         free(list);
-
-      /* Get next line of config file */
-      line = strtok_r(NULL, "\n", &save_ptr);
-   }
-
-   return 0;
+   return config_file_parse_buffer(conf, from_string, NULL);
 }
 
 
@@ -805,8 +736,11 @@ bool config_append_file(config_file_t *conf, const char *path)
    if (new_conf->tail)
    {
       new_conf->tail->next = conf->entries;
+      if (!conf->entries)
+         conf->tail        = new_conf->tail;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+      new_conf->tail       = NULL;
    }
 
    config_file_free(new_conf);
@@ -930,7 +864,6 @@ void config_file_initialize(struct config_file *conf)
    conf->entries_map              = NULL;
    conf->entries                  = NULL;
    conf->tail                     = NULL;
-   conf->last                     = NULL;
    conf->references               = NULL;
    conf->includes                 = NULL;
    conf->include_depth            = 0;
@@ -946,32 +879,6 @@ config_file_t *config_file_new_alloc(void)
    return conf;
 }
 
-/**
- * config_get_entry_internal:
- *
- * Leaf function.
- **/
-static struct config_entry_list *config_get_entry_internal(
-      const config_file_t *conf,
-      const char *key, struct config_entry_list **prev)
-{
-   struct config_entry_list *entry = RHMAP_GET_STR(conf->entries_map, key);
-
-   if (entry)
-      return entry;
-
-   if (prev)
-   {
-      struct config_entry_list *previous = *prev;
-      for (entry = conf->entries; entry; entry = entry->next)
-         previous = entry;
-
-      *prev = previous;
-   }
-
-   return NULL;
-}
-
 struct config_entry_list *config_get_entry(
       const config_file_t *conf, const char *key)
 {
@@ -1232,22 +1139,14 @@ bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *last  = NULL;
    struct config_entry_list *entry = NULL;
 
    if (!conf || !key || !val)
       return;
 
-   last                            = conf->entries;
-
-   if (conf->flags & CONF_FILE_FLG_GUARANTEED_NO_DUPLICATES)
+   if (!(conf->flags & CONF_FILE_FLG_GUARANTEED_NO_DUPLICATES))
    {
-      if (conf->last)
-         last                      = conf->last;
-   }
-   else
-   {
-      if ((entry = config_get_entry_internal(conf, key, &last)))
+      if ((entry = config_get_entry(conf, key)))
       {
          /* An entry corresponding to 'key' already exists
           * > Check whether value is currently set */
@@ -1283,27 +1182,24 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
    entry->next      = NULL;
    conf->flags     |= CONF_FILE_FLG_MODIFIED;
 
-   if (last)
-      last->next    = entry;
+   if (conf->tail)
+      conf->tail->next = entry;
    else
-      conf->entries = entry;
+      conf->entries    = entry;
 
-   conf->last       = entry;
+   conf->tail          = entry;
 
    RHMAP_SET_STR(conf->entries_map, entry->key, entry);
 }
 
 void config_unset(config_file_t *conf, const char *key)
 {
-   struct config_entry_list *last  = NULL;
    struct config_entry_list *entry = NULL;
 
    if (!conf || !key)
       return;
 
-   last  = conf->entries;
-
-   if (!(entry = config_get_entry_internal(conf, key, &last)))
+   if (!(entry = config_get_entry(conf, key)))
       return;
 
    (void)RHMAP_DEL_STR(conf->entries_map, entry->key);
@@ -1464,6 +1360,9 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
    {
       if (!list->readonly && list->key)
          fprintf(file, "%s = \"%s\"\n", list->key, list->value);
+      /* Sorting may have moved the tail */
+      if (!list->next)
+         conf->tail = list;
       list = list->next;
    }
 
@@ -38,6 +38,7 @@
 
 #ifdef _WIN32
 #include <direct.h>
+#include <encodings/utf.h>
 #else
 #include <unistd.h> /* stat() is defined here */
 #endif
@@ -98,6 +99,39 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+int64_t path_get_mtime(const char *path)
+{
+#if defined(VITA) || defined(__PSL1GHT__) || defined(__PS3__)
+   /* Not reported by the stat() of these platforms */
+   return -1;
+#elif defined(_WIN32)
+   struct _stat stat_buf;
+   int ret            = -1;
+#if defined(LEGACY_WIN32)
+   if (!string_is_empty(path))
+      ret = _stat(path, &stat_buf);
+#else
+   wchar_t *path_wide = NULL;
+
+   if (     !string_is_empty(path)
+         && (path_wide = utf8_to_utf16_string_alloc(path)))
+   {
+      ret = _wstat(path_wide, &stat_buf);
+      free(path_wide);
+   }
+#endif
+   if (ret != 0)
+      return -1;
+   return (int64_t)stat_buf.st_mtime;
+#else
+   struct stat stat_buf;
+
+   if (string_is_empty(path) || stat(path, &stat_buf) != 0)
+      return -1;
+   return (int64_t)stat_buf.st_mtime;
+#endif
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
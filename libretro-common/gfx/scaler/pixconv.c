@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <libretro.h>
 
 #include <gfx/scaler/pixconv.h>
 
@@ -45,6 +46,29 @@
 #include <arm_neon.h>
 #endif
 
+/* AVX2 kernels are built regardless of the target flags
+ * (per-function target attribute) and only picked by
+ * conv_simd_kernel() when the CPU reports AVX2. */
+#if !defined(SCALER_NO_SIMD) && defined(__SSE2__) \
+   && (defined(__x86_64__) || defined(__i386__)) \
+   && (defined(__clang__) || (defined(__GNUC__) \
+   && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define PIXCONV_AVX2
+#define PIXCONV_AVX2_TARGET __attribute__((target("avx2")))
+#elif !defined(SCALER_NO_SIMD) && defined(_MSC_VER) \
+   && (defined(_M_X64) || defined(_M_IX86))
+#define PIXCONV_AVX2
+#define PIXCONV_AVX2_TARGET
+#endif
+
+#ifdef PIXCONV_AVX2
+#include <immintrin.h>
+#endif
+
+#if !defined(SCALER_NO_SIMD) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define PIXCONV_NEON
+#endif
+
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -67,7 +91,7 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
@@ -355,10 +379,10 @@ void conv_rgb565_abgr8888(void *output_, const void *input_,
          r                = _mm_mulhi_epi16(r, mul16_r);
          g                = _mm_mulhi_epi16(g, mul16_g);
          b                = _mm_mulhi_epi16(b, mul16_b);
-         res_lo_bg        = _mm_unpacklo_epi8(b, g);
-         res_hi_bg        = _mm_unpackhi_epi8(b, g);
-         res_lo_ra        = _mm_unpacklo_epi8(r, a);
-         res_hi_ra        = _mm_unpackhi_epi8(r, a);
+         res_lo_bg        = _mm_unpacklo_epi8(r, g);
+         res_hi_bg        = _mm_unpackhi_epi8(r, g);
+         res_lo_ra        = _mm_unpacklo_epi8(b, a);
+         res_hi_ra        = _mm_unpackhi_epi8(b, a);
          res_lo           = _mm_or_si128(res_lo_bg,
                _mm_slli_si128(res_lo_ra, 2));
          res_hi           = _mm_or_si128(res_hi_bg,
@@ -441,7 +465,6 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
    const __m64 mul16_r    = _mm_set1_pi16(0x0440);
    const __m64 mul16_g    = _mm_set1_pi16(0x1100);
    const __m64 mul16_b    = _mm_set1_pi16(0x1100);
-   const __m64 a          = _mm_set1_pi16(0x00ff);
 
    int max_width            = width - 3;
 #endif
@@ -459,10 +482,12 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
          __m64          r = _mm_and_si64(_mm_srli_pi16(in, 2), pix_mask_r);
          __m64          g = _mm_and_si64(in, pix_mask_g);
          __m64          b = _mm_and_si64(_mm_slli_pi16(in, 4), pix_mask_b);
+         __m64          a = _mm_and_si64(_mm_slli_pi16(in, 8), pix_mask_b);
 
          r                = _mm_mulhi_pi16(r, mul16_r);
          g                = _mm_mulhi_pi16(g, mul16_g);
          b                = _mm_mulhi_pi16(b, mul16_b);
+         a                = _mm_mulhi_pi16(a, mul16_b);
 
          res_lo_bg        = _mm_unpacklo_pi8(b, g);
          res_hi_bg        = _mm_unpackhi_pi8(b, g);
@@ -1081,3 +1106,573 @@ void conv_copy(void *output_, const void *input_,
          h++, output += out_stride, input += in_stride)
       memcpy(output, input, copy_len);
 }
+
+#ifdef PIXCONV_AVX2
+/* The AVX2 kernels convert whole blocks of each line and
+ * hand the remaining columns to the generic converter, so
+ * they produce the exact same output. */
+
+static PIXCONV_AVX2_TARGET void conv_0rgb1555_rgb565_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input   = (const uint16_t*)input_;
+   uint16_t *output        = (uint16_t*)output_;
+   int block_width         = width & ~15;
+   const __m256i hi_mask   = _mm256_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+   const __m256i glow_mask = _mm256_set1_epi16(1 << 5);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i rg   = _mm256_and_si256(_mm256_slli_epi16(in, 1), hi_mask);
+         __m256i b    = _mm256_and_si256(in, lo_mask);
+         __m256i glow = _mm256_and_si256(_mm256_srli_epi16(in, 4), glow_mask);
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_or_si256(rg, _mm256_or_si256(b, glow)));
+      }
+   }
+
+   if (block_width < width)
+      conv_0rgb1555_rgb565((uint16_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static PIXCONV_AVX2_TARGET void conv_rgb565_0rgb1555_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input   = (const uint16_t*)input_;
+   uint16_t *output        = (uint16_t*)output_;
+   int block_width         = width & ~15;
+   const __m256i hi_mask   = _mm256_set1_epi16(0x7fe0);
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 1), hi_mask);
+         __m256i lo = _mm256_and_si256(in, lo_mask);
+         _mm256_storeu_si256((__m256i*)(output + w), _mm256_or_si256(hi, lo));
+      }
+   }
+
+   if (block_width < width)
+      conv_rgb565_0rgb1555((uint16_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+/* Expands 16 pixels of 8-bit channels held in the low byte
+ * of each 16-bit lane into ARGB8888 and stores them. Byte
+ * unpacks work within 128-bit lanes, hence the final
+ * cross-lane permutes. */
+static PIXCONV_AVX2_TARGET INLINE void conv_store_x16_avx2(uint32_t *output,
+      __m256i c0, __m256i c1, __m256i c2, __m256i c3)
+{
+   __m256i res_lo = _mm256_or_si256(_mm256_unpacklo_epi8(c0, c1),
+         _mm256_slli_si256(_mm256_unpacklo_epi8(c2, c3), 2));
+   __m256i res_hi = _mm256_or_si256(_mm256_unpackhi_epi8(c0, c1),
+         _mm256_slli_si256(_mm256_unpackhi_epi8(c2, c3), 2));
+
+   _mm256_storeu_si256((__m256i*)(output + 0),
+         _mm256_permute2x128_si256(res_lo, res_hi, 0x20));
+   _mm256_storeu_si256((__m256i*)(output + 8),
+         _mm256_permute2x128_si256(res_lo, res_hi, 0x31));
+}
+
+static PIXCONV_AVX2_TARGET void conv_0rgb1555_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input     = (const uint16_t*)input_;
+   uint32_t *output          = (uint32_t*)output_;
+   int block_width           = width & ~15;
+   const __m256i pix_mask_r  = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_gb = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul15_mid   = _mm256_set1_epi16(0x4200);
+   const __m256i mul15_hi    = _mm256_set1_epi16(0x0210);
+   const __m256i a           = _mm256_set1_epi16(0x00ff);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i r = _mm256_and_si256(in, pix_mask_r);
+         __m256i g = _mm256_and_si256(in, pix_mask_gb);
+         __m256i b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_gb);
+
+         r         = _mm256_mulhi_epi16(r, mul15_hi);
+         g         = _mm256_mulhi_epi16(g, mul15_mid);
+         b         = _mm256_mulhi_epi16(b, mul15_mid);
+
+         conv_store_x16_avx2(output + w, b, g, r, a);
+      }
+   }
+
+   if (block_width < width)
+      conv_0rgb1555_argb8888((uint32_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static PIXCONV_AVX2_TARGET void conv_rgb565_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input    = (const uint16_t*)input_;
+   uint32_t *output         = (uint32_t*)output_;
+   int block_width          = width & ~15;
+   const __m256i pix_mask_r = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_g = _mm256_set1_epi16(0x3f <<  5);
+   const __m256i pix_mask_b = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul16_r    = _mm256_set1_epi16(0x0210);
+   const __m256i mul16_g    = _mm256_set1_epi16(0x2080);
+   const __m256i mul16_b    = _mm256_set1_epi16(0x4200);
+   const __m256i a          = _mm256_set1_epi16(0x00ff);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i        r = _mm256_and_si256(_mm256_srli_epi16(in, 1), pix_mask_r);
+         __m256i        g = _mm256_and_si256(in, pix_mask_g);
+         __m256i        b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_b);
+
+         r                = _mm256_mulhi_epi16(r, mul16_r);
+         g                = _mm256_mulhi_epi16(g, mul16_g);
+         b                = _mm256_mulhi_epi16(b, mul16_b);
+
+         conv_store_x16_avx2(output + w, b, g, r, a);
+      }
+   }
+
+   if (block_width < width)
+      conv_rgb565_argb8888((uint32_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static PIXCONV_AVX2_TARGET void conv_rgb565_abgr8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input    = (const uint16_t*)input_;
+   uint32_t *output         = (uint32_t*)output_;
+   int block_width          = width & ~15;
+   const __m256i pix_mask_r = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_g = _mm256_set1_epi16(0x3f <<  5);
+   const __m256i pix_mask_b = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul16_r    = _mm256_set1_epi16(0x0210);
+   const __m256i mul16_g    = _mm256_set1_epi16(0x2080);
+   const __m256i mul16_b    = _mm256_set1_epi16(0x4200);
+   const __m256i a          = _mm256_set1_epi16(0x00ff);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i        r = _mm256_and_si256(_mm256_srli_epi16(in, 1), pix_mask_r);
+         __m256i        g = _mm256_and_si256(in, pix_mask_g);
+         __m256i        b = _mm256_and_si256(_mm256_slli_epi16(in, 5), pix_mask_b);
+
+         r                = _mm256_mulhi_epi16(r, mul16_r);
+         g                = _mm256_mulhi_epi16(g, mul16_g);
+         b                = _mm256_mulhi_epi16(b, mul16_b);
+
+         conv_store_x16_avx2(output + w, r, g, b, a);
+      }
+   }
+
+   if (block_width < width)
+      conv_rgb565_abgr8888((uint32_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static PIXCONV_AVX2_TARGET void conv_argb8888_abgr8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input    = (const uint32_t*)input_;
+   uint32_t *output         = (uint32_t*)output_;
+   int block_width          = width & ~7;
+   const __m256i swap_rb    = _mm256_setr_epi8(
+         2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+         2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 2)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 8)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_shuffle_epi8(in, swap_rb));
+      }
+   }
+
+   if (block_width < width)
+      conv_argb8888_abgr8888((uint32_t*)output_ + block_width,
+            (const uint32_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static PIXCONV_AVX2_TARGET void conv_yuyv_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint8_t *input        = (const uint8_t*)input_;
+   uint32_t *output            = (uint32_t*)output_;
+   int block_width             = width & ~31;
+   const __m256i mask_y        = _mm256_set1_epi16(0xff);
+   const __m256i mask_c        = _mm256_set1_epi32(0xff);
+   const __m256i chroma_offset = _mm256_set1_epi16(128);
+   const __m256i round_offset  = _mm256_set1_epi16(YUV_OFFSET);
+   const __m256i yuv_mul       = _mm256_set1_epi16(YUV_MAT_Y);
+   const __m256i u_g_mul       = _mm256_set1_epi16(YUV_MAT_U_G);
+   const __m256i u_b_mul       = _mm256_set1_epi16(YUV_MAT_U_B);
+   const __m256i v_r_mul       = _mm256_set1_epi16(YUV_MAT_V_R);
+   const __m256i v_g_mul       = _mm256_set1_epi16(YUV_MAT_V_G);
+   const __m256i a             = _mm256_set1_epi16(-1);
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t      *dst = output;
+      int              w;
+
+      /* Each loop processes 32 pixels. Within each 128-bit
+       * lane this is the SSE2 kernel: lane 0 holds pixels
+       * 0-7 and 16-23, lane 1 pixels 8-15 and 24-31. */
+      for (w = 0; w < block_width; w += 32, src += 64, dst += 32)
+      {
+         __m256i u, v, u0, u1, v0, v1, r0, g0, b0, r1, g1, b1;
+         __m256i res_lo_bg, res_hi_bg, res_lo_ra, res_hi_ra;
+         __m256i res0, res1, res2, res3;
+         __m256i yuv0 = _mm256_loadu_si256((const __m256i*)(src +  0));
+         __m256i yuv1 = _mm256_loadu_si256((const __m256i*)(src + 32));
+         __m256i _y0  = _mm256_and_si256(yuv0, mask_y);
+         __m256i _y1  = _mm256_and_si256(yuv1, mask_y);
+
+         u0 = _mm256_and_si256(_mm256_srli_epi32(yuv0,  8), mask_c);
+         u1 = _mm256_and_si256(_mm256_srli_epi32(yuv1,  8), mask_c);
+         v0 = _mm256_srli_epi32(yuv0, 24);
+         v1 = _mm256_srli_epi32(yuv1, 24);
+         u  = _mm256_sub_epi16(_mm256_packs_epi32(u0, u1), chroma_offset);
+         v  = _mm256_sub_epi16(_mm256_packs_epi32(v0, v1), chroma_offset);
+
+         /* Upscale chroma horizontally (nearest). */
+         u0 = _mm256_unpacklo_epi16(u, u);
+         u1 = _mm256_unpackhi_epi16(u, u);
+         v0 = _mm256_unpacklo_epi16(v, v);
+         v1 = _mm256_unpackhi_epi16(v, v);
+
+         _y0 = _mm256_mullo_epi16(_y0, yuv_mul);
+         _y1 = _mm256_mullo_epi16(_y1, yuv_mul);
+
+         r0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y0,
+                     _mm256_mullo_epi16(v0, v_r_mul)), round_offset), YUV_SHIFT);
+         g0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y0, _mm256_mullo_epi16(v0, v_g_mul)),
+                     _mm256_mullo_epi16(u0, u_g_mul)), round_offset), YUV_SHIFT);
+         b0 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y0,
+                     _mm256_mullo_epi16(u0, u_b_mul)), round_offset), YUV_SHIFT);
+
+         r1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y1,
+                     _mm256_mullo_epi16(v1, v_r_mul)), round_offset), YUV_SHIFT);
+         g1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y1, _mm256_mullo_epi16(v1, v_g_mul)),
+                     _mm256_mullo_epi16(u1, u_g_mul)), round_offset), YUV_SHIFT);
+         b1 = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y1,
+                     _mm256_mullo_epi16(u1, u_b_mul)), round_offset), YUV_SHIFT);
+
+         /* Saturate into 8-bit. */
+         r0 = _mm256_packus_epi16(r0, r1);
+         g0 = _mm256_packus_epi16(g0, g1);
+         b0 = _mm256_packus_epi16(b0, b1);
+
+         /* Interleave into ARGB. */
+         res_lo_bg = _mm256_unpacklo_epi8(b0, g0);
+         res_hi_bg = _mm256_unpackhi_epi8(b0, g0);
+         res_lo_ra = _mm256_unpacklo_epi8(r0, a);
+         res_hi_ra = _mm256_unpackhi_epi8(r0, a);
+         res0      = _mm256_unpacklo_epi16(res_lo_bg, res_lo_ra);
+         res1      = _mm256_unpackhi_epi16(res_lo_bg, res_lo_ra);
+         res2      = _mm256_unpacklo_epi16(res_hi_bg, res_hi_ra);
+         res3      = _mm256_unpackhi_epi16(res_hi_bg, res_hi_ra);
+
+         _mm256_storeu_si256((__m256i*)(dst +  0),
+               _mm256_permute2x128_si256(res0, res1, 0x20));
+         _mm256_storeu_si256((__m256i*)(dst +  8),
+               _mm256_permute2x128_si256(res0, res1, 0x31));
+         _mm256_storeu_si256((__m256i*)(dst + 16),
+               _mm256_permute2x128_si256(res2, res3, 0x20));
+         _mm256_storeu_si256((__m256i*)(dst + 24),
+               _mm256_permute2x128_si256(res2, res3, 0x31));
+      }
+   }
+
+   if (block_width < width)
+      conv_yuyv_argb8888((uint32_t*)output_ + block_width,
+            (const uint8_t*)input_ + block_width * 2,
+            width - block_width, height, out_stride, in_stride);
+}
+#endif
+
+#ifdef PIXCONV_NEON
+static void conv_0rgb1555_rgb565_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   int block_width       = width & ~7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 8)
+      {
+         uint16x8_t in   = vld1q_u16(input + w);
+         uint16x8_t rg   = vandq_u16(vshlq_n_u16(in, 1),
+               vdupq_n_u16((0x1f << 11) | (0x1f << 6)));
+         uint16x8_t b    = vandq_u16(in, vdupq_n_u16(0x1f));
+         uint16x8_t glow = vandq_u16(vshrq_n_u16(in, 4),
+               vdupq_n_u16(1 << 5));
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
+   }
+
+   if (block_width < width)
+      conv_0rgb1555_rgb565((uint16_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static void conv_rgb565_0rgb1555_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+   int block_width       = width & ~7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 8)
+      {
+         uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t hi = vandq_u16(vshrq_n_u16(in, 1), vdupq_n_u16(0x7fe0));
+         uint16x8_t lo = vandq_u16(in, vdupq_n_u16(0x1f));
+         vst1q_u16(output + w, vorrq_u16(hi, lo));
+      }
+   }
+
+   if (block_width < width)
+      conv_rgb565_0rgb1555((uint16_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static void conv_0rgb1555_argb8888_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   int block_width       = width & ~7;
+   const uint16x8_t mask = vdupq_n_u16(0x1f);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 8)
+      {
+         uint8x8x4_t res;
+         uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t r  = vandq_u16(vshrq_n_u16(in, 10), mask);
+         uint16x8_t g  = vandq_u16(vshrq_n_u16(in,  5), mask);
+         uint16x8_t b  = vandq_u16(in, mask);
+
+         res.val[3]    = vdup_n_u8(0xffu);
+         res.val[2]    = vmovn_u16(vorrq_u16(vshlq_n_u16(r, 3), vshrq_n_u16(r, 2)));
+         res.val[1]    = vmovn_u16(vorrq_u16(vshlq_n_u16(g, 3), vshrq_n_u16(g, 2)));
+         res.val[0]    = vmovn_u16(vorrq_u16(vshlq_n_u16(b, 3), vshrq_n_u16(b, 2)));
+
+         vst4_u8((uint8_t*)(output + w), res);
+      }
+   }
+
+   if (block_width < width)
+      conv_0rgb1555_argb8888((uint32_t*)output_ + block_width,
+            (const uint16_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static void conv_argb8888_abgr8888_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+   int block_width       = width & ~15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 2)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         uint8x16x4_t px = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16_t   b  = px.val[0];
+         px.val[0]       = px.val[2];
+         px.val[2]       = b;
+         vst4q_u8((uint8_t*)(output + w), px);
+      }
+   }
+
+   if (block_width < width)
+      conv_argb8888_abgr8888((uint32_t*)output_ + block_width,
+            (const uint32_t*)input_ + block_width,
+            width - block_width, height, out_stride, in_stride);
+}
+
+static void conv_yuyv_argb8888_neon(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+   int block_width      = width & ~15;
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      int w;
+      for (w = 0; w < block_width; w += 16)
+      {
+         uint8x8x4_t res;
+         uint8x8x2_t r, g, b;
+         /* val[0] = even Y, val[1] = U, val[2] = odd Y, val[3] = V */
+         uint8x8x4_t yuv = vld4_u8(input + w * 2);
+         int16x8_t u     = vsubq_s16(vreinterpretq_s16_u16(
+                  vmovl_u8(yuv.val[1])), vdupq_n_s16(128));
+         int16x8_t v     = vsubq_s16(vreinterpretq_s16_u16(
+                  vmovl_u8(yuv.val[3])), vdupq_n_s16(128));
+         int16x8_t ye    = vmulq_n_s16(vreinterpretq_s16_u16(
+                  vmovl_u8(yuv.val[0])), YUV_MAT_Y);
+         int16x8_t yo    = vmulq_n_s16(vreinterpretq_s16_u16(
+                  vmovl_u8(yuv.val[2])), YUV_MAT_Y);
+         int16x8_t cr    = vmlaq_n_s16(vdupq_n_s16(YUV_OFFSET), v, YUV_MAT_V_R);
+         int16x8_t cg    = vmlaq_n_s16(vmlaq_n_s16(vdupq_n_s16(YUV_OFFSET),
+                  u, YUV_MAT_U_G), v, YUV_MAT_V_G);
+         int16x8_t cb    = vmlaq_n_s16(vdupq_n_s16(YUV_OFFSET), u, YUV_MAT_U_B);
+
+         r = vzip_u8(
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(ye, cr), YUV_SHIFT)),
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(yo, cr), YUV_SHIFT)));
+         g = vzip_u8(
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(ye, cg), YUV_SHIFT)),
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(yo, cg), YUV_SHIFT)));
+         b = vzip_u8(
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(ye, cb), YUV_SHIFT)),
+               vqmovun_s16(vshrq_n_s16(vaddq_s16(yo, cb), YUV_SHIFT)));
+
+         res.val[3]     = vdup_n_u8(0xffu);
+         res.val[2]     = r.val[0];
+         res.val[1]     = g.val[0];
+         res.val[0]     = b.val[0];
+         vst4_u8((uint8_t*)(output + w), res);
+
+         res.val[2]     = r.val[1];
+         res.val[1]     = g.val[1];
+         res.val[0]     = b.val[1];
+         vst4_u8((uint8_t*)(output + w + 8), res);
+      }
+   }
+
+   if (block_width < width)
+      conv_yuyv_argb8888((uint32_t*)output_ + block_width,
+            (const uint8_t*)input_ + block_width * 2,
+            width - block_width, height, out_stride, in_stride);
+}
+#endif
+
+pixconv_func_t conv_simd_kernel(pixconv_func_t conv, uint64_t simd_mask)
+{
+#ifdef PIXCONV_AVX2
+   if (simd_mask & RETRO_SIMD_AVX2)
+   {
+      if (conv == conv_rgb565_argb8888)
+         return conv_rgb565_argb8888_avx2;
+      if (conv == conv_rgb565_abgr8888)
+         return conv_rgb565_abgr8888_avx2;
+      if (conv == conv_0rgb1555_argb8888)
+         return conv_0rgb1555_argb8888_avx2;
+      if (conv == conv_0rgb1555_rgb565)
+         return conv_0rgb1555_rgb565_avx2;
+      if (conv == conv_rgb565_0rgb1555)
+         return conv_rgb565_0rgb1555_avx2;
+      if (conv == conv_argb8888_abgr8888)
+         return conv_argb8888_abgr8888_avx2;
+      if (conv == conv_yuyv_argb8888)
+         return conv_yuyv_argb8888_avx2;
+   }
+#endif
+#ifdef PIXCONV_NEON
+   /* conv_rgb565_argb8888/abgr8888 already use NEON
+    * when it is available at build time. */
+   if (simd_mask & RETRO_SIMD_NEON)
+   {
+      if (conv == conv_0rgb1555_argb8888)
+         return conv_0rgb1555_argb8888_neon;
+      if (conv == conv_0rgb1555_rgb565)
+         return conv_0rgb1555_rgb565_neon;
+      if (conv == conv_rgb565_0rgb1555)
+         return conv_rgb565_0rgb1555_neon;
+      if (conv == conv_argb8888_abgr8888)
+         return conv_argb8888_abgr8888_neon;
+      if (conv == conv_yuyv_argb8888)
+         return conv_yuyv_argb8888_neon;
+   }
+#endif
+   (void)simd_mask;
+   return conv;
+}
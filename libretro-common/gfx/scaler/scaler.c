@@ -25,11 +25,211 @@
 #include <string.h>
 #include <math.h>
 
+#include <features/features_cpu.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/scaler/scaler_int.h>
 #include <gfx/scaler/filter.h>
 #include <gfx/scaler/pixconv.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+
+/* Slices shorter than this are not worth a trip through the pool. */
+#define SCALER_SLICE_MIN_ROWS 16
+
+struct scaler_slice
+{
+   /* Copy of the parent context narrowed to this slice: its own
+    * scaled scratch rows, and vertical taps rebased onto them. */
+   struct scaler_ctx ctx;
+   const struct scaler_ctx *parent;
+   const void *input;
+   void *output;
+   int *filter_pos;
+
+   int in_first;     /* First input row the vertical taps read */
+   int out_first;
+   int out_rows;
+   int conv_first;   /* Input rows converted by this slice */
+   int conv_rows;
+};
+
+static void scaler_ctx_free_slices(struct scaler_ctx *ctx)
+{
+   int i;
+
+   if (!ctx->slices)
+      return;
+
+   for (i = 0; i < ctx->num_slices; i++)
+   {
+      struct scaler_slice *slice = &ctx->slices[i];
+      if (slice->ctx.scaled.frame)
+         free(slice->ctx.scaled.frame);
+      if (slice->filter_pos)
+         free(slice->filter_pos);
+   }
+
+   free(ctx->slices);
+   ctx->slices     = NULL;
+   ctx->num_slices = 0;
+}
+
+static bool scaler_ctx_gen_slices(struct scaler_ctx *ctx)
+{
+   int i;
+   int num_slices = ctx->threads;
+
+   if (num_slices > ctx->out_height / SCALER_SLICE_MIN_ROWS)
+      num_slices = ctx->out_height / SCALER_SLICE_MIN_ROWS;
+   if (num_slices < 2)
+      return true;
+
+   if (!(ctx->slices = (struct scaler_slice*)
+            calloc(num_slices, sizeof(*ctx->slices))))
+      return false;
+   ctx->num_slices = num_slices;
+
+   for (i = 0; i < num_slices; i++)
+   {
+      int h;
+      struct scaler_slice *slice = &ctx->slices[i];
+      int in_first               = ctx->in_height;
+      int in_last                = 0;
+
+      slice->parent              = ctx;
+      slice->out_first           = ctx->out_height * i       / num_slices;
+      slice->out_rows            = ctx->out_height * (i + 1) / num_slices
+         - slice->out_first;
+      slice->conv_first          = ctx->in_height  * i       / num_slices;
+      slice->conv_rows           = ctx->in_height  * (i + 1) / num_slices
+         - slice->conv_first;
+
+      /* The point path samples the converted input directly. */
+      if (ctx->scaler_special)
+         continue;
+
+      for (h = slice->out_first; h < slice->out_first + slice->out_rows; h++)
+      {
+         int pos = ctx->vert.filter_pos[h];
+         if (pos < in_first)
+            in_first = pos;
+         if (pos + ctx->vert.filter_len - 1 > in_last)
+            in_last  = pos + ctx->vert.filter_len - 1;
+      }
+
+      if (!(slice->filter_pos = (int*)
+               malloc(slice->out_rows * sizeof(int))))
+         return false;
+
+      for (h = 0; h < slice->out_rows; h++)
+         slice->filter_pos[h] =
+            ctx->vert.filter_pos[slice->out_first + h] - in_first;
+
+      slice->in_first             = in_first;
+      slice->ctx                  = *ctx;
+      slice->ctx.pool             = NULL;
+      slice->ctx.slices           = NULL;
+      slice->ctx.num_slices       = 0;
+      slice->ctx.out_height       = slice->out_rows;
+      slice->ctx.vert.filter      = ctx->vert.filter
+         + slice->out_first * ctx->vert.filter_stride;
+      slice->ctx.vert.filter_pos  = slice->filter_pos;
+      slice->ctx.scaled.height    = in_last - in_first + 1;
+      slice->ctx.scaled.frame     = (uint64_t*)calloc(sizeof(uint64_t),
+            (ctx->scaled.stride * slice->ctx.scaled.height) >> 3);
+
+      if (!slice->ctx.scaled.frame)
+         return false;
+   }
+
+   return true;
+}
+
+static void scaler_slice_convert(void *data)
+{
+   struct scaler_slice *slice    = (struct scaler_slice*)data;
+   const struct scaler_ctx *ctx  = slice->parent;
+
+   ctx->in_pixconv(
+         (uint8_t*)ctx->input.frame + slice->conv_first * ctx->input.stride,
+         (const uint8_t*)slice->input + slice->conv_first * ctx->in_stride,
+         ctx->in_width, slice->conv_rows,
+         ctx->input.stride, ctx->in_stride);
+}
+
+static void scaler_slice_scale(void *data)
+{
+   struct scaler_slice *slice    = (struct scaler_slice*)data;
+   const struct scaler_ctx *ctx  = slice->parent;
+   const void *input_frame       = slice->input;
+   void *output_frame            = slice->output;
+   int input_stride              = ctx->in_stride;
+   int output_stride             = ctx->out_stride;
+
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      input_frame   = ctx->input.frame;
+      input_stride  = ctx->input.stride;
+   }
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+   {
+      output_frame  = ctx->output.frame;
+      output_stride = ctx->output.stride;
+   }
+
+   if (ctx->scaler_special)
+      scaler_argb8888_point_rows(ctx, output_frame, input_frame,
+            ctx->out_width, ctx->out_height,
+            ctx->in_width, ctx->in_height,
+            output_stride, input_stride,
+            slice->out_first, slice->out_rows);
+   else
+   {
+      ctx->scaler_horiz(&slice->ctx,
+            (const uint8_t*)input_frame + slice->in_first * input_stride,
+            input_stride);
+      ctx->scaler_vert(&slice->ctx,
+            (uint8_t*)output_frame + slice->out_first * output_stride,
+            output_stride);
+   }
+
+   if (ctx->out_fmt != SCALER_FMT_ARGB8888)
+      ctx->out_pixconv(
+            (uint8_t*)slice->output + slice->out_first * ctx->out_stride,
+            (const uint8_t*)ctx->output.frame
+            + slice->out_first * ctx->output.stride,
+            ctx->out_width, slice->out_rows,
+            ctx->out_stride, ctx->output.stride);
+}
+
+static void scaler_ctx_scale_slices(struct scaler_ctx *ctx,
+      void *output, const void *input)
+{
+   int i;
+
+   for (i = 0; i < ctx->num_slices; i++)
+   {
+      ctx->slices[i].input  = input;
+      ctx->slices[i].output = output;
+   }
+
+   /* Every slice may read input rows converted by its neighbours,
+    * so the conversion pass has to finish before scaling starts. */
+   if (ctx->in_fmt != SCALER_FMT_ARGB8888)
+   {
+      for (i = 0; i < ctx->num_slices; i++)
+         tpool_add_work(ctx->pool, scaler_slice_convert, &ctx->slices[i]);
+      tpool_wait(ctx->pool);
+   }
+
+   for (i = 0; i < ctx->num_slices; i++)
+      tpool_add_work(ctx->pool, scaler_slice_scale, &ctx->slices[i]);
+   tpool_wait(ctx->pool);
+}
+#endif
+
 static bool allocate_frames(struct scaler_ctx *ctx)
 {
    uint64_t *scaled_frame = NULL;
@@ -263,11 +463,39 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
          return false;
    }
 
+   /* Swap in kernels for SIMD extensions the CPU has
+    * beyond what the build targets. */
+   {
+      uint64_t simd = cpu_features_get();
+
+      if (ctx->direct_pixconv)
+         ctx->direct_pixconv = conv_simd_kernel(ctx->direct_pixconv, simd);
+      if (ctx->in_pixconv)
+         ctx->in_pixconv     = conv_simd_kernel(ctx->in_pixconv, simd);
+      if (ctx->out_pixconv)
+         ctx->out_pixconv    = conv_simd_kernel(ctx->out_pixconv, simd);
+   }
+
+#ifdef HAVE_THREADS
+   /* Only the point scaler has a special path that can be sliced. */
+   if (     ctx->pool
+         && !ctx->unscaled
+         && (!ctx->scaler_special
+            || ctx->scaler_special == scaler_argb8888_point_special))
+   {
+      if (!scaler_ctx_gen_slices(ctx))
+         return false;
+   }
+#endif
+
    return true;
 }
 
 void scaler_ctx_gen_reset(struct scaler_ctx *ctx)
 {
+#ifdef HAVE_THREADS
+   scaler_ctx_free_slices(ctx);
+#endif
    if (ctx->horiz.filter)
       free(ctx->horiz.filter);
    if (ctx->horiz.filter_pos)
@@ -321,6 +549,14 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
    int input_stride        = ctx->in_stride;
    int output_stride       = ctx->out_stride;
 
+#ifdef HAVE_THREADS
+   if (ctx->slices)
+   {
+      scaler_ctx_scale_slices(ctx, output, input);
+      return;
+   }
+#endif
+
    if (ctx->in_fmt != SCALER_FMT_ARGB8888)
    {
       ctx->in_pixconv(ctx->input.frame, input,
@@ -349,7 +585,7 @@ void scaler_ctx_scale(struct scaler_ctx *ctx,
       if (ctx->scaler_horiz)
          ctx->scaler_horiz(ctx, input_frame, input_stride);
       if (ctx->scaler_vert)
-         ctx->scaler_vert (ctx, output, output_stride);
+         ctx->scaler_vert (ctx, output_frame, output_stride);
    }
 
    if (ctx->out_fmt != SCALER_FMT_ARGB8888)
@@ -231,11 +231,12 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
    }
 }
 
-void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
+void scaler_argb8888_point_rows(const struct scaler_ctx *ctx,
       void *output_, const void *input_,
       int out_width, int out_height,
       int in_width, int in_height,
-      int out_stride, int in_stride)
+      int out_stride, int in_stride,
+      int first_row, int num_rows)
 {
    int h, w;
    int x_pos             = (1 << 15) * in_width / out_width - (1 << 15);
@@ -243,14 +244,16 @@ void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
    int y_pos             = (1 << 15) * in_height / out_height - (1 << 15);
    int y_step            = (1 << 16) * in_height / out_height;
    const uint32_t *input = (const uint32_t*)input_;
-   uint32_t *output      = (uint32_t*)output_;
+   uint32_t *output      = (uint32_t*)output_ + first_row * (out_stride >> 2);
 
    if (x_pos < 0)
       x_pos = 0;
    if (y_pos < 0)
       y_pos = 0;
 
-   for (h = 0; h < out_height; h++, y_pos += y_step, output += out_stride >> 2)
+   y_pos += first_row * y_step;
+
+   for (h = 0; h < num_rows; h++, y_pos += y_step, output += out_stride >> 2)
    {
       int               x = x_pos;
       const uint32_t *inp = input + (y_pos >> 16) * (in_stride >> 2);
@@ -259,3 +262,14 @@ void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
          output[w] = inp[x >> 16];
    }
 }
+
+void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
+      void *output, const void *input,
+      int out_width, int out_height,
+      int in_width, int in_height,
+      int out_stride, int in_stride)
+{
+   scaler_argb8888_point_rows(ctx, output, input,
+         out_width, out_height, in_width, in_height,
+         out_stride, in_stride, 0, out_height);
+}
@@ -63,7 +63,6 @@ struct config_file
    struct config_entry_list **entries_map;
    struct config_entry_list *entries;
    struct config_entry_list *tail;
-   struct config_entry_list *last;
    struct config_include_list *includes;
    struct path_linked_list *references;
    unsigned include_depth;
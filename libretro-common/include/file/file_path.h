@@ -691,6 +691,15 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_mtime:
+ * @path               : path
+ *
+ * @return last modification time of path, in seconds
+ * since the epoch, or -1 if it cannot be determined.
+ */
+int64_t path_get_mtime(const char *path);
+
 bool is_path_accessible_using_standard_io(const char *path);
 
 RETRO_END_DECLS
@@ -23,12 +23,17 @@
 #ifndef __LIBRETRO_SDK_SCALER_PIXCONV_H__
 #define __LIBRETRO_SDK_SCALER_PIXCONV_H__
 
+#include <stdint.h>
 #include <clamping.h>
 
 #include <retro_common_api.h>
 
 RETRO_BEGIN_DECLS
 
+typedef void (*pixconv_func_t)(void *output, const void *input,
+      int width, int height,
+      int out_stride, int in_stride);
+
 void conv_0rgb1555_argb8888(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
@@ -105,6 +110,21 @@ void conv_copy(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
 
+/**
+ * conv_simd_kernel:
+ * @conv                      : One of the conv_* converters above.
+ * @simd_mask                 : RETRO_SIMD_* flags, usually
+ *                              cpu_features_get().
+ *
+ * Looks up a variant of @conv that uses instruction sets
+ * the compiler was not told to target (AVX2), or that has
+ * no build-time path yet (NEON). Variants produce the same
+ * output as @conv.
+ *
+ * Returns: the variant, or @conv if none applies.
+ **/
+pixconv_func_t conv_simd_kernel(pixconv_func_t conv, uint64_t simd_mask);
+
 RETRO_END_DECLS
 
 #endif
@@ -51,6 +51,9 @@ enum scaler_type
    SCALER_TYPE_SINC
 };
 
+struct tpool;
+struct scaler_slice;
+
 struct scaler_filter
 {
    int16_t *filter;
@@ -73,6 +76,14 @@ struct scaler_ctx
    void (*direct_pixconv)(void*, const void*, int, int, int, int);
    struct scaler_filter horiz, vert;   /* ptr alignment */
 
+   /* Optional worker pool. When set before scaler_ctx_gen_filter()
+    * together with threads > 1, each frame is split into horizontal
+    * slices that are scaled on the pool. The pool is owned by the
+    * caller and must outlive the context; the slices are owned by
+    * the context and released by scaler_ctx_gen_reset(). */
+   struct tpool *pool;
+   struct scaler_slice *slices;
+
    struct
    {
       uint32_t *frame;
@@ -105,6 +116,9 @@ struct scaler_ctx
    enum scaler_pix_fmt out_fmt;
    enum scaler_type scaler_type;
 
+   int threads;
+   int num_slices;
+
    bool unscaled;
 };
 
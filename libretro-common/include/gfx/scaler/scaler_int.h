@@ -41,6 +41,15 @@ void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
       int in_width, int in_height,
       int out_stride, int in_stride);
 
+/* Same as scaler_argb8888_point_special(), but only writes
+ * output rows [first_row, first_row + num_rows). */
+void scaler_argb8888_point_rows(const struct scaler_ctx *ctx,
+      void *output, const void *input,
+      int out_width, int out_height,
+      int in_width, int in_height,
+      int out_stride, int in_stride,
+      int first_row, int num_rows);
+
 RETRO_END_DECLS
 
 #endif
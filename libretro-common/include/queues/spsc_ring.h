@@ -0,0 +1,157 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_ring.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_SPSC_RING_H
+#define __LIBRETRO_SDK_SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <retro_atomic.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+#define SPSC_RING_CACHE_LINE 64
+
+#ifdef HAVE_RETRO_ATOMIC
+typedef retro_atomic_uint_t spsc_ring_index_t;
+#else
+typedef volatile uint32_t spsc_ring_index_t;
+#endif
+
+/** @copydoc spsc_ring_t */
+struct spsc_ring
+{
+   /* Set up once, then only read */
+   uint8_t *buffer;
+   /* Without atomics, the ring falls back to an rthreads lock */
+   void *lock;
+   uint32_t capacity;
+   uint32_t mask;
+   uint8_t pad0[SPSC_RING_CACHE_LINE - 2 * sizeof(void*) - 2 * sizeof(uint32_t)];
+
+   /* Written by the producer only */
+   spsc_ring_index_t head;
+   uint32_t tail_cache;
+   uint8_t pad1[SPSC_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+
+   /* Written by the consumer only */
+   spsc_ring_index_t tail;
+   uint32_t head_cache;
+   uint8_t pad2[SPSC_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+};
+
+/**
+ * A bounded byte queue for exactly one producer thread
+ * and one consumer thread, which need no lock to use it.
+ *
+ * The storage is a power of two so the position wraps with a mask,
+ * while the capacity is what was asked for, so swapping this in for
+ * a \c fifo_buffer_t keeps the same latency.
+ * What each thread writes lives on its own cache line.
+ *
+ * Only the producer may call \c spsc_ring_write and
+ * only the consumer \c spsc_ring_read; either thread,
+ * or any other, may query how full the ring is.
+ */
+typedef struct spsc_ring spsc_ring_t;
+
+/**
+ * Initializes an existing ring that can hold \c capacity bytes.
+ * Must be freed with \c spsc_ring_deinit.
+ *
+ * @param ring The ring to initialize. May be static or automatic.
+ * @param capacity How many bytes the ring holds, at most 2^31.
+ * @return \c true if \c ring was initialized,
+ * \c false if the size is out of range or there was an error.
+ */
+bool spsc_ring_init(spsc_ring_t *ring, size_t capacity);
+
+/**
+ * Deallocates the contents of \c ring, but not \c ring itself.
+ *
+ * @param ring The ring to deinitialize. If \c NULL, nothing happens.
+ */
+void spsc_ring_deinit(spsc_ring_t *ring);
+
+/**
+ * Creates a new ring that can hold \c capacity bytes.
+ * Must be freed with \c spsc_ring_free.
+ *
+ * @param capacity How many bytes the ring holds, at most 2^31.
+ * @return The new ring if successful, \c NULL otherwise.
+ */
+spsc_ring_t *spsc_ring_new(size_t capacity);
+
+/**
+ * Releases \c ring and its contents.
+ *
+ * @param ring The ring to free. If \c NULL, nothing happens.
+ */
+void spsc_ring_free(spsc_ring_t *ring);
+
+/**
+ * Writes as much of \c data as fits. Producer only.
+ *
+ * @param ring The ring to write to.
+ * @param data The bytes to write.
+ * @param size The length of \c data, in bytes.
+ * @return The number of bytes written, which is less than \c size
+ * if the ring filled up.
+ */
+size_t spsc_ring_write(spsc_ring_t *ring, const void *data, size_t size);
+
+/**
+ * Reads up to \c size bytes. Consumer only.
+ *
+ * @param ring The ring to read from.
+ * @param data The buffer to store the bytes in.
+ * @param size The length of \c data, in bytes.
+ * @return The number of bytes read, which is less than \c size
+ * if the ring ran out.
+ */
+size_t spsc_ring_read(spsc_ring_t *ring, void *data, size_t size);
+
+/**
+ * Returns how many bytes are waiting to be read.
+ * Safe to call from any thread; by the time it returns the
+ * consumer may have read some, or the producer written more.
+ *
+ * @param ring The ring to check.
+ * @return The number of bytes in \c ring.
+ */
+size_t spsc_ring_read_avail(spsc_ring_t *ring);
+
+/**
+ * Returns how many bytes can be written.
+ * Safe to call from any thread, like \c spsc_ring_read_avail.
+ *
+ * @param ring The ring to check.
+ * @return The number of bytes \c ring can accept.
+ */
+size_t spsc_ring_write_avail(spsc_ring_t *ring);
+
+RETRO_END_DECLS
+
+#endif
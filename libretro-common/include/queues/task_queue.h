@@ -46,6 +46,32 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/**
+ * Which tasks the threaded task queue runs first.
+ * Blocking tasks of any priority still run one at a time.
+ */
+enum task_priority
+{
+   /** Anything not listed below. */
+   TASK_PRIORITY_NORMAL = 0,
+
+   /**
+    * Something the user is waiting on,
+    * such as a savestate or a screenshot.
+    * Runs before any other task, on a worker
+    * that background tasks never all take up.
+    */
+   TASK_PRIORITY_INTERACTIVE,
+
+   /**
+    * Long running work, such as a scan or a download.
+    * Only runs when nothing else is waiting.
+    */
+   TASK_PRIORITY_BACKGROUND,
+
+   TASK_PRIORITY_LAST
+};
+
 enum task_style
 {
    TASK_STYLE_NONE,
@@ -120,7 +146,13 @@ enum retro_task_flags
     * If set, the task queue will not call \c progress_cb
     * and will not display any messages from this task.
     */
-   RETRO_TASK_FLG_MUTE             = (1 << 3)
+   RETRO_TASK_FLG_MUTE             = (1 << 3),
+   /**
+    * If set, \c handler may run on any task worker, alongside other tasks.
+    * Only set this when \c handler touches no state shared with other tasks;
+    * all other tasks run one at a time on a single worker.
+    */
+   RETRO_TASK_FLG_PARALLEL         = (1 << 4)
 };
 
 /**
@@ -235,6 +267,15 @@ struct retro_task
     */
    char *title;
 
+   /**
+    * Short name for the kind of work this task does (e.g. "save_state"),
+    * used to group its timings in the task queue statistics and traces.
+    * May be \c NULL, in which case tasks are grouped by \c handler.
+    * Not freed by the task queue, so it should be a string literal.
+    * @see task_queue_get_stats
+    */
+   const char *name;
+
    /**
     * Pointer to arbitrary data, intended for use by a frontend
     * (for example, to associate a sticky notification with a task).
@@ -250,6 +291,13 @@ struct retro_task
     */
    retro_task_t *next;
 
+   /**
+    * @private When the task was pushed and when its handler first ran,
+    * for the task queue statistics.
+    */
+   retro_time_t queued;
+   retro_time_t started;
+
    /**
     * Indicates the current progress of the task.
     *
@@ -275,6 +323,12 @@ struct retro_task
    enum task_type type;
    enum task_style style;
 
+   /**
+    * How soon the task should run compared to others.
+    * Set by the caller, \c TASK_PRIORITY_NORMAL by default.
+    */
+   enum task_priority priority;
+
    uint8_t flags;
 };
 
@@ -308,6 +362,39 @@ typedef struct task_finder_data
  * Contains the result of a call to \c task_retriever_data::func.
  * Implemented as an intrusive singly-linked list.
  */
+/* Histogram buckets are powers of two in microseconds:
+ * bucket 0 counts times below 1 us, bucket N times below 2^N us,
+ * and the last bucket everything longer. */
+#define TASK_STATS_BUCKETS 24
+
+typedef struct task_stats_histogram
+{
+   uint32_t buckets[TASK_STATS_BUCKETS];
+   uint32_t count;
+   retro_time_t total;
+   retro_time_t max;
+} task_stats_histogram_t;
+
+/**
+ * Timings of all tasks of one kind,
+ * grouped by \c retro_task::name (or \c handler if it has none).
+ */
+typedef struct task_stats
+{
+   /** \c retro_task::name, or \c NULL */
+   const char *name;
+   retro_task_handler_t handler;
+   /** Tasks pushed and tasks finished */
+   uint32_t pushed;
+   uint32_t finished;
+   /** From being pushed (or its \c when) to the first call to \c handler */
+   task_stats_histogram_t wait;
+   /** Each call to \c handler */
+   task_stats_histogram_t iteration;
+   /** From the first call to \c handler to the task finishing */
+   task_stats_histogram_t runtime;
+} task_stats_t;
+
 typedef struct task_retriever_info
 {
    /**
@@ -525,7 +612,7 @@ bool task_is_on_main_thread(void);
  *
  * Next time \c retro_task_queue_check is called,
  * the task queue will be recreated with threading enabled.
- * Existing tasks will continue to run on the new thread.
+ * Existing tasks will continue to run on the new threads.
  */
 void task_queue_set_threaded(void);
 
@@ -541,6 +628,76 @@ void task_queue_set_threaded(void);
  */
 void task_queue_unset_threaded(void);
 
+/**
+ * Sets how many threads the threaded task queue runs tasks on.
+ * Only tasks with \c RETRO_TASK_FLG_PARALLEL use more than the first one.
+ * Next time \c retro_task_queue_check is called,
+ * the task queue will be recreated with that many threads.
+ * @param threads Number of threads,
+ * or 0 to pick one from the number of CPU cores.
+ * @see task_queue_set_threaded
+ */
+void task_queue_set_threads(unsigned threads);
+
+/**
+ * Copies the statistics gathered since the task queue was first
+ * initialized (or since \c task_queue_reset_stats).
+ *
+ * @param stats Array to copy into, may be \c NULL to only count them.
+ * @param count Number of entries in \c stats.
+ * @return The number of kinds of tasks that have statistics,
+ * which may be more than \c count.
+ */
+size_t task_queue_get_stats(task_stats_t *stats, size_t count);
+
+/**
+ * Clears the task queue statistics.
+ */
+void task_queue_reset_stats(void);
+
+/**
+ * Estimates a percentile from a histogram.
+ *
+ * @param hist The histogram.
+ * @param percent The percentile, from 0 to 100.
+ * @return The upper bound (in microseconds) of the bucket
+ * the percentile falls in, or 0 if the histogram is empty.
+ */
+retro_time_t task_stats_percentile(const task_stats_histogram_t *hist,
+      unsigned percent);
+
+/**
+ * Starts recording every call to a task handler,
+ * to be written out as a Chrome trace (which Perfetto also reads).
+ *
+ * @param path Where \c task_queue_trace_stop writes the trace.
+ * @param max_events How many events to keep before dropping the rest,
+ * or 0 for a default.
+ * @return \c true if recording started.
+ * @see task_queue_trace_event
+ */
+bool task_queue_trace_start(const char *path, size_t max_events);
+
+/**
+ * Stops recording and writes the trace
+ * to the path given to \c task_queue_trace_start.
+ *
+ * @return \c true if a trace was written.
+ */
+bool task_queue_trace_stop(void);
+
+/**
+ * Adds an event of the frontend's own to the trace being recorded,
+ * such as a frame of the main loop. Does nothing when not recording.
+ *
+ * @param name Name of the event, must outlive the recording.
+ * @param start When the event started.
+ * @param duration How long it lasted, in microseconds.
+ * @see cpu_features_get_time_usec
+ */
+void task_queue_trace_event(const char *name,
+      retro_time_t start, retro_time_t duration);
+
 /**
  * Returns whether the task queue is running in threaded mode.
  *
@@ -657,9 +814,8 @@ void task_queue_deinit(void);
  *
  * @param threaded \c true if tasks should run on a separate thread,
  * \c false if they should remain on the calling thread.
- * All tasks run in sequence on a single thread.
- * If you want to scale a task to multiple threads,
- * you must do so within the task itself.
+ * Separate tasks may run at the same time on different threads,
+ * but a task's handler never runs on two threads at once.
  * @param msg_push The task system will call this function to output messages.
  * If \c NULL, no messages will be output.
  * @note Calling this function while the task system is already initialized
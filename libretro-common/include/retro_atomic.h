@@ -0,0 +1,133 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_atomic.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_ATOMIC_H
+#define __LIBRETRO_SDK_ATOMIC_H
+
+#include <stdint.h>
+
+#include <retro_common_api.h>
+#include <retro_inline.h>
+#include <boolean.h>
+
+/**
+ * Minimal set of 32-bit atomic operations used by the lock-free
+ * primitives in libretro-common.
+ *
+ * All operations act on a \c retro_atomic_uint_t. When the toolchain
+ * provides none of the supported intrinsics, \c HAVE_RETRO_ATOMIC is
+ * left undefined and callers are expected to fall back to rthreads locks.
+ */
+
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define HAVE_RETRO_ATOMIC 1
+
+typedef uint32_t retro_atomic_uint_t;
+
+#define retro_atomic_load_acquire(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define retro_atomic_store_release(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define retro_atomic_fetch_add(ptr, val)     __atomic_fetch_add((ptr), (val), __ATOMIC_ACQ_REL)
+#define retro_atomic_exchange(ptr, val)      __atomic_exchange_n((ptr), (val), __ATOMIC_ACQ_REL)
+#define retro_atomic_fence()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static INLINE bool retro_atomic_cas(retro_atomic_uint_t *ptr,
+      uint32_t expected, uint32_t desired)
+{
+   return __atomic_compare_exchange_n(ptr, &expected, desired,
+         false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+#elif defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define HAVE_RETRO_ATOMIC 1
+
+typedef volatile uint32_t retro_atomic_uint_t;
+
+static INLINE uint32_t retro_atomic_load_acquire(retro_atomic_uint_t *ptr)
+{
+   uint32_t val = *ptr;
+   __sync_synchronize();
+   return val;
+}
+
+static INLINE void retro_atomic_store_release(retro_atomic_uint_t *ptr,
+      uint32_t val)
+{
+   __sync_synchronize();
+   *ptr = val;
+}
+
+#define retro_atomic_fetch_add(ptr, val)     __sync_fetch_and_add((ptr), (val))
+#define retro_atomic_exchange(ptr, val)      __sync_lock_test_and_set((ptr), (val))
+#define retro_atomic_cas(ptr, expected, desired) __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#define retro_atomic_fence()                 __sync_synchronize()
+
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64))
+#define HAVE_RETRO_ATOMIC 1
+
+#include <intrin.h>
+
+typedef volatile long retro_atomic_uint_t;
+
+#if defined(_M_ARM) || defined(_M_ARM64)
+#define RETRO_ATOMIC_MSVC_BARRIER() __dmb(0xB) /* ISH */
+#define retro_atomic_fence()        __dmb(0xB)
+#else
+#define RETRO_ATOMIC_MSVC_BARRIER() _ReadWriteBarrier()
+#define retro_atomic_fence()        _mm_mfence()
+#endif
+
+static INLINE uint32_t retro_atomic_load_acquire(retro_atomic_uint_t *ptr)
+{
+   uint32_t val = (uint32_t)*ptr;
+   RETRO_ATOMIC_MSVC_BARRIER();
+   return val;
+}
+
+static INLINE void retro_atomic_store_release(retro_atomic_uint_t *ptr,
+      uint32_t val)
+{
+   RETRO_ATOMIC_MSVC_BARRIER();
+   *ptr = (long)val;
+}
+
+#define retro_atomic_fetch_add(ptr, val)     ((uint32_t)_InterlockedExchangeAdd((ptr), (long)(val)))
+#define retro_atomic_exchange(ptr, val)      ((uint32_t)_InterlockedExchange((ptr), (long)(val)))
+#define retro_atomic_cas(ptr, expected, desired) (_InterlockedCompareExchange((ptr), (long)(desired), (long)(expected)) == (long)(expected))
+
+#endif
+
+/**
+ * retro_cpu_relax:
+ *
+ * Hint to the CPU that the caller is spinning on a shared variable.
+ */
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define retro_cpu_relax() _mm_pause()
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define retro_cpu_relax() __asm__ __volatile__("pause")
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7))
+#define retro_cpu_relax() __asm__ __volatile__("yield")
+#else
+#define retro_cpu_relax() ((void)0)
+#endif
+
+#endif
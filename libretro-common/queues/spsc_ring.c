@@ -0,0 +1,201 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_ring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/spsc_ring.h>
+
+#if !defined(HAVE_RETRO_ATOMIC) && defined(HAVE_THREADS)
+#include <rthreads/rthreads.h>
+#endif
+
+/* Positions are free-running counters, wrapped with the mask
+ * only to index the storage, so (head - tail) is always the
+ * number of bytes in the ring even after the counters overflow. */
+#if defined(HAVE_RETRO_ATOMIC)
+#define SPSC_LOAD(ptr)       retro_atomic_load_acquire(ptr)
+#define SPSC_STORE(ptr, val) retro_atomic_store_release(ptr, val)
+#define SPSC_LOCK(ring)
+#define SPSC_UNLOCK(ring)
+#else
+#define SPSC_LOAD(ptr)       (*(ptr))
+#define SPSC_STORE(ptr, val) (*(ptr) = (val))
+#if defined(HAVE_THREADS)
+#define SPSC_LOCK(ring)      slock_lock((slock_t*)(ring)->lock)
+#define SPSC_UNLOCK(ring)    slock_unlock((slock_t*)(ring)->lock)
+#else
+#define SPSC_LOCK(ring)
+#define SPSC_UNLOCK(ring)
+#endif
+#endif
+
+bool spsc_ring_init(spsc_ring_t *ring, size_t capacity)
+{
+   size_t storage = 1;
+
+   if (!ring || !capacity || capacity > ((size_t)1 << 31))
+      return false;
+
+   while (storage < capacity)
+      storage <<= 1;
+
+   memset(ring, 0, sizeof(*ring));
+   if (!(ring->buffer = (uint8_t*)malloc(storage)))
+      return false;
+
+#if !defined(HAVE_RETRO_ATOMIC) && defined(HAVE_THREADS)
+   if (!(ring->lock = slock_new()))
+   {
+      free(ring->buffer);
+      ring->buffer = NULL;
+      return false;
+   }
+#endif
+
+   ring->capacity = (uint32_t)capacity;
+   ring->mask     = (uint32_t)(storage - 1);
+   return true;
+}
+
+void spsc_ring_deinit(spsc_ring_t *ring)
+{
+   if (!ring)
+      return;
+
+#if !defined(HAVE_RETRO_ATOMIC) && defined(HAVE_THREADS)
+   slock_free((slock_t*)ring->lock);
+#endif
+   free(ring->buffer);
+   ring->buffer = NULL;
+   ring->lock   = NULL;
+}
+
+spsc_ring_t *spsc_ring_new(size_t capacity)
+{
+   spsc_ring_t *ring = (spsc_ring_t*)malloc(sizeof(*ring));
+
+   if (!ring)
+      return NULL;
+
+   if (!spsc_ring_init(ring, capacity))
+   {
+      free(ring);
+      return NULL;
+   }
+
+   return ring;
+}
+
+void spsc_ring_free(spsc_ring_t *ring)
+{
+   if (!ring)
+      return;
+
+   spsc_ring_deinit(ring);
+   free(ring);
+}
+
+size_t spsc_ring_write(spsc_ring_t *ring, const void *data, size_t size)
+{
+   uint32_t head, pos, first;
+   size_t avail;
+
+   SPSC_LOCK(ring);
+   head  = ring->head;
+   avail = ring->capacity - (uint32_t)(head - ring->tail_cache);
+
+   /* Only look at the consumer's cache line when
+    * the last position seen does not leave enough room */
+   if (avail < size)
+   {
+      ring->tail_cache = SPSC_LOAD(&ring->tail);
+      avail            = ring->capacity - (uint32_t)(head - ring->tail_cache);
+   }
+
+   if (size > avail)
+      size  = avail;
+
+   pos      = head & ring->mask;
+   first    = ring->mask + 1 - pos;
+   if (first > size)
+      first = (uint32_t)size;
+
+   memcpy(ring->buffer + pos, data, first);
+   memcpy(ring->buffer, (const uint8_t*)data + first, size - first);
+
+   SPSC_STORE(&ring->head, head + (uint32_t)size);
+   SPSC_UNLOCK(ring);
+   return size;
+}
+
+size_t spsc_ring_read(spsc_ring_t *ring, void *data, size_t size)
+{
+   uint32_t tail, pos, first;
+   size_t avail;
+
+   SPSC_LOCK(ring);
+   tail  = ring->tail;
+   avail = (uint32_t)(ring->head_cache - tail);
+
+   if (avail < size)
+   {
+      ring->head_cache = SPSC_LOAD(&ring->head);
+      avail            = (uint32_t)(ring->head_cache - tail);
+   }
+
+   if (size > avail)
+      size  = avail;
+
+   pos      = tail & ring->mask;
+   first    = ring->mask + 1 - pos;
+   if (first > size)
+      first = (uint32_t)size;
+
+   memcpy(data, ring->buffer + pos, first);
+   memcpy((uint8_t*)data + first, ring->buffer, size - first);
+
+   SPSC_STORE(&ring->tail, tail + (uint32_t)size);
+   SPSC_UNLOCK(ring);
+   return size;
+}
+
+size_t spsc_ring_read_avail(spsc_ring_t *ring)
+{
+   uint32_t head, tail, used;
+
+   SPSC_LOCK(ring);
+   /* Read tail first, so it is never ahead of head. A thread that
+    * is neither side can still see both move in between, which
+    * would make the ring look fuller than it can be. */
+   tail = SPSC_LOAD(&ring->tail);
+   head = SPSC_LOAD(&ring->head);
+   SPSC_UNLOCK(ring);
+
+   used = head - tail;
+   return (used > ring->capacity) ? ring->capacity : used;
+}
+
+size_t spsc_ring_write_avail(spsc_ring_t *ring)
+{
+   return ring->capacity - spsc_ring_read_avail(ring);
+}
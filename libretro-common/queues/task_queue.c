@@ -23,10 +23,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <queues/task_queue.h>
+#include <retro_miscellaneous.h>
 
 #include <features/features_cpu.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
@@ -60,18 +64,210 @@ static task_queue_t tasks_finished          = {NULL, NULL};
 static struct retro_task_impl *impl_current = NULL;
 static bool task_threaded_enable            = false;
 
+/* Kinds of tasks that get statistics of their own,
+ * any others are counted together with the last one */
+#define TASK_STATS_MAX            32
+#define TASK_TRACE_EVENTS_DEFAULT (1 << 18)
+/* Trace thread of events from neither
+ * the main thread nor a task worker */
+#define TASK_TRACE_THREAD_OTHER   255
+
+typedef struct
+{
+   const char *name;
+   retro_time_t start;
+   retro_time_t duration;
+   uint32_t ident;
+   uint8_t thread;
+   bool task;
+} task_trace_event_t;
+
+/* use stats_lock when touching the following */
+static task_stats_t task_stats[TASK_STATS_MAX];
+static size_t task_stats_count              = 0;
+static task_trace_event_t *trace_events     = NULL;
+static size_t trace_events_count            = 0;
+static size_t trace_events_max              = 0;
+static size_t trace_events_dropped          = 0;
+static char *trace_path                     = NULL;
+
 #ifdef HAVE_THREADS
+#define TASK_WORKERS_MAX 8
+
+/* Tasks waiting for a worker, as a ring */
+typedef struct
+{
+   retro_task_t **tasks;
+   size_t first;
+   size_t count;
+   size_t capacity;
+} task_deque_t;
+
+/* A thread running tasks. Parallel tasks of each priority wait
+ * in the worker's own deques, which other workers steal from
+ * when they have nothing else to do. */
+typedef struct
+{
+   task_deque_t deques[TASK_PRIORITY_LAST];
+   slock_t *lock;
+   sthread_t *thread;
+   unsigned id;
+} task_worker_t;
+
 static uintptr_t main_thread_id             = 0;
 static slock_t *running_lock                = NULL;
 static slock_t *finished_lock               = NULL;
 static slock_t *property_lock               = NULL;
 static slock_t *queue_lock                  = NULL;
+static slock_t *stats_lock                  = NULL;
+static task_worker_t workers[TASK_WORKERS_MAX];
+static unsigned workers_count               = 0;
+static unsigned workers_wanted              = 0;
+/* use worker_lock when touching the following,
+ * and take it before the lock of any worker */
+static slock_t *worker_lock                 = NULL;
 static scond_t *worker_cond                 = NULL;
-static sthread_t *worker_thread             = NULL;
+static task_deque_t tasks_delayed           = {NULL, 0, 0, 0};
+/* Tasks without RETRO_TASK_FLG_PARALLEL, which only the
+ * first worker runs, so that they never run together */
+static task_deque_t tasks_serial[TASK_PRIORITY_LAST];
+/* Parallel tasks waiting in the workers' deques */
+static int tasks_ready[TASK_PRIORITY_LAST]  = {0};
+static unsigned background_running          = 0;
+static unsigned next_worker                 = 0;
 static bool worker_continue                 = true;
-/* use running_lock when touching it */
 #endif
 
+static void task_stats_add(task_stats_histogram_t *hist, retro_time_t usec)
+{
+   unsigned bucket = 0;
+
+   if (usec < 0)
+      usec = 0;
+   while (     bucket < TASK_STATS_BUCKETS - 1
+         && usec >= ((retro_time_t)1 << bucket))
+      bucket++;
+
+   hist->buckets[bucket]++;
+   hist->count++;
+   hist->total += usec;
+   if (usec > hist->max)
+      hist->max = usec;
+}
+
+/* Must hold stats_lock */
+static task_stats_t *task_stats_find(retro_task_t *task)
+{
+   size_t i;
+   task_stats_t *stats = NULL;
+
+   for (i = 0; i < task_stats_count; i++)
+   {
+      stats = &task_stats[i];
+      if (task->name)
+      {
+         if (stats->name && string_is_equal(stats->name, task->name))
+            return stats;
+      }
+      else if (!stats->name && stats->handler == task->handler)
+         return stats;
+   }
+
+   if (task_stats_count == TASK_STATS_MAX)
+      return &task_stats[TASK_STATS_MAX - 1];
+
+   stats          = &task_stats[task_stats_count++];
+   memset(stats, 0, sizeof(*stats));
+   stats->name    = task->name;
+   stats->handler = task->handler;
+   return stats;
+}
+
+/* Must hold stats_lock */
+static void task_trace_add(const char *name, retro_time_t start,
+      retro_time_t duration, uint32_t ident, uint8_t thread, bool task)
+{
+   task_trace_event_t *event = NULL;
+
+   if (!trace_events)
+      return;
+   if (trace_events_count == trace_events_max)
+   {
+      trace_events_dropped++;
+      return;
+   }
+
+   event           = &trace_events[trace_events_count++];
+   event->name     = name;
+   event->start    = start;
+   event->duration = duration;
+   event->ident    = ident;
+   event->thread   = thread;
+   event->task     = task;
+}
+
+static void task_stats_push(retro_task_t *task)
+{
+   task->queued  = cpu_features_get_time_usec();
+   task->started = 0;
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   task_stats_find(task)->pushed++;
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+}
+
+/* Calls the task's handler once and times it.
+ * 'thread' is 0 on the main thread, or a worker's id + 1 */
+static void task_queue_run(retro_task_t *task, uint8_t thread)
+{
+   task_stats_t *stats = NULL;
+   retro_time_t start  = cpu_features_get_time_usec();
+   retro_time_t end;
+   bool first          = !task->started;
+
+   if (first)
+      task->started = start;
+
+   task->handler(task);
+
+   end = cpu_features_get_time_usec();
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   stats = task_stats_find(task);
+   /* Delayed tasks are only waiting once they are due */
+   if (first)
+      task_stats_add(&stats->wait, start
+            - ((task->when > task->queued) ? task->when : task->queued));
+   task_stats_add(&stats->iteration, end - start);
+   task_trace_add(task->name, start, end - start, task->ident, thread, true);
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+}
+
+static void task_stats_finish(retro_task_t *task)
+{
+   task_stats_t *stats = NULL;
+   retro_time_t now    = cpu_features_get_time_usec();
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   stats = task_stats_find(task);
+   stats->finished++;
+   if (task->started)
+      task_stats_add(&stats->runtime, now - task->started);
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+}
+
 static void task_queue_msg_push(retro_task_t *task,
       unsigned prio, unsigned duration,
       bool flush, const char *fmt, ...)
@@ -226,13 +422,16 @@ static void retro_task_regular_gather(void)
 
       if (!task->when || task->when < cpu_features_get_time_usec())
       {
-         task->handler(task);
+         task_queue_run(task, 0);
 
          task_queue_push_progress(task);
       }
 
       if ((task->flags & RETRO_TASK_FLG_FINISHED) > 0)
+      {
+         task_stats_finish(task);
          task_queue_put(&tasks_finished, task);
+      }
       else
          task_queue_put(&tasks_running, task);
    }
@@ -371,14 +570,263 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
    }
 }
 
+static bool task_deque_push(task_deque_t *deque, retro_task_t *task)
+{
+   if (deque->count == deque->capacity)
+   {
+      size_t i;
+      size_t capacity      = deque->capacity ? deque->capacity * 2 : 8;
+      retro_task_t **tasks = (retro_task_t**)
+         malloc(capacity * sizeof(*tasks));
+
+      if (!tasks)
+         return false;
+
+      for (i = 0; i < deque->count; i++)
+         tasks[i] = deque->tasks[(deque->first + i) % deque->capacity];
+
+      free(deque->tasks);
+      deque->tasks    = tasks;
+      deque->first    = 0;
+      deque->capacity = capacity;
+   }
+
+   deque->tasks[(deque->first + deque->count) % deque->capacity] = task;
+   deque->count++;
+   return true;
+}
+
+static retro_task_t *task_deque_pop_front(task_deque_t *deque)
+{
+   retro_task_t *task;
+
+   if (!deque->count)
+      return NULL;
+
+   task         = deque->tasks[deque->first];
+   deque->first = (deque->first + 1) % deque->capacity;
+   deque->count--;
+   return task;
+}
+
+static retro_task_t *task_deque_pop_back(task_deque_t *deque)
+{
+   if (!deque->count)
+      return NULL;
+
+   deque->count--;
+   return deque->tasks[(deque->first + deque->count) % deque->capacity];
+}
+
+static void task_deque_free(task_deque_t *deque)
+{
+   free(deque->tasks);
+   deque->tasks    = NULL;
+   deque->first    = 0;
+   deque->count    = 0;
+   deque->capacity = 0;
+}
+
+static enum task_priority task_get_priority(retro_task_t *task)
+{
+   if ((unsigned)task->priority < TASK_PRIORITY_LAST)
+      return task->priority;
+   return TASK_PRIORITY_NORMAL;
+}
+
+/* Workers never all run background tasks,
+ * unless there is only one of them */
+static unsigned task_background_max(void)
+{
+   return (workers_count > 1) ? workers_count - 1 : 1;
+}
+
+/* 'worker_lock' must be held for the duration of this function.
+ * Queues 'task' on 'worker', or on the next worker in turn if NULL.
+ * Tasks that are not parallel always go to the serial queue. */
+static void task_worker_push(retro_task_t *task, task_worker_t *worker)
+{
+   enum task_priority priority = task_get_priority(task);
+
+   if (!(task->flags & RETRO_TASK_FLG_PARALLEL))
+   {
+      task_deque_push(&tasks_serial[priority], task);
+      /* Only the first worker can take it, so wake them all */
+      scond_broadcast(worker_cond);
+      return;
+   }
+
+   if (!worker)
+      worker = &workers[next_worker++ % workers_count];
+
+   slock_lock(worker->lock);
+   task_deque_push(&worker->deques[priority], task);
+   slock_unlock(worker->lock);
+
+   tasks_ready[priority]++;
+   scond_signal(worker_cond);
+}
+
+/* 'worker_lock' must be held for the duration of this function.
+ * Like task_worker_push(), unless the task's 'when'
+ * is still to come, in which case it waits until then. */
+static void task_worker_queue(retro_task_t *task, task_worker_t *worker)
+{
+   if (task->when && task->when > cpu_features_get_time_usec())
+   {
+      task_deque_push(&tasks_delayed, task);
+      /* The first delayed task decides how long idle workers sleep */
+      scond_signal(worker_cond);
+      return;
+   }
+
+   task_worker_push(task, worker);
+}
+
+/* 'worker_lock' must be held for the duration of this function.
+ * Queues the delayed tasks that are due on 'worker'.
+ * Returns how long until the next one is, or 0 if none is left. */
+static retro_time_t task_worker_release_delayed(task_worker_t *worker)
+{
+   size_t i;
+   retro_time_t next = 0;
+   retro_time_t now;
+
+   if (!tasks_delayed.count)
+      return 0;
+
+   now = cpu_features_get_time_usec();
+
+   /* Allow half a millisecond for context switching */
+   for (i = 0; i < tasks_delayed.count; )
+   {
+      retro_task_t *task = tasks_delayed.tasks[i];
+
+      if (task->when - now - 500 <= 0)
+      {
+         tasks_delayed.tasks[i] = tasks_delayed.tasks[--tasks_delayed.count];
+         task_worker_push(task, worker);
+         continue;
+      }
+
+      if (!next || task->when - now < next)
+         next = task->when - now;
+      i++;
+   }
+
+   return next;
+}
+
+/* 'worker_lock' must be held for the duration of this function */
+static unsigned task_worker_ready(task_worker_t *worker,
+      enum task_priority priority)
+{
+   unsigned ready = tasks_ready[priority];
+   if (worker->id == 0)
+      ready += (unsigned)tasks_serial[priority].count;
+   return ready;
+}
+
+/* 'worker_lock' must be held for the duration of this function */
+static bool task_worker_has_work(task_worker_t *worker)
+{
+   return task_worker_ready(worker, TASK_PRIORITY_INTERACTIVE) > 0
+      ||  task_worker_ready(worker, TASK_PRIORITY_NORMAL)      > 0
+      || (task_worker_ready(worker, TASK_PRIORITY_BACKGROUND)  > 0
+            && background_running < task_background_max());
+}
+
+/* Takes the most urgent task of any worker, looking at the
+ * serial queue (first worker only), then at 'worker' itself
+ * first for each priority */
+static retro_task_t *task_worker_take(task_worker_t *worker,
+      enum task_priority *priority)
+{
+   static const enum task_priority order[] = {
+      TASK_PRIORITY_INTERACTIVE,
+      TASK_PRIORITY_NORMAL,
+      TASK_PRIORITY_BACKGROUND
+   };
+   unsigned i, j;
+
+   for (i = 0; i < ARRAY_SIZE(order); i++)
+   {
+      enum task_priority p = order[i];
+
+      if (p == TASK_PRIORITY_BACKGROUND)
+      {
+         bool allowed;
+
+         slock_lock(worker_lock);
+         if ((allowed = background_running < task_background_max()))
+            background_running++;
+         slock_unlock(worker_lock);
+
+         if (!allowed)
+            return NULL;
+      }
+
+      if (worker->id == 0)
+      {
+         retro_task_t *task;
+
+         slock_lock(worker_lock);
+         task = task_deque_pop_front(&tasks_serial[p]);
+         slock_unlock(worker_lock);
+
+         if (task)
+         {
+            *priority = p;
+            return task;
+         }
+      }
+
+      for (j = 0; j < workers_count; j++)
+      {
+         task_worker_t *victim = &workers[(worker->id + j) % workers_count];
+         retro_task_t *task;
+
+         /* Own tasks go round in order, stolen ones
+          * come from the end the owner gets to last */
+         slock_lock(victim->lock);
+         task = (victim == worker)
+            ? task_deque_pop_front(&victim->deques[p])
+            : task_deque_pop_back(&victim->deques[p]);
+         slock_unlock(victim->lock);
+
+         if (task)
+         {
+            slock_lock(worker_lock);
+            tasks_ready[p]--;
+            slock_unlock(worker_lock);
+
+            *priority = p;
+            return task;
+         }
+      }
+
+      if (p == TASK_PRIORITY_BACKGROUND)
+      {
+         slock_lock(worker_lock);
+         background_running--;
+         slock_unlock(worker_lock);
+      }
+   }
+
+   return NULL;
+}
+
 static void retro_task_threaded_push_running(retro_task_t *task)
 {
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
+
+   slock_lock(worker_lock);
+   task_worker_queue(task, NULL);
+   slock_unlock(worker_lock);
 }
 
 static void retro_task_threaded_cancel(void *task)
@@ -476,65 +924,59 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
 
 static void threaded_worker(void *userdata)
 {
+   task_worker_t *worker = (task_worker_t*)userdata;
+
    for (;;)
    {
+      enum task_priority priority;
       retro_task_t *task  = NULL;
       bool       finished = false;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
-
-      slock_lock(running_lock);
+      slock_lock(worker_lock);
 
-      /* Get first task to run */
-      if (!(task = tasks_running.front))
+      for (;;)
       {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
+         retro_time_t delay = task_worker_release_delayed(worker);
+
+         /* should we keep running until all tasks finished? */
+         if (!worker_continue || task_worker_has_work(worker))
+            break;
+
+         if (delay > 0)
+            scond_wait_timeout(worker_cond, worker_lock, delay);
+         else
+            scond_wait(worker_cond, worker_lock);
       }
 
-      if (task->when)
+      if (!worker_continue)
       {
-         retro_time_t now   = cpu_features_get_time_usec();
-         retro_time_t delay = task->when - now - 500; /* allow half a millisecond for context switching */
-         if (delay > 0)
-         {
-            scond_wait_timeout(worker_cond, running_lock, delay);
-            slock_unlock(running_lock);
-            continue;
-         }
+         slock_unlock(worker_lock);
+         break;
       }
 
-      slock_unlock(running_lock);
+      slock_unlock(worker_lock);
+
+      if (!(task = task_worker_take(worker, &priority)))
+         continue;
 
-      task->handler(task);
+      task_queue_run(task, (uint8_t)(worker->id + 1));
 
       slock_lock(property_lock);
       finished = ((task->flags & RETRO_TASK_FLG_FINISHED) > 0) ? true : false;
       slock_unlock(property_lock);
 
-      /* Update queue */
       if (!finished)
       {
-         /* Move the task to the back of the queue */
-         /* mimics retro_task_threaded_push_running,
-          * but also includes a task_queue_remove */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-
-         /* do nothing if only item in queue */
-         if (task->next)
-         {
-            task_queue_remove(&tasks_running, task);
-            task_queue_put(&tasks_running, task);
-            scond_signal(worker_cond);
-         }
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
+         /* Back to the end of this worker's queue, or
+          * to the delayed tasks if it asked to wait */
+         slock_lock(worker_lock);
+         task_worker_queue(task, worker);
+         slock_unlock(worker_lock);
       }
       else
       {
+         task_stats_finish(task);
+
          /* Remove task from running queue */
          slock_lock(running_lock);
          slock_lock(queue_lock);
@@ -547,45 +989,117 @@ static void threaded_worker(void *userdata)
          task_queue_put(&tasks_finished, task);
          slock_unlock(finished_lock);
       }
+
+      if (priority == TASK_PRIORITY_BACKGROUND)
+      {
+         /* Another worker may have been held back by the limit,
+          * and only the first one can take serial tasks */
+         slock_lock(worker_lock);
+         background_running--;
+         scond_broadcast(worker_cond);
+         slock_unlock(worker_lock);
+      }
    }
 }
 
+static unsigned task_queue_workers_wanted(void)
+{
+   unsigned threads = workers_wanted;
+
+   /* Even on a single core, a second thread keeps
+    * background tasks from holding up the others */
+   if (!threads)
+   {
+      threads = cpu_features_get_core_amount();
+      if (threads < 2)
+         threads = 2;
+      else if (threads > 4)
+         threads = 4;
+   }
+
+   return (threads > TASK_WORKERS_MAX) ? TASK_WORKERS_MAX : threads;
+}
+
 static void retro_task_threaded_init(void)
 {
-   running_lock    = slock_new();
-   finished_lock   = slock_new();
-   property_lock   = slock_new();
-   queue_lock      = slock_new();
-   worker_cond     = scond_new();
+   unsigned i;
+   retro_task_t *task = NULL;
+
+   running_lock       = slock_new();
+   finished_lock      = slock_new();
+   property_lock      = slock_new();
+   queue_lock         = slock_new();
+   stats_lock         = slock_new();
+   worker_lock        = slock_new();
+   worker_cond        = scond_new();
+
+   workers_count      = task_queue_workers_wanted();
+   background_running = 0;
+   next_worker        = 0;
+   worker_continue    = true;
 
+   for (i = 0; i < TASK_PRIORITY_LAST; i++)
+      tasks_ready[i]  = 0;
+
+   for (i = 0; i < workers_count; i++)
+   {
+      memset(&workers[i], 0, sizeof(workers[i]));
+      workers[i].id   = i;
+      workers[i].lock = slock_new();
+   }
+
+   /* Tasks pushed before the switch to threads */
    slock_lock(running_lock);
-   worker_continue = true;
+   slock_lock(worker_lock);
+   for (task = tasks_running.front; task; task = task->next)
+      task_worker_queue(task, NULL);
+   slock_unlock(worker_lock);
    slock_unlock(running_lock);
 
-   worker_thread   = sthread_create(threaded_worker, NULL);
+   for (i = 0; i < workers_count; i++)
+      workers[i].thread = sthread_create(threaded_worker, &workers[i]);
 }
 
 static void retro_task_threaded_deinit(void)
 {
-   slock_lock(running_lock);
+   unsigned i, j;
+
+   slock_lock(worker_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
-   slock_unlock(running_lock);
+   scond_broadcast(worker_cond);
+   slock_unlock(worker_lock);
 
-   sthread_join(worker_thread);
+   /* Unfinished tasks stay in the running queue */
+   for (i = 0; i < workers_count; i++)
+   {
+      if (workers[i].thread)
+         sthread_join(workers[i].thread);
+      for (j = 0; j < TASK_PRIORITY_LAST; j++)
+         task_deque_free(&workers[i].deques[j]);
+      slock_free(workers[i].lock);
+      workers[i].thread = NULL;
+      workers[i].lock   = NULL;
+   }
+   for (j = 0; j < TASK_PRIORITY_LAST; j++)
+      task_deque_free(&tasks_serial[j]);
+   task_deque_free(&tasks_delayed);
 
    scond_free(worker_cond);
+   slock_free(worker_lock);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
    slock_free(queue_lock);
+   slock_free(stats_lock);
 
-   worker_thread   = NULL;
+   workers_count   = 0;
    worker_cond     = NULL;
+   worker_lock     = NULL;
    running_lock    = NULL;
    finished_lock   = NULL;
    property_lock   = NULL;
    queue_lock      = NULL;
+   stats_lock      = NULL;
 }
 
 static struct retro_task_impl impl_threaded = {
@@ -656,20 +1170,216 @@ void task_queue_retrieve(task_retriever_data_t *data)
    impl_current->retrieve(data);
 }
 
+void task_queue_set_threads(unsigned threads)
+{
+#ifdef HAVE_THREADS
+   workers_wanted = threads;
+#endif
+}
+
+size_t task_queue_get_stats(task_stats_t *stats, size_t count)
+{
+   size_t _len;
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   _len = task_stats_count;
+   if (stats)
+      memcpy(stats, task_stats,
+            MIN(count, task_stats_count) * sizeof(*stats));
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+
+   return _len;
+}
+
+void task_queue_reset_stats(void)
+{
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   task_stats_count = 0;
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+}
+
+retro_time_t task_stats_percentile(const task_stats_histogram_t *hist,
+      unsigned percent)
+{
+   unsigned i;
+   uint64_t seen   = 0;
+   uint64_t wanted = ((uint64_t)hist->count * MIN(percent, 100) + 99) / 100;
+
+   if (!hist->count)
+      return 0;
+
+   for (i = 0; i < TASK_STATS_BUCKETS - 1; i++)
+   {
+      if ((seen += hist->buckets[i]) >= wanted && seen)
+         return MIN((retro_time_t)1 << i, hist->max);
+   }
+
+   return hist->max;
+}
+
+bool task_queue_trace_start(const char *path, size_t max_events)
+{
+   task_trace_event_t *events = NULL;
+
+   if (!path || !*path || trace_events)
+      return false;
+
+   if (!max_events)
+      max_events = TASK_TRACE_EVENTS_DEFAULT;
+   if (!(events = (task_trace_event_t*)
+            malloc(max_events * sizeof(*events))))
+      return false;
+
+   free(trace_path);
+   trace_path           = strdup(path);
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   trace_events_count   = 0;
+   trace_events_max     = max_events;
+   trace_events_dropped = 0;
+   trace_events         = events;
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+
+   return true;
+}
+
+static const char *task_trace_thread_name(uint8_t thread,
+      char *s, size_t len)
+{
+   if (thread == 0)
+      return "main";
+   if (thread == TASK_TRACE_THREAD_OTHER)
+      return "other";
+   snprintf(s, len, "task worker %u", (unsigned)thread);
+   return s;
+}
+
+bool task_queue_trace_stop(void)
+{
+   size_t i;
+   RFILE *file                = NULL;
+   task_trace_event_t *events = NULL;
+   size_t count               = 0;
+   size_t dropped             = 0;
+   bool threads[256]          = {false};
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   events               = trace_events;
+   count                = trace_events_count;
+   dropped              = trace_events_dropped;
+   trace_events         = NULL;
+   trace_events_count   = 0;
+   trace_events_max     = 0;
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+
+   if (!events)
+      return false;
+
+   if (!(file = filestream_open(trace_path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      free(events);
+      return false;
+   }
+
+   /* Chrome's trace event format, 'X' being an event
+    * with a duration and 'M' naming a thread */
+   filestream_printf(file, "{\"traceEvents\":[\n");
+   for (i = 0; i < count; i++)
+   {
+      const task_trace_event_t *event = &events[i];
+      threads[event->thread]          = true;
+      filestream_printf(file,
+            "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%u,\"ts\":%lld,\"dur\":%lld",
+            event->name ? event->name : "task",
+            event->task ? "task" : "frontend",
+            (unsigned)event->thread,
+            (long long)event->start, (long long)event->duration);
+      if (event->task)
+         filestream_printf(file, ",\"args\":{\"ident\":%u}",
+               (unsigned)event->ident);
+      filestream_printf(file, "},\n");
+   }
+   for (i = 0; i < ARRAY_SIZE(threads); i++)
+   {
+      char name[32];
+      if (!threads[i])
+         continue;
+      filestream_printf(file,
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+            (unsigned)i, task_trace_thread_name((uint8_t)i,
+               name, sizeof(name)));
+   }
+   filestream_printf(file,
+         "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+         "\"args\":{\"name\":\"task queue\"}}\n"
+         "],\"displayTimeUnit\":\"ms\","
+         "\"otherData\":{\"dropped_events\":%u}}\n",
+         (unsigned)dropped);
+
+   filestream_close(file);
+   free(events);
+   return true;
+}
+
+void task_queue_trace_event(const char *name,
+      retro_time_t start, retro_time_t duration)
+{
+   uint8_t thread = task_is_on_main_thread() ? 0 : TASK_TRACE_THREAD_OTHER;
+
+#ifdef HAVE_THREADS
+   slock_lock(stats_lock);
+#endif
+   task_trace_add(name, start, duration, 0, thread, false);
+#ifdef HAVE_THREADS
+   slock_unlock(stats_lock);
+#endif
+}
+
 void task_queue_check(void)
 {
 #ifdef HAVE_THREADS
    bool current_threaded = (impl_current == &impl_threaded);
    bool want_threaded    = task_threaded_enable;
 
-   if (want_threaded != current_threaded)
+   if (     (want_threaded != current_threaded)
+         || (current_threaded
+            && workers_count != task_queue_workers_wanted()))
       task_queue_deinit();
 
    if (!impl_current)
       task_queue_init(want_threaded, msg_push_bak);
 #endif
 
-   impl_current->gather();
+   /* Callbacks run here, on the main thread */
+   if (trace_events)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+      impl_current->gather();
+      task_queue_trace_event("task_queue_check", start,
+            cpu_features_get_time_usec() - start);
+   }
+   else
+      impl_current->gather();
 }
 
 bool task_queue_push(retro_task_t *task)
@@ -703,6 +1413,8 @@ bool task_queue_push(retro_task_t *task)
          return false;
    }
 
+   task_stats_push(task);
+
    /* The lack of NULL checks in the following functions
     * is proposital to ensure correct control flow by the users. */
    impl_current->push_running(task);
@@ -926,12 +1638,16 @@ retro_task_t *task_init(void)
    task->progress          = 0;
    task->progress_cb       = NULL;
    task->title             = NULL;
+   task->name              = NULL;
    task->type              = TASK_TYPE_NONE;
    task->style             = TASK_STYLE_NONE;
+   task->priority          = TASK_PRIORITY_NORMAL;
    task->ident             = task_count++;
    task->frontend_userdata = NULL;
    task->next              = NULL;
    task->when              = 0;
+   task->queued            = 0;
+   task->started           = 0;
 
    return task;
 }
@@ -0,0 +1,192 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_spsc_ring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/spsc_ring.h>
+#include <rthreads/rthreads.h>
+#include <retro_miscellaneous.h>
+#include <retro_timers.h>
+
+#define SUITE_NAME "SPSC Ring"
+
+START_TEST (test_spsc_ring_create)
+{
+   spsc_ring_t *ring = spsc_ring_new(100);
+   ck_assert_ptr_nonnull(ring);
+   ck_assert_int_eq(spsc_ring_read_avail(ring), 0);
+   ck_assert_int_eq(spsc_ring_write_avail(ring), 100);
+   spsc_ring_free(ring);
+   spsc_ring_free(NULL);
+
+   ck_assert(spsc_ring_new(0) == NULL);
+}
+END_TEST
+
+START_TEST (test_spsc_ring_capacity)
+{
+   unsigned i;
+   uint8_t in[128], out[128];
+   spsc_ring_t ring;
+
+   for (i = 0; i < sizeof(in); i++)
+      in[i] = (uint8_t)i;
+
+   /* Holds exactly what was asked for, not the power of two */
+   ck_assert(spsc_ring_init(&ring, 100));
+   ck_assert_int_eq(spsc_ring_write(&ring, in, sizeof(in)), 100);
+   ck_assert_int_eq(spsc_ring_read_avail(&ring), 100);
+   ck_assert_int_eq(spsc_ring_write_avail(&ring), 0);
+   ck_assert_int_eq(spsc_ring_write(&ring, in, 1), 0);
+
+   ck_assert_int_eq(spsc_ring_read(&ring, out, sizeof(out)), 100);
+   ck_assert(!memcmp(in, out, 100));
+   ck_assert_int_eq(spsc_ring_read(&ring, out, 1), 0);
+   ck_assert_int_eq(spsc_ring_write_avail(&ring), 100);
+   spsc_ring_deinit(&ring);
+}
+END_TEST
+
+START_TEST (test_spsc_ring_wrap)
+{
+   unsigned i, j;
+   uint8_t in[37], out[37];
+   uint8_t next_in  = 0;
+   uint8_t next_out = 0;
+   spsc_ring_t ring;
+
+   ck_assert(spsc_ring_init(&ring, 64));
+
+   /* Odd sizes, so reads and writes straddle the end of the storage */
+   for (i = 0; i < 1000; i++)
+   {
+      size_t size = 1 + (i * 7) % sizeof(in);
+      size_t done;
+
+      for (j = 0; j < size; j++)
+         in[j] = (uint8_t)(next_in + j);
+      done     = spsc_ring_write(&ring, in, size);
+      next_in += (uint8_t)done;
+
+      done = spsc_ring_read(&ring, out, 1 + (i * 5) % sizeof(out));
+      for (j = 0; j < done; j++)
+         ck_assert_int_eq(out[j], (uint8_t)(next_out + j));
+      next_out += (uint8_t)done;
+
+      ck_assert(spsc_ring_read_avail(&ring) <= 64);
+      ck_assert_int_eq(spsc_ring_read_avail(&ring)
+            + spsc_ring_write_avail(&ring), 64);
+   }
+   spsc_ring_deinit(&ring);
+}
+END_TEST
+
+#ifdef HAVE_THREADS
+#define TEST_THREADED_BYTES (8 * 1024 * 1024)
+
+static void test_spsc_ring_producer(void *data)
+{
+   spsc_ring_t *ring = (spsc_ring_t*)data;
+   uint8_t chunk[97];
+   size_t sent       = 0;
+   uint8_t next      = 0;
+
+   while (sent < TEST_THREADED_BYTES)
+   {
+      size_t i, done;
+      size_t size = MIN(sizeof(chunk), TEST_THREADED_BYTES - sent);
+
+      for (i = 0; i < size; i++)
+         chunk[i] = (uint8_t)(next + i);
+
+      /* Retry the rest of the chunk until it fits */
+      for (i = 0; i < size; i += done)
+         if (!(done = spsc_ring_write(ring, chunk + i, size - i)))
+            retro_sleep(0);
+
+      next += (uint8_t)size;
+      sent += size;
+   }
+}
+
+START_TEST (test_spsc_ring_threaded)
+{
+   uint8_t chunk[61];
+   size_t received   = 0;
+   uint8_t next      = 0;
+   bool in_order     = true;
+   spsc_ring_t *ring = spsc_ring_new(1000);
+   sthread_t *thread = sthread_create(test_spsc_ring_producer, ring);
+
+   ck_assert_ptr_nonnull(thread);
+
+   while (received < TEST_THREADED_BYTES)
+   {
+      size_t i;
+      size_t done = spsc_ring_read(ring, chunk, sizeof(chunk));
+
+      if (!done)
+         retro_sleep(0);
+      for (i = 0; i < done; i++)
+         if (chunk[i] != (uint8_t)(next + i))
+            in_order = false;
+      next     += (uint8_t)done;
+      received += done;
+   }
+
+   sthread_join(thread);
+   ck_assert(in_order);
+   ck_assert_int_eq(received, TEST_THREADED_BYTES);
+   ck_assert_int_eq(spsc_ring_read_avail(ring), 0);
+   spsc_ring_free(ring);
+}
+END_TEST
+#endif
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_set_timeout(tc_core, 60);
+   tcase_add_test(tc_core, test_spsc_ring_create);
+   tcase_add_test(tc_core, test_spsc_ring_capacity);
+   tcase_add_test(tc_core, test_spsc_ring_wrap);
+#ifdef HAVE_THREADS
+   tcase_add_test(tc_core, test_spsc_ring_threaded);
+#endif
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+	int num_fail;
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	num_fail = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
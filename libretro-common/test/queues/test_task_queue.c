@@ -0,0 +1,548 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_task_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/task_queue.h>
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#include <retro_timers.h>
+
+#define SUITE_NAME "Task Queue"
+
+/* How long a test waits for tasks before failing */
+#define TEST_TIMEOUT_USEC 10000000
+
+typedef struct
+{
+   slock_t *lock;
+   /* Slices left to run before the task finishes,
+    * or -1 to run until cancelled */
+   int slices;
+   unsigned ran;
+   unsigned inside;
+   unsigned overlaps;
+   /* Tasks with the same 'meet' wait for each other */
+   unsigned *meet;
+   unsigned meet_count;
+   bool met;
+   bool on_main_thread;
+   bool callback_on_main_thread;
+   bool done;
+} test_task_state_t;
+
+static void test_task_handler(retro_task_t *task)
+{
+   test_task_state_t *state = (test_task_state_t*)task->state;
+   bool finish              = false;
+
+   slock_lock(state->lock);
+   if (state->inside++)
+      state->overlaps++;
+   state->ran++;
+   if (!task_is_on_main_thread())
+      state->on_main_thread = false;
+   slock_unlock(state->lock);
+
+   if (state->meet)
+   {
+      retro_time_t start = cpu_features_get_time_usec();
+
+      slock_lock(state->lock);
+      (*state->meet)++;
+      slock_unlock(state->lock);
+
+      for (;;)
+      {
+         unsigned met;
+
+         slock_lock(state->lock);
+         met = *state->meet;
+         slock_unlock(state->lock);
+
+         if (met >= state->meet_count)
+         {
+            state->met = true;
+            break;
+         }
+         if (cpu_features_get_time_usec() - start > TEST_TIMEOUT_USEC / 10)
+            break;
+         retro_sleep(1);
+      }
+   }
+
+   if (state->slices < 0)
+   {
+      if (task_get_flags(task) & RETRO_TASK_FLG_CANCELLED)
+         finish = true;
+      else
+         retro_sleep(5);
+   }
+   else if (--state->slices <= 0)
+      finish = true;
+
+   slock_lock(state->lock);
+   state->inside--;
+   slock_unlock(state->lock);
+
+   if (finish)
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+
+static void test_task_callback(retro_task_t *task,
+      void *task_data, void *user_data, const char *error)
+{
+   test_task_state_t *state       = (test_task_state_t*)task->state;
+   state->callback_on_main_thread = task_is_on_main_thread();
+   state->done                    = true;
+}
+
+static slock_t *test_lock;
+
+static retro_task_t *test_task_new(test_task_state_t *state, int slices,
+      enum task_priority priority)
+{
+   retro_task_t *task = task_init();
+
+   memset(state, 0, sizeof(*state));
+   state->lock           = test_lock;
+   state->slices         = slices;
+   state->on_main_thread = true;
+
+   task->handler         = test_task_handler;
+   task->callback        = test_task_callback;
+   task->state           = state;
+   task->priority        = priority;
+   task->flags          |= RETRO_TASK_FLG_MUTE;
+   return task;
+}
+
+/* Runs the queue until 'state' is done, or the test times out */
+static bool test_task_wait(test_task_state_t *state)
+{
+   retro_time_t start = cpu_features_get_time_usec();
+
+   while (!state->done)
+   {
+      if (cpu_features_get_time_usec() - start > TEST_TIMEOUT_USEC)
+         return false;
+      task_queue_check();
+      retro_sleep(1);
+   }
+
+   return true;
+}
+
+static void test_setup(bool threaded, unsigned threads)
+{
+   test_lock = slock_new();
+   task_queue_set_threads(threads);
+   task_queue_init(threaded, NULL);
+}
+
+static void test_teardown(void)
+{
+   task_queue_deinit();
+   task_queue_set_threads(0);
+   slock_free(test_lock);
+   test_lock = NULL;
+}
+
+START_TEST (test_task_queue_regular)
+{
+   test_task_state_t state;
+
+   test_setup(false, 0);
+   task_queue_push(test_task_new(&state, 3, TASK_PRIORITY_NORMAL));
+   ck_assert(test_task_wait(&state));
+   ck_assert_int_eq(state.ran, 3);
+   ck_assert(state.on_main_thread);
+   ck_assert(state.callback_on_main_thread);
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_threaded)
+{
+   unsigned i;
+   test_task_state_t states[32];
+
+   test_setup(true, 4);
+   for (i = 0; i < 32; i++)
+   {
+      retro_task_t *task = test_task_new(&states[i], 1 + i % 5,
+            (enum task_priority)(i % TASK_PRIORITY_LAST));
+      if (i & 1)
+         task->flags    |= RETRO_TASK_FLG_PARALLEL;
+      task_queue_push(task);
+   }
+
+   for (i = 0; i < 32; i++)
+   {
+      ck_assert(test_task_wait(&states[i]));
+      ck_assert_int_eq(states[i].ran, 1 + i % 5);
+      /* Handlers run on the workers, callbacks on the main thread */
+      ck_assert(!states[i].on_main_thread);
+      ck_assert(states[i].callback_on_main_thread);
+      /* A task never runs on two workers at once */
+      ck_assert_int_eq(states[i].overlaps, 0);
+   }
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_workers_run_together)
+{
+   unsigned meet = 0;
+   retro_task_t *task_a, *task_b;
+   test_task_state_t a, b;
+
+   /* Each task waits for the other one to run */
+   test_setup(true, 2);
+   task_a       = test_task_new(&a, 1, TASK_PRIORITY_NORMAL);
+   task_b       = test_task_new(&b, 1, TASK_PRIORITY_NORMAL);
+   a.meet       = b.meet       = &meet;
+   a.meet_count = b.meet_count = 2;
+   task_a->flags |= RETRO_TASK_FLG_PARALLEL;
+   task_b->flags |= RETRO_TASK_FLG_PARALLEL;
+   task_queue_push(task_a);
+   task_queue_push(task_b);
+
+   ck_assert(test_task_wait(&a));
+   ck_assert(test_task_wait(&b));
+   ck_assert(a.met);
+   ck_assert(b.met);
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_serial_run_alone)
+{
+   unsigned meet = 0;
+   retro_task_t *task_a, *task_b;
+   test_task_state_t a, b;
+
+   /* Without RETRO_TASK_FLG_PARALLEL, whichever task runs
+    * first gives up waiting before the other one starts */
+   test_setup(true, 4);
+   task_a       = test_task_new(&a, 1, TASK_PRIORITY_NORMAL);
+   task_b       = test_task_new(&b, 1, TASK_PRIORITY_INTERACTIVE);
+   a.meet       = b.meet       = &meet;
+   a.meet_count = b.meet_count = 2;
+   task_queue_push(task_a);
+   task_queue_push(task_b);
+
+   ck_assert(test_task_wait(&a));
+   ck_assert(test_task_wait(&b));
+   ck_assert(a.met != b.met);
+   test_teardown();
+}
+END_TEST
+
+static bool test_task_find(retro_task_t *task, void *userdata)
+{
+   return task->state == userdata;
+}
+
+START_TEST (test_task_queue_interactive_not_starved)
+{
+   unsigned i;
+   task_finder_data_t find_data;
+   test_task_state_t background[4];
+   test_task_state_t interactive;
+
+   /* Background tasks that only finish when cancelled
+    * take up every worker they are allowed to */
+   test_setup(true, 2);
+   for (i = 0; i < 4; i++)
+      task_queue_push(test_task_new(&background[i], -1,
+               TASK_PRIORITY_BACKGROUND));
+   retro_sleep(20);
+
+   task_queue_push(test_task_new(&interactive, 2,
+            TASK_PRIORITY_INTERACTIVE));
+   ck_assert(test_task_wait(&interactive));
+   ck_assert_int_eq(interactive.ran, 2);
+
+   for (i = 0; i < 4; i++)
+      ck_assert(!background[i].done);
+
+   find_data.func     = test_task_find;
+   find_data.userdata = &background[0];
+   ck_assert(task_queue_find(&find_data));
+
+   task_queue_reset();
+   for (i = 0; i < 4; i++)
+   {
+      ck_assert(test_task_wait(&background[i]));
+      ck_assert_int_eq(background[i].overlaps, 0);
+   }
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_cancel)
+{
+   test_task_state_t state;
+   retro_task_t *task;
+
+   test_setup(true, 2);
+   task = test_task_new(&state, -1, TASK_PRIORITY_NORMAL);
+   task_queue_push(task);
+   retro_sleep(20);
+   ck_assert(!state.done);
+
+   task_queue_cancel_task(task);
+   ck_assert(test_task_wait(&state));
+   ck_assert(state.ran > 0);
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_blocking)
+{
+   test_task_state_t first, second;
+   retro_task_t *task;
+
+   test_setup(true, 2);
+   task       = test_task_new(&first, -1, TASK_PRIORITY_INTERACTIVE);
+   task->type = TASK_TYPE_BLOCKING;
+   ck_assert(task_queue_push(task));
+
+   task       = test_task_new(&second, 1, TASK_PRIORITY_INTERACTIVE);
+   task->type = TASK_TYPE_BLOCKING;
+   ck_assert(!task_queue_push(task));
+   free(task);
+
+   task_queue_reset();
+   ck_assert(test_task_wait(&first));
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_delayed)
+{
+   test_task_state_t state;
+   retro_task_t *task;
+   retro_time_t start;
+
+   test_setup(true, 2);
+   task       = test_task_new(&state, 1, TASK_PRIORITY_NORMAL);
+   start      = cpu_features_get_time_usec();
+   task->when = start + 50000;
+   task_queue_push(task);
+
+   ck_assert(test_task_wait(&state));
+   ck_assert(cpu_features_get_time_usec() - start >= 49000);
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_switch_threaded)
+{
+   test_task_state_t state;
+
+   /* Tasks carry on when the queue moves to threads */
+   test_setup(false, 2);
+   task_queue_push(test_task_new(&state, 50, TASK_PRIORITY_NORMAL));
+   task_queue_check();
+   task_queue_set_threaded();
+   ck_assert(test_task_wait(&state));
+   ck_assert_int_eq(state.ran, 50);
+   ck_assert_int_eq(state.overlaps, 0);
+   task_queue_unset_threaded();
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_wait)
+{
+   unsigned i;
+   test_task_state_t states[8];
+
+   test_setup(true, 3);
+   for (i = 0; i < 8; i++)
+      task_queue_push(test_task_new(&states[i], 4,
+               TASK_PRIORITY_BACKGROUND));
+
+   task_queue_wait(NULL, NULL);
+   for (i = 0; i < 8; i++)
+   {
+      ck_assert(states[i].done);
+      ck_assert_int_eq(states[i].ran, 4);
+   }
+   test_teardown();
+}
+END_TEST
+
+static const task_stats_t *test_find_stats(const task_stats_t *stats,
+      size_t count, const char *name)
+{
+   size_t i;
+   for (i = 0; i < count; i++)
+      if (stats[i].name && !strcmp(stats[i].name, name))
+         return &stats[i];
+   return NULL;
+}
+
+START_TEST (test_task_queue_stats)
+{
+   unsigned i;
+   size_t count;
+   task_stats_t stats[8];
+   const task_stats_t *found;
+   test_task_state_t states[3];
+
+   test_setup(true, 2);
+   task_queue_reset_stats();
+   for (i = 0; i < 3; i++)
+   {
+      retro_task_t *task = test_task_new(&states[i], 2,
+            TASK_PRIORITY_NORMAL);
+      task->name         = "stats_test";
+      task_queue_push(task);
+   }
+   for (i = 0; i < 3; i++)
+      ck_assert(test_task_wait(&states[i]));
+
+   count = task_queue_get_stats(stats, 8);
+   ck_assert_int_eq(count, 1);
+   found = test_find_stats(stats, count, "stats_test");
+   ck_assert(found != NULL);
+   ck_assert_int_eq(found->pushed, 3);
+   ck_assert_int_eq(found->finished, 3);
+   ck_assert_int_eq(found->wait.count, 3);
+   ck_assert_int_eq(found->iteration.count, 6);
+   ck_assert_int_eq(found->runtime.count, 3);
+   ck_assert(found->runtime.max >= found->iteration.max);
+
+   task_queue_reset_stats();
+   ck_assert_int_eq(task_queue_get_stats(NULL, 0), 0);
+   test_teardown();
+}
+END_TEST
+
+START_TEST (test_task_queue_stats_percentile)
+{
+   unsigned i;
+   task_stats_histogram_t hist;
+
+   memset(&hist, 0, sizeof(hist));
+   ck_assert_int_eq(task_stats_percentile(&hist, 50), 0);
+
+   /* 90 times of 3 us (below 4) and 10 of 1000 us (below 1024) */
+   hist.buckets[2] = 90;
+   hist.buckets[10] = 10;
+   hist.count      = 100;
+   hist.max        = 1000;
+   ck_assert_int_eq(task_stats_percentile(&hist, 50), 4);
+   ck_assert_int_eq(task_stats_percentile(&hist, 90), 4);
+   ck_assert_int_eq(task_stats_percentile(&hist, 91), 1000);
+   ck_assert_int_eq(task_stats_percentile(&hist, 100), 1000);
+
+   for (i = 0; i < TASK_STATS_BUCKETS; i++)
+      hist.buckets[i] = 0;
+   hist.buckets[TASK_STATS_BUCKETS - 1] = 1;
+   hist.count = 1;
+   hist.max   = 123456789;
+   ck_assert_int_eq(task_stats_percentile(&hist, 50), 123456789);
+}
+END_TEST
+
+START_TEST (test_task_queue_trace)
+{
+   FILE *file;
+   long size;
+   char *json;
+   retro_task_t *task;
+   test_task_state_t state;
+   const char *path = "test_task_queue_trace.json";
+
+   test_setup(true, 2);
+   ck_assert(!task_queue_trace_stop());
+   ck_assert(task_queue_trace_start(path, 0));
+   ck_assert(!task_queue_trace_start(path, 0));
+
+   task       = test_task_new(&state, 3, TASK_PRIORITY_NORMAL);
+   task->name = "trace_test";
+   task_queue_push(task);
+   ck_assert(test_task_wait(&state));
+   task_queue_trace_event("frame", 1000, 16000);
+   ck_assert(task_queue_trace_stop());
+   test_teardown();
+
+   ck_assert((file = fopen(path, "rb")) != NULL);
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+   json = (char*)calloc(1, size + 1);
+   ck_assert_int_eq(fread(json, 1, size, file), size);
+   fclose(file);
+   remove(path);
+
+   ck_assert(strstr(json, "{\"traceEvents\":[") == json);
+   ck_assert(strstr(json, "\"name\":\"trace_test\",\"cat\":\"task\"") != NULL);
+   ck_assert(strstr(json, "\"name\":\"frame\",\"cat\":\"frontend\","
+            "\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":1000,\"dur\":16000") != NULL);
+   ck_assert(strstr(json, "\"name\":\"task worker 1\"") != NULL
+         ||  strstr(json, "\"name\":\"task worker 2\"") != NULL);
+   ck_assert(strstr(json, "\"dropped_events\":0}}") != NULL);
+   free(json);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_set_timeout(tc_core, 60);
+   tcase_add_test(tc_core, test_task_queue_regular);
+   tcase_add_test(tc_core, test_task_queue_threaded);
+   tcase_add_test(tc_core, test_task_queue_workers_run_together);
+   tcase_add_test(tc_core, test_task_queue_serial_run_alone);
+   tcase_add_test(tc_core, test_task_queue_interactive_not_starved);
+   tcase_add_test(tc_core, test_task_queue_cancel);
+   tcase_add_test(tc_core, test_task_queue_blocking);
+   tcase_add_test(tc_core, test_task_queue_delayed);
+   tcase_add_test(tc_core, test_task_queue_switch_threaded);
+   tcase_add_test(tc_core, test_task_queue_wait);
+   tcase_add_test(tc_core, test_task_queue_stats);
+   tcase_add_test(tc_core, test_task_queue_stats_percentile);
+   tcase_add_test(tc_core, test_task_queue_trace);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+	int num_fail;
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	num_fail = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
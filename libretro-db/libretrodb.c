@@ -35,6 +35,11 @@
 #include <string/stdstring.h>
 #include <compat/strl.h>
 
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
@@ -50,24 +55,39 @@ struct node_iter_ctx
    libretrodb_index_t *idx;
 };
 
+struct libretrodb_index
+{
+   char name[50];
+   uint64_t key_size;
+   uint64_t next;
+   uint64_t count;
+};
+
+/* An index of the database, whose keys and item
+ * offsets are loaded the first time it is used */
+typedef struct libretrodb_index_cache
+{
+   libretrodb_index_t idx;
+   uint64_t offset;
+   const uint8_t *data;
+   bool owned;
+} libretrodb_index_cache_t;
+
 struct libretrodb
 {
    RFILE *fd;
    char *path;
+   uint8_t *map;
+   libretrodb_index_cache_t *indexes;
+   size_t map_size;
+   size_t num_indexes;
    bool can_write;
+   bool indexes_read;
    uint64_t root;
    uint64_t count;
    uint64_t first_index_offset;
 };
 
-struct libretrodb_index
-{
-   char name[50];
-   uint64_t key_size;
-   uint64_t next;
-   uint64_t count;
-};
-
 typedef struct libretrodb_metadata
 {
    uint64_t count;
@@ -79,11 +99,39 @@ typedef struct libretrodb_header
    uint64_t metadata_offset;
 } libretrodb_header_t;
 
+#define LIBRETRODB_CURSOR_BUFFER_SIZE 65536
+
+/* How a cursor with a query finds its items */
+enum libretrodb_cursor_scan
+{
+   /* Decode every item and test it */
+   LIBRETRODB_SCAN_ITEMS = 0,
+   /* Test items straight from the file, and
+    * decode only the ones that match */
+   LIBRETRODB_SCAN_BUFFER,
+   /* Read only the items an index points to */
+   LIBRETRODB_SCAN_INDEX
+};
+
 struct libretrodb_cursor
 {
    RFILE *fd;
    libretrodb_query_t *query;
    libretrodb_t *db;
+   /* Items read ahead (or the mapped database),
+    * starting at file offset 'data_pos' */
+   const uint8_t *data;
+   uint8_t *buff;
+   /* Items found through an index, in file order */
+   uint64_t *offsets;
+   uint64_t data_pos;
+   /* Offset of the next item */
+   uint64_t pos;
+   size_t data_len;
+   size_t buff_size;
+   size_t num_offsets;
+   size_t next_offset;
+   enum libretrodb_cursor_scan scan;
    int is_valid;
    int eof;
 };
@@ -171,8 +219,29 @@ clean:
    return rv;
 }
 
+static void libretrodb_free_indexes(libretrodb_t *db)
+{
+   size_t i;
+
+   for (i = 0; i < db->num_indexes; i++)
+      if (db->indexes[i].owned)
+         free((void*)db->indexes[i].data);
+   free(db->indexes);
+
+   db->indexes      = NULL;
+   db->num_indexes  = 0;
+   db->indexes_read = false;
+}
+
 void libretrodb_close(libretrodb_t *db)
 {
+   libretrodb_free_indexes(db);
+#ifdef HAVE_MMAP
+   if (db->map)
+      munmap(db->map, db->map_size);
+#endif
+   db->map      = NULL;
+   db->map_size = 0;
    if (db->fd)
       filestream_close(db->fd);
    if (!string_is_empty(db->path))
@@ -214,6 +283,34 @@ int libretrodb_open(const char *path, libretrodb_t *db, bool write)
    db->count              = md.count;
    db->first_index_offset = filestream_tell(fd);
    db->fd                 = fd;
+
+#ifdef HAVE_MMAP
+   /* Indexes are looked up straight from the mapped
+    * file, instead of being read into memory */
+   if (!write)
+   {
+      int map_fd = open(path, O_RDONLY);
+
+      if (map_fd >= 0)
+      {
+         off_t size = lseek(map_fd, 0, SEEK_END);
+
+         if (size > 0)
+         {
+            void *data = mmap(NULL, (size_t)size, PROT_READ,
+                  MAP_SHARED, map_fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+               db->map      = (uint8_t*)data;
+               db->map_size = (size_t)size;
+            }
+         }
+
+         close(map_fd);
+      }
+   }
+#endif
    return 0;
 
 error:
@@ -253,69 +350,238 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
    return -1;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+/* Reads the headers of all the indexes once */
+static void libretrodb_read_indexes(libretrodb_t *db)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint8_t *current   = ((uint8_t *)buff + (mid * item_size));
-   int rv             = memcmp(current, item, field_size);
+   libretrodb_index_t idx;
+
+   db->indexes_read = true;
+
+   filestream_seek(db->fd,
+                   (ssize_t)db->first_index_offset,
+                   RETRO_VFS_SEEK_POSITION_START);
 
-   if (rv == 0)
+   while (!filestream_eof(db->fd))
    {
-      *offset         = *(uint64_t *)(current + field_size);
-      return 0;
+      libretrodb_index_cache_t *indexes;
+      uint64_t name_len = 50;
+
+      if (rmsgpack_dom_read_into(db->fd,
+            "name",     idx.name, &name_len,
+            "key_size", &idx.key_size,
+            "next",     &idx.next,
+            "count",    &idx.count,
+                                 NULL) < 0)
+         break;
+
+      if (     idx.key_size == 0
+            || idx.key_size > 0xFF
+            || idx.next != idx.count * (idx.key_size + sizeof(uint64_t)))
+         break;
+
+      if (!(indexes = (libretrodb_index_cache_t*)realloc(db->indexes,
+                  (db->num_indexes + 1) * sizeof(*indexes))))
+         break;
+
+      db->indexes                        = indexes;
+      indexes[db->num_indexes].idx       = idx;
+      indexes[db->num_indexes].offset    = filestream_tell(db->fd);
+      indexes[db->num_indexes].data      = NULL;
+      indexes[db->num_indexes].owned     = false;
+      db->num_indexes++;
+
+      filestream_seek(db->fd, (ssize_t)idx.next,
+            RETRO_VFS_SEEK_POSITION_CURRENT);
    }
+}
 
-   if (count == 0)
-      return -1;
+/* Returns the index called 'index_name', with its keys loaded */
+static const libretrodb_index_cache_t *libretrodb_get_index(
+      libretrodb_t *db, const char *index_name)
+{
+   size_t i;
+
+   if (!db->indexes_read)
+      libretrodb_read_indexes(db);
+
+   for (i = 0; i < db->num_indexes; i++)
+   {
+      libretrodb_index_cache_t *cache = &db->indexes[i];
+
+      if (strncmp(index_name, cache->idx.name,
+               strlen(cache->idx.name)) != 0)
+         continue;
+
+      if (!cache->data)
+      {
+         uint8_t *buff;
+         size_t bufflen = (size_t)cache->idx.next;
+
+         if (db->map)
+         {
+            if (     cache->offset > db->map_size
+                  || bufflen > db->map_size - cache->offset)
+               return NULL;
+            cache->data = db->map + cache->offset;
+            return cache;
+         }
+
+         if (!(buff = (uint8_t*)malloc(bufflen ? bufflen : 1)))
+            return NULL;
+
+         if (     filestream_seek(db->fd, (int64_t)cache->offset,
+                     RETRO_VFS_SEEK_POSITION_START) < 0
+               || filestream_read(db->fd, buff, bufflen)
+                     != (int64_t)bufflen)
+         {
+            free(buff);
+            return NULL;
+         }
+
+         cache->data  = buff;
+         cache->owned = true;
+      }
+
+      return cache;
+   }
+
+   return NULL;
+}
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+/* Position of the first key of 'cache' in [first, count)
+ * that is not less than 'key' */
+static uint64_t libretrodb_index_lower_bound(
+      const libretrodb_index_cache_t *cache,
+      const void *key, uint64_t first)
+{
+   size_t key_size  = (size_t)cache->idx.key_size;
+   size_t item_size = key_size + sizeof(uint64_t);
+   uint64_t count   = cache->idx.count - first;
+
+   while (count > 0)
+   {
+      uint64_t step = count / 2;
+      uint64_t mid  = first + step;
+
+      if (memcmp(cache->data + mid * item_size, key, key_size) < 0)
+      {
+         first  = mid + 1;
+         count -= step + 1;
+      }
+      else
+         count  = step;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+   return first;
+}
+
+static bool libretrodb_index_get_offset(
+      const libretrodb_index_cache_t *cache,
+      const void *key, uint64_t pos, uint64_t *offset)
+{
+   size_t key_size    = (size_t)cache->idx.key_size;
+   const uint8_t *cur = cache->data + pos * (key_size + sizeof(uint64_t));
+
+   if (pos >= cache->idx.count || memcmp(cur, key, key_size) != 0)
+      return false;
+
+   memcpy(offset, cur + key_size, sizeof(*offset));
+   return true;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
-   libretrodb_index_t idx;
-   int rv;
-   uint8_t *buff;
    uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   const libretrodb_index_cache_t *cache =
+      libretrodb_get_index(db, index_name);
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (     !cache
+         || !libretrodb_index_get_offset(cache, key,
+            libretrodb_index_lower_bound(cache, key, 0), &offset))
       return -1;
 
-   bufflen        = idx.next;
-   if (!(buff = (uint8_t*)malloc(bufflen)))
+   filestream_seek(db->fd, (ssize_t)offset, RETRO_VFS_SEEK_POSITION_START);
+   if (rmsgpack_dom_read(db->fd, out) < 0)
       return -1;
+   return 0;
+}
 
-   while (nread < bufflen)
+/* Sorts 'order' by the keys it points to, keeping equal
+ * keys in order (bottom-up merge sort through 'tmp') */
+static void libretrodb_sort_keys(const void *const *keys, size_t key_size,
+      size_t *order, size_t *tmp, size_t count)
+{
+   size_t width;
+
+   for (width = 1; width < count; width *= 2)
    {
-      void *buff_ = (buff + nread);
-      rv          = (int)filestream_read(db->fd, buff_, bufflen - nread);
+      size_t i;
 
-      if (rv <= 0)
+      for (i = 0; i < count; i += 2 * width)
       {
-         free(buff);
-         return -1;
+         size_t l   = i;
+         size_t m   = (i + width     < count) ? i + width     : count;
+         size_t end = (i + 2 * width < count) ? i + 2 * width : count;
+         size_t r   = m;
+         size_t k   = i;
+
+         while (l < m && r < end)
+            tmp[k++] = (memcmp(keys[order[r]], keys[order[l]], key_size) < 0)
+               ? order[r++] : order[l++];
+         while (l < m)
+            tmp[k++] = order[l++];
+         while (r < end)
+            tmp[k++] = order[r++];
       }
-      nread += rv;
+
+      memcpy(order, tmp, count * sizeof(*order));
    }
+}
+
+int libretrodb_find_entries(libretrodb_t *db, const char *index_name,
+      const void *const *keys, size_t count, struct rmsgpack_dom_value *out)
+{
+   size_t i;
+   size_t *order;
+   uint64_t pos = 0;
+   int found    = 0;
+   const libretrodb_index_cache_t *cache =
+      libretrodb_get_index(db, index_name);
+
+   for (i = 0; i < count; i++)
+      out[i].type = RDT_NULL;
 
-   rv = binsearch(buff, key, idx.count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+   if (!cache)
+      return -1;
+
+   if (!(order = (size_t*)malloc(2 * count * sizeof(*order) + 1)))
+      return -1;
+
+   for (i = 0; i < count; i++)
+      order[i] = i;
+   libretrodb_sort_keys(keys, (size_t)cache->idx.key_size,
+         order, order + count, count);
+
+   /* The sorted keys only ever move forward through the index */
+   for (i = 0; i < count; i++)
+   {
+      uint64_t offset;
+      const void *key = keys[order[i]];
+
+      pos = libretrodb_index_lower_bound(cache, key, pos);
+      if (!libretrodb_index_get_offset(cache, key, pos, &offset))
+         continue;
 
-   if (rv == 0) {
       filestream_seek(db->fd, (ssize_t)offset, RETRO_VFS_SEEK_POSITION_START);
-      rmsgpack_dom_read(db->fd, out);
-      return 0;
-   } else {
-     return -1;
+      if (rmsgpack_dom_read(db->fd, &out[order[i]]) < 0)
+         out[order[i]].type = RDT_NULL;
+      else
+         found++;
    }
+
+   free(order);
+   return found;
 }
 
 /**
@@ -328,12 +594,162 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof         = 0;
+   cursor->pos         = cursor->db->root + sizeof(libretrodb_header_t);
+   cursor->next_offset = 0;
    return (int)filestream_seek(cursor->fd,
-         (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
+         (ssize_t)cursor->pos,
          RETRO_VFS_SEEK_POSITION_START);
 }
 
+/* Makes at least 'want' bytes from the cursor's position
+ * available, unless the file ends before.
+ * Returns the number of bytes available. */
+static size_t libretrodb_cursor_fill(libretrodb_cursor_t *cursor,
+      size_t want)
+{
+   int64_t read_len;
+   size_t avail = 0;
+
+   if (     cursor->pos >= cursor->data_pos
+         && cursor->pos <= cursor->data_pos + cursor->data_len)
+      avail = (size_t)(cursor->data_pos + cursor->data_len - cursor->pos);
+
+   if (avail >= want || !cursor->buff)
+      return avail;
+
+   if (want > cursor->buff_size)
+   {
+      size_t size = cursor->buff_size * 2;
+      uint8_t *buff;
+
+      if (size < want)
+         size = want;
+      if (!(buff = (uint8_t*)realloc(cursor->buff, size)))
+         return avail;
+
+      cursor->buff      = buff;
+      cursor->buff_size = size;
+   }
+
+   /* Keep what is left of the current item */
+   if (avail)
+      memmove(cursor->buff,
+            cursor->buff + (size_t)(cursor->pos - cursor->data_pos), avail);
+   cursor->data     = cursor->buff;
+   cursor->data_pos = cursor->pos;
+   cursor->data_len = avail;
+
+   if (filestream_seek(cursor->fd, (int64_t)(cursor->pos + avail),
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return avail;
+   if ((read_len = filestream_read(cursor->fd, cursor->buff + avail,
+               (int64_t)(cursor->buff_size - avail))) > 0)
+      cursor->data_len += (size_t)read_len;
+
+   return cursor->data_len;
+}
+
+/* Decodes the item at the cursor's position
+ * and moves to the next one */
+static int libretrodb_cursor_decode(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+
+   if (filestream_seek(cursor->fd, (int64_t)cursor->pos,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+   if ((rv = rmsgpack_dom_read(cursor->fd, out)) < 0)
+      return rv;
+
+   cursor->pos = (uint64_t)filestream_tell(cursor->fd);
+   return 0;
+}
+
+static int libretrodb_cursor_read_buffered(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   size_t want = 4096;
+
+   for (;;)
+   {
+      int rv;
+      size_t size  = 0;
+      size_t avail = libretrodb_cursor_fill(cursor, want);
+      const uint8_t *item;
+
+      if (!avail)
+         return -1;
+
+      item = cursor->data + (size_t)(cursor->pos - cursor->data_pos);
+
+      /* The database ends with a nil */
+      if (*item == 0xc0)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      if ((rv = libretrodb_query_filter_buffer(cursor->query,
+                  item, avail, &size)) == 0)
+      {
+         cursor->pos += size;
+         want         = 4096;
+         continue;
+      }
+
+      if (rv == -2 && avail >= want)
+      {
+         /* Read more of the item, unless the file ends */
+         want = avail * 2;
+         continue;
+      }
+
+      if ((rv = libretrodb_cursor_decode(cursor, out)) < 0)
+         return rv;
+
+      if (out->type == RDT_NULL)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      /* Items the query could not test without decoding them */
+      if (size == 0 && !libretrodb_query_filter(cursor->query, out))
+      {
+         rmsgpack_dom_value_free(out);
+         want = 4096;
+         continue;
+      }
+
+      return 0;
+   }
+}
+
+static int libretrodb_cursor_read_indexed(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   while (cursor->next_offset < cursor->num_offsets)
+   {
+      int rv;
+
+      cursor->pos = cursor->offsets[cursor->next_offset++];
+      if ((rv = libretrodb_cursor_decode(cursor, out)) < 0)
+         return rv;
+
+      /* The index only narrows down the items, the
+       * rest of the query still has to match */
+      if (libretrodb_query_filter(cursor->query, out))
+         return 0;
+
+      rmsgpack_dom_value_free(out);
+   }
+
+   cursor->eof = 1;
+   return EOF;
+}
+
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out)
 {
@@ -342,6 +758,11 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
    if (cursor->eof)
       return EOF;
 
+   if (cursor->scan == LIBRETRODB_SCAN_BUFFER)
+      return libretrodb_cursor_read_buffered(cursor, out);
+   if (cursor->scan == LIBRETRODB_SCAN_INDEX)
+      return libretrodb_cursor_read_indexed(cursor, out);
+
 retry:
    if ((rv = rmsgpack_dom_read(cursor->fd, out)) < 0)
       return rv;
@@ -364,6 +785,40 @@ retry:
    return 0;
 }
 
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
+{
+   if (cursor->scan == LIBRETRODB_SCAN_BUFFER)
+      return cursor->pos;
+   if (cursor->scan == LIBRETRODB_SCAN_INDEX)
+      return (cursor->next_offset < cursor->num_offsets)
+         ? cursor->offsets[cursor->next_offset] : cursor->pos;
+   return (uint64_t)filestream_tell(cursor->fd);
+}
+
+int libretrodb_read_item_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+
+   if (!db->fd || offset < db->root + sizeof(libretrodb_header_t))
+      return -1;
+
+   if (filestream_seek(db->fd, (int64_t)offset,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+
+   if ((rv = rmsgpack_dom_read(db->fd, out)) < 0)
+      return rv;
+
+   if (out->type != RDT_MAP)
+   {
+      rmsgpack_dom_value_free(out);
+      return -1;
+   }
+
+   return 0;
+}
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -381,11 +836,95 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
-   cursor->eof      = 1;
-   cursor->fd       = NULL;
-   cursor->db       = NULL;
-   cursor->query    = NULL;
+   free(cursor->buff);
+   free(cursor->offsets);
+
+   cursor->is_valid    = 0;
+   cursor->eof         = 1;
+   cursor->fd          = NULL;
+   cursor->db          = NULL;
+   cursor->query       = NULL;
+   cursor->data        = NULL;
+   cursor->buff        = NULL;
+   cursor->offsets     = NULL;
+   cursor->data_pos    = 0;
+   cursor->data_len    = 0;
+   cursor->buff_size   = 0;
+   cursor->num_offsets = 0;
+   cursor->scan        = LIBRETRODB_SCAN_ITEMS;
+}
+
+static int libretrodb_offset_compare(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+   return (x > y) - (x < y);
+}
+
+/* Looks up the items the query asks for by an indexed field,
+ * if it asks for a field to be equal to one of a few keys */
+static bool libretrodb_cursor_use_index(libretrodb_cursor_t *cursor)
+{
+   size_t i, j;
+   unsigned n, k, num_keys;
+   const char *field;
+
+   for (n = 0; (field = libretrodb_query_get_field(
+               cursor->query, n, &num_keys)); n++)
+   {
+      const libretrodb_index_cache_t *cache;
+
+      if (!num_keys || !(cache = libretrodb_get_index(cursor->db, field)))
+         continue;
+
+      /* Indexes are only known by name, which
+       * has to be the one of the field */
+      if (!string_is_equal(cache->idx.name, field))
+         continue;
+
+      if (!(cursor->offsets = (uint64_t*)malloc(
+                  num_keys * sizeof(*cursor->offsets))))
+         return false;
+
+      for (k = 0; k < num_keys; k++)
+      {
+         uint64_t offset;
+         const struct rmsgpack_dom_value *key =
+            libretrodb_query_get_key(cursor->query, n, k);
+
+         /* Keys of any other size are in no item */
+         if (     key->val.binary.len != cache->idx.key_size
+               || !libretrodb_index_get_offset(cache, key->val.binary.buff,
+                  libretrodb_index_lower_bound(cache,
+                     key->val.binary.buff, 0), &offset))
+            continue;
+
+         /* Older indexes can point the first item past the
+          * items, in which case the items are searched instead */
+         if (offset >= cursor->db->first_index_offset)
+         {
+            free(cursor->offsets);
+            cursor->offsets     = NULL;
+            cursor->num_offsets = 0;
+            return false;
+         }
+
+         cursor->offsets[cursor->num_offsets++] = offset;
+      }
+
+      /* Items come in the order of the database,
+       * whichever key found them */
+      qsort(cursor->offsets, cursor->num_offsets,
+            sizeof(*cursor->offsets), libretrodb_offset_compare);
+      for (i = 0, j = 0; i < cursor->num_offsets; i++)
+         if (!j || cursor->offsets[i] != cursor->offsets[j - 1])
+            cursor->offsets[j++] = cursor->offsets[i];
+      cursor->num_offsets = j;
+
+      return true;
+   }
+
+   return false;
 }
 
 /**
@@ -411,15 +950,40 @@ int libretrodb_cursor_open(libretrodb_t *db,
          RETRO_VFS_FILE_ACCESS_HINT_NONE)))
       return -1;
 
-   cursor->fd       = fd;
-   cursor->db       = db;
-   cursor->is_valid = 1;
+   cursor->fd          = fd;
+   cursor->db          = db;
+   cursor->is_valid    = 1;
+   cursor->query       = q;
+   cursor->data        = NULL;
+   cursor->buff        = NULL;
+   cursor->offsets     = NULL;
+   cursor->data_pos    = 0;
+   cursor->data_len    = 0;
+   cursor->buff_size   = 0;
+   cursor->num_offsets = 0;
+   cursor->scan        = LIBRETRODB_SCAN_ITEMS;
    libretrodb_cursor_reset(cursor);
-   cursor->query    = q;
 
    if (q)
+   {
       libretrodb_query_inc_ref(q);
 
+      if (libretrodb_cursor_use_index(cursor))
+         cursor->scan = LIBRETRODB_SCAN_INDEX;
+      else if (db->map)
+      {
+         cursor->scan     = LIBRETRODB_SCAN_BUFFER;
+         cursor->data     = db->map;
+         cursor->data_len = db->map_size;
+      }
+      else if ((cursor->buff = (uint8_t*)malloc(
+                  LIBRETRODB_CURSOR_BUFFER_SIZE)))
+      {
+         cursor->scan      = LIBRETRODB_SCAN_BUFFER;
+         cursor->buff_size = LIBRETRODB_CURSOR_BUFFER_SIZE;
+      }
+   }
+
    return 0;
 }
 
@@ -451,7 +1015,7 @@ int libretrodb_create_index(libretrodb_t *db,
    void *buff                       = NULL;
    uint64_t *buff_u64               = NULL;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = filestream_tell(db->fd);
+   uint64_t item_loc                = 0;
    bintree_t *tree;
    uint64_t item_count              = 0;
    int rval                         = -1;
@@ -468,6 +1032,8 @@ int libretrodb_create_index(libretrodb_t *db,
    if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
       goto clean;
 
+   item_loc                         = filestream_tell(cur.fd);
+
    key.type                         = RDT_STRING;
    key.val.string.len               = (uint32_t)strlen(field_name);
    key.val.string.buff              = (char *)field_name;   /* We know we aren't going to change it */
@@ -541,6 +1107,7 @@ int libretrodb_create_index(libretrodb_t *db,
    bintree_iterate(tree->root, node_iter, &nictx);
 
    filestream_flush(db->fd);
+   libretrodb_free_indexes(db);
 clean:
    rmsgpack_dom_value_free(&item);
    if (buff)
@@ -566,6 +1133,16 @@ libretrodb_cursor_t *libretrodb_cursor_new(void)
    dbc->eof                 = 0;
    dbc->query               = NULL;
    dbc->db                  = NULL;
+   dbc->data                = NULL;
+   dbc->buff                = NULL;
+   dbc->offsets             = NULL;
+   dbc->data_pos            = 0;
+   dbc->pos                 = 0;
+   dbc->data_len            = 0;
+   dbc->buff_size           = 0;
+   dbc->num_offsets         = 0;
+   dbc->next_offset         = 0;
+   dbc->scan                = LIBRETRODB_SCAN_ITEMS;
 
    return dbc;
 }
@@ -588,6 +1165,11 @@ libretrodb_t *libretrodb_new(void)
    db->count              = 0;
    db->first_index_offset = 0;
    db->path               = NULL;
+   db->map                = NULL;
+   db->map_size           = 0;
+   db->indexes            = NULL;
+   db->num_indexes        = 0;
+   db->indexes_read       = false;
 
    return db;
 }
@@ -54,9 +54,39 @@ int libretrodb_open(const char *path, libretrodb_t *db, bool write);
 int libretrodb_create_index(libretrodb_t *db, const char *name,
       const char *field_name);
 
+/**
+ * libretrodb_find_entry:
+ * @db                  : Handle to database.
+ * @index_name          : Name of the index to search.
+ * @key                 : Key of the item, of the index's key size.
+ * @out                 : Item found.
+ *
+ * The index is read (or mapped) the first time it is
+ * searched, and kept until the database is closed.
+ *
+ * Returns: 0 if the item was found, otherwise negative.
+ **/
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_find_entries:
+ * @db                  : Handle to database.
+ * @index_name          : Name of the index to search.
+ * @keys                : Keys of the items.
+ * @count               : Number of keys.
+ * @out                 : Items found, @count of them. Keys that
+ *                        are not found get an RDT_NULL item.
+ *
+ * Looks up many keys in a single pass over the index,
+ * in order of the keys.
+ *
+ * Returns: number of items found, or negative if there
+ * is no such index.
+ **/
+int libretrodb_find_entries(libretrodb_t *db, const char *index_name,
+      const void *const *keys, size_t count, struct rmsgpack_dom_value *out);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -105,6 +135,30 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_cursor_tell:
+ * @cursor              : Handle to database cursor.
+ *
+ * Returns: offset of the item the next call to
+ * libretrodb_cursor_read_item() will read (or skip over,
+ * if it does not match the cursor's query).
+ **/
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor);
+
+/**
+ * libretrodb_read_item_at:
+ * @db                  : Handle to database.
+ * @offset              : Offset of the item, as returned by
+ *                        libretrodb_cursor_tell().
+ * @out                 : Item read.
+ *
+ * Reads a single item, without walking the database.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_read_item_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
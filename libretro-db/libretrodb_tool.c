@@ -21,13 +21,129 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <string/stdstring.h>
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 
+#define BENCH_BATCH 256
+
+/* Times looking up the values of 'field_name', which
+ * 'index_name' indexes, one at a time and in batches */
+static int bench(libretrodb_t *db, libretrodb_cursor_t *cur,
+      const char *index_name, const char *field_name, unsigned lookups)
+{
+   struct rmsgpack_dom_value key, item;
+   struct rmsgpack_dom_value out[BENCH_BATCH];
+   const void *batch[BENCH_BATCH];
+   char **keys      = NULL;
+   unsigned count   = 0;
+   unsigned found   = 0;
+   unsigned found_batched = 0;
+   unsigned i, j;
+   clock_t t;
+   double single, batched;
+   int rv           = -1;
+
+   key.type           = RDT_STRING;
+   key.val.string.len = (uint32_t)strlen(field_name);
+   key.val.string.buff = (char*)field_name;
+
+   if (libretrodb_cursor_open(db, cur, NULL) != 0)
+   {
+      printf("Could not open cursor\n");
+      return -1;
+   }
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      struct rmsgpack_dom_value *field = rmsgpack_dom_value_map_value(&item, &key);
+
+      if (field && field->type == RDT_BINARY)
+      {
+         char **new_keys = (char**)realloc(keys, (count + 1) * sizeof(*keys));
+         if (!new_keys)
+         {
+            rmsgpack_dom_value_free(&item);
+            goto end;
+         }
+         keys             = new_keys;
+         keys[count++]    = field->val.binary.buff;
+         field->val.binary.buff = NULL;
+         field->val.binary.len  = 0;
+      }
+
+      rmsgpack_dom_value_free(&item);
+   }
+   libretrodb_cursor_close(cur);
+
+   if (!count || !lookups)
+   {
+      printf("No '%s' values to look up\n", field_name);
+      goto end;
+   }
+
+   /* Spread the lookups over the whole index */
+   t = clock();
+   for (i = 0; i < lookups; i++)
+   {
+      if (libretrodb_find_entry(db, index_name,
+               keys[(i * 7919u) % count], &item) == 0)
+      {
+         found++;
+         rmsgpack_dom_value_free(&item);
+      }
+   }
+   single = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+   t = clock();
+   for (i = 0; i < lookups; i += BENCH_BATCH)
+   {
+      unsigned n = lookups - i < BENCH_BATCH ? lookups - i : BENCH_BATCH;
+      int ret;
+
+      for (j = 0; j < n; j++)
+         batch[j] = keys[((i + j) * 7919u) % count];
+
+      if ((ret = libretrodb_find_entries(db, index_name,
+               batch, n, out)) < 0)
+      {
+         printf("No index '%s'\n", index_name);
+         goto end;
+      }
+      found_batched += (unsigned)ret;
+
+      for (j = 0; j < n; j++)
+         rmsgpack_dom_value_free(&out[j]);
+   }
+   batched = (double)(clock() - t) / CLOCKS_PER_SEC;
+
+   if (found != found_batched)
+   {
+      printf("Found %u items one at a time, but %u in batches\n",
+            found, found_batched);
+      goto end;
+   }
+
+   printf("%u lookups of %u keys (%u found): %.0f lookups/s one at a time, "
+         "%.0f lookups/s in batches of %u\n",
+         lookups, count, found,
+         single  > 0 ? lookups / single  : 0.0,
+         batched > 0 ? lookups / batched : 0.0,
+         BENCH_BATCH);
+   rv = 0;
+
+end:
+   for (i = 0; i < count; i++)
+      free(keys[i]);
+   free(keys);
+   return rv;
+}
+
 int main(int argc, char ** argv)
 {
    int rv;
@@ -48,6 +164,7 @@ int main(int argc, char ** argv)
       printf("\tcreate-index <index name> <field name>\n");
       printf("\tfind <query expression>\n");
       printf("\tget-names <query expression>\n");
+      printf("\tbench <index name> <field name> [lookups]\n");
       return 1;
    }
 
@@ -60,7 +177,9 @@ int main(int argc, char ** argv)
    if (!db || !cur)
       goto error;
 
-   if ((rv = libretrodb_open(path, db, true)) != 0)
+   /* Only creating an index writes to the database */
+   if ((rv = libretrodb_open(path, db,
+               memcmp(command, "create-index", 12) == 0)) != 0)
    {
       printf("Could not open db file '%s'\n", path);
       goto error;
@@ -174,6 +293,18 @@ int main(int argc, char ** argv)
 
       libretrodb_create_index(db, index_name, field_name);
    }
+   else if (memcmp(command, "bench", 5) == 0)
+   {
+      if (argc != 5 && argc != 6)
+      {
+         printf("Usage: %s <db file> bench <index name> <field name> [lookups]\n", argv[0]);
+         goto error;
+      }
+
+      if (bench(db, cur, argv[3], argv[4],
+               argc == 6 ? strtoul(argv[5], NULL, 0) : 100000) != 0)
+         goto error;
+   }
    else
    {
       printf("Unknown command %s\n", argv[2]);
@@ -38,6 +38,7 @@
 #include "libretrodb.h"
 #include "query.h"
 #include "rmsgpack_dom.h"
+#include "rmsgpack.h"
 
 #define MAX_ERROR_LEN   256
 #define QUERY_MAX_ARGS  50
@@ -80,9 +81,23 @@ struct argument
    enum argument_type type;
 };
 
+/* A field tested by a query made of a single table,
+ * resolved when the query is compiled */
+struct query_field
+{
+   const struct rmsgpack_dom_value *name;
+   const struct argument *pred;
+   unsigned first_key;
+   unsigned num_keys;
+};
+
 struct query
 {
    struct invocation root; /* ptr alignment */
+   struct query_field *fields;
+   /* Binaries the fields have to be equal to, if any */
+   const struct rmsgpack_dom_value **keys;
+   unsigned num_fields;
    unsigned ref_count;
 };
 
@@ -722,6 +737,24 @@ clean:
    return buff;
 }
 
+/* Tests the value of a field against what a table wants of it */
+static int query_field_matches(const struct argument *arg,
+      struct rmsgpack_dom_value value)
+{
+   struct rmsgpack_dom_value res;
+
+   if (arg->type == AT_VALUE)
+      res = func_equals(value, 1, arg);
+   else
+      res = query_func_is_true(arg->a.invocation.func(
+               value,
+               arg->a.invocation.argc,
+               arg->a.invocation.argv
+               ), 0, NULL);
+
+   return res.val.bool_;
+}
+
 static struct rmsgpack_dom_value query_func_all_map(
       struct rmsgpack_dom_value input,
       unsigned argc, const struct argument *argv)
@@ -746,28 +779,16 @@ static struct rmsgpack_dom_value query_func_all_map(
       unsigned i;
       for (i = 0; i < argc; i += 2)
       {
-         struct argument arg = argv[i];
-         if (arg.type != AT_VALUE)
+         if (argv[i].type != AT_VALUE)
          {
             res.val.bool_ = 0;
             return res;
          }
          /* All missing fields are nil */
-         if (!(value = rmsgpack_dom_value_map_value(&input, &arg.a.value)))
+         if (!(value = rmsgpack_dom_value_map_value(&input,
+                     &argv[i].a.value)))
             value = &nil_value;
-         arg      = argv[i + 1];
-         if (arg.type == AT_VALUE)
-            res   = func_equals(*value, 1, &arg);
-         else
-         {
-            res   = query_func_is_true(arg.a.invocation.func(
-                     *value,
-                     arg.a.invocation.argc,
-                     arg.a.invocation.argv
-                     ), 0, NULL);
-            value = NULL;
-         }
-         if (!res.val.bool_)
+         if (!(res.val.bool_ = query_field_matches(&argv[i + 1], *value)))
             break;
       }
    }
@@ -898,6 +919,83 @@ clean:
    return buff;
 }
 
+/* Binary a field has to be equal to, or NULL */
+static const struct rmsgpack_dom_value *query_key(const struct argument *arg)
+{
+   if (     arg->type            != AT_VALUE
+         || arg->a.value.type    != RDT_BINARY
+         || arg->a.value.val.binary.len == 0)
+      return NULL;
+   return &arg->a.value;
+}
+
+/* Resolves the fields of a query made of a single table,
+ * so libretrodb_query_filter_buffer() can test items
+ * straight from the database, and notes the fields
+ * that an index can look up */
+static void query_compile_fields(struct query *q)
+{
+   unsigned i, j;
+   unsigned num_keys = 0;
+
+   if (     q->root.func != query_func_all_map
+         || q->root.argc % 2 != 0
+         || q->root.argc / 2 > 32)
+      return;
+
+   for (i = 0; i < q->root.argc; i += 2)
+   {
+      const struct argument *pred = &q->root.argv[i + 1];
+
+      if (q->root.argv[i].type != AT_VALUE)
+         return;
+
+      if (query_key(pred))
+         num_keys++;
+      else if (pred->type == AT_FUNCTION
+            && pred->a.invocation.func == query_func_operator_or)
+         num_keys += pred->a.invocation.argc;
+   }
+
+   if (!(q->fields = (struct query_field*)calloc(
+               q->root.argc / 2 + 1, sizeof(*q->fields))))
+      return;
+   if (num_keys && !(q->keys = (const struct rmsgpack_dom_value**)
+            malloc(num_keys * sizeof(*q->keys))))
+   {
+      free(q->fields);
+      q->fields = NULL;
+      return;
+   }
+
+   num_keys = 0;
+   for (i = 0; i < q->root.argc; i += 2)
+   {
+      struct query_field *field   = &q->fields[q->num_fields++];
+      const struct argument *pred = &q->root.argv[i + 1];
+
+      field->name      = &q->root.argv[i].a.value;
+      field->pred      = pred;
+      field->first_key = num_keys;
+
+      if (query_key(pred))
+         q->keys[num_keys++] = query_key(pred);
+      else if (pred->type == AT_FUNCTION
+            && pred->a.invocation.func == query_func_operator_or)
+      {
+         /* Only if every alternative is a binary */
+         for (j = 0; j < pred->a.invocation.argc; j++)
+            if (!query_key(&pred->a.invocation.argv[j]))
+               break;
+         if (j == pred->a.invocation.argc)
+            for (j = 0; j < pred->a.invocation.argc; j++)
+               q->keys[num_keys++] = query_key(&pred->a.invocation.argv[j]);
+      }
+
+      field->num_keys  = num_keys - field->first_key;
+   }
+}
+
 void libretrodb_query_free(void *q)
 {
    unsigned i;
@@ -910,6 +1008,8 @@ void libretrodb_query_free(void *q)
    for (i = 0; i < real_q->root.argc; i++)
       query_argument_free(&real_q->root.argv[i]);
 
+   free(real_q->fields);
+   free(real_q->keys);
    free(real_q->root.argv);
    real_q->root.argv = NULL;
    real_q->root.argc = 0;
@@ -932,6 +1032,9 @@ void *libretrodb_query_compile(libretrodb_t *db,
    q->root.argc          = 0;
    q->root.func          = NULL;
    q->root.argv          = NULL;
+   q->fields             = NULL;
+   q->keys               = NULL;
+   q->num_fields         = 0;
 
    buff.data             = query;
    buff.len              = buff_len;
@@ -969,6 +1072,8 @@ void *libretrodb_query_compile(libretrodb_t *db,
       goto error;
    }
 
+   query_compile_fields(q);
+
    return q;
 
 error:
@@ -991,3 +1096,126 @@ int libretrodb_query_filter(libretrodb_query_t *q,
    struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+int libretrodb_query_filter_buffer(libretrodb_query_t *q,
+      const uint8_t *data, size_t len, size_t *size)
+{
+   unsigned i, j;
+   int rv;
+   struct rmsgpack_dom_value map;
+   char str[1024];
+   struct query *rq = (struct query*)q;
+   uint32_t found   = 0;
+   int matches      = 1;
+   size_t pos       = 0;
+
+   if (!rq->fields)
+      return -1;
+
+   if ((rv = rmsgpack_read_buffer(data, len, &map)) <= 0)
+      return rv == 0 ? -2 : -1;
+   if (map.type != RDT_MAP)
+      return -1;
+   pos += rv;
+
+   for (i = 0; i < map.val.map.len; i++)
+   {
+      struct rmsgpack_dom_value key, value;
+      int64_t skipped;
+      uint32_t wanted = 0;
+
+      /* Once the item fails, the rest of it only needs skipping */
+      if (     matches
+            && (rv = rmsgpack_read_buffer(data + pos, len - pos, &key)) > 0
+            && (key.type == RDT_STRING || key.type == RDT_BINARY))
+      {
+         pos += rv;
+
+         /* Only the first of duplicate keys counts */
+         for (j = 0; j < rq->num_fields; j++)
+         {
+            const struct rmsgpack_dom_value *name = rq->fields[j].name;
+            if (     !(found & (1u << j))
+                  && name->type           == key.type
+                  && name->val.string.len == key.val.string.len
+                  && !memcmp(name->val.string.buff, key.val.string.buff,
+                     key.val.string.len))
+               wanted |= 1u << j;
+         }
+      }
+      else if ((skipped = rmsgpack_skip_buffer(data + pos, len - pos)) <= 0)
+         return skipped == 0 ? -2 : -1;
+      else
+         pos += (size_t)skipped;
+
+      if (!wanted)
+      {
+         if ((skipped = rmsgpack_skip_buffer(data + pos, len - pos)) <= 0)
+            return skipped == 0 ? -2 : -1;
+         pos += (size_t)skipped;
+         continue;
+      }
+
+      if ((rv = rmsgpack_read_buffer(data + pos, len - pos, &value)) <= 0)
+         return rv == 0 ? -2 : -1;
+      pos   += rv;
+
+      if (value.type == RDT_MAP || value.type == RDT_ARRAY)
+         return -1;
+
+      /* The query functions want strings NUL terminated */
+      if (value.type == RDT_STRING)
+      {
+         if (value.val.string.len >= sizeof(str))
+            return -1;
+         memcpy(str, value.val.string.buff, value.val.string.len);
+         str[value.val.string.len] = '\0';
+         value.val.string.buff     = str;
+      }
+
+      found |= wanted;
+      for (j = 0; j < rq->num_fields && matches; j++)
+         if (wanted & (1u << j))
+            matches = query_field_matches(rq->fields[j].pred, value);
+   }
+
+   /* All missing fields are nil */
+   if (matches)
+   {
+      struct rmsgpack_dom_value nil_value;
+      nil_value.type = RDT_NULL;
+
+      for (j = 0; j < rq->num_fields && matches; j++)
+         if (!(found & (1u << j)))
+            matches = query_field_matches(rq->fields[j].pred, nil_value);
+   }
+
+   *size = pos;
+   return matches;
+}
+
+const char *libretrodb_query_get_field(libretrodb_query_t *q,
+      unsigned n, unsigned *num_keys)
+{
+   struct query *rq = (struct query*)q;
+
+   if (n >= rq->num_fields)
+      return NULL;
+
+   /* Fields named by binaries have no index */
+   if (rq->fields[n].name->type != RDT_STRING)
+   {
+      *num_keys = 0;
+      return "";
+   }
+
+   *num_keys = rq->fields[n].num_keys;
+   return rq->fields[n].name->val.string.buff;
+}
+
+const struct rmsgpack_dom_value *libretrodb_query_get_key(
+      libretrodb_query_t *q, unsigned n, unsigned k)
+{
+   struct query *rq = (struct query*)q;
+   return rq->keys[rq->fields[n].first_key + k];
+}
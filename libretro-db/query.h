@@ -38,6 +38,47 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+/**
+ * libretrodb_query_filter_buffer:
+ * @q                   : Query.
+ * @data                : Item, as stored in the database.
+ * @len                 : Bytes available at @data.
+ * @size                : Size of the item, if it could be tested.
+ *
+ * Tests an item without decoding it. Only the fields the
+ * query looks at are read, the others are skipped over.
+ *
+ * Returns: 1 if the item matches, 0 if not, -2 if @data
+ * ends before the item does, or -1 if the item has to be
+ * decoded and tested with libretrodb_query_filter() instead.
+ **/
+int libretrodb_query_filter_buffer(libretrodb_query_t *q,
+      const uint8_t *data, size_t len, size_t *size);
+
+/**
+ * libretrodb_query_get_field:
+ * @q                   : Query.
+ * @n                   : Field of the query.
+ * @num_keys            : Number of binaries the field has to be
+ *                        equal to for an item to match, or 0.
+ *
+ * Returns: name of the @n-th field @q tests, or NULL
+ * past the last one.
+ **/
+const char *libretrodb_query_get_field(libretrodb_query_t *q,
+      unsigned n, unsigned *num_keys);
+
+/**
+ * libretrodb_query_get_key:
+ * @q                   : Query.
+ * @n                   : Field of the query.
+ * @k                   : Less than the field's number of keys.
+ *
+ * Returns: the @k-th binary the @n-th field has to be equal to.
+ **/
+const struct rmsgpack_dom_value *libretrodb_query_get_key(
+      libretrodb_query_t *q, unsigned n, unsigned k);
+
 RETRO_END_DECLS
 
 #endif
@@ -32,6 +32,7 @@
 #include <retro_endianness.h>
 
 #include "rmsgpack.h"
+#include "rmsgpack_dom.h"
 
 #define _MPF_FIXMAP     0x80
 #define _MPF_MAP16      0xde
@@ -593,3 +594,181 @@ end:
       free(buff);
    return 0;
 }
+
+static uint64_t rmsgpack_buffer_uint(const uint8_t *data, size_t size)
+{
+   size_t i;
+   uint64_t value = 0;
+
+   for (i = 0; i < size; i++)
+      value = (value << 8) | data[i];
+
+   return value;
+}
+
+int rmsgpack_read_buffer(const uint8_t *data, size_t len,
+      struct rmsgpack_dom_value *out)
+{
+   size_t size;
+   uint64_t tmp_len;
+   uint8_t type;
+
+   if (len < 1)
+      return 0;
+
+   type = data[0];
+
+   if (type < MPF_FIXMAP)
+   {
+      out->type            = RDT_INT;
+      out->val.int_        = type;
+      return 1;
+   }
+   else if (type < MPF_FIXARRAY)
+   {
+      out->type            = RDT_MAP;
+      out->val.map.len     = type - MPF_FIXMAP;
+      out->val.map.items   = NULL;
+      return 1;
+   }
+   else if (type < MPF_FIXSTR)
+   {
+      out->type            = RDT_ARRAY;
+      out->val.array.len   = type - MPF_FIXARRAY;
+      out->val.array.items = NULL;
+      return 1;
+   }
+   else if (type < MPF_NIL)
+   {
+      size                 = type - MPF_FIXSTR;
+      if (len < 1 + size)
+         return 0;
+      out->type            = RDT_STRING;
+      out->val.string.len  = (uint32_t)size;
+      out->val.string.buff = (char*)data + 1;
+      return (int)(1 + size);
+   }
+   else if (type > MPF_MAP32)
+   {
+      out->type            = RDT_INT;
+      out->val.int_        = (int8_t)type;
+      return 1;
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         out->type         = RDT_NULL;
+         return 1;
+      case _MPF_FALSE:
+      case _MPF_TRUE:
+         out->type         = RDT_BOOL;
+         out->val.bool_    = (type == _MPF_TRUE);
+         return 1;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         size = (size_t)1 << ((type >= _MPF_STR8)
+               ? type - _MPF_STR8 : type - _MPF_BIN8);
+         if (len < 1 + size)
+            return 0;
+         tmp_len = rmsgpack_buffer_uint(data + 1, size);
+         if (tmp_len > len - 1 - size)
+            return 0;
+         if (tmp_len > INT32_MAX - 1 - size)
+            return -1;
+         out->type            = (type >= _MPF_STR8) ? RDT_STRING : RDT_BINARY;
+         out->val.string.len  = (uint32_t)tmp_len;
+         out->val.string.buff = (char*)data + 1 + size;
+         return (int)(1 + size + tmp_len);
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         size = (size_t)1 << (type - _MPF_UINT8);
+         if (len < 1 + size)
+            return 0;
+         out->type         = RDT_UINT;
+         out->val.uint_    = rmsgpack_buffer_uint(data + 1, size);
+         return (int)(1 + size);
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         size = (size_t)1 << (type - _MPF_INT8);
+         if (len < 1 + size)
+            return 0;
+         tmp_len           = rmsgpack_buffer_uint(data + 1, size);
+         out->type         = RDT_INT;
+         switch (size)
+         {
+            case 1:
+               out->val.int_ = (int8_t)tmp_len;
+               break;
+            case 2:
+               out->val.int_ = (int16_t)tmp_len;
+               break;
+            case 4:
+               out->val.int_ = (int32_t)tmp_len;
+               break;
+            default:
+               out->val.int_ = (int64_t)tmp_len;
+               break;
+         }
+         return (int)(1 + size);
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         size = (size_t)2 << ((type >= _MPF_MAP16)
+               ? type - _MPF_MAP16 : type - _MPF_ARRAY16);
+         if (len < 1 + size)
+            return 0;
+         tmp_len = rmsgpack_buffer_uint(data + 1, size);
+         if (type >= _MPF_MAP16)
+         {
+            out->type            = RDT_MAP;
+            out->val.map.len     = (uint32_t)tmp_len;
+            out->val.map.items   = NULL;
+         }
+         else
+         {
+            out->type            = RDT_ARRAY;
+            out->val.array.len   = (uint32_t)tmp_len;
+            out->val.array.items = NULL;
+         }
+         return (int)(1 + size);
+   }
+
+   return -1;
+}
+
+int64_t rmsgpack_skip_buffer(const uint8_t *data, size_t len)
+{
+   size_t pos         = 0;
+   /* Values still to skip, counting the items of
+    * the maps and arrays found on the way */
+   uint64_t remaining = 1;
+
+   while (remaining > 0)
+   {
+      struct rmsgpack_dom_value value;
+      int rv = rmsgpack_read_buffer(data + pos, len - pos, &value);
+
+      if (rv <= 0)
+         return rv;
+
+      pos += rv;
+      remaining--;
+
+      if (value.type == RDT_MAP)
+         remaining += 2 * (uint64_t)value.val.map.len;
+      else if (value.type == RDT_ARRAY)
+         remaining += value.val.array.len;
+   }
+
+   return (int64_t)pos;
+}
@@ -24,9 +24,12 @@
 #define __LIBRETRODB_MSGPACK_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <streams/file_stream.h>
 
+struct rmsgpack_dom_value;
+
 struct rmsgpack_read_callbacks
 {
    int (*read_nil        )(void *);
@@ -57,4 +60,34 @@ int rmsgpack_write_uint(RFILE *fd, uint64_t value );
 
 int rmsgpack_read(RFILE *fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+/**
+ * rmsgpack_read_buffer:
+ * @data                : Encoded value.
+ * @len                 : Bytes available at @data.
+ * @out                 : Value read.
+ *
+ * Reads the value at @data without allocating anything.
+ * Strings and binaries point into @data and are not NUL
+ * terminated; maps and arrays only get their length, and
+ * their items follow in @data.
+ *
+ * Returns: number of bytes read, 0 if @data ends before
+ * the value does, or -1 if it is not a value rmsgpack_read()
+ * knows about.
+ **/
+int rmsgpack_read_buffer(const uint8_t *data, size_t len,
+      struct rmsgpack_dom_value *out);
+
+/**
+ * rmsgpack_skip_buffer:
+ * @data                : Encoded value.
+ * @len                 : Bytes available at @data.
+ *
+ * Returns: size of the whole value at @data, including
+ * the items of maps and arrays, 0 if @data ends before
+ * the value does, or -1 if it is not a value
+ * rmsgpack_read() knows about.
+ **/
+int64_t rmsgpack_skip_buffer(const uint8_t *data, size_t len);
+
 #endif
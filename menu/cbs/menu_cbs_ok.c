@@ -8441,6 +8441,7 @@ static int action_ok_delete_playlist(const char *path,
    path = playlist_get_conf_path(playlist);
 
    filestream_delete(path);
+   playlist_delete_cache(path);
 
    if (menu_st->driver_ctx->environ_cb)
       menu_st->driver_ctx->environ_cb(MENU_ENVIRON_RESET_HORIZONTAL_LIST,
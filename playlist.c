@@ -30,6 +30,19 @@
 #include <lists/string_list.h>
 #include <formats/rjson.h>
 #include <array/rbuf.h>
+#include <streams/file_stream.h>
+#include <encodings/crc32.h>
+#include <queues/task_queue.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "playlist.h"
 #include "verbosity.h"
@@ -66,9 +79,23 @@ enum content_playlist_flags
    CNT_PLAYLIST_FLG_MOD        = (1 << 0),
    CNT_PLAYLIST_FLG_OLD_FMT    = (1 << 1),
    CNT_PLAYLIST_FLG_COMPRESSED = (1 << 2),
-   CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3)
+   CNT_PLAYLIST_FLG_CACHED_EXT = (1 << 3),
+   CNT_PLAYLIST_FLG_INDEXED    = (1 << 4),
+   CNT_PLAYLIST_FLG_MAPPED     = (1 << 5),
+   CNT_PLAYLIST_FLG_JOURNAL    = (1 << 6)
 };
 
+/* Slot of the entry path index. 'key' is the
+ * path hash of an entry (0 marks a free slot),
+ * 'pos' its position in the entries array,
+ * offset by the index shift - see
+ * playlist_index_push_front() */
+typedef struct
+{
+   uint32_t key;
+   uint32_t pos;
+} playlist_index_slot_t;
+
 struct content_playlist
 {
    char *default_core_path;
@@ -77,6 +104,23 @@ struct content_playlist
 
    struct playlist_entry *entries;
 
+   /* Open-addressed hash index of entry paths,
+    * valid while CNT_PLAYLIST_FLG_INDEXED is set */
+   playlist_index_slot_t *index;
+   size_t *index_matches;
+   size_t index_size;
+   size_t index_used;
+   size_t index_matches_cap;
+
+   /* Contents of the binary cache the playlist was
+    * loaded from, if any - entry strings may point
+    * into its string table. Memory mapped if
+    * CNT_PLAYLIST_FLG_MAPPED is set. */
+   uint8_t *cache_data;
+   const char *cache_strings;
+   size_t cache_size;
+   size_t cache_strings_size;
+
    playlist_manual_scan_record_t scan_record; /* ptr alignment */
    playlist_config_t config;                  /* size_t alignment */
 
@@ -86,6 +130,12 @@ struct content_playlist
    enum playlist_thumbnail_match_mode thumbnail_match_mode;
    enum playlist_sort_mode sort_mode;
 
+   uint32_t index_shift;
+
+   /* Records in the journal, which changes may be
+    * appended to while CNT_PLAYLIST_FLG_JOURNAL is set */
+   uint32_t journal_records;
+
    uint8_t flags;
 };
 
@@ -537,6 +587,310 @@ static bool playlist_core_path_equal(const char *real_core_path,
    return false;
 }
 
+/* Key under which an entry path hash is stored in the
+ * path index. Entries without a path are filed under
+ * the hash of an empty string (which
+ * playlist_path_hash() can never return 0 for) */
+#define PLAYLIST_INDEX_KEY(hash) ((hash) ? (hash) : (uint32_t)0x811c9dc5)
+
+/* Minimum number of path index slots */
+#define PLAYLIST_INDEX_MIN_SIZE 64
+
+static void playlist_index_invalidate(playlist_t *playlist)
+{
+   playlist->flags &= ~CNT_PLAYLIST_FLG_INDEXED;
+}
+
+static void playlist_index_insert_key(playlist_t *playlist,
+      uint32_t key, size_t idx)
+{
+   size_t mask = playlist->index_size - 1;
+   size_t i    = key & mask;
+
+   while (playlist->index[i].key)
+      i        = (i + 1) & mask;
+
+   playlist->index[i].key = key;
+   playlist->index[i].pos = (uint32_t)idx - playlist->index_shift;
+   playlist->index_used++;
+}
+
+/* Files the entry at 'idx' under its path hash and,
+ * if it refers to a file inside an archive, under the
+ * hash of its parent archive as well, so that fuzzy
+ * archive matches can be found without a scan */
+static bool playlist_index_insert(playlist_t *playlist, size_t idx)
+{
+   struct playlist_entry *entry = &playlist->entries[idx];
+
+   if (!entry->path_id)
+   {
+      if (!(entry->path_id = playlist_path_id_init(entry->path)))
+         return false;
+   }
+
+   playlist_index_insert_key(playlist,
+         PLAYLIST_INDEX_KEY(entry->path_id->real_path_hash), idx);
+
+   if (     entry->path_id->is_in_archive
+         && (entry->path_id->archive_path_hash
+            != entry->path_id->real_path_hash))
+      playlist_index_insert_key(playlist,
+            PLAYLIST_INDEX_KEY(entry->path_id->archive_path_hash), idx);
+
+   return true;
+}
+
+/**
+ * playlist_index_build:
+ * @playlist            : Playlist handle.
+ *
+ * (Re)builds the path index from scratch, at no more
+ * than half full, so that the entries pushed afterwards
+ * fit in without another rebuild for a while.
+ *
+ * Returns true if successful, false on allocation failure.
+ **/
+static bool playlist_index_build(playlist_t *playlist)
+{
+   size_t i;
+   size_t len  = RBUF_LEN(playlist->entries);
+   size_t keys = 0;
+   size_t size = PLAYLIST_INDEX_MIN_SIZE;
+
+   /* Every entry needs its path ID for its hashes */
+   for (i = 0; i < len; i++)
+   {
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      if (!entry->path_id)
+      {
+         if (!(entry->path_id = playlist_path_id_init(entry->path)))
+            return false;
+      }
+
+      keys += entry->path_id->is_in_archive ? 2 : 1;
+   }
+
+   while (size < keys * 2)
+      size <<= 1;
+
+   if (size != playlist->index_size)
+   {
+      playlist_index_slot_t *index = (playlist_index_slot_t*)
+         realloc(playlist->index, size * sizeof(*index));
+
+      if (!index)
+         return false;
+
+      playlist->index      = index;
+      playlist->index_size = size;
+   }
+
+   memset(playlist->index, 0, size * sizeof(*playlist->index));
+   playlist->index_used  = 0;
+   playlist->index_shift = 0;
+
+   for (i = 0; i < len; i++)
+      playlist_index_insert(playlist, i);
+
+   playlist->flags      |= CNT_PLAYLIST_FLG_INDEXED;
+   return true;
+}
+
+/**
+ * playlist_index_push_front:
+ * @playlist            : Playlist handle.
+ *
+ * To be called once all entries have moved down by
+ * one to make room for a new first entry, which must
+ * be in place. Rather than renumbering every slot,
+ * the positions stored in the index are relative
+ * to an index shift which is incremented here.
+ * Should the last entry have been dropped to make
+ * room, its slot is left to point past the end of
+ * the entries and is ignored from then on.
+ **/
+static void playlist_index_push_front(playlist_t *playlist)
+{
+   if (!(playlist->flags & CNT_PLAYLIST_FLG_INDEXED))
+      return;
+
+   playlist->index_shift++;
+
+   /* Keep the index at most three quarters full - the
+    * next lookup rebuilds it at a larger size otherwise */
+   if (     ((playlist->index_used + 2) * 4 > playlist->index_size * 3)
+         || !playlist_index_insert(playlist, 0))
+      playlist_index_invalidate(playlist);
+}
+
+/**
+ * playlist_index_move:
+ * @playlist            : Playlist handle.
+ * @idx                 : Index the entry was moved from.
+ * @to_front            : Whether it moved to the top of the playlist,
+ *                        rather than being deleted.
+ *
+ * To be called once the entry at 'idx' has been
+ * deleted, or bumped to the top of the playlist and
+ * the ones above it moved down by one. Renumbers the
+ * slots of the entries that moved. The slots of a
+ * deleted entry are left to point past the end of
+ * the entries, like those of a dropped last entry.
+ **/
+static void playlist_index_move(playlist_t *playlist,
+      size_t idx, bool to_front)
+{
+   size_t i;
+   uint32_t shift               = playlist->index_shift;
+   uint32_t moved               = (uint32_t)(to_front
+         ? 0 : RBUF_LEN(playlist->entries)) - shift;
+   playlist_index_slot_t *slots = playlist->index;
+
+   if (!(playlist->flags & CNT_PLAYLIST_FLG_INDEXED))
+      return;
+
+   /* Free slots are renumbered as well, which
+    * is harmless and keeps the loops branchless */
+   if (to_front)
+   {
+      for (i = 0; i < playlist->index_size; i++)
+      {
+         uint32_t pos  = slots[i].pos + shift;
+         slots[i].pos  = (pos == idx)
+            ? moved : slots[i].pos + (pos < idx);
+      }
+   }
+   else
+   {
+      for (i = 0; i < playlist->index_size; i++)
+      {
+         uint32_t pos  = slots[i].pos + shift;
+         slots[i].pos  = (pos == idx)
+            ? moved : slots[i].pos - (pos > idx);
+      }
+   }
+}
+
+static bool playlist_index_match(playlist_t *playlist,
+      playlist_path_id_t *path_id, size_t idx)
+{
+   if (string_is_empty(path_id->real_path))
+      return string_is_empty(playlist->entries[idx].path);
+   return playlist_path_matches_entry(path_id,
+         &playlist->entries[idx], &playlist->config);
+}
+
+static bool playlist_index_add_match(playlist_t *playlist,
+      size_t count, size_t idx)
+{
+   size_t i;
+
+   /* An entry may be filed under both keys
+    * probed for a path */
+   for (i = 0; i < count; i++)
+      if (playlist->index_matches[i] == idx)
+         return false;
+
+   if (count == playlist->index_matches_cap)
+   {
+      size_t cap      = count ? count * 2 : 16;
+      size_t *matches = (size_t*)realloc(playlist->index_matches,
+            cap * sizeof(*matches));
+
+      if (!matches)
+         return false;
+
+      playlist->index_matches     = matches;
+      playlist->index_matches_cap = cap;
+   }
+
+   playlist->index_matches[count] = idx;
+   return true;
+}
+
+static size_t playlist_index_probe(playlist_t *playlist,
+      playlist_path_id_t *path_id, uint32_t key, size_t count)
+{
+   size_t len  = RBUF_LEN(playlist->entries);
+   size_t mask = playlist->index_size - 1;
+   size_t i    = key & mask;
+
+   for (; playlist->index[i].key; i = (i + 1) & mask)
+   {
+      size_t idx;
+
+      if (playlist->index[i].key != key)
+         continue;
+
+      idx = (uint32_t)(playlist->index[i].pos + playlist->index_shift);
+
+      if (     (idx < len)
+            && playlist_index_match(playlist, path_id, idx)
+            && playlist_index_add_match(playlist, count, idx))
+         count++;
+   }
+
+   return count;
+}
+
+static int playlist_index_cmp(const void *a, const void *b)
+{
+   size_t idx_a = *(const size_t*)a;
+   size_t idx_b = *(const size_t*)b;
+   return (idx_a > idx_b) - (idx_a < idx_b);
+}
+
+/**
+ * playlist_index_find:
+ * @playlist            : Playlist handle.
+ * @path_id             : Path identity to search for.
+ *
+ * Finds all entries whose content path matches 'path_id'
+ * (as per playlist_path_matches_entry(), or entries without
+ * a path if 'path_id' has none). The path index is (re)built
+ * first if required; should that fail, entries are scanned.
+ *
+ * Returns: number of matching entries, whose indices are
+ * stored in ascending order in playlist->index_matches
+ * until the next call.
+ **/
+static size_t playlist_index_find(playlist_t *playlist,
+      playlist_path_id_t *path_id)
+{
+   size_t count = 0;
+
+   if (     !(playlist->flags & CNT_PLAYLIST_FLG_INDEXED)
+         && !playlist_index_build(playlist))
+   {
+      size_t i, len;
+
+      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+         if (     playlist_index_match(playlist, path_id, i)
+               && playlist_index_add_match(playlist, count, i))
+            count++;
+
+      return count;
+   }
+
+   count = playlist_index_probe(playlist, path_id,
+         PLAYLIST_INDEX_KEY(path_id->real_path_hash), count);
+
+   /* A file inside an archive also matches entries
+    * referring to the archive itself */
+   if (     path_id->is_in_archive
+         && (path_id->archive_path_hash != path_id->real_path_hash))
+      count = playlist_index_probe(playlist, path_id,
+            PLAYLIST_INDEX_KEY(path_id->archive_path_hash), count);
+
+   if (count > 1)
+      qsort(playlist->index_matches, count,
+            sizeof(*playlist->index_matches), playlist_index_cmp);
+
+   return count;
+}
+
 uint32_t playlist_get_size(playlist_t *playlist)
 {
    if (!playlist)
@@ -571,37 +925,50 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+/* Frees an entry string, unless it lives in the
+ * string table of the binary cache */
+static void playlist_free_string(playlist_t *playlist, char *str)
+{
+   if (     str
+         && !(   (str >= playlist->cache_strings)
+              && (str <  playlist->cache_strings
+                  + playlist->cache_strings_size)))
+      free(str);
+}
+
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist handle.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
    if (entry->path)
-      free(entry->path);
+      playlist_free_string(playlist, entry->path);
    if (entry->label)
-      free(entry->label);
+      playlist_free_string(playlist, entry->label);
    if (entry->core_path)
-      free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
    if (entry->core_name)
-      free(entry->core_name);
+      playlist_free_string(playlist, entry->core_name);
    if (entry->db_name)
-      free(entry->db_name);
+      playlist_free_string(playlist, entry->db_name);
    if (entry->crc32)
-      free(entry->crc32);
+      playlist_free_string(playlist, entry->crc32);
    if (entry->subsystem_ident)
-      free(entry->subsystem_ident);
+      playlist_free_string(playlist, entry->subsystem_ident);
    if (entry->subsystem_name)
-      free(entry->subsystem_name);
+      playlist_free_string(playlist, entry->subsystem_name);
    if (entry->runtime_str)
-      free(entry->runtime_str);
+      playlist_free_string(playlist, entry->runtime_str);
    if (entry->last_played_str)
-      free(entry->last_played_str);
+      playlist_free_string(playlist, entry->last_played_str);
    if (entry->subsystem_roms)
       string_list_free(entry->subsystem_roms);
    if (entry->path_id)
@@ -655,7 +1022,7 @@ void playlist_delete_index(playlist_t *playlist,
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
-      playlist_free_entry(entry_to_delete);
+      playlist_free_entry(playlist, entry_to_delete);
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -663,6 +1030,7 @@ void playlist_delete_index(playlist_t *playlist,
 
    RBUF_RESIZE(playlist->entries, len - 1);
 
+   playlist_index_move(playlist, idx, false);
    playlist->flags |= CNT_PLAYLIST_FLG_MOD;
 }
 
@@ -678,7 +1046,7 @@ void playlist_delete_by_path(playlist_t *playlist,
       const char *search_path)
 {
    playlist_path_id_t *path_id = NULL;
-   size_t i                    = 0;
+   size_t i;
 
    if (!playlist || string_is_empty(search_path))
       return;
@@ -686,21 +1054,11 @@ void playlist_delete_by_path(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(search_path)))
       return;
 
-   while (i < RBUF_LEN(playlist->entries))
-   {
-      if (!playlist_path_matches_entry(path_id,
-            &playlist->entries[i], &playlist->config))
-      {
-         i++;
-         continue;
-      }
-
-      /* Paths are equal - delete entry */
-      playlist_delete_index(playlist, i);
-
-      /* Entries are shifted up by the delete
-       * operation - *do not* increment i */
-   }
+   /* Delete matching entries last to first, so
+    * that the delete operation does not shift
+    * the ones still to be deleted */
+   for (i = playlist_index_find(playlist, path_id); i > 0; i--)
+      playlist_delete_index(playlist, playlist->index_matches[i - 1]);
 
    playlist_path_id_free(path_id);
 }
@@ -710,7 +1068,6 @@ void playlist_get_index_by_path(playlist_t *playlist,
       const struct playlist_entry **entry)
 {
    playlist_path_id_t *path_id = NULL;
-   size_t i, len;
 
    if (!playlist || !entry || string_is_empty(search_path))
       return;
@@ -718,15 +1075,8 @@ void playlist_get_index_by_path(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(search_path)))
       return;
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-   {
-      if (!playlist_path_matches_entry(path_id,
-            &playlist->entries[i], &playlist->config))
-         continue;
-
-      *entry = &playlist->entries[i];
-      break;
-   }
+   if (playlist_index_find(playlist, path_id) > 0)
+      *entry = &playlist->entries[playlist->index_matches[0]];
 
    playlist_path_id_free(path_id);
 }
@@ -735,7 +1085,7 @@ bool playlist_entry_exists(playlist_t *playlist,
       const char *path)
 {
    playlist_path_id_t *path_id = NULL;
-   size_t i, len;
+   bool exists;
 
    if (!playlist || string_is_empty(path))
       return false;
@@ -743,18 +1093,10 @@ bool playlist_entry_exists(playlist_t *playlist,
    if (!(path_id = playlist_path_id_init(path)))
       return false;
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-   {
-      if (playlist_path_matches_entry(path_id,
-            &playlist->entries[i], &playlist->config))
-      {
-         playlist_path_id_free(path_id);
-         return true;
-      }
-   }
+   exists = playlist_index_find(playlist, path_id) > 0;
 
    playlist_path_id_free(path_id);
-   return false;
+   return exists;
 }
 
 void playlist_update(playlist_t *playlist, size_t idx,
@@ -770,7 +1112,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path)
-         free(entry->path);
+         playlist_free_string(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
 
       if (entry->path_id)
@@ -779,13 +1121,15 @@ void playlist_update(playlist_t *playlist, size_t idx,
          entry->path_id  = NULL;
       }
 
+      playlist_index_invalidate(playlist);
+
       playlist->flags |= CNT_PLAYLIST_FLG_MOD;
    }
 
    if (update_entry->label && (update_entry->label != entry->label))
    {
       if (entry->label)
-         free(entry->label);
+         playlist_free_string(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -793,7 +1137,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path)
-         free(entry->core_path);
+         playlist_free_string(playlist, entry->core_path);
       entry->core_path   = strdup(update_entry->core_path);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -801,7 +1145,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
       if (entry->core_name)
-         free(entry->core_name);
+         playlist_free_string(playlist, entry->core_name);
       entry->core_name   = strdup(update_entry->core_name);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -809,7 +1153,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
       if (entry->db_name)
-         free(entry->db_name);
+         playlist_free_string(playlist, entry->db_name);
       entry->db_name     = strdup(update_entry->db_name);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -817,7 +1161,7 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
       if (entry->crc32)
-         free(entry->crc32);
+         playlist_free_string(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
       playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -837,7 +1181,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path)
-         free(entry->path);
+         playlist_free_string(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
 
       if (entry->path_id)
@@ -846,6 +1190,8 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
          entry->path_id  = NULL;
       }
 
+      playlist_index_invalidate(playlist);
+
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
    }
@@ -853,7 +1199,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
       if (entry->core_path)
-         free(entry->core_path);
+         playlist_free_string(playlist, entry->core_path);
       entry->core_path      = strdup(update_entry->core_path);
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
@@ -932,7 +1278,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->runtime_str && (update_entry->runtime_str != entry->runtime_str))
    {
       if (entry->runtime_str)
-         free(entry->runtime_str);
+         playlist_free_string(playlist, entry->runtime_str);
       entry->runtime_str    = strdup(update_entry->runtime_str);
       if (register_update)
          playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
@@ -941,7 +1287,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->last_played_str && (update_entry->last_played_str != entry->last_played_str))
    {
       if (entry->last_played_str)
-         free(entry->last_played_str);
+         playlist_free_string(playlist, entry->last_played_str);
       entry->last_played_str = NULL;
       entry->last_played_str = strdup(update_entry->last_played_str);
       if (register_update)
@@ -953,7 +1299,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       const struct playlist_entry *entry)
 {
    playlist_path_id_t *path_id = NULL;
-   size_t i, len;
+   size_t i, j, len, matches;
    char real_core_path[PATH_MAX_LENGTH];
 
    if (!playlist || !entry)
@@ -982,18 +1328,13 @@ bool playlist_push_runtime(playlist_t *playlist,
       goto error;
    }
 
-   len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+   len     = RBUF_LEN(playlist->entries);
+   matches = playlist_index_find(playlist, path_id);
+   for (j = 0; j < matches; j++)
    {
       struct playlist_entry tmp;
-      bool equal_path  = (string_is_empty(path_id->real_path)
-            && string_is_empty(playlist->entries[i].path));
 
-      equal_path       = equal_path || playlist_path_matches_entry(
-            path_id, &playlist->entries[i], &playlist->config);
-
-      if (!equal_path)
-         continue;
+      i = playlist->index_matches[j];
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
@@ -1010,6 +1351,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
+      playlist_index_move(playlist, i, true);
 
       goto success;
    }
@@ -1020,7 +1362,7 @@ bool playlist_push_runtime(playlist_t *playlist,
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
-      playlist_free_entry(last_entry);
+      playlist_free_entry(playlist, last_entry);
       len--;
    }
    else
@@ -1043,6 +1385,7 @@ bool playlist_push_runtime(playlist_t *playlist,
          playlist->entries[0].path            = strdup(path_id->real_path);
       playlist->entries[0].path_id            = path_id;
       path_id                                 = NULL;
+      playlist_index_push_front(playlist);
 
       if (!string_is_empty(real_core_path))
          playlist->entries[0].core_path       = strdup(real_core_path);
@@ -1297,10 +1640,13 @@ bool playlist_content_path_is_valid(const char *path)
  *
  * Push entry to top of playlist.
  **/
-bool playlist_push(playlist_t *playlist,
-      const struct playlist_entry *entry)
+/* 'moved_from' receives the index the entry
+ * was bumped to the top from, or (size_t)-1
+ * if it is a new entry */
+static bool playlist_push_internal(playlist_t *playlist,
+      const struct playlist_entry *entry, size_t *moved_from)
 {
-   size_t i, len;
+   size_t i, j, len, matches;
    char real_core_path[PATH_MAX_LENGTH];
    playlist_path_id_t *path_id = NULL;
    const char *core_name       = entry->core_name;
@@ -1347,18 +1693,13 @@ bool playlist_push(playlist_t *playlist,
       }
    }
 
-   len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+   len     = RBUF_LEN(playlist->entries);
+   matches = playlist_index_find(playlist, path_id);
+   for (j = 0; j < matches; j++)
    {
       struct playlist_entry tmp;
-      bool equal_path  = (string_is_empty(path_id->real_path)
-                       && string_is_empty(playlist->entries[i].path));
-
-      equal_path       = equal_path || playlist_path_matches_entry(
-            path_id, &playlist->entries[i], &playlist->config);
 
-      if (!equal_path)
-         continue;
+      i = playlist->index_matches[j];
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
@@ -1378,188 +1719,1449 @@ bool playlist_push(playlist_t *playlist,
             && string_is_empty(playlist->entries[i].subsystem_ident))
          continue;
 
-      if (     !string_is_empty(entry->subsystem_name)
-            && !string_is_empty(playlist->entries[i].subsystem_name)
-            && !string_is_equal(playlist->entries[i].subsystem_name, entry->subsystem_name))
-         continue;
+      if (     !string_is_empty(entry->subsystem_name)
+            && !string_is_empty(playlist->entries[i].subsystem_name)
+            && !string_is_equal(playlist->entries[i].subsystem_name, entry->subsystem_name))
+         continue;
+
+      if (      string_is_empty(entry->subsystem_name)
+            && !string_is_empty(playlist->entries[i].subsystem_name))
+         continue;
+
+      if (     !string_is_empty(entry->subsystem_name)
+            &&  string_is_empty(playlist->entries[i].subsystem_name))
+         continue;
+
+      if (entry->subsystem_roms)
+      {
+         unsigned j;
+         const struct string_list *roms = playlist->entries[i].subsystem_roms;
+         bool                   unequal = false;
+
+         if (entry->subsystem_roms->size != roms->size)
+            continue;
+
+         for (j = 0; j < entry->subsystem_roms->size; j++)
+         {
+            char real_rom_path[PATH_MAX_LENGTH];
+
+            if (!string_is_empty(entry->subsystem_roms->elems[j].data))
+            {
+               strlcpy(real_rom_path, entry->subsystem_roms->elems[j].data, sizeof(real_rom_path));
+               path_resolve_realpath(real_rom_path, sizeof(real_rom_path), true);
+            }
+            else
+               real_rom_path[0] = '\0';
+
+            if (!playlist_path_equal(real_rom_path, roms->elems[j].data,
+                     &playlist->config))
+            {
+               unequal = true;
+               break;
+            }
+         }
+
+         if (unequal)
+            continue;
+      }
+
+      if (playlist->entries[i].entry_slot != entry->entry_slot)
+      {
+         playlist->entries[i].entry_slot  = entry->entry_slot;
+         entry_updated                    = true;
+      }
+
+      /* If content was previously loaded via file browser
+       * or command line, certain entry values will be missing.
+       * If we are now loading the same content from a playlist,
+       * fill in any blanks */
+      if (     !playlist->entries[i].label
+            && !string_is_empty(entry->label))
+      {
+         playlist->entries[i].label       = strdup(entry->label);
+         entry_updated                    = true;
+      }
+      if (     !playlist->entries[i].crc32
+            && !string_is_empty(entry->crc32))
+      {
+         playlist->entries[i].crc32       = strdup(entry->crc32);
+         entry_updated                    = true;
+      }
+      if (     !playlist->entries[i].db_name
+            && !string_is_empty(entry->db_name))
+      {
+         playlist->entries[i].db_name     = strdup(entry->db_name);
+         entry_updated                    = true;
+      }
+
+      /* If top entry, we don't want to push a new entry since
+       * the top and the entry to be pushed are the same. */
+      if (i == 0)
+      {
+         if (entry_updated)
+         {
+            *moved_from = 0;
+            goto success;
+         }
+
+         goto error;
+      }
+
+      /* Seen it before, bump to top. */
+      *moved_from = i;
+      tmp = playlist->entries[i];
+      memmove(playlist->entries + 1, playlist->entries,
+            i * sizeof(struct playlist_entry));
+      playlist->entries[0] = tmp;
+      playlist_index_move(playlist, i, true);
+
+      goto success;
+   }
+
+   if (playlist->config.capacity == 0)
+      goto error;
+
+   *moved_from = (size_t)-1;
+
+   if (len == playlist->config.capacity)
+   {
+      struct playlist_entry *last_entry = &playlist->entries[len - 1];
+      playlist_free_entry(playlist, last_entry);
+      len--;
+   }
+   else
+   {
+      /* Allocate memory to fit one more item and resize the buffer */
+      if (!RBUF_TRYFIT(playlist->entries, len + 1))
+         goto error; /* out of memory */
+      RBUF_RESIZE(playlist->entries, len + 1);
+   }
+
+   if (playlist->entries)
+   {
+      memmove(playlist->entries + 1, playlist->entries,
+            len * sizeof(struct playlist_entry));
+
+      playlist->entries[0].path               = NULL;
+      playlist->entries[0].label              = NULL;
+      playlist->entries[0].core_path          = NULL;
+      playlist->entries[0].core_name          = NULL;
+      playlist->entries[0].db_name            = NULL;
+      playlist->entries[0].crc32              = NULL;
+      playlist->entries[0].subsystem_ident    = NULL;
+      playlist->entries[0].subsystem_name     = NULL;
+      playlist->entries[0].runtime_str        = NULL;
+      playlist->entries[0].last_played_str    = NULL;
+      playlist->entries[0].subsystem_roms     = NULL;
+      playlist->entries[0].path_id            = NULL;
+      playlist->entries[0].runtime_status     = PLAYLIST_RUNTIME_UNKNOWN;
+      playlist->entries[0].runtime_hours      = 0;
+      playlist->entries[0].runtime_minutes    = 0;
+      playlist->entries[0].runtime_seconds    = 0;
+      playlist->entries[0].last_played_year   = 0;
+      playlist->entries[0].last_played_month  = 0;
+      playlist->entries[0].last_played_day    = 0;
+      playlist->entries[0].last_played_hour   = 0;
+      playlist->entries[0].last_played_minute = 0;
+      playlist->entries[0].last_played_second = 0;
+
+      if (!string_is_empty(path_id->real_path))
+         playlist->entries[0].path            = strdup(path_id->real_path);
+      playlist->entries[0].path_id            = path_id;
+      path_id                                 = NULL;
+      playlist_index_push_front(playlist);
+
+      playlist->entries[0].entry_slot         = entry->entry_slot;
+
+      if (!string_is_empty(entry->label))
+         playlist->entries[0].label           = strdup(entry->label);
+      if (!string_is_empty(real_core_path))
+         playlist->entries[0].core_path       = strdup(real_core_path);
+      if (!string_is_empty(core_name))
+         playlist->entries[0].core_name       = strdup(core_name);
+      if (!string_is_empty(entry->db_name))
+         playlist->entries[0].db_name         = strdup(entry->db_name);
+      if (!string_is_empty(entry->crc32))
+         playlist->entries[0].crc32           = strdup(entry->crc32);
+      if (!string_is_empty(entry->subsystem_ident))
+         playlist->entries[0].subsystem_ident = strdup(entry->subsystem_ident);
+      if (!string_is_empty(entry->subsystem_name))
+         playlist->entries[0].subsystem_name  = strdup(entry->subsystem_name);
+
+      if (entry->subsystem_roms)
+      {
+         union string_list_elem_attr attributes = {0};
+
+         playlist->entries[0].subsystem_roms    = string_list_new();
+
+         for (i = 0; i < entry->subsystem_roms->size; i++)
+            string_list_append(playlist->entries[0].subsystem_roms, entry->subsystem_roms->elems[i].data, attributes);
+      }
+   }
+
+success:
+   if (path_id)
+      playlist_path_id_free(path_id);
+   playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
+   return true;
+
+error:
+   if (path_id)
+      playlist_path_id_free(path_id);
+   return false;
+}
+
+bool playlist_push(playlist_t *playlist,
+      const struct playlist_entry *entry)
+{
+   size_t moved_from;
+   return playlist_push_internal(playlist, entry, &moved_from);
+}
+
+/* Binary playlist cache
+ * > Written next to the playlist file whenever the
+ *   playlist is saved, or parsed without a valid cache
+ * > Loaded in place of the playlist file as long as the
+ *   size and modification time of the latter match what
+ *   the cache recorded
+ * > Fixed size entry records followed by a table of
+ *   NUL terminated strings, which the entries point
+ *   straight into. With HAVE_MMAP the file is mapped,
+ *   so only the pages holding strings that are actually
+ *   read (e.g. labels of the entries the menu displays)
+ *   are ever loaded. */
+
+#define PLAYLIST_CACHE_EXTENSION ".lplc"
+#define PLAYLIST_CACHE_MAGIC     0x43504C52 /* "RLPC" */
+#define PLAYLIST_CACHE_VERSION   1
+
+enum playlist_cache_flags
+{
+   PLAYLIST_CACHE_FLG_OLD_FMT            = (1 << 0),
+   PLAYLIST_CACHE_FLG_COMPRESSED         = (1 << 1),
+   PLAYLIST_CACHE_FLG_SEARCH_RECURSIVELY = (1 << 2),
+   PLAYLIST_CACHE_FLG_SEARCH_ARCHIVES    = (1 << 3),
+   PLAYLIST_CACHE_FLG_FILTER_DAT_CONTENT = (1 << 4),
+   PLAYLIST_CACHE_FLG_OVERWRITE_PLAYLIST = (1 << 5)
+};
+
+/* String fields hold offsets into the string
+ * table, 0 standing for a NULL/empty string */
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   int64_t lpl_size;
+   int64_t lpl_mtime;
+   uint32_t num_entries;
+   uint32_t entry_size;
+   uint32_t strings_size;
+   uint32_t flags;
+   uint32_t default_core_path;
+   uint32_t default_core_name;
+   uint32_t base_content_directory;
+   uint32_t scan_content_dir;
+   uint32_t scan_file_exts;
+   uint32_t scan_dat_file_path;
+   uint32_t label_display_mode;
+   uint32_t right_thumbnail_mode;
+   uint32_t left_thumbnail_mode;
+   uint32_t thumbnail_match_mode;
+   uint32_t sort_mode;
+   uint32_t reserved;
+} playlist_cache_header_t;
+
+typedef struct
+{
+   uint32_t path;
+   uint32_t label;
+   uint32_t core_path;
+   uint32_t core_name;
+   uint32_t db_name;
+   uint32_t crc32;
+   uint32_t subsystem_ident;
+   uint32_t subsystem_name;
+   uint32_t subsystem_roms; /* First of 'num_subsystem_roms' consecutive strings */
+   uint32_t num_subsystem_roms;
+   uint32_t entry_slot;
+   uint32_t reserved;
+} playlist_cache_entry_t;
+
+typedef struct
+{
+   char *data;
+   size_t size;
+   size_t capacity;
+   bool oom;
+} playlist_cache_strings_t;
+
+static void playlist_cache_get_path(char *s,
+      const char *playlist_path, size_t len)
+{
+   fill_pathname(s, playlist_path, PLAYLIST_CACHE_EXTENSION, len);
+}
+
+static char *playlist_cache_get_string(playlist_t *playlist,
+      uint32_t offset)
+{
+   if (!offset || offset >= playlist->cache_strings_size)
+      return NULL;
+   return (char*)playlist->cache_strings + offset;
+}
+
+static char *playlist_cache_dup_string(playlist_t *playlist,
+      uint32_t offset)
+{
+   const char *str = playlist_cache_get_string(playlist, offset);
+   return str ? strdup(str) : NULL;
+}
+
+static void playlist_cache_release(playlist_t *playlist)
+{
+   if (!playlist->cache_data)
+      return;
+
+#ifdef HAVE_MMAP
+   if (playlist->flags & CNT_PLAYLIST_FLG_MAPPED)
+      munmap(playlist->cache_data, playlist->cache_size);
+   else
+#endif
+      free(playlist->cache_data);
+
+   playlist->cache_data         = NULL;
+   playlist->cache_strings      = NULL;
+   playlist->cache_size         = 0;
+   playlist->cache_strings_size = 0;
+   playlist->flags             &= ~CNT_PLAYLIST_FLG_MAPPED;
+}
+
+/**
+ * playlist_cache_read:
+ * @playlist            : Playlist handle.
+ *
+ * Loads the entries and metadata of the playlist from
+ * its binary cache. Does nothing if there is no cache,
+ * or if it does not match the playlist file.
+ *
+ * Returns true if the playlist was loaded.
+ **/
+static bool playlist_cache_read(playlist_t *playlist)
+{
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   const playlist_cache_header_t *header = NULL;
+   const playlist_cache_entry_t *records = NULL;
+   int64_t lpl_mtime                     = path_get_mtime(playlist->config.path);
+   int32_t lpl_size                      = path_get_size(playlist->config.path);
+   size_t num_entries;
+
+   if (lpl_mtime < 0 || lpl_size < 0)
+      return false;
+
+   playlist_cache_get_path(cache_path, playlist->config.path,
+         sizeof(cache_path));
+
+#ifdef HAVE_MMAP
+   {
+      int fd = open(cache_path, O_RDONLY);
+
+      if (fd >= 0)
+      {
+         off_t size = lseek(fd, 0, SEEK_END);
+
+         if (size >= (off_t)sizeof(*header))
+         {
+            void *data = mmap(NULL, (size_t)size, PROT_READ,
+                  MAP_SHARED, fd, 0);
+
+            if (data != MAP_FAILED)
+            {
+               playlist->cache_data  = (uint8_t*)data;
+               playlist->cache_size  = (size_t)size;
+               playlist->flags      |= CNT_PLAYLIST_FLG_MAPPED;
+            }
+         }
+
+         close(fd);
+      }
+   }
+#endif
+
+   if (!playlist->cache_data)
+   {
+      void *data  = NULL;
+      int64_t len = 0;
+
+      if (     !path_is_valid(cache_path)
+            || !filestream_read_file(cache_path, &data, &len))
+         return false;
+
+      playlist->cache_data = (uint8_t*)data;
+      playlist->cache_size = (size_t)len;
+   }
+
+   /* Validate */
+   header  = (const playlist_cache_header_t*)playlist->cache_data;
+   records = (const playlist_cache_entry_t*)(header + 1);
+
+   if (     (playlist->cache_size < sizeof(*header))
+         || (header->magic        != PLAYLIST_CACHE_MAGIC)
+         || (header->version      != PLAYLIST_CACHE_VERSION)
+         || (header->entry_size   != sizeof(*records))
+         || (header->lpl_size     != lpl_size)
+         || (header->lpl_mtime    != lpl_mtime)
+         || (header->strings_size == 0)
+         || (playlist->cache_size != sizeof(*header)
+               + (size_t)header->num_entries * sizeof(*records)
+               + header->strings_size))
+      goto error;
+
+   playlist->cache_strings      = (const char*)(records + header->num_entries);
+   playlist->cache_strings_size = header->strings_size;
+
+   if (playlist->cache_strings[playlist->cache_strings_size - 1] != '\0')
+      goto error;
+
+   num_entries = header->num_entries;
+   if (num_entries > playlist->config.capacity)
+      num_entries = playlist->config.capacity;
+
+   if (num_entries)
+   {
+      if (!RBUF_TRYFIT(playlist->entries, num_entries))
+         goto error;
+      RBUF_RESIZE(playlist->entries, num_entries);
+   }
+
+   /* Entries */
+   for (i = 0; i < num_entries; i++)
+   {
+      const playlist_cache_entry_t *record = &records[i];
+      struct playlist_entry *entry         = &playlist->entries[i];
+
+      memset(entry, 0, sizeof(*entry));
+
+      entry->path            = playlist_cache_get_string(playlist, record->path);
+      entry->label           = playlist_cache_get_string(playlist, record->label);
+      entry->core_path       = playlist_cache_get_string(playlist, record->core_path);
+      entry->core_name       = playlist_cache_get_string(playlist, record->core_name);
+      entry->db_name         = playlist_cache_get_string(playlist, record->db_name);
+      entry->crc32           = playlist_cache_get_string(playlist, record->crc32);
+      entry->subsystem_ident = playlist_cache_get_string(playlist, record->subsystem_ident);
+      entry->subsystem_name  = playlist_cache_get_string(playlist, record->subsystem_name);
+      entry->entry_slot      = record->entry_slot;
+
+      if (record->num_subsystem_roms)
+      {
+         uint32_t j;
+         union string_list_elem_attr attr = {0};
+         size_t offset                    = record->subsystem_roms;
+
+         if (!(entry->subsystem_roms = string_list_new()))
+            goto error;
+
+         for (j = 0; j < record->num_subsystem_roms; j++)
+         {
+            const char *rom = playlist_cache_get_string(playlist,
+                  (uint32_t)offset);
+
+            if (!rom)
+               break;
+
+            string_list_append(entry->subsystem_roms, rom, attr);
+            offset += strlen(rom) + 1;
+         }
+      }
+   }
+
+   /* Metadata */
+   playlist->default_core_path          = playlist_cache_dup_string(playlist, header->default_core_path);
+   playlist->default_core_name          = playlist_cache_dup_string(playlist, header->default_core_name);
+   playlist->base_content_directory     = playlist_cache_dup_string(playlist, header->base_content_directory);
+   playlist->scan_record.content_dir    = playlist_cache_dup_string(playlist, header->scan_content_dir);
+   playlist->scan_record.file_exts      = playlist_cache_dup_string(playlist, header->scan_file_exts);
+   playlist->scan_record.dat_file_path  = playlist_cache_dup_string(playlist, header->scan_dat_file_path);
+
+   playlist->label_display_mode         = (enum playlist_label_display_mode)header->label_display_mode;
+   playlist->right_thumbnail_mode       = (enum playlist_thumbnail_mode)header->right_thumbnail_mode;
+   playlist->left_thumbnail_mode        = (enum playlist_thumbnail_mode)header->left_thumbnail_mode;
+   playlist->thumbnail_match_mode       = (enum playlist_thumbnail_match_mode)header->thumbnail_match_mode;
+   playlist->sort_mode                  = (enum playlist_sort_mode)header->sort_mode;
+
+   playlist->scan_record.search_recursively = (header->flags & PLAYLIST_CACHE_FLG_SEARCH_RECURSIVELY) != 0;
+   playlist->scan_record.search_archives    = (header->flags & PLAYLIST_CACHE_FLG_SEARCH_ARCHIVES)    != 0;
+   playlist->scan_record.filter_dat_content = (header->flags & PLAYLIST_CACHE_FLG_FILTER_DAT_CONTENT) != 0;
+   playlist->scan_record.overwrite_playlist = (header->flags & PLAYLIST_CACHE_FLG_OVERWRITE_PLAYLIST) != 0;
+
+   if (header->flags & PLAYLIST_CACHE_FLG_OLD_FMT)
+      playlist->flags |=  CNT_PLAYLIST_FLG_OLD_FMT;
+   else
+      playlist->flags &= ~CNT_PLAYLIST_FLG_OLD_FMT;
+
+   if (header->flags & PLAYLIST_CACHE_FLG_COMPRESSED)
+      playlist->flags |=  CNT_PLAYLIST_FLG_COMPRESSED;
+   else
+      playlist->flags &= ~CNT_PLAYLIST_FLG_COMPRESSED;
+
+   return true;
+
+error:
+   playlist_clear(playlist);
+   playlist_cache_release(playlist);
+   return false;
+}
+
+/* Appends 'str' to the string table, returning its offset */
+static uint32_t playlist_cache_add_string(
+      playlist_cache_strings_t *strings, const char *str)
+{
+   size_t len;
+   uint32_t offset;
+
+   if (string_is_empty(str))
+      return 0;
+
+   len = strlen(str) + 1;
+
+   if (strings->size + len > strings->capacity)
+   {
+      size_t capacity = strings->capacity;
+      char *data      = NULL;
+
+      while (strings->size + len > capacity)
+         capacity <<= 1;
+
+      if (!(data = (char*)realloc(strings->data, capacity)))
+      {
+         strings->oom = true;
+         return 0;
+      }
+
+      strings->data     = data;
+      strings->capacity = capacity;
+   }
+
+   offset         = (uint32_t)strings->size;
+   memcpy(strings->data + strings->size, str, len);
+   strings->size += len;
+
+   return offset;
+}
+
+/* Entries of a playlist tend to share their core and
+ * database names with the previous entry - store such
+ * strings only once */
+static uint32_t playlist_cache_add_entry_string(
+      playlist_cache_strings_t *strings, const char *str,
+      const char *prev_str, uint32_t prev_offset)
+{
+   if (prev_offset && string_is_equal(str, prev_str))
+      return prev_offset;
+   return playlist_cache_add_string(strings, str);
+}
+
+/**
+ * playlist_cache_write:
+ * @playlist            : Playlist handle.
+ *
+ * (Re)generates the binary cache of the playlist,
+ * which must have just been read from or written to
+ * its playlist file. The cache is written under a
+ * temporary name first, then renamed over the old one,
+ * so that readers either see the old cache or the
+ * complete new one.
+ **/
+static void playlist_cache_write(playlist_t *playlist)
+{
+   size_t i;
+   playlist_cache_header_t header;
+   char cache_path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   char tmp_suffix[32];
+   playlist_cache_strings_t strings   = {0};
+   playlist_cache_entry_t *records    = NULL;
+   RFILE *file                        = NULL;
+   size_t len                         = RBUF_LEN(playlist->entries);
+   bool success                       = false;
+
+   memset(&header, 0, sizeof(header));
+
+   header.lpl_mtime = path_get_mtime(playlist->config.path);
+   header.lpl_size  = path_get_size(playlist->config.path);
+
+   if (header.lpl_mtime < 0 || header.lpl_size < 0)
+      return;
+
+   if (len && !(records = (playlist_cache_entry_t*)calloc(len, sizeof(*records))))
+      return;
+
+   /* Offset 0 stands for 'no string' */
+   if (!(strings.data = (char*)malloc(4096)))
+      goto end;
+   strings.data[0]  = '\0';
+   strings.size     = 1;
+   strings.capacity = 4096;
+
+   for (i = 0; i < len; i++)
+   {
+      const struct playlist_entry *entry  = &playlist->entries[i];
+      const struct playlist_entry *prev   = i ? &playlist->entries[i - 1] : NULL;
+      const playlist_cache_entry_t *prec  = i ? &records[i - 1] : NULL;
+      playlist_cache_entry_t *record      = &records[i];
+
+      record->path            = playlist_cache_add_string(&strings, entry->path);
+      record->label           = playlist_cache_add_string(&strings, entry->label);
+      record->core_path       = playlist_cache_add_entry_string(&strings,
+            entry->core_path, prev ? prev->core_path : NULL, prec ? prec->core_path : 0);
+      record->core_name       = playlist_cache_add_entry_string(&strings,
+            entry->core_name, prev ? prev->core_name : NULL, prec ? prec->core_name : 0);
+      record->db_name         = playlist_cache_add_entry_string(&strings,
+            entry->db_name, prev ? prev->db_name : NULL, prec ? prec->db_name : 0);
+      record->crc32           = playlist_cache_add_string(&strings, entry->crc32);
+      record->subsystem_ident = playlist_cache_add_string(&strings, entry->subsystem_ident);
+      record->subsystem_name  = playlist_cache_add_string(&strings, entry->subsystem_name);
+      record->entry_slot      = entry->entry_slot;
+
+      if (entry->subsystem_roms)
+      {
+         size_t j;
+
+         for (j = 0; j < entry->subsystem_roms->size; j++)
+         {
+            const char *rom = entry->subsystem_roms->elems[j].data;
+            uint32_t offset;
+
+            /* Empty ROM paths are dropped on load, too */
+            if (string_is_empty(rom))
+               continue;
+
+            offset = playlist_cache_add_string(&strings, rom);
+            if (!record->num_subsystem_roms)
+               record->subsystem_roms = offset;
+            record->num_subsystem_roms++;
+         }
+      }
+   }
+
+   header.magic                  = PLAYLIST_CACHE_MAGIC;
+   header.version                = PLAYLIST_CACHE_VERSION;
+   header.num_entries            = (uint32_t)len;
+   header.entry_size             = sizeof(*records);
+   header.default_core_path      = playlist_cache_add_string(&strings, playlist->default_core_path);
+   header.default_core_name      = playlist_cache_add_string(&strings, playlist->default_core_name);
+   header.base_content_directory = playlist_cache_add_string(&strings, playlist->base_content_directory);
+   header.scan_content_dir       = playlist_cache_add_string(&strings, playlist->scan_record.content_dir);
+   header.scan_file_exts         = playlist_cache_add_string(&strings, playlist->scan_record.file_exts);
+   header.scan_dat_file_path     = playlist_cache_add_string(&strings, playlist->scan_record.dat_file_path);
+   header.label_display_mode     = (uint32_t)playlist->label_display_mode;
+   header.right_thumbnail_mode   = (uint32_t)playlist->right_thumbnail_mode;
+   header.left_thumbnail_mode    = (uint32_t)playlist->left_thumbnail_mode;
+   header.thumbnail_match_mode   = (uint32_t)playlist->thumbnail_match_mode;
+   header.sort_mode              = (uint32_t)playlist->sort_mode;
+   header.strings_size           = (uint32_t)strings.size;
+
+   if (playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)
+      header.flags |= PLAYLIST_CACHE_FLG_OLD_FMT;
+   if (playlist->flags & CNT_PLAYLIST_FLG_COMPRESSED)
+      header.flags |= PLAYLIST_CACHE_FLG_COMPRESSED;
+   if (playlist->scan_record.search_recursively)
+      header.flags |= PLAYLIST_CACHE_FLG_SEARCH_RECURSIVELY;
+   if (playlist->scan_record.search_archives)
+      header.flags |= PLAYLIST_CACHE_FLG_SEARCH_ARCHIVES;
+   if (playlist->scan_record.filter_dat_content)
+      header.flags |= PLAYLIST_CACHE_FLG_FILTER_DAT_CONTENT;
+   if (playlist->scan_record.overwrite_playlist)
+      header.flags |= PLAYLIST_CACHE_FLG_OVERWRITE_PLAYLIST;
+
+   /* Offsets are 32 bit */
+   if (strings.oom || ((uint64_t)strings.size != header.strings_size))
+      goto end;
+
+   /* Another playlist handle may be writing the
+    * same cache - give each its own temporary file */
+   playlist_cache_get_path(cache_path, playlist->config.path,
+         sizeof(cache_path));
+   snprintf(tmp_suffix, sizeof(tmp_suffix), ".%lx.tmp",
+         (unsigned long)(uintptr_t)playlist);
+   strlcpy(tmp_path, cache_path, sizeof(tmp_path));
+   strlcat(tmp_path, tmp_suffix, sizeof(tmp_path));
+
+   if (!(file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      goto end;
+
+   success =
+         (filestream_write(file, &header, sizeof(header))
+            == (int64_t)sizeof(header))
+      && (filestream_write(file, records, len * sizeof(*records))
+            == (int64_t)(len * sizeof(*records)))
+      && (filestream_write(file, strings.data, strings.size)
+            == (int64_t)strings.size);
+
+   if (filestream_close(file) != 0)
+      success = false;
+
+   if (success)
+   {
+      /* Renaming over an existing file fails on some
+       * platforms - fall back to deleting it first */
+      if (filestream_rename(tmp_path, cache_path) != 0)
+      {
+         filestream_delete(cache_path);
+         success = (filestream_rename(tmp_path, cache_path) == 0);
+      }
+   }
+
+   if (!success)
+   {
+      RARCH_WARN("[Playlist]: Failed to write playlist cache: \"%s\".\n",
+            cache_path);
+      filestream_delete(tmp_path);
+   }
+
+end:
+   free(strings.data);
+   free(records);
+}
+
+/* Playlist journal
+ * > History and favorites change one entry at a
+ *   time, on every content launch. Instead of having
+ *   the whole playlist file rewritten each time, the
+ *   command_playlist_*() helpers append a record of
+ *   the change to a journal next to it, which
+ *   playlist_init() replays
+ * > Records hold the entry as it ended up rather than
+ *   the one that was pushed, so replaying them involves
+ *   no path resolution or core info lookups
+ * > Appending records, and compacting the journal into
+ *   the playlist file once it grows long, is done on the
+ *   task thread, one job after the other. Loading,
+ *   writing or freeing a playlist first runs any jobs
+ *   still pending
+ * > Until playlist_journal_init() has been called, jobs
+ *   run right away on the calling thread */
+
+#define PLAYLIST_JOURNAL_EXTENSION   ".lplj"
+#define PLAYLIST_JOURNAL_MAGIC       0x4A504C52 /* "RLPJ" */
+#define PLAYLIST_JOURNAL_VERSION     1
+#define PLAYLIST_JOURNAL_MAX_RECORDS 64
+#define PLAYLIST_JOURNAL_NUM_STRINGS 8
+
+enum playlist_journal_op
+{
+   /* New entry at the top, pushing out the
+    * last one if the playlist is at capacity */
+   PLAYLIST_JOURNAL_OP_INSERT = 0,
+   /* Entry 'idx' bumped to the top and replaced */
+   PLAYLIST_JOURNAL_OP_MOVE,
+   /* Entry 'idx' replaced */
+   PLAYLIST_JOURNAL_OP_SET,
+   /* playlist_qsort() */
+   PLAYLIST_JOURNAL_OP_SORT
+};
+
+/* Identifies the playlist file the
+ * journal records apply to */
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   int64_t lpl_size;
+   int64_t lpl_mtime;
+} playlist_journal_header_t;
+
+/* Followed, except for PLAYLIST_JOURNAL_OP_SORT,
+ * by the NUL terminated path, label, core_path,
+ * core_name, db_name, crc32, subsystem_ident and
+ * subsystem_name of the entry, then its subsystem
+ * ROMs. 'size' is that of the whole record, 'crc'
+ * covers everything past it - a record torn by a
+ * crash ends the journal. */
+typedef struct
+{
+   uint32_t size;
+   uint32_t crc;
+   uint32_t op;
+   uint32_t idx;
+   uint32_t entry_slot;
+   uint32_t num_subsystem_roms;
+} playlist_journal_record_t;
+
+/* Record to append to the journal of the playlist
+ * at config.path - or if NULL, request to compact
+ * that journal */
+typedef struct playlist_journal_job
+{
+   struct playlist_journal_job *next;
+   uint8_t *record;
+   size_t record_size;
+   playlist_config_t config;
+} playlist_journal_job_t;
+
+/* TODO/FIXME - global state - perhaps move outside this file */
+static struct
+{
+   playlist_journal_job_t *head;
+   playlist_journal_job_t *tail;
+#ifdef HAVE_THREADS
+   slock_t *lock;       /* Guards everything but 'io_thread' */
+   slock_t *io_lock;    /* Held while running jobs */
+   uintptr_t io_thread; /* Thread holding 'io_lock' */
+   bool task_pending;
+#else
+   bool running;
+#endif
+   /* Playlists a record could not be appended for,
+    * which must be written out in full */
+   struct string_list *failed_paths;
+} playlist_journal_queue;
+
+/* Index of 'path' in 'failed_paths', or -1 */
+static int playlist_journal_find_failed(const char *path)
+{
+   size_t i;
+   const struct string_list *list = playlist_journal_queue.failed_paths;
+
+   if (list)
+      for (i = 0; i < list->size; i++)
+         if (string_is_equal(list->elems[i].data, path))
+            return (int)i;
+   return -1;
+}
+
+static void playlist_journal_get_path(char *s,
+      const char *playlist_path, size_t len)
+{
+   fill_pathname(s, playlist_path, PLAYLIST_JOURNAL_EXTENSION, len);
+}
+
+static size_t playlist_journal_put_string(uint8_t *data,
+      size_t pos, const char *str)
+{
+   size_t len = str ? strlen(str) : 0;
+   if (len)
+      memcpy(data + pos, str, len);
+   data[pos + len] = '\0';
+   return pos + len + 1;
+}
+
+static uint8_t *playlist_journal_record_new(enum playlist_journal_op op,
+      size_t idx, const struct playlist_entry *entry, size_t *size)
+{
+   size_t i, pos;
+   uint8_t *data;
+   playlist_journal_record_t record;
+   const char *strings[PLAYLIST_JOURNAL_NUM_STRINGS];
+   const struct string_list *roms = NULL;
+
+   memset(&record, 0, sizeof(record));
+   record.op   = op;
+   record.idx  = (uint32_t)idx;
+   record.size = sizeof(record);
+
+   if (entry)
+   {
+      strings[0]                = entry->path;
+      strings[1]                = entry->label;
+      strings[2]                = entry->core_path;
+      strings[3]                = entry->core_name;
+      strings[4]                = entry->db_name;
+      strings[5]                = entry->crc32;
+      strings[6]                = entry->subsystem_ident;
+      strings[7]                = entry->subsystem_name;
+      roms                      = entry->subsystem_roms;
+      record.entry_slot         = entry->entry_slot;
+      record.num_subsystem_roms = roms ? (uint32_t)roms->size : 0;
+
+      for (i = 0; i < PLAYLIST_JOURNAL_NUM_STRINGS; i++)
+         record.size += (strings[i] ? strlen(strings[i]) : 0) + 1;
+      for (i = 0; i < record.num_subsystem_roms; i++)
+         record.size += (roms->elems[i].data
+               ? strlen(roms->elems[i].data) : 0) + 1;
+   }
+
+   if (!(data = (uint8_t*)malloc(record.size)))
+      return NULL;
+
+   pos = sizeof(record);
+   if (entry)
+   {
+      for (i = 0; i < PLAYLIST_JOURNAL_NUM_STRINGS; i++)
+         pos = playlist_journal_put_string(data, pos, strings[i]);
+      for (i = 0; i < record.num_subsystem_roms; i++)
+         pos = playlist_journal_put_string(data, pos, roms->elems[i].data);
+   }
+
+   memcpy(data, &record, sizeof(record));
+   record.crc = encoding_crc32(0, data + 2 * sizeof(uint32_t),
+         record.size - 2 * sizeof(uint32_t));
+   memcpy(data, &record, sizeof(record));
+
+   *size = record.size;
+   return data;
+}
+
+/* Replaces 'entry' with the one stored in a journal
+ * record, whose strings are the 'len' bytes at
+ * 'strings'. Returns false, leaving 'entry' as it
+ * is, if these are malformed. */
+static bool playlist_journal_record_get_entry(playlist_t *playlist,
+      const playlist_journal_record_t *record,
+      const char *strings, size_t len, struct playlist_entry *entry)
+{
+   size_t i;
+   const char *str[PLAYLIST_JOURNAL_NUM_STRINGS];
+   const char *pos = strings;
+   const char *end = strings + len;
+
+   for (i = 0; i < PLAYLIST_JOURNAL_NUM_STRINGS
+         + record->num_subsystem_roms; i++)
+   {
+      const char *nul = (const char*)memchr(pos, '\0', end - pos);
+      if (!nul)
+         return false;
+      if (i < PLAYLIST_JOURNAL_NUM_STRINGS)
+         str[i] = pos;
+      pos = nul + 1;
+   }
+
+   if (pos != end)
+      return false;
+
+   playlist_free_entry(playlist, entry);
+
+   entry->path            = *str[0] ? strdup(str[0]) : NULL;
+   entry->label           = *str[1] ? strdup(str[1]) : NULL;
+   entry->core_path       = *str[2] ? strdup(str[2]) : NULL;
+   entry->core_name       = *str[3] ? strdup(str[3]) : NULL;
+   entry->db_name         = *str[4] ? strdup(str[4]) : NULL;
+   entry->crc32           = *str[5] ? strdup(str[5]) : NULL;
+   entry->subsystem_ident = *str[6] ? strdup(str[6]) : NULL;
+   entry->subsystem_name  = *str[7] ? strdup(str[7]) : NULL;
+   entry->entry_slot      = record->entry_slot;
+
+   if (     record->num_subsystem_roms
+         && (entry->subsystem_roms = string_list_new()))
+   {
+      union string_list_elem_attr attributes = {0};
+      const char *rom                        = str[7] + strlen(str[7]) + 1;
+
+      for (i = 0; i < record->num_subsystem_roms; i++)
+      {
+         string_list_append(entry->subsystem_roms, rom, attributes);
+         rom += strlen(rom) + 1;
+      }
+   }
+
+   return true;
+}
+
+static bool playlist_journal_apply(playlist_t *playlist,
+      const playlist_journal_record_t *record,
+      const char *strings, size_t len)
+{
+   struct playlist_entry tmp;
+   size_t entries_len = RBUF_LEN(playlist->entries);
+
+   switch (record->op)
+   {
+      case PLAYLIST_JOURNAL_OP_INSERT:
+         if (playlist->config.capacity == 0)
+            return false;
+
+         memset(&tmp, 0, sizeof(tmp));
+         if (!playlist_journal_record_get_entry(playlist,
+                  record, strings, len, &tmp))
+            return false;
+
+         if (entries_len == playlist->config.capacity)
+            playlist_free_entry(playlist,
+                  &playlist->entries[--entries_len]);
+         else
+         {
+            if (!RBUF_TRYFIT(playlist->entries, entries_len + 1))
+            {
+               playlist_free_entry(playlist, &tmp);
+               return false;
+            }
+            RBUF_RESIZE(playlist->entries, entries_len + 1);
+         }
+
+         memmove(playlist->entries + 1, playlist->entries,
+               entries_len * sizeof(struct playlist_entry));
+         playlist->entries[0] = tmp;
+         break;
+      case PLAYLIST_JOURNAL_OP_MOVE:
+         if (record->idx >= entries_len)
+            return false;
+
+         tmp = playlist->entries[record->idx];
+         if (!playlist_journal_record_get_entry(playlist,
+                  record, strings, len, &tmp))
+            return false;
+
+         memmove(playlist->entries + 1, playlist->entries,
+               record->idx * sizeof(struct playlist_entry));
+         playlist->entries[0] = tmp;
+         break;
+      case PLAYLIST_JOURNAL_OP_SET:
+         if (     (record->idx >= entries_len)
+               || !playlist_journal_record_get_entry(playlist,
+                  record, strings, len,
+                  &playlist->entries[record->idx]))
+            return false;
+         break;
+      case PLAYLIST_JOURNAL_OP_SORT:
+         playlist_qsort(playlist);
+         return true;
+      default:
+         return false;
+   }
+
+   playlist_index_invalidate(playlist);
+   return true;
+}
+
+/* Applies the journal to a freshly loaded playlist.
+ * Returns the number of records applied, or -1 if the
+ * journal is damaged past those. */
+static int playlist_journal_replay(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   playlist_journal_header_t header;
+   size_t pos;
+   int64_t len       = 0;
+   uint8_t *data     = NULL;
+   int records       = 0;
+   int64_t lpl_mtime = path_get_mtime(playlist->config.path);
+   int32_t lpl_size  = path_get_size(playlist->config.path);
+
+   /* Changes are only journalled once
+    * the playlist file exists */
+   if (lpl_mtime < 0 || lpl_size < 0)
+      return 0;
+
+   playlist->flags |= CNT_PLAYLIST_FLG_JOURNAL;
+
+   playlist_journal_get_path(journal_path,
+         playlist->config.path, sizeof(journal_path));
+
+   if (!filestream_read_file(journal_path, (void**)&data, &len))
+      return 0;
+
+   if ((size_t)len >= sizeof(header))
+      memcpy(&header, data, sizeof(header));
+
+   /* Left behind by a crash right after the
+    * playlist file was last written */
+   if (     ((size_t)len < sizeof(header))
+         || (header.magic     != PLAYLIST_JOURNAL_MAGIC)
+         || (header.version   != PLAYLIST_JOURNAL_VERSION)
+         || (header.lpl_size  != lpl_size)
+         || (header.lpl_mtime != lpl_mtime))
+   {
+      free(data);
+      filestream_delete(journal_path);
+      return 0;
+   }
+
+   for (pos = sizeof(header); pos < (size_t)len; records++)
+   {
+      playlist_journal_record_t record;
+
+      if ((size_t)len - pos < sizeof(record))
+         break;
+
+      memcpy(&record, data + pos, sizeof(record));
+
+      if (     (record.size < sizeof(record))
+            || (record.size > (size_t)len - pos)
+            || (record.crc  != encoding_crc32(0,
+                  data + pos + 2 * sizeof(uint32_t),
+                  record.size - 2 * sizeof(uint32_t)))
+            || !playlist_journal_apply(playlist, &record,
+                  (const char*)data + pos + sizeof(record),
+                  record.size - sizeof(record)))
+         break;
+
+      pos += record.size;
+   }
+
+   free(data);
+
+   if (pos < (size_t)len)
+   {
+      RARCH_WARN("[Playlist]: Discarding damaged journal records: \"%s\".\n",
+            journal_path);
+      return -1;
+   }
+
+   return records;
+}
+
+static bool playlist_journal_write(const char *playlist_path,
+      const uint8_t *record, size_t size)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   bool success = false;
+   RFILE *file  = NULL;
+
+   playlist_journal_get_path(journal_path,
+         playlist_path, sizeof(journal_path));
+
+   if ((file = filestream_open(journal_path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      if (filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END) != 0)
+         goto end;
+   }
+   else
+   {
+      playlist_journal_header_t header;
+
+      if (!(file = filestream_open(journal_path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto end;
+
+      header.magic     = PLAYLIST_JOURNAL_MAGIC;
+      header.version   = PLAYLIST_JOURNAL_VERSION;
+      header.lpl_size  = path_get_size(playlist_path);
+      header.lpl_mtime = path_get_mtime(playlist_path);
+
+      if (   (header.lpl_size < 0)
+          || (header.lpl_mtime < 0)
+          || (filestream_write(file, &header, sizeof(header))
+               != sizeof(header)))
+         goto end;
+   }
+
+   success = (filestream_write(file, record, size) == (int64_t)size);
+
+end:
+   if (file)
+      filestream_close(file);
+   return success;
+}
+
+static void playlist_journal_run(playlist_journal_job_t *job)
+{
+   if (job->record)
+   {
+      bool failed;
+
+#ifdef HAVE_THREADS
+      slock_lock(playlist_journal_queue.lock);
+#endif
+      /* Once a record is lost, later ones would
+       * apply to the wrong entries */
+      failed = (playlist_journal_find_failed(job->config.path) >= 0);
+#ifdef HAVE_THREADS
+      slock_unlock(playlist_journal_queue.lock);
+#endif
+
+      if (     !failed
+            && !playlist_journal_write(job->config.path,
+                  job->record, job->record_size))
+      {
+         char journal_path[PATH_MAX_LENGTH];
+
+         playlist_journal_get_path(journal_path,
+               job->config.path, sizeof(journal_path));
+         RARCH_WARN("[Playlist]: Failed to write playlist journal: \"%s\".\n",
+               journal_path);
+         filestream_delete(journal_path);
+
+#ifdef HAVE_THREADS
+         slock_lock(playlist_journal_queue.lock);
+#endif
+         {
+            union string_list_elem_attr attr;
+            attr.i = 0;
+            if (!playlist_journal_queue.failed_paths)
+               playlist_journal_queue.failed_paths = string_list_new();
+            if (playlist_journal_queue.failed_paths)
+               string_list_append(playlist_journal_queue.failed_paths,
+                     job->config.path, attr);
+         }
+#ifdef HAVE_THREADS
+         slock_unlock(playlist_journal_queue.lock);
+#endif
+      }
+   }
+   else
+   {
+      /* Fold the journal into the playlist file */
+      playlist_t *playlist;
+
+#ifndef HAVE_THREADS
+      playlist_journal_queue.running = true;
+#endif
+      if ((playlist = playlist_init(&job->config)))
+      {
+         playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+         playlist_write_file(playlist);
+         playlist_free(playlist);
+      }
+#ifndef HAVE_THREADS
+      playlist_journal_queue.running = false;
+#endif
+   }
+
+   free(job->record);
+   free(job);
+}
+
+#ifdef HAVE_THREADS
+static playlist_journal_job_t *playlist_journal_pop(void)
+{
+   playlist_journal_job_t *job;
+
+   slock_lock(playlist_journal_queue.lock);
+   if ((job = playlist_journal_queue.head))
+   {
+      if (!(playlist_journal_queue.head = job->next))
+         playlist_journal_queue.tail = NULL;
+   }
+   else
+      playlist_journal_queue.task_pending = false;
+   slock_unlock(playlist_journal_queue.lock);
+
+   return job;
+}
+
+static void playlist_journal_task_handler(retro_task_t *task)
+{
+   playlist_journal_job_t *job;
+
+   slock_lock(playlist_journal_queue.io_lock);
+   playlist_journal_queue.io_thread = sthread_get_current_thread_id();
 
-      if (      string_is_empty(entry->subsystem_name)
-            && !string_is_empty(playlist->entries[i].subsystem_name))
-         continue;
+   if ((job = playlist_journal_pop()))
+      playlist_journal_run(job);
 
-      if (     !string_is_empty(entry->subsystem_name)
-            &&  string_is_empty(playlist->entries[i].subsystem_name))
-         continue;
+   playlist_journal_queue.io_thread = 0;
+   slock_unlock(playlist_journal_queue.io_lock);
 
-      if (entry->subsystem_roms)
-      {
-         unsigned j;
-         const struct string_list *roms = playlist->entries[i].subsystem_roms;
-         bool                   unequal = false;
+   if (!job)
+      task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
+}
+#endif
 
-         if (entry->subsystem_roms->size != roms->size)
-            continue;
+/* Whether the calling thread is running a journal
+ * job, which playlist_init() and friends are called
+ * from when compacting */
+static bool playlist_journal_in_job(void)
+{
+#ifdef HAVE_THREADS
+   return playlist_journal_queue.io_thread
+      == sthread_get_current_thread_id();
+#else
+   return playlist_journal_queue.running;
+#endif
+}
 
-         for (j = 0; j < entry->subsystem_roms->size; j++)
-         {
-            char real_rom_path[PATH_MAX_LENGTH];
+/* Runs any pending journal jobs on the calling thread */
+static void playlist_journal_flush(void)
+{
+#ifdef HAVE_THREADS
+   playlist_journal_job_t *job;
 
-            if (!string_is_empty(entry->subsystem_roms->elems[j].data))
-            {
-               strlcpy(real_rom_path, entry->subsystem_roms->elems[j].data, sizeof(real_rom_path));
-               path_resolve_realpath(real_rom_path, sizeof(real_rom_path), true);
-            }
-            else
-               real_rom_path[0] = '\0';
+   if (!playlist_journal_queue.io_lock || playlist_journal_in_job())
+      return;
 
-            if (!playlist_path_equal(real_rom_path, roms->elems[j].data,
-                     &playlist->config))
-            {
-               unequal = true;
-               break;
-            }
-         }
+   slock_lock(playlist_journal_queue.io_lock);
+   playlist_journal_queue.io_thread = sthread_get_current_thread_id();
 
-         if (unequal)
-            continue;
-      }
+   while ((job = playlist_journal_pop()))
+      playlist_journal_run(job);
 
-      if (playlist->entries[i].entry_slot != entry->entry_slot)
-      {
-         playlist->entries[i].entry_slot  = entry->entry_slot;
-         entry_updated                    = true;
-      }
+   playlist_journal_queue.io_thread = 0;
+   slock_unlock(playlist_journal_queue.io_lock);
+#endif
+}
 
-      /* If content was previously loaded via file browser
-       * or command line, certain entry values will be missing.
-       * If we are now loading the same content from a playlist,
-       * fill in any blanks */
-      if (     !playlist->entries[i].label
-            && !string_is_empty(entry->label))
-      {
-         playlist->entries[i].label       = strdup(entry->label);
-         entry_updated                    = true;
-      }
-      if (     !playlist->entries[i].crc32
-            && !string_is_empty(entry->crc32))
-      {
-         playlist->entries[i].crc32       = strdup(entry->crc32);
-         entry_updated                    = true;
-      }
-      if (     !playlist->entries[i].db_name
-            && !string_is_empty(entry->db_name))
-      {
-         playlist->entries[i].db_name     = strdup(entry->db_name);
-         entry_updated                    = true;
-      }
+static void playlist_journal_push(playlist_journal_job_t *job)
+{
+#ifdef HAVE_THREADS
+   bool push_task;
 
-      /* If top entry, we don't want to push a new entry since
-       * the top and the entry to be pushed are the same. */
-      if (i == 0)
+   if (playlist_journal_queue.lock)
+   {
+      slock_lock(playlist_journal_queue.lock);
+      if (playlist_journal_queue.tail)
+         playlist_journal_queue.tail->next = job;
+      else
+         playlist_journal_queue.head       = job;
+      playlist_journal_queue.tail          = job;
+      push_task = !playlist_journal_queue.task_pending;
+      playlist_journal_queue.task_pending  = true;
+      slock_unlock(playlist_journal_queue.lock);
+
+      if (push_task)
       {
-         if (entry_updated)
-            goto success;
+         retro_task_t *task = task_init();
 
-         goto error;
+         if (task)
+         {
+            task->handler = playlist_journal_task_handler;
+            task->flags  |= RETRO_TASK_FLG_MUTE;
+            task_queue_push(task);
+         }
+         else
+         {
+            slock_lock(playlist_journal_queue.lock);
+            playlist_journal_queue.task_pending = false;
+            slock_unlock(playlist_journal_queue.lock);
+            playlist_journal_flush();
+         }
       }
-
-      /* Seen it before, bump to top. */
-      tmp = playlist->entries[i];
-      memmove(playlist->entries + 1, playlist->entries,
-            i * sizeof(struct playlist_entry));
-      playlist->entries[0] = tmp;
-
-      goto success;
+      return;
    }
+#endif
 
-   if (playlist->config.capacity == 0)
-      goto error;
+   playlist_journal_run(job);
+}
 
-   if (len == playlist->config.capacity)
+void playlist_journal_init(void)
+{
+#ifdef HAVE_THREADS
+   if (playlist_journal_queue.lock)
+      return;
+   if (     !(playlist_journal_queue.lock    = slock_new())
+         || !(playlist_journal_queue.io_lock = slock_new()))
    {
-      struct playlist_entry *last_entry = &playlist->entries[len - 1];
-      playlist_free_entry(last_entry);
-      len--;
+      slock_free(playlist_journal_queue.lock);
+      playlist_journal_queue.lock = NULL;
    }
-   else
+#endif
+}
+
+void playlist_journal_deinit(void)
+{
+   /* The journal task may have been dropped with the
+    * task queue, so run whatever it left here */
+   playlist_journal_flush();
+
+#ifdef HAVE_THREADS
+   slock_free(playlist_journal_queue.lock);
+   slock_free(playlist_journal_queue.io_lock);
+   playlist_journal_queue.lock         = NULL;
+   playlist_journal_queue.io_lock      = NULL;
+   playlist_journal_queue.task_pending = false;
+#endif
+   string_list_free(playlist_journal_queue.failed_paths);
+   playlist_journal_queue.failed_paths = NULL;
+}
+
+static playlist_journal_job_t *playlist_journal_job_new(
+      playlist_t *playlist)
+{
+   playlist_journal_job_t *job = (playlist_journal_job_t*)
+      malloc(sizeof(*job));
+
+   if (!job)
+      return NULL;
+
+   job->next        = NULL;
+   job->record      = NULL;
+   job->record_size = 0;
+
+   if (!playlist_config_copy(&playlist->config, &job->config))
    {
-      /* Allocate memory to fit one more item and resize the buffer */
-      if (!RBUF_TRYFIT(playlist->entries, len + 1))
-         goto error; /* out of memory */
-      RBUF_RESIZE(playlist->entries, len + 1);
+      free(job);
+      return NULL;
    }
 
-   if (playlist->entries)
+   return job;
+}
+
+/* Whether a record could not be appended to the journal
+ * of 'playlist', which then has to be written out in
+ * full. Reports each failure once. */
+static bool playlist_journal_failed(playlist_t *playlist)
+{
+   bool failed;
+
+#ifdef HAVE_THREADS
+   slock_lock(playlist_journal_queue.lock);
+#endif
    {
-      memmove(playlist->entries + 1, playlist->entries,
-            len * sizeof(struct playlist_entry));
+      struct string_list *list = playlist_journal_queue.failed_paths;
+      int i                    = playlist_journal_find_failed(
+            playlist->config.path);
+      if ((failed = (i >= 0)))
+      {
+         free(list->elems[i].data);
+         list->elems[i] = list->elems[--list->size];
+      }
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(playlist_journal_queue.lock);
+#endif
 
-      playlist->entries[0].path               = NULL;
-      playlist->entries[0].label              = NULL;
-      playlist->entries[0].core_path          = NULL;
-      playlist->entries[0].core_name          = NULL;
-      playlist->entries[0].db_name            = NULL;
-      playlist->entries[0].crc32              = NULL;
-      playlist->entries[0].subsystem_ident    = NULL;
-      playlist->entries[0].subsystem_name     = NULL;
-      playlist->entries[0].runtime_str        = NULL;
-      playlist->entries[0].last_played_str    = NULL;
-      playlist->entries[0].subsystem_roms     = NULL;
-      playlist->entries[0].path_id            = NULL;
-      playlist->entries[0].runtime_status     = PLAYLIST_RUNTIME_UNKNOWN;
-      playlist->entries[0].runtime_hours      = 0;
-      playlist->entries[0].runtime_minutes    = 0;
-      playlist->entries[0].runtime_seconds    = 0;
-      playlist->entries[0].last_played_year   = 0;
-      playlist->entries[0].last_played_month  = 0;
-      playlist->entries[0].last_played_day    = 0;
-      playlist->entries[0].last_played_hour   = 0;
-      playlist->entries[0].last_played_minute = 0;
-      playlist->entries[0].last_played_second = 0;
+   return failed;
+}
 
-      if (!string_is_empty(path_id->real_path))
-         playlist->entries[0].path            = strdup(path_id->real_path);
-      playlist->entries[0].path_id            = path_id;
-      path_id                                 = NULL;
+/* Whether changes to the playlist can be journalled,
+ * i.e. the playlist file and its journal hold what is
+ * in memory and the file is in the requested format */
+static bool playlist_journal_enabled(playlist_t *playlist)
+{
+   bool pl_old_fmt    = ((playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)    > 0);
+#if defined(HAVE_ZLIB)
+   bool pl_compressed = ((playlist->flags & CNT_PLAYLIST_FLG_COMPRESSED) > 0);
+#endif
 
-      playlist->entries[0].entry_slot         = entry->entry_slot;
+   return   (playlist->flags & CNT_PLAYLIST_FLG_JOURNAL)
+#if defined(HAVE_ZLIB)
+         && (pl_compressed == playlist->config.compress)
+#endif
+         && (pl_old_fmt    == playlist->config.old_format)
+         && !playlist_journal_failed(playlist);
+}
 
-      if (!string_is_empty(entry->label))
-         playlist->entries[0].label           = strdup(entry->label);
-      if (!string_is_empty(real_core_path))
-         playlist->entries[0].core_path       = strdup(real_core_path);
-      if (!string_is_empty(core_name))
-         playlist->entries[0].core_name       = strdup(core_name);
-      if (!string_is_empty(entry->db_name))
-         playlist->entries[0].db_name         = strdup(entry->db_name);
-      if (!string_is_empty(entry->crc32))
-         playlist->entries[0].crc32           = strdup(entry->crc32);
-      if (!string_is_empty(entry->subsystem_ident))
-         playlist->entries[0].subsystem_ident = strdup(entry->subsystem_ident);
-      if (!string_is_empty(entry->subsystem_name))
-         playlist->entries[0].subsystem_name  = strdup(entry->subsystem_name);
+static void playlist_journal_compact(playlist_t *playlist)
+{
+   playlist_journal_job_t *job = playlist_journal_job_new(playlist);
 
-      if (entry->subsystem_roms)
-      {
-         union string_list_elem_attr attributes = {0};
+   if (job)
+   {
+      playlist_journal_push(job);
+      playlist->journal_records = 0;
+   }
+}
 
-         playlist->entries[0].subsystem_roms    = string_list_new();
+/* Journals a change made to a playlist that was
+ * unmodified before it, or if that is not possible
+ * writes the playlist out in full */
+static void playlist_journal_append(playlist_t *playlist,
+      bool modified, enum playlist_journal_op op, size_t idx,
+      const struct playlist_entry *entry)
+{
+   playlist_journal_job_t *job = NULL;
 
-         for (i = 0; i < entry->subsystem_roms->size; i++)
-            string_list_append(playlist->entries[0].subsystem_roms, entry->subsystem_roms->elems[i].data, attributes);
-      }
+   if (     modified
+         || !playlist_journal_enabled(playlist)
+         || !(job = playlist_journal_job_new(playlist))
+         || !(job->record = playlist_journal_record_new(
+               op, idx, entry, &job->record_size)))
+   {
+      if (job)
+         free(job);
+      playlist->flags |= CNT_PLAYLIST_FLG_MOD;
+      playlist_write_file(playlist);
+      return;
    }
 
-success:
-   if (path_id)
-      playlist_path_id_free(path_id);
-   playlist->flags   |= CNT_PLAYLIST_FLG_MOD;
-   return true;
+   playlist_journal_push(job);
+   playlist->flags &= ~CNT_PLAYLIST_FLG_MOD;
 
-error:
-   if (path_id)
-      playlist_path_id_free(path_id);
-   return false;
+   if (++playlist->journal_records >= PLAYLIST_JOURNAL_MAX_RECORDS)
+      playlist_journal_compact(playlist);
 }
 
 void playlist_write_runtime_file(playlist_t *playlist)
@@ -1724,9 +3326,11 @@ void playlist_write_file(playlist_t *playlist)
    size_t i, len;
    intfstream_t *file = NULL;
    bool compressed    = false;
+   bool written       = false;
 
    /* Playlist will be written if any of the
     * following are true:
+    * > A change could not be journalled
     * > 'modified' flag is set
     * > Current playlist format (old/new) does not
     *   match requested
@@ -1736,13 +3340,19 @@ void playlist_write_file(playlist_t *playlist)
    bool pl_old_fmt      = ((playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)    > 0);
 
    if (   !playlist
-       || !((playlist->flags & CNT_PLAYLIST_FLG_MOD) ||
+       || !(playlist_journal_failed(playlist) ||
+        (playlist->flags & CNT_PLAYLIST_FLG_MOD) ||
 #if defined(HAVE_ZLIB)
         (pl_compressed != playlist->config.compress) ||
 #endif
         (pl_old_fmt    != playlist->config.old_format)))
       return;
 
+   /* Journal writes still pending are about
+    * to be superseded */
+   playlist_journal_flush();
+   playlist->flags &= ~CNT_PLAYLIST_FLG_JOURNAL;
+
 #if defined(HAVE_ZLIB)
    if (playlist->config.compress)
       file = intfstream_open_rzip_file(playlist->config.path,
@@ -2118,9 +3728,25 @@ void playlist_write_file(playlist_t *playlist)
       playlist->flags  &= ~(CNT_PLAYLIST_FLG_COMPRESSED);
 
    RARCH_LOG("[Playlist]: Written to playlist file: \"%s\".\n", playlist->config.path);
+   written              = true;
 end:
    intfstream_close(file);
    free(file);
+
+   if (written)
+   {
+      char journal_path[PATH_MAX_LENGTH];
+
+      /* The playlist file now holds everything
+       * that had been journalled */
+      playlist_journal_get_path(journal_path,
+            playlist->config.path, sizeof(journal_path));
+      filestream_delete(journal_path);
+      playlist->journal_records  = 0;
+      playlist->flags           |= CNT_PLAYLIST_FLG_JOURNAL;
+
+      playlist_cache_write(playlist);
+   }
 }
 
 /**
@@ -2136,6 +3762,9 @@ void playlist_free(playlist_t *playlist)
    if (!playlist)
       return;
 
+   /* Make sure journalled changes are on disk */
+   playlist_journal_flush();
+
    if (playlist->default_core_path)
       free(playlist->default_core_path);
    playlist->default_core_path = NULL;
@@ -2167,12 +3796,19 @@ void playlist_free(playlist_t *playlist)
          struct playlist_entry *entry = &playlist->entries[i];
 
          if (entry)
-            playlist_free_entry(entry);
+            playlist_free_entry(playlist, entry);
       }
 
       RBUF_FREE(playlist->entries);
    }
 
+   playlist_cache_release(playlist);
+
+   if (playlist->index)
+      free(playlist->index);
+   if (playlist->index_matches)
+      free(playlist->index_matches);
+
    free(playlist);
 }
 
@@ -2193,9 +3829,10 @@ void playlist_clear(playlist_t *playlist)
       struct playlist_entry *entry = &playlist->entries[i];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
    }
    RBUF_CLEAR(playlist->entries);
+   playlist_index_invalidate(playlist);
 }
 
 /**
@@ -2882,6 +4519,21 @@ end:
    return res;
 }
 
+void playlist_delete_cache(const char *path)
+{
+   char cache_path[PATH_MAX_LENGTH];
+
+   if (string_is_empty(path))
+      return;
+
+   playlist_journal_flush();
+
+   playlist_cache_get_path(cache_path, path, sizeof(cache_path));
+   filestream_delete(cache_path);
+   playlist_journal_get_path(cache_path, path, sizeof(cache_path));
+   filestream_delete(cache_path);
+}
+
 void playlist_free_cached(void)
 {
    if (playlist_cached && !(playlist_cached->flags & CNT_PLAYLIST_FLG_CACHED_EXT))
@@ -2929,16 +4581,32 @@ bool playlist_init_cached(const playlist_config_t *config)
  **/
 playlist_t *playlist_init(const playlist_config_t *config)
 {
+   int journal_records;
    playlist_t           *playlist   = (playlist_t*)malloc(sizeof(*playlist));
    if (!playlist)
       return NULL;
 
+   /* Journal writes still pending may
+    * be for this playlist */
+   playlist_journal_flush();
+
    /* Set initial values */
    playlist->flags                          = 0;
    playlist->default_core_name              = NULL;
    playlist->default_core_path              = NULL;
    playlist->base_content_directory         = NULL;
    playlist->entries                        = NULL;
+   playlist->index                          = NULL;
+   playlist->index_matches                  = NULL;
+   playlist->index_size                     = 0;
+   playlist->index_used                     = 0;
+   playlist->index_matches_cap              = 0;
+   playlist->index_shift                    = 0;
+   playlist->journal_records                = 0;
+   playlist->cache_data                     = NULL;
+   playlist->cache_strings                  = NULL;
+   playlist->cache_size                     = 0;
+   playlist->cache_strings_size             = 0;
    playlist->label_display_mode             = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode           = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode            = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -2956,9 +4624,33 @@ playlist_t *playlist_init(const playlist_config_t *config)
    if (!playlist_config_copy(config, &playlist->config))
       goto error;
 
-   /* Attempt to read any existing playlist file */
-   if (!playlist_read_file(playlist))
-      goto error;
+   /* Attempt to read any existing playlist file,
+    * through its binary cache if possible */
+   if (!playlist_cache_read(playlist))
+   {
+      if (!playlist_read_file(playlist))
+         goto error;
+
+      /* Entries past the capacity have not been read,
+       * and must not go missing from the cache (the JSON
+       * parser flags the playlist as modified if it
+       * drops any, the old format parser cannot tell) */
+      if (     !(playlist->flags & CNT_PLAYLIST_FLG_MOD)
+            && (   !(playlist->flags & CNT_PLAYLIST_FLG_OLD_FMT)
+                || (RBUF_LEN(playlist->entries) < playlist->config.capacity)))
+         playlist_cache_write(playlist);
+   }
+
+   /* Apply the changes journalled since the
+    * playlist file was last written. A damaged
+    * journal cannot be appended to, and has to
+    * be compacted straight away. */
+   journal_records           = playlist_journal_replay(playlist);
+   playlist->journal_records = (journal_records < 0)
+      ? PLAYLIST_JOURNAL_MAX_RECORDS : (uint32_t)journal_records;
+   if (     (playlist->journal_records >= PLAYLIST_JOURNAL_MAX_RECORDS)
+         && !playlist_journal_in_job())
+      playlist_journal_compact(playlist);
 
    /* Try auto-fixing paths if enabled, and playlist
     * base content directory is different */
@@ -2985,7 +4677,7 @@ playlist_t *playlist_init(const playlist_config_t *config)
                   playlist->base_content_directory, playlist->config.base_content_directory,
                   sizeof(tmp_entry_path));
 
-            free(entry->path);
+            playlist_free_string(playlist, entry->path);
             entry->path = strdup(tmp_entry_path);
 
             /* Fix subsystem roms paths*/
@@ -3161,14 +4853,31 @@ void playlist_qsort(playlist_t *playlist)
    qsort(playlist->entries, RBUF_LEN(playlist->entries),
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
+   playlist_index_invalidate(playlist);
 }
 
-void command_playlist_push_write(
+bool command_playlist_push_write(
       playlist_t *playlist,
       const struct playlist_entry *entry)
 {
-   if (playlist && playlist_push(playlist, entry))
-      playlist_write_file(playlist);
+   size_t moved_from;
+   bool modified;
+
+   if (!playlist)
+      return false;
+
+   modified = ((playlist->flags & CNT_PLAYLIST_FLG_MOD) > 0);
+
+   if (!playlist_push_internal(playlist, entry, &moved_from))
+      return false;
+
+   if (moved_from == (size_t)-1)
+      playlist_journal_append(playlist, modified,
+            PLAYLIST_JOURNAL_OP_INSERT, 0, &playlist->entries[0]);
+   else
+      playlist_journal_append(playlist, modified,
+            PLAYLIST_JOURNAL_OP_MOVE, moved_from, &playlist->entries[0]);
+   return true;
 }
 
 void command_playlist_update_write(
@@ -3176,17 +4885,39 @@ void command_playlist_update_write(
       size_t idx,
       const struct playlist_entry *entry)
 {
+   bool modified;
    playlist_t *playlist = plist ? plist : playlist_get_cached();
 
    if (!playlist)
       return;
 
+   modified = ((playlist->flags & CNT_PLAYLIST_FLG_MOD) > 0);
+
    playlist_update(
          playlist,
          idx,
          entry);
 
-   playlist_write_file(playlist);
+   if (     (playlist->flags & CNT_PLAYLIST_FLG_MOD)
+         && (idx < RBUF_LEN(playlist->entries)))
+      playlist_journal_append(playlist, modified,
+            PLAYLIST_JOURNAL_OP_SET, idx, &playlist->entries[idx]);
+   else
+      playlist_write_file(playlist);
+}
+
+void command_playlist_sort_write(playlist_t *playlist)
+{
+   bool modified;
+
+   if (!playlist || (playlist->sort_mode == PLAYLIST_SORT_MODE_OFF))
+      return;
+
+   modified = ((playlist->flags & CNT_PLAYLIST_FLG_MOD) > 0);
+
+   playlist_qsort(playlist);
+   playlist_journal_append(playlist, modified,
+         PLAYLIST_JOURNAL_OP_SORT, 0, NULL);
 }
 
 bool playlist_index_is_valid(playlist_t *playlist, size_t idx,
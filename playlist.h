@@ -325,8 +325,22 @@ void playlist_write_runtime_file(playlist_t *playlist);
 
 void playlist_qsort(playlist_t *playlist);
 
+/* Deletes the binary cache and the journal kept
+ * alongside the playlist file at 'path', which
+ * should be called when deleting the playlist
+ * file itself */
+void playlist_delete_cache(const char *path);
+
 void playlist_free_cached(void);
 
+/* Lets journal records be written on the task
+ * thread; until then they are written right away.
+ * Call from the main thread, before any playlist
+ * is loaded. playlist_journal_deinit() writes out
+ * anything still pending. */
+void playlist_journal_init(void);
+void playlist_journal_deinit(void);
+
 playlist_t *playlist_get_cached(void);
 
 /* If current on-disk playlist file referenced
@@ -339,7 +353,15 @@ playlist_t *playlist_get_cached(void);
  *   are always kept synced with user settings */
 bool playlist_init_cached(const playlist_config_t *config);
 
-void command_playlist_push_write(
+/* Push, update or sort a playlist and save the
+ * change. Changes to a playlist that is otherwise
+ * unmodified are appended to a journal alongside
+ * the playlist file, on the task thread, rather
+ * than rewriting it; the journal is folded back
+ * into the playlist file once it grows long.
+ * command_playlist_push_write() returns false
+ * if the entry was not pushed. */
+bool command_playlist_push_write(
       playlist_t *playlist,
       const struct playlist_entry *entry);
 
@@ -348,6 +370,8 @@ void command_playlist_update_write(
       size_t idx,
       const struct playlist_entry *entry);
 
+void command_playlist_sort_write(playlist_t *playlist);
+
 /* Returns true if specified playlist index matches
  * specified content/core paths */
 bool playlist_index_is_valid(playlist_t *playlist, size_t idx,
@@ -25,6 +25,7 @@
 #include <boolean.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
 #include <file/config_file.h>
@@ -485,6 +486,14 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    video->codec->thread_count = params->threads;
 
+   /* Let the in-house scaler split frames across the same
+    * number of threads the encoder gets. */
+   if (!video->use_sws && params->threads > 1)
+   {
+      video->scaler.pool    = tpool_create(params->threads);
+      video->scaler.threads = params->threads;
+   }
+
    if (params->video_qscale)
    {
       video->codec->flags |= AV_CODEC_FLAG_QSCALE;
@@ -967,6 +976,8 @@ static void ffmpeg_free(void *data)
    av_free(handle->video.conv_frame_buf);
 
    scaler_ctx_gen_reset(&handle->video.scaler);
+   if (handle->video.scaler.pool)
+      tpool_destroy(handle->video.scaler.pool);
 
    if (handle->video.sws)
       sws_freeContext(handle->video.sws);
@@ -4431,7 +4431,7 @@ bool command_event(enum event_command cmd, void *data)
                   entry.db_name   = str_list->elems[5].data; /* db_name */
 
                   /* Write playlist entry */
-                  if (playlist_push(g_defaults.content_favorites, &entry))
+                  if (command_playlist_push_write(g_defaults.content_favorites, &entry))
                   {
                      enum playlist_sort_mode current_sort_mode =
                         playlist_get_sort_mode(g_defaults.content_favorites);
@@ -4440,9 +4440,8 @@ bool command_event(enum event_command cmd, void *data)
                      if (     (playlist_sort_alphabetical
                            && (current_sort_mode == PLAYLIST_SORT_MODE_DEFAULT))
                            || (current_sort_mode == PLAYLIST_SORT_MODE_ALPHABETICAL))
-                        playlist_qsort(g_defaults.content_favorites);
+                        command_playlist_sort_write(g_defaults.content_favorites);
 
-                     playlist_write_file(g_defaults.content_favorites);
                      runloop_msg_queue_push(
                            msg_hash_to_str(MSG_ADDED_TO_FAVORITES), 1, 180, true, NULL,
                            MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
@@ -5797,6 +5796,7 @@ void main_exit(void *args)
    retroarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free(p_rarch);
    task_queue_deinit();
+   playlist_journal_deinit();
 
    ui_companion_driver_deinit();
    retroarch_config_deinit();
@@ -5928,11 +5928,15 @@ int rarch_main(int argc, char *argv[], void *data)
    for (;;)
    {
       int ret;
+      retro_time_t frame_start;
       bool app_exit     = false;
 #ifdef HAVE_QT
       ui_companion_qt.application->process_events();
 #endif
-      ret = runloop_iterate();
+      frame_start = cpu_features_get_time_usec();
+      ret         = runloop_iterate();
+      task_queue_trace_event("frame", frame_start,
+            cpu_features_get_time_usec() - frame_start);
 
       task_queue_check();
 
@@ -7577,6 +7581,7 @@ bool retroarch_main_init(int argc, char *argv[])
 
    retroarch_validate_cpu_features();
    retroarch_init_task_queue();
+   playlist_journal_init();
 
    {
       const char    *fullpath  = path_get(RARCH_PATH_CONTENT);
@@ -336,17 +336,23 @@ typedef struct content_state
 
    content_file_override_t *content_override_list;
    content_file_list_t *content_list;
+   /* Content already resident in memory, handed over
+    * by content_set_memory_buffer() */
+   void *memory_content_data;
+   size_t memory_content_size;
 
    int pending_subsystem_rom_num;
    int pending_subsystem_id;
    unsigned pending_subsystem_rom_id;
    uint32_t rom_crc;
+   uint32_t memory_content_crc;
    uint8_t flags;
 
    char companion_ui_crc32[32];
    char pending_subsystem_ident[NAME_MAX_LENGTH];
    char pending_rom_crc_path[PATH_MAX_LENGTH];
    char companion_ui_db_name[PATH_MAX_LENGTH];
+   char memory_content_path[PATH_MAX_LENGTH];
 } content_state_t;
 
 RETRO_END_DECLS
@@ -17,18 +17,36 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
 
+/* Dirty page snapshots need write protection and
+ * a SIGSEGV handler that may touch it */
+#if defined(__linux__) && !defined(ANDROID)
+#define HAVE_RUNAHEAD_SNAPSHOT
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sched.h>
+#include <retro_atomic.h>
+#endif
+
 #include <encodings/utf.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
 #include <time/rtime.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "content.h"
 #include "core.h"
+#include "core_info.h"
 #include "dynamic.h"
 #include "driver.h"
 #include "audio/audio_driver.h"
@@ -37,19 +55,17 @@
 #include "runloop.h"
 #include "verbosity.h"
 
-static int16_t input_state_get_last(unsigned port,
+static int16_t input_list_get_state(my_list *list, unsigned port,
       unsigned device, unsigned index, unsigned id)
 {
-   runloop_state_t      *runloop_st = runloop_state_get_ptr();
-
-   if (runloop_st->input_state_list)
+   if (list)
    {
       int i;
       /* find list item */
-      for (i = 0; i < runloop_st->input_state_list->size; i++)
+      for (i = 0; i < list->size; i++)
       {
          input_list_element *element =
-            (input_list_element*)runloop_st->input_state_list->data[i];
+            (input_list_element*)list->data[i];
 
          if (     (element->port   == port)
                && (element->device == device)
@@ -65,6 +81,14 @@ static int16_t input_state_get_last(unsigned port,
    return 0;
 }
 
+static int16_t input_state_get_last(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   runloop_state_t      *runloop_st = runloop_state_get_ptr();
+   return input_list_get_state(runloop_st->input_state_list,
+         port, device, index, id);
+}
+
 static void free_retro_ctx_load_content_info(struct
       retro_ctx_load_content_info *dest)
 {
@@ -138,6 +162,127 @@ void runahead_set_load_content_info(void *data,
 }
 
 /* RUNAHEAD - SECONDARY CORE  */
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+#define HAVE_RUNAHEAD_SECONDARY_WORKER
+
+/* Secondary core worker
+ *
+ * While the input stays the same, the secondary core's visible frame
+ * does not depend on the primary core's frame, so it runs on a worker
+ * thread while the main thread runs the primary. The worker reads a
+ * copy of the last input taken before the primary polls, and its
+ * video is captured and presented by the main thread once both are
+ * done, in the same order as the serial path.
+ *
+ * If the primary's frame turns out to change the input, the serial
+ * path runs as before: it unserializes the primary's state into the
+ * secondary core, which discards what the worker did.
+ *
+ * Only software rendered cores run this way, since hardware frames
+ * belong to the video driver's context.
+ *
+ * The core's environment calls on the worker never reach the main
+ * thread's state:
+ *  - getters are answered from values the main thread took before
+ *    the job, once the core has been seen to use them; the first
+ *    use only records that and has the frame redone serially
+ *  - geometry, AV info, rotation, performance level, audio latency
+ *    and messages are queued, and replayed on the main thread when
+ *    the frame is presented
+ *  - anything else also has the frame redone serially, and the
+ *    worker is not used again until the core is reloaded */
+
+/* Getters the worker can answer, and whether the answer may
+ * change between frames (else it is taken once) */
+#define RUNAHEAD_SECONDARY_ENV_GETS 12
+
+static const struct
+{
+   unsigned cmd;
+   size_t size;
+   bool each_frame;
+} runahead_secondary_env_gets[RUNAHEAD_SECONDARY_ENV_GETS] = {
+   { RETRO_ENVIRONMENT_GET_OVERSCAN,              sizeof(bool),                       false },
+   { RETRO_ENVIRONMENT_GET_CAN_DUPE,              sizeof(bool),                       false },
+   { RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY,      sizeof(const char*),                false },
+   { RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY,        sizeof(const char*),                false },
+   { RETRO_ENVIRONMENT_GET_CORE_ASSETS_DIRECTORY, sizeof(const char*),                false },
+   { RETRO_ENVIRONMENT_GET_LIBRETRO_PATH,         sizeof(const char*),                false },
+   { RETRO_ENVIRONMENT_GET_LANGUAGE,              sizeof(unsigned),                   false },
+   { RETRO_ENVIRONMENT_GET_LOG_INTERFACE,         sizeof(struct retro_log_callback),  false },
+   { RETRO_ENVIRONMENT_GET_PERF_INTERFACE,        sizeof(struct retro_perf_callback), false },
+   { RETRO_ENVIRONMENT_GET_INPUT_BITMASKS,        0,                                  false },
+   { RETRO_ENVIRONMENT_GET_FASTFORWARDING,        sizeof(bool),                       true  },
+   { RETRO_ENVIRONMENT_GET_TARGET_REFRESH_RATE,   sizeof(float),                      true  }
+};
+
+typedef union runahead_secondary_env_value
+{
+   struct retro_log_callback log;
+   struct retro_perf_callback perf;
+   const char *str;
+   unsigned u;
+   float f;
+   bool b;
+} runahead_secondary_env_value_t;
+
+/* Calls queued for the main thread */
+#define RUNAHEAD_SECONDARY_ENV_CALLS 16
+
+typedef struct runahead_secondary_env_call
+{
+   union
+   {
+      struct retro_game_geometry geometry;
+      struct retro_system_av_info av_info;
+      struct retro_message msg;
+      struct retro_message_ext msg_ext;
+      unsigned u;
+   } data;
+   char *msg;                 /* copy of the message text */
+   unsigned cmd;
+} runahead_secondary_env_call_t;
+
+typedef struct runahead_secondary_worker
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   my_list *input_state_list; /* the last input, as of the job */
+   uint8_t *frame;
+   size_t frame_capacity;
+   size_t frame_pitch;
+   unsigned frame_width;
+   unsigned frame_height;
+   unsigned cores;
+   runahead_secondary_env_value_t env_values[RUNAHEAD_SECONDARY_ENV_GETS];
+   runahead_secondary_env_call_t env_calls[RUNAHEAD_SECONDARY_ENV_CALLS];
+   const char **var_keys;     /* core options, as of the job */
+   const char **var_values;
+   size_t num_vars;
+   size_t var_capacity;
+   unsigned num_env_calls;
+   unsigned env_unsupported;  /* call that ruled the worker out */
+   bool env_results[RUNAHEAD_SECONDARY_ENV_GETS];
+   bool env_wanted[RUNAHEAD_SECONDARY_ENV_GETS];
+   bool env_taken[RUNAHEAD_SECONDARY_ENV_GETS];
+   bool vars_wanted;
+   bool env_failed;           /* a call has to be redone serially */
+   bool disabled;
+   bool frame_valid;          /* the core submitted a frame */
+   bool frame_dupe;           /* ...and it was a dupe (NULL data) */
+   bool frame_failed;         /* ...and it could not be captured */
+   bool job_pending;
+   bool running;              /* the worker owns the secondary core */
+   bool quit;
+} runahead_secondary_worker_t;
+
+static runahead_secondary_worker_t runahead_secondary_worker_st;
+
+static void runahead_secondary_worker_free(void);
+static bool runahead_secondary_worker_environment(unsigned cmd, void *data);
+#endif
+
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
 static void strcat_alloc(char **dst, const char *s)
 {
@@ -180,6 +325,9 @@ static void strcat_alloc(char **dst, const char *s)
 void runahead_secondary_core_destroy(void *data)
 {
    runloop_state_t *runloop_st      = (runloop_state_t*)data;
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+   runahead_secondary_worker_free();
+#endif
    if (!runloop_st->secondary_lib_handle)
       return;
 
@@ -393,7 +541,16 @@ static bool runloop_environment_secondary_core_hook(
       unsigned cmd, void *data)
 {
    runloop_state_t *runloop_st    = runloop_state_get_ptr();
-   bool result                    = runloop_environment_cb(cmd, data);
+   bool result;
+
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+   /* On the worker thread, stay off state the main thread
+    * is using */
+   if (runahead_secondary_worker_st.running)
+      return runahead_secondary_worker_environment(cmd, data);
+#endif
+
+   result                         = runloop_environment_cb(cmd, data);
 
    if (runloop_st->flags & RUNLOOP_FLAG_HAS_VARIABLE_UPDATE)
    {
@@ -1012,11 +1169,420 @@ static void runahead_add_hooks(runloop_state_t *runloop_st)
    runahead_add_input_state_hook(runloop_st);
 }
 
+#ifdef HAVE_RUNAHEAD_SNAPSHOT
+/* Dirty page snapshots
+ *
+ * Cores whose info file declares savestate_features = "snapshot"
+ * keep all of their emulated state in the writable regions they
+ * expose with RETRO_ENVIRONMENT_SET_MEMORY_MAPS. For those, the
+ * single instance runahead loop keeps a shadow copy of the regions
+ * instead of a serialized state, and write-protects them. The first
+ * write to a page after a save or load faults; the handler marks the
+ * page dirty and makes it writable again. Saving then copies only
+ * the dirty pages into the shadow, loading copies only the dirty
+ * pages back, and both protect them again.
+ *
+ * Pages only partly covered by a region are shared with whatever
+ * the core allocated next to it, so they are never protected and
+ * the covered bytes are copied every time.
+ *
+ * The kernel does not go through the handler: a system call that
+ * writes into a protected page (a read() straight into core RAM,
+ * say) fails with EFAULT instead of marking the page dirty. Cores
+ * may only opt in if nothing but their own code writes to the
+ * regions; see CORE_INFO_SAVESTATE_SNAPSHOT.
+ *
+ * A fault is far more expensive than copying a page, so a core that
+ * dirties most of its memory every frame is better off serializing.
+ * Both costs are measured when the snapshot is set up, and once a
+ * window of frames shows the snapshot losing, runahead goes back
+ * to serializing for the rest of the session. */
+
+/* Frames between comparing snapshot and serialize costs */
+#define RUNAHEAD_SNAPSHOT_WINDOW 60
+
+typedef struct runahead_snapshot_region
+{
+   uint8_t *ptr;
+   uint8_t *prot;   /* first page fully inside the region */
+   uint8_t *shadow;
+   uint8_t *dirty;  /* one byte per protected page */
+   size_t len;
+   size_t pages;    /* protected pages from 'prot' on */
+} runahead_snapshot_region_t;
+
+typedef struct runahead_snapshot
+{
+   runahead_snapshot_region_t *regions;
+   /* The memory maps the regions were built from */
+   const rarch_memory_descriptor_t *descriptors;
+   struct sigaction old_action;
+   size_t page_size;
+   retro_time_t serialize_usec; /* save + load by serializing */
+   retro_time_t window_usec;    /* spent syncing in this window */
+   uint64_t window_pages;       /* pages synced, i.e. faults taken */
+   unsigned fault_nsec;
+   unsigned window_frames;
+   unsigned num_regions;
+   unsigned num_descriptors;
+   /* Handlers running, and whether they may touch 'regions';
+    * deinit waits for the former after clearing the latter */
+   retro_atomic_uint_t faults_in_flight;
+   retro_atomic_uint_t active;
+   bool handler_installed;
+   bool unavailable;
+} runahead_snapshot_t;
+
+static runahead_snapshot_t runahead_snapshot_st;
+
+static void runahead_snapshot_fault(int sig, siginfo_t *info, void *ctx)
+{
+   runahead_snapshot_t *snap = &runahead_snapshot_st;
+   uint8_t *addr             = (uint8_t*)info->si_addr;
+   struct sigaction old_action;
+   unsigned i;
+
+   retro_atomic_fetch_add(&snap->faults_in_flight, 1);
+   retro_atomic_fence();
+
+   /* Being torn down: the old handler is back or about to be,
+    * and the pages are being unprotected, so just retry */
+   if (!retro_atomic_load_acquire(&snap->active))
+   {
+      retro_atomic_fetch_add(&snap->faults_in_flight, (uint32_t)-1);
+      return;
+   }
+
+   for (i = 0; i < snap->num_regions; i++)
+   {
+      runahead_snapshot_region_t *region = &snap->regions[i];
+
+      if (     (addr >= region->prot)
+            && (addr <  region->prot + region->pages * snap->page_size))
+      {
+         size_t page         = (size_t)(addr - region->prot)
+            / snap->page_size;
+         region->dirty[page] = 1;
+         if (mprotect(region->prot + page * snap->page_size,
+                  snap->page_size, PROT_READ | PROT_WRITE) == 0)
+         {
+            retro_atomic_fetch_add(&snap->faults_in_flight, (uint32_t)-1);
+            return;
+         }
+         break;
+      }
+   }
+
+   /* Not ours, hand it on. The old handler may never return,
+    * so stop counting before calling it. */
+   old_action = snap->old_action;
+   retro_atomic_fetch_add(&snap->faults_in_flight, (uint32_t)-1);
+
+   if (old_action.sa_flags & SA_SIGINFO)
+   {
+      if (old_action.sa_sigaction)
+      {
+         old_action.sa_sigaction(sig, info, ctx);
+         return;
+      }
+   }
+   else if (   (old_action.sa_handler != SIG_DFL)
+            && (old_action.sa_handler != SIG_IGN))
+   {
+      old_action.sa_handler(sig);
+      return;
+   }
+
+   /* The faulting access is retried on return and
+    * now crashes the way it would have without us */
+   signal(sig, SIG_DFL);
+}
+
+static int runahead_snapshot_region_cmp(const void *a, const void *b)
+{
+   const runahead_snapshot_region_t *ra = (const runahead_snapshot_region_t*)a;
+   const runahead_snapshot_region_t *rb = (const runahead_snapshot_region_t*)b;
+   if (ra->ptr < rb->ptr)
+      return -1;
+   return (ra->ptr > rb->ptr) ? 1 : 0;
+}
+
+static void runahead_snapshot_deinit(void)
+{
+   runahead_snapshot_t *snap = &runahead_snapshot_st;
+   unsigned i;
+
+   /* A core thread may be faulting right now, so nothing is
+    * freed until the handler is gone, no page can fault any
+    * more and every handler already running has returned */
+   retro_atomic_store_release(&snap->active, 0);
+   retro_atomic_fence();
+
+   if (snap->handler_installed)
+      sigaction(SIGSEGV, &snap->old_action, NULL);
+
+   for (i = 0; i < snap->num_regions; i++)
+   {
+      runahead_snapshot_region_t *region = &snap->regions[i];
+      if (region->pages)
+         mprotect(region->prot, region->pages * snap->page_size,
+               PROT_READ | PROT_WRITE);
+   }
+
+   while (retro_atomic_load_acquire(&snap->faults_in_flight))
+      sched_yield();
+
+   for (i = 0; i < snap->num_regions; i++)
+   {
+      free(snap->regions[i].shadow);
+      free(snap->regions[i].dirty);
+   }
+   free(snap->regions);
+
+   memset(snap, 0, sizeof(*snap));
+}
+
+static bool runahead_snapshot_init(runloop_state_t *runloop_st)
+{
+   unsigned i, j;
+   struct sigaction action;
+   runahead_snapshot_t *snap       = &runahead_snapshot_st;
+   const rarch_memory_map_t *mmaps = &runloop_st->system.mmaps;
+   long page_size                  = sysconf(_SC_PAGESIZE);
+   size_t total                    = 0;
+   size_t protected_pages          = 0;
+   unsigned count                  = 0;
+
+   if (!mmaps->num_descriptors || page_size <= 0)
+      return false;
+
+   if (!(snap->regions = (runahead_snapshot_region_t*)calloc(
+               mmaps->num_descriptors, sizeof(*snap->regions))))
+      return false;
+
+   snap->page_size       = (size_t)page_size;
+   snap->descriptors     = mmaps->descriptors;
+   snap->num_descriptors = mmaps->num_descriptors;
+
+   for (i = 0; i < mmaps->num_descriptors; i++)
+   {
+      const struct retro_memory_descriptor *desc =
+         &mmaps->descriptors[i].core;
+      if (     (desc->flags & RETRO_MEMDESC_CONST)
+            || !desc->ptr
+            || !desc->len)
+         continue;
+      snap->regions[count].ptr = (uint8_t*)desc->ptr + desc->offset;
+      snap->regions[count].len = desc->len;
+      count++;
+   }
+
+   if (!count)
+      goto error;
+
+   /* Mirrors and overlapping descriptors become one region */
+   qsort(snap->regions, count, sizeof(*snap->regions),
+         runahead_snapshot_region_cmp);
+   for (i = 1, j = 0; i < count; i++)
+   {
+      runahead_snapshot_region_t *last = &snap->regions[j];
+      if (snap->regions[i].ptr <= last->ptr + last->len)
+      {
+         uint8_t *end = snap->regions[i].ptr + snap->regions[i].len;
+         if (end > last->ptr + last->len)
+            last->len = end - last->ptr;
+      }
+      else
+         snap->regions[++j] = snap->regions[i];
+   }
+   snap->num_regions = j + 1;
+
+   for (i = 0; i < snap->num_regions; i++)
+   {
+      runahead_snapshot_region_t *region = &snap->regions[i];
+      uintptr_t start = ((uintptr_t)region->ptr + snap->page_size - 1)
+         & ~(uintptr_t)(snap->page_size - 1);
+      uintptr_t end   = ((uintptr_t)region->ptr + region->len)
+         & ~(uintptr_t)(snap->page_size - 1);
+
+      if (end > start)
+      {
+         region->prot  = (uint8_t*)start;
+         region->pages = (end - start) / snap->page_size;
+      }
+      else
+      {
+         region->prot  = region->ptr + region->len;
+         region->pages = 0;
+      }
+
+      region->shadow = (uint8_t*)malloc(region->len);
+      region->dirty  = (uint8_t*)calloc(region->pages + 1, 1);
+      if (!region->shadow || !region->dirty)
+         goto error;
+      memcpy(region->shadow, region->ptr, region->len);
+
+      total           += region->len;
+      protected_pages += region->pages;
+   }
+
+   if (!protected_pages)
+      goto error;
+
+   /* What runahead would pay to serialize instead, counting
+    * unserializing as the same again. Best of a few, since the
+    * first call may still be warming up. */
+   for (i = 0; i < 3; i++)
+   {
+      retro_ctx_serialize_info_t *serialize_info =
+         (retro_ctx_serialize_info_t*)
+         runloop_st->runahead_save_state_list->data[0];
+      retro_time_t t = cpu_features_get_time_usec();
+      if (!core_serialize_special(serialize_info))
+         goto error;
+      t = 2 * (cpu_features_get_time_usec() - t);
+      if (!i || t < snap->serialize_usec)
+         snap->serialize_usec = t;
+   }
+
+   memset(&action, 0, sizeof(action));
+   action.sa_sigaction = runahead_snapshot_fault;
+   action.sa_flags     = SA_SIGINFO | SA_RESTART;
+   sigemptyset(&action.sa_mask);
+   retro_atomic_store_release(&snap->active, 1);
+   if (sigaction(SIGSEGV, &action, &snap->old_action) != 0)
+      goto error;
+   snap->handler_installed = true;
+
+   for (i = 0; i < snap->num_regions; i++)
+   {
+      runahead_snapshot_region_t *region = &snap->regions[i];
+      if (     region->pages
+            && mprotect(region->prot, region->pages * snap->page_size,
+               PROT_READ) != 0)
+         goto error;
+   }
+
+   /* Time a few faults by rewriting protected bytes with
+    * their own value; that changes nothing, so the pages can
+    * go straight back to clean */
+   for (i = 0, j = 0; i < snap->num_regions; i++)
+      if (snap->regions[i].pages > snap->regions[j].pages)
+         j = i;
+   {
+      runahead_snapshot_region_t *region = &snap->regions[j];
+      volatile uint8_t *mem              = region->prot;
+      size_t n                           = region->pages < 16
+         ? region->pages : 16;
+      size_t k;
+      retro_time_t t                     = cpu_features_get_time_usec();
+      for (k = 0; k < n; k++)
+         mem[k * snap->page_size] = mem[k * snap->page_size];
+      t                                  = cpu_features_get_time_usec() - t;
+      memset(region->dirty, 0, n);
+      mprotect(region->prot, n * snap->page_size, PROT_READ);
+      snap->fault_nsec                   = (unsigned)(t * 1000 / n);
+   }
+
+   RARCH_LOG("[Run-Ahead]: Snapshotting %u memory region(s), %u KB, "
+         "%u write-protected page(s); a fault costs %u ns, "
+         "serializing %u us.\n",
+         snap->num_regions, (unsigned)(total / 1024),
+         (unsigned)protected_pages, snap->fault_nsec,
+         (unsigned)snap->serialize_usec);
+   return true;
+
+error:
+   runahead_snapshot_deinit();
+   return false;
+}
+
+/* Copies the dirty pages of @region into the shadow (@save)
+ * or back out of it, then write-protects them again */
+static size_t runahead_snapshot_sync(runahead_snapshot_t *snap,
+      runahead_snapshot_region_t *region, bool save)
+{
+   uint8_t *tail  = region->prot + region->pages * snap->page_size;
+   size_t head    = region->prot - region->ptr;
+   size_t page    = 0;
+   size_t synced  = 0;
+
+   if (save)
+   {
+      memcpy(region->shadow, region->ptr, head);
+      memcpy(region->shadow + (tail - region->ptr), tail,
+            region->ptr + region->len - tail);
+   }
+   else
+   {
+      memcpy(region->ptr, region->shadow, head);
+      memcpy(tail, region->shadow + (tail - region->ptr),
+            region->ptr + region->len - tail);
+   }
+
+   while (page < region->pages)
+   {
+      uint8_t *mem;
+      uint8_t *shadow;
+      size_t len;
+      size_t run = page;
+
+      if (!region->dirty[page])
+      {
+         page++;
+         continue;
+      }
+
+      while (run < region->pages && region->dirty[run])
+         region->dirty[run++] = 0;
+
+      mem    = region->prot + page * snap->page_size;
+      shadow = region->shadow + (mem - region->ptr);
+      len    = (run - page) * snap->page_size;
+
+      if (save)
+         memcpy(shadow, mem, len);
+      else
+         memcpy(mem, shadow, len);
+      synced += run - page;
+      page    = run;
+   }
+
+   /* One call for the whole region: cheaper than one per run,
+    * and it merges the mappings the faults split up */
+   if (synced)
+      mprotect(region->prot, region->pages * snap->page_size, PROT_READ);
+   return synced;
+}
+
+static void runahead_snapshot_sync_all(runahead_snapshot_t *snap,
+      bool save)
+{
+   unsigned i;
+   retro_time_t t = cpu_features_get_time_usec();
+   for (i = 0; i < snap->num_regions; i++)
+      snap->window_pages += runahead_snapshot_sync(snap,
+            &snap->regions[i], save);
+   snap->window_usec += cpu_features_get_time_usec() - t;
+}
+
+static bool runahead_snapshot_changed(runloop_state_t *runloop_st)
+{
+   return runahead_snapshot_st.descriptors
+         != runloop_st->system.mmaps.descriptors
+       || runahead_snapshot_st.num_descriptors
+         != runloop_st->system.mmaps.num_descriptors;
+}
+#endif
+
 /* Runahead Code */
 
 static void runahead_error(runloop_state_t *runloop_st)
 {
    runloop_st->flags &= ~RUNLOOP_FLAG_RUNAHEAD_AVAILABLE;
+#ifdef HAVE_RUNAHEAD_SNAPSHOT
+   runahead_snapshot_deinit();
+#endif
    mylist_destroy(&runloop_st->runahead_save_state_list);
    runahead_remove_hooks(runloop_st);
    runloop_st->runahead_save_state_size       = 0;
@@ -1104,6 +1670,525 @@ static bool runahead_load_state_secondary(runloop_state_t *runloop_st, settings_
 }
 #endif
 
+static bool runahead_save_state_snapshot(runloop_state_t *runloop_st)
+{
+#ifdef HAVE_RUNAHEAD_SNAPSHOT
+   runahead_snapshot_t *snap = &runahead_snapshot_st;
+
+   /* The core replaced its memory maps */
+   if (snap->num_regions && runahead_snapshot_changed(runloop_st))
+      runahead_snapshot_deinit();
+
+   if (!snap->num_regions && !snap->unavailable)
+   {
+      if (     !core_info_current_supports_runahead_snapshot()
+            || !runahead_snapshot_init(runloop_st))
+         snap->unavailable = true;
+   }
+
+   if (snap->num_regions)
+   {
+      runahead_snapshot_sync_all(snap, true);
+      return true;
+   }
+#endif
+   return runahead_save_state(runloop_st);
+}
+
+static bool runahead_load_state_snapshot(runloop_state_t *runloop_st)
+{
+#ifdef HAVE_RUNAHEAD_SNAPSHOT
+   runahead_snapshot_t *snap = &runahead_snapshot_st;
+
+   if (snap->num_regions)
+   {
+      /* The regions saved from are gone */
+      if (runahead_snapshot_changed(runloop_st))
+      {
+         runahead_snapshot_deinit();
+         runahead_error(runloop_st);
+         return false;
+      }
+
+      runahead_snapshot_sync_all(snap, false);
+
+      if (++snap->window_frames >= RUNAHEAD_SNAPSHOT_WINDOW)
+      {
+         retro_time_t cost = (snap->window_usec
+               + (retro_time_t)(snap->window_pages
+                  * snap->fault_nsec / 1000))
+            / snap->window_frames;
+
+         if (cost > snap->serialize_usec)
+         {
+            RARCH_LOG("[Run-Ahead]: Snapshots cost %u us per frame, "
+                  "serializing %u us. Serializing instead.\n",
+                  (unsigned)cost, (unsigned)snap->serialize_usec);
+            runahead_snapshot_deinit();
+            snap->unavailable = true;
+         }
+         else
+         {
+            snap->window_usec   = 0;
+            snap->window_pages  = 0;
+            snap->window_frames = 0;
+         }
+      }
+      return true;
+   }
+#endif
+   return runahead_load_state(runloop_st);
+}
+
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+static void runahead_secondary_worker_video_cb(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+   size_t size                         = pitch * height;
+
+   worker->frame_valid  = true;
+   worker->frame_dupe   = !data;
+   worker->frame_width  = width;
+   worker->frame_height = height;
+   worker->frame_pitch  = pitch;
+
+   if (!data)
+      return;
+
+   if (data == RETRO_HW_FRAME_BUFFER_VALID)
+   {
+      worker->frame_failed = true;
+      return;
+   }
+
+   if (size > worker->frame_capacity)
+   {
+      uint8_t *frame = (uint8_t*)realloc(worker->frame, size);
+      if (!frame)
+      {
+         worker->frame_failed = true;
+         return;
+      }
+      worker->frame          = frame;
+      worker->frame_capacity = size;
+   }
+   memcpy(worker->frame, data, size);
+}
+
+static void runahead_secondary_worker_audio_sample(
+      int16_t left, int16_t right) { }
+
+static size_t runahead_secondary_worker_audio_sample_batch(
+      const int16_t *data, size_t frames) { return frames; }
+
+static int16_t runahead_secondary_worker_input_state(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   return input_list_get_state(
+         runahead_secondary_worker_st.input_state_list,
+         port, device, index, id);
+}
+
+/* Queues a state changing call for the main thread.
+ * Returns false if it has to be redone serially. */
+static bool runahead_secondary_worker_defer(
+      runahead_secondary_worker_t *worker, unsigned cmd, const void *data)
+{
+   runahead_secondary_env_call_t *call;
+
+   if (!data || worker->num_env_calls >= RUNAHEAD_SECONDARY_ENV_CALLS)
+      return false;
+
+   call      = &worker->env_calls[worker->num_env_calls];
+   call->cmd = cmd;
+   call->msg = NULL;
+
+   switch (cmd)
+   {
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+         call->data.geometry = *(const struct retro_game_geometry*)data;
+         break;
+      case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+         call->data.av_info  = *(const struct retro_system_av_info*)data;
+         break;
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+         call->data.msg      = *(const struct retro_message*)data;
+         if (     call->data.msg.msg
+               && !(call->msg = strdup(call->data.msg.msg)))
+            return false;
+         call->data.msg.msg  = call->msg;
+         break;
+      case RETRO_ENVIRONMENT_SET_MESSAGE_EXT:
+         call->data.msg_ext  = *(const struct retro_message_ext*)data;
+         if (     call->data.msg_ext.msg
+               && !(call->msg = strdup(call->data.msg_ext.msg)))
+            return false;
+         call->data.msg_ext.msg = call->msg;
+         break;
+      default:
+         call->data.u        = *(const unsigned*)data;
+         break;
+   }
+
+   worker->num_env_calls++;
+   return true;
+}
+
+/* Environment callback of the secondary core on the worker */
+static bool runahead_secondary_worker_environment(unsigned cmd, void *data)
+{
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+   unsigned i;
+
+   switch (cmd)
+   {
+      /* Jobs are only started with no variable update
+       * pending, which is what the serial path sees */
+      case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+         if (data)
+            *(bool*)data = false;
+         return true;
+      case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+         return false;
+      case RETRO_ENVIRONMENT_GET_VARIABLE:
+         if (worker->vars_wanted)
+         {
+            struct retro_variable *var = (struct retro_variable*)data;
+            if (!var)
+               return true;
+            var->value = NULL;
+            for (i = 0; i < worker->num_vars; i++)
+            {
+               if (string_is_equal(worker->var_keys[i], var->key))
+               {
+                  var->value = worker->var_values[i];
+                  break;
+               }
+            }
+            return true;
+         }
+         worker->vars_wanted = true;
+         break;
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+      case RETRO_ENVIRONMENT_SET_ROTATION:
+      case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+      case RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY:
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+      case RETRO_ENVIRONMENT_SET_MESSAGE_EXT:
+         if (runahead_secondary_worker_defer(worker, cmd, data))
+            return true;
+         break;
+      default:
+         for (i = 0; i < RUNAHEAD_SECONDARY_ENV_GETS; i++)
+         {
+            if (runahead_secondary_env_gets[i].cmd != cmd)
+               continue;
+            if (!worker->env_wanted[i])
+            {
+               worker->env_wanted[i] = true;
+               break;
+            }
+            if (data)
+               memcpy(data, &worker->env_values[i],
+                     runahead_secondary_env_gets[i].size);
+            return worker->env_results[i];
+         }
+         if (i == RUNAHEAD_SECONDARY_ENV_GETS)
+            worker->env_unsupported = cmd;
+         break;
+   }
+
+   worker->env_failed = true;
+   return false;
+}
+
+/* Takes the answers the worker may need on the main thread */
+static bool runahead_secondary_worker_take_env(runloop_state_t *runloop_st)
+{
+   unsigned i;
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+
+   for (i = 0; i < RUNAHEAD_SECONDARY_ENV_GETS; i++)
+   {
+      if (     !worker->env_wanted[i]
+            || (worker->env_taken[i]
+               && !runahead_secondary_env_gets[i].each_frame))
+         continue;
+      memset(&worker->env_values[i], 0, sizeof(worker->env_values[i]));
+      worker->env_results[i] = runloop_environment_cb(
+            runahead_secondary_env_gets[i].cmd, &worker->env_values[i]);
+      worker->env_taken[i]   = true;
+   }
+
+   if (worker->vars_wanted)
+   {
+      core_option_manager_t *opts = runloop_st->core_options;
+      size_t size                 = opts ? opts->size : 0;
+
+      if (size > worker->var_capacity)
+      {
+         const char **keys   = (const char**)realloc(
+               (void*)worker->var_keys, size * sizeof(*keys));
+         const char **values = NULL;
+         if (keys)
+         {
+            worker->var_keys = keys;
+            values           = (const char**)realloc(
+                  (void*)worker->var_values, size * sizeof(*values));
+         }
+         if (!values)
+            return false;
+         worker->var_values   = values;
+         worker->var_capacity = size;
+      }
+
+      /* The strings belong to the option manager,
+       * as do the ones GET_VARIABLE hands out */
+      for (i = 0; i < size; i++)
+      {
+         worker->var_keys[i]   = opts->opts[i].key;
+         worker->var_values[i] = core_option_manager_get_val(opts, i);
+      }
+      worker->num_vars = size;
+   }
+
+   return true;
+}
+
+static void runahead_secondary_worker_drop_env_calls(
+      runahead_secondary_worker_t *worker)
+{
+   unsigned i;
+   for (i = 0; i < worker->num_env_calls; i++)
+      free(worker->env_calls[i].msg);
+   worker->num_env_calls = 0;
+}
+
+static void runahead_secondary_worker_thread(void *data)
+{
+   runloop_state_t *runloop_st         = (runloop_state_t*)data;
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+
+   slock_lock(worker->lock);
+   for (;;)
+   {
+      while (!worker->job_pending && !worker->quit)
+         scond_wait(worker->cond, worker->lock);
+      if (worker->quit)
+         break;
+      slock_unlock(worker->lock);
+
+      runloop_st->secondary_core.retro_run();
+
+      slock_lock(worker->lock);
+      worker->job_pending = false;
+      scond_signal(worker->cond);
+   }
+   slock_unlock(worker->lock);
+}
+
+static void runahead_secondary_worker_free(void)
+{
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+
+   if (worker->thread)
+   {
+      slock_lock(worker->lock);
+      worker->quit = true;
+      scond_signal(worker->cond);
+      slock_unlock(worker->lock);
+      sthread_join(worker->thread);
+   }
+   if (worker->lock)
+      slock_free(worker->lock);
+   if (worker->cond)
+      scond_free(worker->cond);
+   mylist_destroy(&worker->input_state_list);
+   runahead_secondary_worker_drop_env_calls(worker);
+   free((void*)worker->var_keys);
+   free((void*)worker->var_values);
+   free(worker->frame);
+
+   memset(worker, 0, sizeof(*worker));
+}
+
+static bool runahead_secondary_worker_init(runloop_state_t *runloop_st)
+{
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+
+   if (worker->thread)
+      return true;
+
+   /* Only worth it with a core to spare */
+   if (!worker->cores)
+      worker->cores = cpu_features_get_core_amount();
+   if (worker->cores < 2)
+      return false;
+
+   if (     !(worker->lock   = slock_new())
+         || !(worker->cond   = scond_new())
+         || !(worker->thread = sthread_create(
+               runahead_secondary_worker_thread, runloop_st)))
+   {
+      runahead_secondary_worker_free();
+      /* Don't try again every frame */
+      worker->cores = 1;
+      return false;
+   }
+
+   RARCH_LOG("[Run-Ahead]: Running the secondary instance "
+         "on a worker thread.\n");
+   return true;
+}
+
+/* Copies the last input for the worker to read */
+static void runahead_secondary_worker_copy_input(
+      runloop_state_t *runloop_st)
+{
+   int i;
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+   my_list *src                        = runloop_st->input_state_list;
+
+   if (!worker->input_state_list)
+      mylist_create(&worker->input_state_list, 16,
+            input_list_element_constructor,
+            input_list_element_destructor);
+
+   mylist_resize(worker->input_state_list, src ? src->size : 0, true);
+
+   for (i = 0; i < worker->input_state_list->size; i++)
+   {
+      input_list_element *from = (input_list_element*)src->data[i];
+      input_list_element *to   = (input_list_element*)
+         worker->input_state_list->data[i];
+
+      to->port   = from->port;
+      to->device = from->device;
+      to->index  = from->index;
+      input_list_element_realloc(to, from->state_size);
+      memcpy(to->state, from->state,
+            from->state_size * sizeof(int16_t));
+      if (to->state_size > from->state_size)
+         memset(&to->state[from->state_size], 0,
+               (to->state_size - from->state_size) * sizeof(int16_t));
+   }
+}
+
+/**
+ * runahead_secondary_worker_start:
+ *
+ * Starts the secondary core's next visible frame on the worker,
+ * if nothing rules out running it alongside the primary core.
+ * Must be followed by runahead_secondary_worker_wait().
+ *
+ * Returns: true if the frame was started.
+ **/
+static bool runahead_secondary_worker_start(runloop_state_t *runloop_st)
+{
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+   struct retro_core_t *core           = &runloop_st->secondary_core;
+
+   /* Input already known to be dirty, so the frame would be
+    * thrown away, or something the worker cannot reproduce */
+   if (     worker->disabled
+         || (runloop_st->flags & RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY)
+         || (runloop_st->flags & RUNLOOP_FLAG_HAS_VARIABLE_UPDATE)
+         || (runloop_st->core_options && runloop_st->core_options->updated)
+         || video_driver_is_hw_context())
+      return false;
+
+   if (!runahead_secondary_worker_init(runloop_st))
+      return false;
+
+   /* Calls of a frame that was redone serially */
+   runahead_secondary_worker_drop_env_calls(worker);
+   if (!runahead_secondary_worker_take_env(runloop_st))
+      return false;
+
+   runahead_secondary_worker_copy_input(runloop_st);
+
+   worker->env_failed   = false;
+   worker->frame_valid  = false;
+   worker->frame_dupe   = false;
+   worker->frame_failed = false;
+
+   core->retro_set_video_refresh(runahead_secondary_worker_video_cb);
+   core->retro_set_audio_sample(runahead_secondary_worker_audio_sample);
+   core->retro_set_audio_sample_batch(
+         runahead_secondary_worker_audio_sample_batch);
+   core->retro_set_input_poll(secondary_core_input_poll_null);
+   core->retro_set_input_state(runahead_secondary_worker_input_state);
+
+   worker->running      = true;
+   slock_lock(worker->lock);
+   worker->job_pending  = true;
+   scond_signal(worker->cond);
+   slock_unlock(worker->lock);
+   return true;
+}
+
+/**
+ * runahead_secondary_worker_wait:
+ *
+ * Waits for the frame started by runahead_secondary_worker_start()
+ * and gives the secondary core back its usual callbacks.
+ *
+ * Returns: false if the frame it produced cannot be presented.
+ **/
+static bool runahead_secondary_worker_wait(runloop_state_t *runloop_st)
+{
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+   struct retro_callbacks *cbs         = &runloop_st->secondary_callbacks;
+   struct retro_core_t *core           = &runloop_st->secondary_core;
+
+   slock_lock(worker->lock);
+   while (worker->job_pending)
+      scond_wait(worker->cond, worker->lock);
+   slock_unlock(worker->lock);
+   worker->running = false;
+
+   core->retro_set_video_refresh(cbs->frame_cb);
+   core->retro_set_audio_sample(cbs->sample_cb);
+   core->retro_set_audio_sample_batch(cbs->sample_batch_cb);
+   core->retro_set_input_poll(cbs->poll_cb);
+   core->retro_set_input_state(cbs->state_cb);
+
+   if (worker->env_unsupported)
+   {
+      RARCH_LOG("[Run-Ahead]: Secondary instance made environment "
+            "call %u, which has to run on the main thread. "
+            "No longer using the worker thread.\n",
+            worker->env_unsupported);
+      worker->env_unsupported = 0;
+      worker->disabled        = true;
+   }
+
+   return !worker->frame_failed && !worker->env_failed;
+}
+
+/* Replays the core's queued environment calls and presents
+ * the frame captured by the worker, as the secondary core
+ * would have in the serial path */
+static void runahead_secondary_worker_present(runloop_state_t *runloop_st)
+{
+   unsigned i;
+   runahead_secondary_worker_t *worker = &runahead_secondary_worker_st;
+
+   for (i = 0; i < worker->num_env_calls; i++)
+      runloop_environment_cb(worker->env_calls[i].cmd,
+            &worker->env_calls[i].data);
+   runahead_secondary_worker_drop_env_calls(worker);
+
+   if (worker->frame_valid)
+      runloop_st->secondary_callbacks.frame_cb(
+            worker->frame_dupe ? NULL : worker->frame,
+            worker->frame_width, worker->frame_height,
+            worker->frame_pitch);
+}
+#endif
+
 static void runahead_core_run_use_last_input(runloop_state_t *runloop_st)
 {
    struct retro_callbacks *cbs            = &runloop_st->retro_ctx;
@@ -1224,7 +2309,7 @@ void runahead_run(void *data,
 
          if (frame_number == 0)
          {
-            if (!runahead_save_state(runloop_st))
+            if (!runahead_save_state_snapshot(runloop_st))
             {
                const char *runahead_failed_str =
                   msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE);
@@ -1236,7 +2321,7 @@ void runahead_run(void *data,
 
          if (last_frame)
          {
-            if (!runahead_load_state(runloop_st))
+            if (!runahead_load_state_snapshot(runloop_st))
             {
                const char *runahead_failed_str =
                   msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE);
@@ -1250,6 +2335,10 @@ void runahead_run(void *data,
    else
    {
 #if HAVE_DYNAMIC
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+      bool speculated = false;
+#endif
+
       if (!secondary_core_ensure_exists(runloop_st, config_get_ptr()))
       {
          const char *runahead_failed_str =
@@ -1261,6 +2350,12 @@ void runahead_run(void *data,
          goto force_input_dirty;
       }
 
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+      /* Assume the input stays the same and run the
+       * secondary core's frame alongside the primary's */
+      speculated = runahead_secondary_worker_start(runloop_st);
+#endif
+
       /* run main core with video suspended */
       video_st->flags &= ~VIDEO_FLAG_ACTIVE;
       core_run();
@@ -1269,10 +2364,20 @@ void runahead_run(void *data,
       else
          video_st->flags &= ~VIDEO_FLAG_ACTIVE;
 
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+      /* A frame that cannot be presented is
+       * redone from the primary's state */
+      if (speculated && !runahead_secondary_worker_wait(runloop_st))
+         runloop_st->flags |= RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY;
+#endif
+
       if (     (runloop_st->flags & RUNLOOP_FLAG_INPUT_IS_DIRTY)
             || (runloop_st->flags & RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY))
       {
          runloop_st->flags &= ~RUNLOOP_FLAG_INPUT_IS_DIRTY;
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+         speculated         = false;
+#endif
 
          if (!runahead_save_state(runloop_st))
          {
@@ -1309,14 +2414,21 @@ void runahead_run(void *data,
                video_st->flags          &= ~VIDEO_FLAG_ACTIVE;
          }
       }
-      audio_st->flags                   |= AUDIO_FLAG_SUSPENDED
-                                         | AUDIO_FLAG_HARD_DISABLE;
-      if (secondary_core_run_use_last_input(runloop_st))
-         runloop_st->flags              |=  RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE;
+#ifdef HAVE_RUNAHEAD_SECONDARY_WORKER
+      if (speculated)
+         runahead_secondary_worker_present(runloop_st);
       else
-         runloop_st->flags              &= ~RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE;
-      audio_st->flags                   &= ~(AUDIO_FLAG_SUSPENDED
+#endif
+      {
+         audio_st->flags                |= AUDIO_FLAG_SUSPENDED
+                                         | AUDIO_FLAG_HARD_DISABLE;
+         if (secondary_core_run_use_last_input(runloop_st))
+            runloop_st->flags           |=  RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE;
+         else
+            runloop_st->flags           &= ~RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE;
+         audio_st->flags                &= ~(AUDIO_FLAG_SUSPENDED
                                          | AUDIO_FLAG_HARD_DISABLE);
+      }
 #endif
    }
    runloop_st->flags &= ~RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY;
@@ -1335,22 +2447,37 @@ static int16_t preempt_input_state(unsigned port,
    runloop_state_t *runloop_st = runloop_state_get_ptr();
    preempt_t *preempt          = runloop_st->preempt_data;
    unsigned device_class       = device & RETRO_DEVICE_MASK;
+   uint32_t query              = 0;
+
+   if (port >= MAX_USERS)
+      return input_driver_state_wrapper(port, device, index, id);
 
    switch (device_class)
    {
+      case RETRO_DEVICE_JOYPAD:
+         if (id == RETRO_DEVICE_ID_JOYPAD_MASK)
+            query = PREEMPT_QUERY_JOYPAD;
+         else if (id < 16)
+            query = 1 << id;
+         break;
       case RETRO_DEVICE_ANALOG:
          /* Add requested inputs to mask */
          preempt->analog_mask[port] |= (1 << (id + index * 2));
+         query = PREEMPT_QUERY_ANALOG;
          break;
       case RETRO_DEVICE_LIGHTGUN:
       case RETRO_DEVICE_POINTER:
          /* Set pointing device for this port */
          preempt->ptr_dev_needed[port] = device_class;
+         query = PREEMPT_QUERY_POINTER;
          break;
       case RETRO_DEVICE_MOUSE:
+         query = PREEMPT_QUERY_POINTER;
          /* Set pointing device and return stored x,y */
          if (id <= RETRO_DEVICE_ID_MOUSE_Y)
          {
+            preempt->query_mask[preempt->query_ptr][port] |= query;
+            preempt->relevant_mask[port]                  |= query;
             preempt->ptr_dev_needed[port] = device_class;
             if (preempt->ptr_dev_polled[port] == device_class)
                return preempt->ptrdev_state[port][id];
@@ -1360,6 +2487,9 @@ static int16_t preempt_input_state(unsigned port,
          break;
    }
 
+   preempt->query_mask[preempt->query_ptr][port] |= query;
+   preempt->relevant_mask[port]                  |= query;
+
    return input_driver_state_wrapper(port, device, index, id);
 }
 
@@ -1409,6 +2539,14 @@ void preempt_deinit(void *data)
    for (i = 0; i < preempt->frames; i++)
       free(preempt->buffer[i]);
 
+   if (preempt->replays || preempt->replays_avoided)
+      RARCH_LOG("[Preemptive Frames]: %u replays (%u frames), "
+            "%u avoided (%u frames not re-emulated).\n",
+            (unsigned)preempt->replays,
+            (unsigned)preempt->replay_frames,
+            (unsigned)preempt->replays_avoided,
+            (unsigned)preempt->replay_frames_avoided);
+
    free(preempt);
    runloop_st->preempt_data = NULL;
 
@@ -1560,33 +2698,39 @@ static INLINE bool preempt_ptr_input_dirty(preempt_t *preempt,
    return true;
 }
 
-static INLINE void preempt_input_poll(preempt_t *preempt,
-      runloop_state_t *runloop_st, settings_t *settings)
+/* Fills @changed with the inputs of each port that changed
+ * (PREEMPT_QUERY_*), and flags the input dirty if the core has
+ * ever read any of them. Returns whether anything changed. */
+static INLINE bool preempt_input_poll(preempt_t *preempt,
+      runloop_state_t *runloop_st, unsigned max_users,
+      uint32_t *changed)
 {
    size_t p;
    int16_t joypad_state;
    retro_input_state_t state_cb = input_driver_state_wrapper;
-   unsigned max_users           = settings->uints.input_max_users;
+   bool any_changed             = false;
 
    input_driver_poll();
 
    /* Check for input state changes */
    for (p = 0; p < max_users; p++)
    {
+      changed[p]   = 0;
+
       /* Check full digital joypad */
       joypad_state = state_cb(p, RETRO_DEVICE_JOYPAD,
             0, RETRO_DEVICE_ID_JOYPAD_MASK);
       if (joypad_state != preempt->joypad_state[p])
       {
+         changed[p] |= (uint16_t)(joypad_state ^ preempt->joypad_state[p]);
          preempt->joypad_state[p] = joypad_state;
-         runloop_st->flags |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
       }
 
       /* Check requested analogs */
       if (     preempt->analog_mask[p]
             && preempt_analog_input_dirty(preempt, state_cb, (unsigned)p))
       {
-         runloop_st->flags |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+         changed[p] |= PREEMPT_QUERY_ANALOG;
          preempt->analog_mask[p] = 0;
       }
 
@@ -1595,12 +2739,63 @@ static INLINE void preempt_input_poll(preempt_t *preempt,
       {
          if (preempt_ptr_input_dirty(
                preempt, state_cb, preempt->ptr_dev_needed[p], (unsigned)p))
-            runloop_st->flags |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+            changed[p] |= PREEMPT_QUERY_POINTER;
 
          preempt->ptr_dev_polled[p] = preempt->ptr_dev_needed[p];
          preempt->ptr_dev_needed[p] = RETRO_DEVICE_NONE;
       }
+
+      if (changed[p])
+      {
+         any_changed = true;
+         if (changed[p] & preempt->relevant_mask[p])
+            runloop_st->flags |= RUNLOOP_FLAG_INPUT_IS_DIRTY;
+      }
    }
+
+   return any_changed;
+}
+
+/* Returns how many of the buffered frames, oldest first, did not
+ * read any of the @changed inputs and so need no replay. Equal to
+ * preempt->frames when none of them did. */
+static INLINE uint8_t preempt_replay_skip(preempt_t *preempt,
+      unsigned max_users, const uint32_t *changed)
+{
+   uint8_t skip;
+   uint8_t ptr = preempt->start_ptr;
+
+   for (skip = 0; skip < preempt->frames; skip++)
+   {
+      unsigned p;
+      for (p = 0; p < max_users; p++)
+         if (preempt->query_mask[ptr][p] & changed[p])
+            return skip;
+      ptr = (ptr + 1) % preempt->frames;
+   }
+
+   return skip;
+}
+
+/* Starts recording the inputs read by the frame run from
+ * the state in buffer @ptr */
+static INLINE void preempt_query_begin(preempt_t *preempt, uint8_t ptr)
+{
+   preempt->query_ptr = ptr;
+   memset(preempt->query_mask[ptr], 0, sizeof(preempt->query_mask[ptr]));
+}
+
+static void preempt_count_replay(preempt_t *preempt,
+      uint8_t frames, uint8_t skipped)
+{
+   if (frames)
+   {
+      preempt->replays++;
+      preempt->replay_frames               += frames;
+   }
+   else
+      preempt->replays_avoided++;
+   preempt->replay_frames_avoided          += skipped;
 }
 
 /* macro for preempt_run */
@@ -1621,44 +2816,70 @@ void preempt_run(preempt_t *preempt, void *data)
    audio_driver_state_t *audio_st    = audio_state_get_ptr();
    video_driver_state_t *video_st    = video_state_get_ptr();
 
+   unsigned max_users                = settings->uints.input_max_users;
+   uint32_t changed[MAX_USERS];
+   bool any_changed;
+
+   if (max_users > MAX_USERS)
+      max_users = MAX_USERS;
+
    /* Poll and check for dirty input */
-   preempt_input_poll(preempt, runloop_st, settings);
+   any_changed = preempt_input_poll(preempt, runloop_st, max_users, changed);
 
    runloop_st->flags                |= RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE;
 
    if ((runloop_st->flags & RUNLOOP_FLAG_INPUT_IS_DIRTY)
          && preempt->frame_count >= preempt->frames)
    {
-      /* Suspend A/V and run preemptive frames */
-      audio_st->flags |=  AUDIO_FLAG_SUSPENDED;
-      video_st->flags &= ~VIDEO_FLAG_ACTIVE;
+      /* Frames that never read what changed come out
+       * the same; replay from the first one that did.
+       * Flagged dirty with no input changed: replay all. */
+      uint8_t skip = any_changed
+         ? preempt_replay_skip(preempt, max_users, changed)
+         : 0;
 
-      if (!current_core->retro_unserialize(
-            preempt->buffer[preempt->start_ptr], preempt->state_size))
+      preempt_count_replay(preempt, preempt->frames - skip, skip);
+
+      if (skip < preempt->frames)
       {
-         failed_str = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_LOAD_STATE);
-         goto error;
-      }
+         uint8_t ptr = (preempt->start_ptr + skip) % preempt->frames;
 
-      current_core->retro_run();
-      preempt->replay_ptr = PREEMPT_NEXT_PTR(preempt->start_ptr);
+         /* Suspend A/V and run preemptive frames */
+         audio_st->flags |=  AUDIO_FLAG_SUSPENDED;
+         video_st->flags &= ~VIDEO_FLAG_ACTIVE;
 
-      while (preempt->replay_ptr != preempt->start_ptr)
-      {
-         if (!current_core->retro_serialize(
-               preempt->buffer[preempt->replay_ptr], preempt->state_size))
+         if (!current_core->retro_unserialize(
+               preempt->buffer[ptr], preempt->state_size))
          {
-            failed_str = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_SAVE_STATE);
+            failed_str = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_LOAD_STATE);
             goto error;
          }
 
+         preempt_query_begin(preempt, ptr);
          current_core->retro_run();
-         preempt->replay_ptr = PREEMPT_NEXT_PTR(preempt->replay_ptr);
-      }
+         preempt->replay_ptr = PREEMPT_NEXT_PTR(ptr);
+
+         while (preempt->replay_ptr != preempt->start_ptr)
+         {
+            if (!current_core->retro_serialize(
+                  preempt->buffer[preempt->replay_ptr], preempt->state_size))
+            {
+               failed_str = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_SAVE_STATE);
+               goto error;
+            }
+
+            preempt_query_begin(preempt, preempt->replay_ptr);
+            current_core->retro_run();
+            preempt->replay_ptr = PREEMPT_NEXT_PTR(preempt->replay_ptr);
+         }
 
-      audio_st->flags &= ~AUDIO_FLAG_SUSPENDED;
-      video_st->flags |=  VIDEO_FLAG_ACTIVE;
+         audio_st->flags &= ~AUDIO_FLAG_SUSPENDED;
+         video_st->flags |=  VIDEO_FLAG_ACTIVE;
+      }
    }
+   /* Changed, but only inputs the core has never read */
+   else if (any_changed && preempt->frame_count >= preempt->frames)
+      preempt_count_replay(preempt, 0, preempt->frames);
 
    /* Save current state and set start_ptr to oldest state */
    if (!current_core->retro_serialize(
@@ -1667,6 +2888,7 @@ void preempt_run(preempt_t *preempt, void *data)
       failed_str = msg_hash_to_str(MSG_PREEMPT_FAILED_TO_SAVE_STATE);
       goto error;
    }
+   preempt_query_begin(preempt, preempt->start_ptr);
    preempt->start_ptr = PREEMPT_NEXT_PTR(preempt->start_ptr);
    runloop_st->flags &= ~(RUNLOOP_FLAG_REQUEST_SPECIAL_SAVESTATE
          | RUNLOOP_FLAG_INPUT_IS_DIRTY);
@@ -1701,4 +2923,7 @@ void runahead_clear_variables(void *data)
                                           | RUNLOOP_FLAG_RUNAHEAD_SECONDARY_CORE_AVAILABLE
                                           | RUNLOOP_FLAG_RUNAHEAD_FORCE_INPUT_DIRTY;
    runloop_st->runahead_last_frame_count  = 0;
+#ifdef HAVE_RUNAHEAD_SNAPSHOT
+   runahead_snapshot_deinit();
+#endif
 }
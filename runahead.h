@@ -26,6 +26,13 @@
 
 #define MAX_RUNAHEAD_FRAMES 12
 
+/* Bits of a preemptive frames query mask: the low 16 bits
+ * are RETRO_DEVICE_ID_JOYPAD_* ids, then whether any analog
+ * or pointing device state was read from the port */
+#define PREEMPT_QUERY_JOYPAD  0xffff
+#define PREEMPT_QUERY_ANALOG  (1 << 16)
+#define PREEMPT_QUERY_POINTER (1 << 17)
+
 typedef void *(*constructor_t)(void);
 typedef void  (*destructor_t )(void*);
 
@@ -47,9 +54,23 @@ typedef struct preemptive_frames_data
    /* Frame count since buffer init/reset */
    uint64_t frame_count;
 
+   /* Replay counters: replays run and the frames they re-emulated,
+    * replays avoided entirely and frames not re-emulated */
+   uint64_t replays;
+   uint64_t replay_frames;
+   uint64_t replays_avoided;
+   uint64_t replay_frames_avoided;
+
    /* Mask of analog states requested */
    uint32_t analog_mask[MAX_USERS];
 
+   /* Inputs the core read while running from each buffered
+    * state, and inputs it has read at all (PREEMPT_QUERY_*).
+    * A change nobody read needs no replay, and a replay only
+    * has to start from the first frame that read it. */
+   uint32_t query_mask[MAX_RUNAHEAD_FRAMES][MAX_USERS];
+   uint32_t relevant_mask[MAX_USERS];
+
    /* Input states. Replays triggered on changes */
    int16_t joypad_state[MAX_USERS];
    int16_t analog_state[MAX_USERS][20];
@@ -62,6 +83,8 @@ typedef struct preemptive_frames_data
    /* Buffer indexes for replays */
    uint8_t start_ptr;
    uint8_t replay_ptr;
+   /* Buffer index of the frame being run */
+   uint8_t query_ptr;
    /* Number of latency frames to remove */
    uint8_t frames;
 } preempt_t;
@@ -0,0 +1,254 @@
+/* public domain */
+
+/*
+ * Config file startup benchmark.
+ *
+ *    config_bench [retroarch.cfg] [iterations]
+ *
+ * Does what starting RetroArch with content does to its config:
+ * loads retroarch.cfg, reads every setting from it (plus as many
+ * again that are missing and fall back to their default), then
+ * appends a core override and a game override and reads every
+ * setting once more. Finally the settings are saved the way
+ * config_save_file() does, setting every key on a new config
+ * and writing it out.
+ *
+ * Without a path, a synthetic retroarch.cfg of 1500 settings is
+ * written to the current directory, along with the overrides
+ * (config_bench_core.cfg and config_bench_game.cfg). Each phase
+ * is averaged over <iterations> runs (default 50).
+ *
+ * The file is loaded both through config_file_new(), which reads
+ * the file itself, and config_file_new_from_path_to_string(), which
+ * configuration.c uses. For reference, "getline" is what reading
+ * the same file one line at a time with filestream_getline() costs,
+ * which is how config_file_new() used to read it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <streams/file_stream.h>
+
+#include "../../../libretro-common/file/config_file.c"
+
+#define BENCH_CFG      "config_bench.cfg"
+#define BENCH_CORE_CFG "config_bench_core.cfg"
+#define BENCH_GAME_CFG "config_bench_game.cfg"
+#define BENCH_SAVE_CFG "config_bench_save.cfg"
+#define BENCH_SETTINGS 1500
+
+static const char *prefixes[] = {
+   "video_", "audio_", "input_", "menu_", "netplay_", "savestate_",
+   "rewind_", "cheevos_", "content_", "playlist_", "notification_",
+   "quick_menu_show_", "settings_show_", "ozone_", "xmb_"
+};
+
+static const char *words[] = {
+   "enable", "scale", "path", "directory", "mode", "index",
+   "size", "color", "delay", "threaded", "count", "filter"
+};
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void bench_key(char *s, size_t len, unsigned n)
+{
+   if (n < 16 * 40)
+      snprintf(s, len, "input_player%u_%s_%u", n / 40 + 1,
+            words[n % 12], n % 40);
+   else
+      snprintf(s, len, "%s%s_%u", prefixes[n % 15], words[(n / 15) % 12], n);
+}
+
+static void bench_value(char *s, size_t len, unsigned n)
+{
+   switch (n % 5)
+   {
+      case 0:  snprintf(s, len, "%s", (n & 8) ? "true" : "false"); break;
+      case 1:  snprintf(s, len, "%u", n * 7); break;
+      case 2:  snprintf(s, len, "%f", n / 3.0); break;
+      case 3:  snprintf(s, len, "~/.config/retroarch/dir_%u", n); break;
+      default: snprintf(s, len, "nul"); break;
+   }
+}
+
+static void write_cfg(const char *path, unsigned first, unsigned count,
+      unsigned step)
+{
+   unsigned i;
+   FILE *file = fopen(path, "wb");
+
+   if (!file)
+   {
+      fprintf(stderr, "Cannot write %s\n", path);
+      exit(1);
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      char key[128];
+      char value[128];
+      bench_key(key, sizeof(key), first + i * step);
+      bench_value(value, sizeof(value), first + i * step);
+      fprintf(file, "%s = \"%s\"\n", key, value);
+   }
+
+   fclose(file);
+}
+
+/* What config_load_file() does for every setting,
+ * with the getter that fits the value */
+static unsigned read_settings(config_file_t *conf,
+      char **keys, size_t count)
+{
+   size_t i;
+   unsigned found = 0;
+
+   for (i = 0; i < count; i++)
+   {
+      char buf[PATH_MAX_LENGTH];
+      bool b;
+      int n;
+      float f;
+      const char *key = keys[i];
+
+      switch ((i / 2) % 5)
+      {
+         case 0:  found += config_get_bool(conf, key, &b); break;
+         case 1:  found += config_get_int(conf, key, &n); break;
+         case 2:  found += config_get_float(conf, key, &f); break;
+         default: found += config_get_array(conf, key, buf, sizeof(buf)); break;
+      }
+   }
+
+   return found;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i, count  = 0;
+   char **keys      = NULL;
+   const char *path = BENCH_CFG;
+   unsigned iters   = 50;
+   unsigned found   = 0;
+   unsigned lines   = 0;
+   unsigned it;
+   double t, t_getline = 0, t_new = 0, t_string = 0, t_read = 0,
+          t_override = 0, t_save = 0;
+   config_file_t *conf;
+   struct config_file_entry entry;
+
+   if (argc > 1 && strcmp(argv[1], "-"))
+      path = argv[1];
+   else
+      write_cfg(BENCH_CFG, 0, BENCH_SETTINGS, 1);
+   if (argc > 2)
+      iters = (unsigned)strtoul(argv[2], NULL, 0);
+   if (!iters)
+      iters = 1;
+
+   write_cfg(BENCH_CORE_CFG, 3, 60, 17);
+   write_cfg(BENCH_GAME_CFG, 5, 20, 61);
+
+   /* Every key in the file, and as many again that
+    * are not in it and fall back to their defaults */
+   if (!(conf = config_file_new(path)))
+   {
+      fprintf(stderr, "Cannot load %s\n", path);
+      return 1;
+   }
+
+   if (config_get_entry_list_head(conf, &entry))
+   {
+      do
+      {
+         char missing[256];
+
+         if (!entry.key)
+            continue;
+
+         keys          = (char**)realloc(keys, (count + 2) * sizeof(*keys));
+         keys[count++] = strdup(entry.key);
+         snprintf(missing, sizeof(missing), "%s_default", entry.key);
+         keys[count++] = strdup(missing);
+      } while (config_get_entry_list_next(&entry));
+   }
+   config_file_free(conf);
+
+   for (it = 0; it < iters; it++)
+   {
+      RFILE *file;
+      config_file_t *save;
+
+      t     = now_us();
+      file  = filestream_open(path, RETRO_VFS_FILE_ACCESS_READ,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      lines = 0;
+      while (file && !filestream_eof(file))
+      {
+         free(filestream_getline(file));
+         lines++;
+      }
+      filestream_close(file);
+      t_getline += now_us() - t;
+
+      t     = now_us();
+      conf  = config_file_new(path);
+      t_new += now_us() - t;
+      config_file_free(conf);
+
+      t     = now_us();
+      conf  = config_file_new_from_path_to_string(path);
+      t_string += now_us() - t;
+
+      t     = now_us();
+      found = read_settings(conf, keys, count);
+      t_read += now_us() - t;
+
+      t     = now_us();
+      config_append_file(conf, BENCH_CORE_CFG);
+      config_append_file(conf, BENCH_GAME_CFG);
+      found = read_settings(conf, keys, count);
+      t_override += now_us() - t;
+
+      /* Save: every setting onto an empty config */
+      t     = now_us();
+      save  = config_file_new_alloc();
+      for (i = 0; i < count; i += 2)
+      {
+         char *value = NULL;
+         if (config_get_string(conf, keys[i], &value))
+         {
+            config_set_string(save, keys[i], value);
+            free(value);
+         }
+      }
+      config_file_write(save, BENCH_SAVE_CFG, true);
+      config_file_free(save);
+      t_save += now_us() - t;
+
+      config_file_free(conf);
+   }
+
+   printf("%s: %u lines, %u of %u lookups hit\n",
+         path, lines, found, (unsigned)count);
+   printf("getline   %10.1f us\n", t_getline  / iters);
+   printf("new       %10.1f us\n", t_new      / iters);
+   printf("string    %10.1f us\n", t_string   / iters);
+   printf("read      %10.1f us\n", t_read     / iters);
+   printf("override  %10.1f us\n", t_override / iters);
+   printf("save      %10.1f us\n", t_save     / iters);
+
+   for (i = 0; i < count; i++)
+      free(keys[i]);
+   free(keys);
+   remove(BENCH_SAVE_CFG);
+   return 0;
+}
@@ -0,0 +1,456 @@
+/* public domain */
+
+/*
+ * Database scan lookup benchmark.
+ *
+ *    scan_bench [databases] [entries] [files] [queried]
+ *
+ * Writes <databases> (default 40) synthetic .rdb files of <entries>
+ * items each (default 2000), with the fields a real database holds,
+ * then looks up the CRC32s of <files> (default 2000) scanned files,
+ * half of which are in one of the databases. One in four items also
+ * has a serial, which every tenth file is looked up by instead.
+ *
+ * The first <queried> files (default 50) are matched the way a scan
+ * used to, with a query walking each database in turn until one
+ * returns the item; all of them through the database index, which
+ * is timed being built, loaded back from disk and partly rebuilt
+ * after one database changed. Both have to find the same items.
+ *
+ * Computing the CRC32 of a file costs the same either way, so the
+ * scanned files are only CRC32s and serials.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "../../../database_info.c"
+
+/* The parts of RetroArch database_info.c links against,
+ * none of which are reached by the benchmark. */
+bool core_info_get_list(core_info_list_t **core) { return false; }
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { va_list ap; va_start(ap, fmt); vfprintf(stderr, fmt, ap); va_end(ap); }
+void RARCH_ERR(const char *fmt, ...) { va_list ap; va_start(ap, fmt); vfprintf(stderr, fmt, ap); va_end(ap); }
+
+#define BENCH_DIR   "scan_bench_rdb"
+#define BENCH_INDEX "scan_bench_rdb/database_index.cache"
+
+typedef struct bench_db
+{
+   unsigned db;
+   unsigned entries;
+   unsigned next;
+   uint32_t generation;
+} bench_db_t;
+
+typedef struct bench_file
+{
+   uint32_t crc;
+   char serial[32];
+   int db;          /* -1 if not in any database */
+   unsigned entry;
+} bench_file_t;
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t item_crc(unsigned db, unsigned entry, uint32_t generation)
+{
+   uint32_t x = (db * 0x10001u + entry + 1) * 0x9E3779B1u ^ generation;
+   x ^= x >> 15;
+   x *= 0x2C1B3C6Du;
+   x ^= x >> 12;
+   return x ? x : 1;
+}
+
+static void item_serial(char *s, size_t len, unsigned db, unsigned entry)
+{
+   snprintf(s, len, "SLUS-%03u%05u", db, entry);
+}
+
+static void set_string(struct rmsgpack_dom_value *v, const char *str,
+      bool binary)
+{
+   size_t len = strlen(str);
+
+   v->type = binary ? RDT_BINARY : RDT_STRING;
+   if (binary)
+   {
+      v->val.binary.len  = (uint32_t)len;
+      v->val.binary.buff = (char*)malloc(len + 1);
+      memcpy(v->val.binary.buff, str, len + 1);
+   }
+   else
+   {
+      v->val.string.len  = (uint32_t)len;
+      v->val.string.buff = strdup(str);
+   }
+}
+
+static void set_binary(struct rmsgpack_dom_value *v, const void *data,
+      size_t len)
+{
+   v->type            = RDT_BINARY;
+   v->val.binary.len  = (uint32_t)len;
+   v->val.binary.buff = (char*)malloc(len);
+   memcpy(v->val.binary.buff, data, len);
+}
+
+static int value_provider(void *ctx, struct rmsgpack_dom_value *out)
+{
+   char str[128];
+   uint8_t hash[20];
+   uint32_t crc;
+   unsigned i       = 0;
+   bench_db_t *bdb  = (bench_db_t*)ctx;
+   unsigned entry   = bdb->next;
+   struct rmsgpack_dom_pair *items;
+
+   if (entry >= bdb->entries)
+      return 1;
+   bdb->next++;
+
+   if (!(items = (struct rmsgpack_dom_pair*)calloc(9, sizeof(*items))))
+      return -1;
+
+   crc = swap_if_little32(item_crc(bdb->db, entry, bdb->generation));
+   memset(hash, (int)(entry & 0xFF), sizeof(hash));
+
+   snprintf(str, sizeof(str), "Game %u-%u (USA)", bdb->db, entry);
+   set_string(&items[i].key, "name", false);
+   set_string(&items[i++].value, str, false);
+   set_string(&items[i].key, "description", false);
+   set_string(&items[i++].value, str, false);
+   snprintf(str, sizeof(str), "Game %u-%u (USA).bin", bdb->db, entry);
+   set_string(&items[i].key, "rom_name", false);
+   set_string(&items[i++].value, str, false);
+   set_string(&items[i].key, "size", false);
+   items[i].value.type     = RDT_UINT;
+   items[i++].value.val.uint_ = 524288 + entry;
+   set_string(&items[i].key, "crc", false);
+   set_binary(&items[i++].value, &crc, sizeof(crc));
+   set_string(&items[i].key, "md5", false);
+   set_binary(&items[i++].value, hash, 16);
+   set_string(&items[i].key, "sha1", false);
+   set_binary(&items[i++].value, hash, 20);
+   set_string(&items[i].key, "releaseyear", false);
+   items[i].value.type     = RDT_UINT;
+   items[i++].value.val.uint_ = 1990 + entry % 20;
+   if (entry % 4 == 0)
+   {
+      item_serial(str, sizeof(str), bdb->db, entry);
+      set_string(&items[i].key, "serial", false);
+      set_string(&items[i++].value, str, true);
+   }
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = i;
+   out->val.map.items = items;
+   return 0;
+}
+
+static void db_path(char *s, size_t len, unsigned db)
+{
+   snprintf(s, len, BENCH_DIR "/System %03u.rdb", db);
+}
+
+static bool write_db(unsigned db, unsigned entries, uint32_t generation)
+{
+   char path[PATH_MAX_LENGTH];
+   bench_db_t bdb;
+   RFILE *file;
+   int rv;
+
+   db_path(path, sizeof(path), db);
+   if (!(file = filestream_open(path, RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
+
+   bdb.db         = db;
+   bdb.entries    = entries;
+   bdb.next       = 0;
+   bdb.generation = generation;
+   rv             = libretrodb_create(file, value_provider, &bdb);
+   filestream_close(file);
+   return rv >= 0;
+}
+
+/* What a scan finds for 'file': the database
+ * and the name of the item, or -1 */
+static int match(const database_info_list_t *list, const bench_file_t *file,
+      char *name, size_t len)
+{
+   size_t i;
+
+   if (!list)
+      return -1;
+
+   for (i = 0; i < list->count; i++)
+   {
+      const database_info_t *info = &list->list[i];
+
+      if (file->serial[0]
+            ? (info->serial && !strcmp(info->serial, file->serial))
+            : (info->crc32 == file->crc))
+      {
+         strlcpy(name, info->name ? info->name : "", len);
+         return 0;
+      }
+   }
+
+   return -1;
+}
+
+static int lookup_query(const struct string_list *dbs,
+      const bench_file_t *file, char *name, size_t len)
+{
+   size_t i;
+
+   for (i = 0; i < dbs->size; i++)
+   {
+      char query[64];
+      database_info_list_t *list;
+      int found;
+
+      if (file->serial[0])
+      {
+         char *hex = bin_to_hex_alloc((const uint8_t*)file->serial,
+               strlen(file->serial));
+         snprintf(query, sizeof(query), "{'serial': b'%s'}", hex);
+         free(hex);
+      }
+      else
+         snprintf(query, sizeof(query), "{crc:or(b\"%08lX\",b\"%08lX\")}",
+               (unsigned long)file->crc, 0UL);
+
+      list  = database_info_list_new(dbs->elems[i].data, query);
+      found = match(list, file, name, len);
+      if (list)
+      {
+         database_info_list_free(list);
+         free(list);
+      }
+      if (found == 0)
+         return (int)i;
+   }
+
+   return -1;
+}
+
+static int lookup_index(const database_info_index_t *index,
+      const struct string_list *dbs, const bench_file_t *file,
+      char *name, size_t len)
+{
+   database_info_index_hit_t hits[32];
+   size_t num_hits = file->serial[0]
+      ? database_info_index_find_serial(index, file->serial, hits, 32)
+      : database_info_index_find_crc(index, file->crc, hits, 32);
+   size_t i, j;
+
+   if (num_hits > 32)
+      return -2;
+
+   for (i = 0; i < dbs->size; i++)
+   {
+      database_info_list_t *list;
+      int found;
+
+      for (j = 0; j < num_hits; j++)
+         if (hits[j].db == i)
+            break;
+      if (j == num_hits)
+         continue;
+
+      list  = database_info_index_list_new(index, (unsigned)i,
+            hits, num_hits);
+      found = match(list, file, name, len);
+      if (list)
+      {
+         database_info_list_free(list);
+         free(list);
+      }
+      if (found == 0)
+         return (int)i;
+   }
+
+   return -1;
+}
+
+/* Looks every file up through a freshly loaded index */
+static bool run_index(const char *label, const struct string_list *dbs,
+      const bench_file_t *files, unsigned num_files,
+      const int *expected)
+{
+   unsigned i;
+   double t, load, lookup;
+   database_info_index_t *index;
+   bool ok = true;
+
+   t      = now_us();
+   index  = database_info_index_new(dbs, BENCH_INDEX);
+   load   = now_us() - t;
+   if (!index)
+   {
+      printf("%-8s could not build the index\n", label);
+      return false;
+   }
+
+   t      = now_us();
+   for (i = 0; i < num_files; i++)
+   {
+      char name[128];
+      int db = lookup_index(index, dbs, &files[i], name, sizeof(name));
+
+      if (db != expected[i])
+      {
+         fprintf(stderr, "File %u: found in %d, expected %d.\n",
+               i, db, expected[i]);
+         ok = false;
+      }
+   }
+   lookup = now_us() - t;
+
+   printf("%-8s %8.1f ms to load the index, %7.2f us/file%s\n",
+         label, load / 1000.0, lookup / num_files, ok ? "" : ", FAILED");
+   database_info_index_free(index);
+   return ok;
+}
+
+static void delete_files(unsigned num_dbs)
+{
+   unsigned i;
+   char path[PATH_MAX_LENGTH];
+
+   for (i = 0; i < num_dbs; i++)
+   {
+      db_path(path, sizeof(path), i);
+      filestream_delete(path);
+   }
+   filestream_delete(BENCH_INDEX);
+   rmdir(BENCH_DIR);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   double t, query;
+   struct string_list *dbs;
+   bench_file_t *files;
+   int *expected;
+   unsigned num_dbs   = argc > 1 ? strtoul(argv[1], NULL, 0) : 40;
+   unsigned entries   = argc > 2 ? strtoul(argv[2], NULL, 0) : 2000;
+   unsigned num_files = argc > 3 ? strtoul(argv[3], NULL, 0) : 2000;
+   unsigned queried   = argc > 4 ? strtoul(argv[4], NULL, 0) : 50;
+   uint32_t seed      = 0x12345678;
+   bool ok            = true;
+
+   if (!num_dbs || !entries || !num_files)
+      return 1;
+   if (queried > num_files)
+      queried = num_files;
+
+   files    = (bench_file_t*)calloc(num_files, sizeof(*files));
+   expected = (int*)calloc(num_files, sizeof(*expected));
+   if (!files || !expected)
+      return 1;
+
+   delete_files(num_dbs);
+   path_mkdir(BENCH_DIR);
+   for (i = 0; i < num_dbs; i++)
+      if (!write_db(i, entries, 0))
+      {
+         fprintf(stderr, "Cannot write databases.\n");
+         delete_files(num_dbs);
+         return 1;
+      }
+
+   if (!(dbs = dir_list_new(BENCH_DIR, "rdb", false, false, false, false)))
+      return 1;
+   dir_list_sort(dbs, true);
+
+   /* Half the files are in one of the databases, the
+    * others are items of a database that does not exist */
+   for (i = 0; i < num_files; i++)
+   {
+      bench_file_t *file = &files[i];
+
+      seed ^= seed << 13;
+      seed ^= seed >> 17;
+      seed ^= seed << 5;
+
+      file->db    = (i % 2) ? -1 : (int)(seed % num_dbs);
+      file->entry = (seed >> 8) % entries;
+      if (i % 10 == 0)
+      {
+         /* Only one in four items has a serial */
+         file->entry &= ~3u;
+         item_serial(file->serial, sizeof(file->serial),
+               file->db < 0 ? num_dbs : (unsigned)file->db, file->entry);
+      }
+      else
+         file->crc = item_crc(file->db < 0 ? num_dbs : (unsigned)file->db,
+               file->entry, 0);
+   }
+
+   printf("%u databases of %u items, %u files (%u queried)\n",
+         num_dbs, entries, num_files, queried);
+
+   /* The old way, checked against what the files are */
+   t = now_us();
+   for (i = 0; i < queried; i++)
+   {
+      char name[128], want[128];
+      int db = lookup_query(dbs, &files[i], name, sizeof(name));
+
+      snprintf(want, sizeof(want), "Game %d-%u (USA)",
+            files[i].db, files[i].entry);
+      if (db != files[i].db || (db >= 0 && strcmp(name, want)))
+      {
+         fprintf(stderr, "File %u: queried %d, expected %d.\n",
+               i, db, files[i].db);
+         ok = false;
+      }
+   }
+   query = now_us() - t;
+   printf("query    %7.2f ms/file%s\n", query / 1000.0 / (queried ? queried : 1),
+         ok ? "" : ", FAILED");
+
+   for (i = 0; i < num_files; i++)
+      expected[i] = files[i].db;
+
+   ok = run_index("build", dbs, files, num_files, expected) && ok;
+   ok = run_index("load",  dbs, files, num_files, expected) && ok;
+
+   /* A changed database no longer holds its old
+    * items, and is the only one read again */
+   write_db(num_dbs / 2, entries, 1);
+   for (i = 0; i < num_files; i++)
+      if (files[i].db == (int)(num_dbs / 2) && !files[i].serial[0])
+         expected[i] = -1;
+   /* mtime only has a resolution of a second */
+   {
+      char path[PATH_MAX_LENGTH];
+      struct utimbuf times;
+      db_path(path, sizeof(path), num_dbs / 2);
+      times.actime  = time(NULL) + 2;
+      times.modtime = times.actime;
+      utime(path, &times);
+   }
+   ok = run_index("changed", dbs, files, num_files, expected) && ok;
+
+   dir_list_free(dbs);
+   delete_files(num_dbs);
+   free(files);
+   free(expected);
+   return ok ? 0 : 1;
+}
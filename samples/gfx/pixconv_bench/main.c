@@ -0,0 +1,399 @@
+/* public domain */
+
+/*
+ * Pixel conversion benchmark and correctness check.
+ *
+ *    pixconv_bench [width height [iterations]]
+ *
+ * For each converter that has a SIMD path, random frames are
+ * converted by
+ *
+ *    ref     - a plain C reference written out below,
+ *    build   - the conv_* function itself, which uses the SIMD
+ *              extensions the compiler targets (SSE2, MMX, NEON),
+ *    runtime - the kernel conv_simd_kernel() picks for this CPU,
+ *              which is what scaler_ctx_gen_filter() installs.
+ *
+ * Outputs are first compared against the reference over many odd
+ * sizes and padded strides (so block tails and overruns past the
+ * line get exercised), then each is timed on a <width>x<height>
+ * frame (default 1920x1080) averaged over <iterations> runs
+ * (default 100). Returns non-zero if any output differs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <features/features_cpu.h>
+#include <gfx/scaler/pixconv.h>
+
+typedef void (*ref_row_t)(uint8_t *out, const uint8_t *in, int width);
+
+typedef struct
+{
+   const char *name;
+   pixconv_func_t conv;
+   ref_row_t ref;
+   int in_bpp;
+   int out_bpp;
+} bench_kernel_t;
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state <<  5;
+   return rng_state;
+}
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint16_t rd16(const uint8_t *p)
+{
+   uint16_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+static uint32_t rd32(const uint8_t *p)
+{
+   uint32_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+static void wr16(uint8_t *p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+static void wr32(uint8_t *p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+
+static uint32_t expand5(uint32_t c) { return (c << 3) | (c >> 2); }
+static uint32_t expand6(uint32_t c) { return (c << 2) | (c >> 4); }
+
+static uint8_t clamp8(int v) { return v < 0 ? 0 : v > 255 ? 255 : v; }
+
+static void ref_rgb565_0rgb1555(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint16_t c = rd16(in + w * 2);
+      wr16(out + w * 2, ((c >> 1) & 0x7fe0) | (c & 0x1f));
+   }
+}
+
+static void ref_0rgb1555_rgb565(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint16_t c = rd16(in + w * 2);
+      uint16_t r = (c >> 10) & 0x1f;
+      uint16_t g = (c >>  5) & 0x1f;
+      uint16_t b = c & 0x1f;
+      /* 5-bit green widened to 6 bits by repeating its top bit */
+      wr16(out + w * 2, (r << 11) | (g << 6) | ((g >> 4) << 5) | b);
+   }
+}
+
+static void ref_0rgb1555_argb8888(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint16_t c = rd16(in + w * 2);
+      wr32(out + w * 4, 0xff000000u
+            | (expand5((c >> 10) & 0x1f) << 16)
+            | (expand5((c >>  5) & 0x1f) <<  8)
+            |  expand5(c & 0x1f));
+   }
+}
+
+static void ref_rgb565_argb8888(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint16_t c = rd16(in + w * 2);
+      wr32(out + w * 4, 0xff000000u
+            | (expand5((c >> 11) & 0x1f) << 16)
+            | (expand6((c >>  5) & 0x3f) <<  8)
+            |  expand5(c & 0x1f));
+   }
+}
+
+static void ref_rgb565_abgr8888(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint16_t c = rd16(in + w * 2);
+      wr32(out + w * 4, 0xff000000u
+            | (expand5(c & 0x1f) << 16)
+            | (expand6((c >>  5) & 0x3f) <<  8)
+            |  expand5((c >> 11) & 0x1f));
+   }
+}
+
+static void ref_rgba4444_argb8888(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint16_t c = rd16(in + w * 2);
+      uint32_t r = ((c >> 12) & 0xf) * 0x11;
+      uint32_t g = ((c >>  8) & 0xf) * 0x11;
+      uint32_t b = ((c >>  4) & 0xf) * 0x11;
+      uint32_t a = (c & 0xf) * 0x11;
+      wr32(out + w * 4, (a << 24) | (r << 16) | (g << 8) | b);
+   }
+}
+
+static void ref_0rgb1555_bgr24(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++, out += 3)
+   {
+      uint16_t c = rd16(in + w * 2);
+      out[0]     = expand5(c & 0x1f);
+      out[1]     = expand5((c >>  5) & 0x1f);
+      out[2]     = expand5((c >> 10) & 0x1f);
+   }
+}
+
+static void ref_rgb565_bgr24(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++, out += 3)
+   {
+      uint16_t c = rd16(in + w * 2);
+      out[0]     = expand5(c & 0x1f);
+      out[1]     = expand6((c >>  5) & 0x3f);
+      out[2]     = expand5((c >> 11) & 0x1f);
+   }
+}
+
+static void ref_argb8888_bgr24(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++, out += 3)
+      memcpy(out, in + w * 4, 3);
+}
+
+static void ref_abgr8888_bgr24(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++, out += 3)
+   {
+      out[0] = in[w * 4 + 2];
+      out[1] = in[w * 4 + 1];
+      out[2] = in[w * 4 + 0];
+   }
+}
+
+static void ref_argb8888_abgr8888(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      uint32_t c = rd32(in + w * 4);
+      wr32(out + w * 4, (c & 0xff00ff00u)
+            | ((c >> 16) & 0xff) | ((c & 0xff) << 16));
+   }
+}
+
+static void ref_yuyv_argb8888(uint8_t *out, const uint8_t *in, int width)
+{
+   int w;
+   for (w = 0; w < width; w++)
+   {
+      const uint8_t *px = in + (w & ~1) * 2;
+      int y = px[(w & 1) * 2];
+      int u = px[1] - 128;
+      int v = px[3] - 128;
+      int r = (64 * y + 90 * v + 32) >> 6;
+      int g = (64 * y - 22 * u - 46 * v + 32) >> 6;
+      int b = (64 * y + 113 * u + 32) >> 6;
+      wr32(out + w * 4, 0xff000000u
+            | ((uint32_t)clamp8(r) << 16)
+            | ((uint32_t)clamp8(g) << 8)
+            |  (uint32_t)clamp8(b));
+   }
+}
+
+static const bench_kernel_t kernels[] = {
+   { "rgb565_0rgb1555",   conv_rgb565_0rgb1555,   ref_rgb565_0rgb1555,   2, 2 },
+   { "0rgb1555_rgb565",   conv_0rgb1555_rgb565,   ref_0rgb1555_rgb565,   2, 2 },
+   { "0rgb1555_argb8888", conv_0rgb1555_argb8888, ref_0rgb1555_argb8888, 2, 4 },
+   { "rgb565_argb8888",   conv_rgb565_argb8888,   ref_rgb565_argb8888,   2, 4 },
+   { "rgb565_abgr8888",   conv_rgb565_abgr8888,   ref_rgb565_abgr8888,   2, 4 },
+   { "rgba4444_argb8888", conv_rgba4444_argb8888, ref_rgba4444_argb8888, 2, 4 },
+   { "0rgb1555_bgr24",    conv_0rgb1555_bgr24,    ref_0rgb1555_bgr24,    2, 3 },
+   { "rgb565_bgr24",      conv_rgb565_bgr24,      ref_rgb565_bgr24,      2, 3 },
+   { "argb8888_bgr24",    conv_argb8888_bgr24,    ref_argb8888_bgr24,    4, 3 },
+   { "abgr8888_bgr24",    conv_abgr8888_bgr24,    ref_abgr8888_bgr24,    4, 3 },
+   { "argb8888_abgr8888", conv_argb8888_abgr8888, ref_argb8888_abgr8888, 4, 4 },
+   { "yuyv_argb8888",     conv_yuyv_argb8888,     ref_yuyv_argb8888,     2, 4 },
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(kernels[0]))
+
+static void fill_random(uint8_t *buf, size_t size)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      buf[i] = (uint8_t)rng();
+}
+
+static void ref_convert(const bench_kernel_t *k, uint8_t *out,
+      const uint8_t *in, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h;
+   for (h = 0; h < height; h++)
+      k->ref(out + h * out_stride, in + h * in_stride, width);
+}
+
+/* Strides are rounded up to a multiple of 4, which every
+ * converter relies on (they shift the stride down by the
+ * pixel size), plus random padding that must stay intact. */
+static int check_kernel(const bench_kernel_t *k, pixconv_func_t conv)
+{
+   int width, height;
+
+   for (width = 1; width <= 140; width++)
+   {
+      for (height = 1; height <= 3; height++)
+      {
+         int conv_width = (k->conv == conv_yuyv_argb8888)
+            ? (width + 1) & ~1 : width;
+         int in_stride  = ((conv_width * k->in_bpp  + 3) & ~3) + (rng() % 4) * 4;
+         int out_stride = ((conv_width * k->out_bpp + 3) & ~3) + (rng() % 4) * 4;
+         size_t in_size  = (size_t)in_stride  * height;
+         size_t out_size = (size_t)out_stride * height;
+         uint8_t *in     = (uint8_t*)malloc(in_size);
+         uint8_t *out    = (uint8_t*)malloc(out_size);
+         uint8_t *ref    = (uint8_t*)malloc(out_size);
+         int ok;
+
+         fill_random(in, in_size);
+         memset(out, 0xcd, out_size);
+         memset(ref, 0xcd, out_size);
+
+         ref_convert(k, ref, in, conv_width, height, out_stride, in_stride);
+         conv(out, in, conv_width, height, out_stride, in_stride);
+         ok = !memcmp(out, ref, out_size);
+
+         free(in);
+         free(out);
+         free(ref);
+
+         if (!ok)
+         {
+            printf("   MISMATCH at %dx%d\n", conv_width, height);
+            return 0;
+         }
+      }
+   }
+
+   return 1;
+}
+
+static double time_convert(const bench_kernel_t *k, pixconv_func_t conv,
+      uint8_t *out, const uint8_t *in, int width, int height,
+      int out_stride, int in_stride, int iterations)
+{
+   int i;
+   double start = now_us();
+
+   for (i = 0; i < iterations; i++)
+   {
+      if (conv)
+         conv(out, in, width, height, out_stride, in_stride);
+      else
+         ref_convert(k, out, in, width, height, out_stride, in_stride);
+   }
+
+   return (now_us() - start) / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   int failed      = 0;
+   int width       = 1920;
+   int height      = 1080;
+   int iterations  = 100;
+   uint64_t simd   = cpu_features_get();
+   char features[256];
+   uint8_t *in, *out;
+   int in_stride, out_stride;
+
+   if (argc >= 3)
+   {
+      width  = atoi(argv[1]);
+      height = atoi(argv[2]);
+   }
+   if (argc >= 4)
+      iterations = atoi(argv[3]);
+   if (width < 2 || height < 1 || iterations < 1)
+   {
+      fprintf(stderr, "usage: %s [width height [iterations]]\n", argv[0]);
+      return 1;
+   }
+   width &= ~1;
+
+   cpu_features_get_model_name(features, sizeof(features));
+   printf("CPU: %s (AVX2: %s, NEON: %s)\n", features,
+         (simd & RETRO_SIMD_AVX2) ? "yes" : "no",
+         (simd & RETRO_SIMD_NEON) ? "yes" : "no");
+   printf("Frame: %dx%d, %d iterations\n\n", width, height, iterations);
+   printf("%-18s %9s %9s %9s %8s %s\n",
+         "kernel", "ref us", "build us", "rt us", "rt Mpx/s", "check");
+
+   in_stride  = width * 4;
+   out_stride = width * 4;
+   in         = (uint8_t*)malloc((size_t)in_stride  * height);
+   out        = (uint8_t*)malloc((size_t)out_stride * height);
+   fill_random(in, (size_t)in_stride * height);
+
+   for (i = 0; i < NUM_KERNELS; i++)
+   {
+      const bench_kernel_t *k = &kernels[i];
+      pixconv_func_t runtime  = conv_simd_kernel(k->conv, simd);
+      int ok                  = check_kernel(k, k->conv);
+      double t_ref, t_build, t_rt;
+
+      if (runtime != k->conv)
+         ok                   = check_kernel(k, runtime) && ok;
+      failed                 |= !ok;
+
+      t_ref   = time_convert(k, NULL, out, in, width, height,
+            out_stride, in_stride, iterations);
+      t_build = time_convert(k, k->conv, out, in, width, height,
+            out_stride, in_stride, iterations);
+      t_rt    = (runtime != k->conv)
+         ? time_convert(k, runtime, out, in, width, height,
+               out_stride, in_stride, iterations)
+         : t_build;
+
+      printf("%-18s %9.1f %9.1f %9.1f %8.0f %s%s\n",
+            k->name, t_ref, t_build, t_rt,
+            (double)width * height / t_rt,
+            ok ? "ok" : "FAIL",
+            (runtime != k->conv) ? "" : " (no runtime kernel)");
+   }
+
+   free(in);
+   free(out);
+
+   return failed;
+}
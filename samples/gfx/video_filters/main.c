@@ -0,0 +1,279 @@
+/* public domain */
+
+/*
+ * CPU video filter (softfilter) benchmark.
+ *
+ *    video_filters [filter_dir [threads [frames]]]
+ *
+ * Every .filt preset in <filter_dir> (default: gfx/video_filters of
+ * this tree) is loaded through rarch_softfilter_new() with the
+ * filters built in, exactly as the frontend does, and run over
+ * random RGB565 frames at 256x224 (SNES) and 1920x1080.
+ *
+ * Each preset is timed three ways, averaged over <frames> frames
+ * (default 60; a tenth of that at 1920x1080):
+ *  - plain C: one thread, no SIMD kernels;
+ *  - SIMD: one thread, the kernels picked for this CPU;
+ *  - threaded: the same with <threads> threads (default: one per core).
+ * Before timing, the SIMD and threaded outputs are compared against
+ * the plain C one; the program returns non-zero if any of them differ.
+ * Set VERBOSE in the environment to see the filter logs.
+ *
+ * The filters get their SIMD mask from cpu_features_get(), which the
+ * Makefile wraps (-Wl,--wrap) so the plain C run can mask it out.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <lists/dir_list.h>
+
+#include "../../../gfx/video_filter.h"
+
+typedef struct
+{
+   unsigned width;
+   unsigned height;
+   unsigned frames_div;
+} bench_size_t;
+
+static const bench_size_t sizes[] = {
+   {  256,  224,  1 },
+   { 1920, 1080, 10 },
+};
+
+static bool verbose = false;
+
+/* SIMD flags the filters are allowed to see */
+static uint64_t simd_mask = ~(uint64_t)0;
+
+uint64_t __real_cpu_features_get(void);
+
+uint64_t __wrap_cpu_features_get(void)
+{
+   return __real_cpu_features_get() & simd_mask;
+}
+
+/* video_filter.c logs through the frontend's logger. */
+void RARCH_LOG(const char *fmt, ...)
+{
+   va_list ap;
+   if (!verbose)
+      return;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_WARN(const char *fmt, ...)
+{
+   va_list ap;
+   if (!verbose)
+      return;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   if (!verbose)
+      return;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void)
+{
+   rng_state ^= rng_state << 13;
+   rng_state ^= rng_state >> 17;
+   rng_state ^= rng_state <<  5;
+   return rng_state;
+}
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static size_t pixel_size(enum retro_pixel_format fmt)
+{
+   return fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? 4 : 2;
+}
+
+static double time_filter(rarch_softfilter_t *filt,
+      void *out, size_t out_stride,
+      const void *in, unsigned width, unsigned height, size_t in_stride,
+      unsigned frames)
+{
+   unsigned i;
+   double start;
+
+   /* Warm up caches and let the worker count settle */
+   for (i = 0; i < 40; i++)
+      rarch_softfilter_process(filt, out, out_stride,
+            in, width, height, in_stride);
+
+   start = now_us();
+   for (i = 0; i < frames; i++)
+      rarch_softfilter_process(filt, out, out_stride,
+            in, width, height, in_stride);
+
+   return (now_us() - start) / frames / 1000.0;
+}
+
+static rarch_softfilter_t *new_filter(const char *path, unsigned threads,
+      const bench_size_t *size, bool simd)
+{
+   rarch_softfilter_t *filt;
+   simd_mask = simd ? ~(uint64_t)0 : 0;
+   filt      = rarch_softfilter_new(path, threads,
+         RETRO_PIXEL_FORMAT_RGB565, size->width, size->height);
+   simd_mask = ~(uint64_t)0;
+   return filt;
+}
+
+static bool same_output(const uint8_t *a, const uint8_t *b,
+      size_t stride, size_t row_len, unsigned height)
+{
+   unsigned y;
+   for (y = 0; y < height; y++)
+      if (memcmp(a + y * stride, b + y * stride, row_len))
+         return false;
+   return true;
+}
+
+/* Returns 1 if the SIMD or threaded output differs, -1 if
+ * the preset could not be run at this size. */
+static int bench_filter(const char *path, const bench_size_t *size,
+      unsigned threads, unsigned frames)
+{
+   unsigned y;
+   unsigned out_width, out_height;
+   size_t out_stride, in_stride, out_pix;
+   double ms_plain, ms_simd, ms_threaded;
+   uint8_t *in_buf               = NULL;
+   const uint8_t *in             = NULL;
+   uint8_t *out_plain            = NULL;
+   uint8_t *out_simd             = NULL;
+   uint8_t *out_threaded         = NULL;
+   int ret                       = -1;
+   rarch_softfilter_t *plain     = new_filter(path, 1, size, false);
+   rarch_softfilter_t *simd      = new_filter(path, 1, size, true);
+   rarch_softfilter_t *threaded  = new_filter(path, threads, size, true);
+
+   if (!plain || !simd || !threaded)
+      goto end;
+
+   rarch_softfilter_get_output_size(plain, &out_width, &out_height,
+         size->width, size->height);
+
+   in_stride  = size->width * 2;
+   out_pix    = pixel_size(rarch_softfilter_get_output_format(plain));
+   out_stride = out_width * out_pix;
+
+   /* Several filters peek a line (and a pixel) past the frame edges,
+    * which core framebuffers tolerate, so keep some slack around it. */
+   in_buf       = (uint8_t*)malloc(in_stride * (size->height + 4));
+   out_plain    = (uint8_t*)calloc(out_stride, out_height);
+   out_simd     = (uint8_t*)calloc(out_stride, out_height);
+   out_threaded = (uint8_t*)calloc(out_stride, out_height);
+   if (!in_buf || !out_plain || !out_simd || !out_threaded)
+      goto end;
+
+   for (y = 0; y < in_stride * (size->height + 4); y++)
+      in_buf[y] = (uint8_t)rng();
+   in = in_buf + 2 * in_stride;
+
+   rarch_softfilter_process(plain, out_plain, out_stride,
+         in, size->width, size->height, in_stride);
+   rarch_softfilter_process(simd, out_simd, out_stride,
+         in, size->width, size->height, in_stride);
+   rarch_softfilter_process(threaded, out_threaded, out_stride,
+         in, size->width, size->height, in_stride);
+
+   ret = (same_output(out_plain, out_simd,
+            out_stride, out_width * out_pix, out_height)
+         && same_output(out_plain, out_threaded,
+            out_stride, out_width * out_pix, out_height)) ? 0 : 1;
+
+   ms_plain    = time_filter(plain, out_plain, out_stride,
+         in, size->width, size->height, in_stride, frames);
+   ms_simd     = time_filter(simd, out_simd, out_stride,
+         in, size->width, size->height, in_stride, frames);
+   ms_threaded = time_filter(threaded, out_threaded, out_stride,
+         in, size->width, size->height, in_stride, frames);
+
+   printf("%-58s %4ux%-4u -> %4ux%-4u %8.3f ms %8.3f ms %5.2fx %8.3f ms %5.2fx%s\n",
+         path_basename(path), size->width, size->height,
+         out_width, out_height, ms_plain, ms_simd, ms_plain / ms_simd,
+         ms_threaded, ms_plain / ms_threaded, ret ? "  MISMATCH" : "");
+
+end:
+   free(in_buf);
+   free(out_plain);
+   free(out_simd);
+   free(out_threaded);
+   rarch_softfilter_free(plain);
+   rarch_softfilter_free(simd);
+   rarch_softfilter_free(threaded);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i, j;
+   struct string_list *list = NULL;
+   int failed               = 0;
+   const char *dir          = argc > 1 ? argv[1] : "../../../gfx/video_filters";
+   unsigned threads         = argc > 2 ? strtoul(argv[2], NULL, 0)
+      : cpu_features_get_core_amount();
+   unsigned frames          = argc > 3 ? strtoul(argv[3], NULL, 0) : 60;
+
+   verbose = getenv("VERBOSE") != NULL;
+
+   if (!(list = dir_list_new(dir, "filt", false, false, false, false)))
+   {
+      fprintf(stderr, "Could not list %s\n", dir);
+      return 1;
+   }
+   dir_list_sort(list, false);
+
+   printf("%-58s %-21s %11s %11s %6s %8s%-3u %6s\n",
+         "preset", "size", "plain C", "SIMD", "gain",
+         "threads=", threads, "gain");
+
+   for (i = 0; i < list->size; i++)
+   {
+      for (j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+      {
+         unsigned n = frames / sizes[j].frames_div;
+         int ret    = bench_filter(list->elems[i].data, &sizes[j],
+               threads, n ? n : 1);
+         if (ret < 0)
+            printf("%-58s %4ux%-4u    (not supported)\n",
+                  path_basename(list->elems[i].data),
+                  sizes[j].width, sizes[j].height);
+         else if (ret > 0)
+            failed = 1;
+      }
+   }
+
+   dir_list_free(list);
+
+   if (failed)
+      fprintf(stderr, "SIMD or threaded output differs from plain C.\n");
+   return failed;
+}
@@ -0,0 +1,455 @@
+/* public domain */
+
+/*
+ * Eapine loopback harness.
+ *
+ *    eapine_replay record <port> <capture>
+ *       records every datagram received on <port> (e.g. from a phone
+ *       controller pointed at this machine) into <capture>.
+ *
+ *    eapine_replay synth <capture> <seconds> [ports] [rate]
+ *       writes a synthetic v2 JoypadBatch capture.
+ *
+ *    eapine_replay upload <host> <port> <file> [console]
+ *       uploads <file> with the chunked UploadGameData protocol and
+ *       reports throughput. RetroArch loads it straight from memory.
+ *
+ *    eapine_replay play <host> <port> <capture> [loops]
+ *       replays <capture> to RetroArch with the original pacing.
+ *       v2 packets are re-stamped with a fresh sequence number and the
+ *       current CLOCK_MONOTONIC time, so when <host> is 127.0.0.1
+ *       RetroArch reports the true send->poll latency on exit
+ *       (see "[Eapine] ... sent->poll" in the verbose log).
+ *
+ * Capture format: a sequence of
+ *    uint32_t delay_usec  (since previous datagram, little-endian)
+ *    uint16_t length      (little-endian)
+ *    uint8_t  data[length]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define EAPINE_PROTOCOL_VERSION  2
+#define EAPINE_UPLOAD_GAME_DATA  4
+#define EAPINE_JOYPAD_BATCH      5
+#define EAPINE_HEADER_SIZE       16
+#define EAPINE_RECORD_SIZE       20
+#define EAPINE_MAX_DATAGRAM_SIZE 1024
+#define EAPINE_UPLOAD_CHUNK_SIZE (EAPINE_MAX_DATAGRAM_SIZE - 12)
+#define EAPINE_UPLOAD_WINDOW     32
+
+enum
+{
+   UPLOAD_BEGIN = 0,
+   UPLOAD_CHUNK,
+   UPLOAD_QUERY,
+   UPLOAD_ABORT,
+   UPLOAD_ACK
+};
+
+enum
+{
+   UPLOAD_STATUS_OK = 0,
+   UPLOAD_STATUS_COMPLETE
+};
+
+static uint64_t now_usec(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_nsec / 1000;
+}
+
+static void put_le(uint8_t *p, uint64_t v, unsigned bytes)
+{
+   unsigned i;
+   for (i = 0; i < bytes; i++)
+      p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_le(const uint8_t *p, unsigned bytes)
+{
+   unsigned i;
+   uint64_t v = 0;
+   for (i = 0; i < bytes; i++)
+      v |= (uint64_t)p[i] << (8 * i);
+   return v;
+}
+
+static int write_record(FILE *f, uint32_t delay, const uint8_t *data,
+      uint16_t len)
+{
+   uint8_t hdr[6];
+   put_le(hdr, delay, 4);
+   put_le(hdr + 4, len, 2);
+   return fwrite(hdr, 1, sizeof(hdr), f) == sizeof(hdr)
+      && fwrite(data, 1, len, f) == len;
+}
+
+static int read_record(FILE *f, uint32_t *delay, uint8_t *data,
+      uint16_t *len)
+{
+   uint8_t hdr[6];
+   if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr))
+      return 0;
+   *delay = (uint32_t)get_le(hdr, 4);
+   *len   = (uint16_t)get_le(hdr + 4, 2);
+   if (*len > EAPINE_MAX_DATAGRAM_SIZE)
+      return 0;
+   return fread(data, 1, *len, f) == *len;
+}
+
+static int cmd_record(int port, const char *path)
+{
+   struct sockaddr_in addr;
+   uint8_t buf[EAPINE_MAX_DATAGRAM_SIZE];
+   uint64_t last = 0;
+   FILE *f       = fopen(path, "wb");
+   int s         = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+   if (!f || s < 0)
+   {
+      perror("record");
+      return 1;
+   }
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_port        = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+   if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+   {
+      perror("bind");
+      return 1;
+   }
+
+   fprintf(stderr, "Recording port %d to %s, Ctrl+C to stop.\n", port, path);
+
+   for (;;)
+   {
+      uint64_t now;
+      ssize_t ret = recv(s, buf, sizeof(buf), 0);
+      if (ret < 0)
+         break;
+      now = now_usec();
+      write_record(f, last ? (uint32_t)(now - last) : 0, buf, (uint16_t)ret);
+      fflush(f);
+      last = now;
+   }
+
+   fclose(f);
+   close(s);
+   return 0;
+}
+
+static int cmd_synth(const char *path, int seconds, int ports, int rate)
+{
+   int i, p;
+   uint8_t buf[EAPINE_MAX_DATAGRAM_SIZE];
+   int frames;
+   FILE *f;
+
+   if (ports < 1 || ports > (EAPINE_MAX_DATAGRAM_SIZE - EAPINE_HEADER_SIZE)
+         / EAPINE_RECORD_SIZE || rate < 1)
+   {
+      fprintf(stderr, "Invalid port count or rate.\n");
+      return 1;
+   }
+
+   frames = seconds * rate;
+   f      = fopen(path, "wb");
+
+   if (!f)
+   {
+      perror("synth");
+      return 1;
+   }
+
+   for (i = 0; i < frames; i++)
+   {
+      size_t len = EAPINE_HEADER_SIZE + (size_t)ports * EAPINE_RECORD_SIZE;
+
+      memset(buf, 0, len);
+      put_le(buf, EAPINE_JOYPAD_BATCH, 2);
+      buf[2] = EAPINE_PROTOCOL_VERSION;
+      buf[3] = (uint8_t)ports;
+      put_le(buf + 4, (uint32_t)i, 4);
+
+      for (p = 0; p < ports; p++)
+      {
+         uint8_t *rec = buf + EAPINE_HEADER_SIZE + p * EAPINE_RECORD_SIZE;
+         rec[0]       = (uint8_t)p;
+         /* Walk through the 16 RetroPad buttons, one per 1/4 second */
+         put_le(rec + 4, 1ULL << ((i * 4 / rate + p) % 16), 8);
+         /* Left stick traces a square wave */
+         put_le(rec + 12, (uint16_t)((i / rate) & 1 ? 0x7fff : 0x8001), 2);
+      }
+
+      write_record(f, i ? 1000000 / rate : 0, buf, (uint16_t)len);
+   }
+
+   fclose(f);
+   fprintf(stderr, "Wrote %d packets (%d port(s), %d Hz) to %s.\n",
+         frames, ports, rate, path);
+   return 0;
+}
+
+static int cmd_play(const char *host, int port, const char *path, int loops)
+{
+   struct sockaddr_in addr;
+   uint8_t buf[EAPINE_MAX_DATAGRAM_SIZE];
+   uint32_t sequence = 1;
+   unsigned packets  = 0;
+   uint64_t late     = 0;
+   int s             = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   FILE *f           = fopen(path, "rb");
+
+   if (!f || s < 0)
+   {
+      perror("play");
+      return 1;
+   }
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port   = htons(port);
+   if (inet_aton(host, &addr.sin_addr) == 0)
+   {
+      fprintf(stderr, "inet_aton() failed\n");
+      return 1;
+   }
+
+   while (loops-- > 0)
+   {
+      uint32_t delay;
+      uint16_t len;
+      uint64_t deadline = now_usec();
+
+      rewind(f);
+
+      while (read_record(f, &delay, buf, &len))
+      {
+         uint64_t now;
+
+         deadline += delay;
+         while ((now = now_usec()) < deadline)
+            usleep((useconds_t)(deadline - now > 1000 ? 1000 : deadline - now));
+         late += now - deadline;
+
+         if (     len >= EAPINE_HEADER_SIZE
+               && get_le(buf, 2) == EAPINE_JOYPAD_BATCH
+               && buf[2] == EAPINE_PROTOCOL_VERSION)
+         {
+            put_le(buf + 4, sequence++, 4);
+            put_le(buf + 8, now_usec(), 8);
+         }
+
+         if (sendto(s, buf, len, 0, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+            perror("sendto");
+         packets++;
+      }
+   }
+
+   fprintf(stderr, "Sent %u packets, average pacing error %u us.\n",
+         packets, packets ? (unsigned)(late / packets) : 0);
+
+   fclose(f);
+   close(s);
+   return 0;
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+   size_t i;
+   crc = ~crc;
+   for (i = 0; i < len; i++)
+   {
+      unsigned k;
+      crc ^= data[i];
+      for (k = 0; k < 8; k++)
+         crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+   }
+   return ~crc;
+}
+
+/* Waits for an Ack; returns the acknowledged offset or -1 on timeout */
+static int64_t upload_wait_ack(int s, uint32_t id, int *status)
+{
+   uint8_t buf[64];
+
+   for (;;)
+   {
+      ssize_t ret = recv(s, buf, sizeof(buf), 0);
+      if (ret < 0)
+         return -1;
+      if (     ret >= 12
+            && get_le(buf, 2) == EAPINE_UPLOAD_GAME_DATA
+            && buf[2] == UPLOAD_ACK
+            && get_le(buf + 4, 4) == id)
+      {
+         *status = buf[3];
+         return (int64_t)get_le(buf + 8, 4);
+      }
+   }
+}
+
+static int cmd_upload(const char *host, int port, const char *path,
+      int console)
+{
+   struct sockaddr_in addr;
+   struct timeval tv;
+   uint8_t buf[EAPINE_MAX_DATAGRAM_SIZE];
+   uint8_t *data;
+   long size;
+   uint64_t start;
+   uint32_t sent    = 0;
+   uint32_t acked   = 0;
+   int status       = UPLOAD_STATUS_OK;
+   uint32_t id      = (uint32_t)now_usec();
+   const char *name = strrchr(path, '/');
+   int s            = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+   FILE *f          = fopen(path, "rb");
+
+   if (!f || s < 0)
+   {
+      perror("upload");
+      return 1;
+   }
+
+   fseek(f, 0, SEEK_END);
+   size = ftell(f);
+   rewind(f);
+   if (size <= 0 || !(data = (uint8_t*)malloc(size))
+         || fread(data, 1, size, f) != (size_t)size)
+   {
+      fprintf(stderr, "Failed to read %s.\n", path);
+      return 1;
+   }
+   fclose(f);
+   name = name ? name + 1 : path;
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port   = htons(port);
+   if (inet_aton(host, &addr.sin_addr) == 0)
+   {
+      fprintf(stderr, "inet_aton() failed\n");
+      return 1;
+   }
+   connect(s, (struct sockaddr*)&addr, sizeof(addr));
+
+   tv.tv_sec  = 0;
+   tv.tv_usec = 200000;
+   setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+   start = now_usec();
+
+   /* Begin (retried until acknowledged) */
+   for (;;)
+   {
+      size_t name_len = strlen(name);
+      int64_t ret;
+
+      put_le(buf, EAPINE_UPLOAD_GAME_DATA, 2);
+      buf[2] = UPLOAD_BEGIN;
+      buf[3] = 0;
+      put_le(buf + 4, id, 4);
+      put_le(buf + 8, (uint32_t)size, 4);
+      put_le(buf + 12, crc32_update(0, data, size), 4);
+      put_le(buf + 16, (uint16_t)console, 2);
+      memcpy(buf + 18, name, name_len + 1);
+      send(s, buf, 18 + name_len + 1, 0);
+
+      if ((ret = upload_wait_ack(s, id, &status)) >= 0)
+      {
+         if (status != UPLOAD_STATUS_OK)
+         {
+            fprintf(stderr, "Upload refused (status %d).\n", status);
+            return 1;
+         }
+         acked = sent = (uint32_t)ret;
+         break;
+      }
+   }
+
+   /* Chunks, keeping up to EAPINE_UPLOAD_WINDOW chunks in flight */
+   while (status != UPLOAD_STATUS_COMPLETE)
+   {
+      int64_t ret;
+
+      while (     sent < (uint32_t)size
+            && sent - acked < EAPINE_UPLOAD_WINDOW * EAPINE_UPLOAD_CHUNK_SIZE)
+      {
+         uint32_t len = (uint32_t)size - sent;
+         if (len > EAPINE_UPLOAD_CHUNK_SIZE)
+            len = EAPINE_UPLOAD_CHUNK_SIZE;
+
+         put_le(buf, EAPINE_UPLOAD_GAME_DATA, 2);
+         buf[2] = UPLOAD_CHUNK;
+         buf[3] = 0;
+         put_le(buf + 4, id, 4);
+         put_le(buf + 8, sent, 4);
+         memcpy(buf + 12, data + sent, len);
+         send(s, buf, 12 + len, 0);
+         sent += len;
+      }
+
+      if ((ret = upload_wait_ack(s, id, &status)) < 0)
+      {
+         /* Timed out: resume from the last acknowledged offset */
+         sent = acked;
+         continue;
+      }
+
+      if (status != UPLOAD_STATUS_OK && status != UPLOAD_STATUS_COMPLETE)
+      {
+         fprintf(stderr, "Upload failed (status %d).\n", status);
+         return 1;
+      }
+
+      if ((uint32_t)ret > acked)
+         acked = (uint32_t)ret;
+      else if ((uint32_t)ret < sent && status == UPLOAD_STATUS_OK)
+         sent = (uint32_t)ret; /* gap detected, rewind */
+   }
+
+   fprintf(stderr, "Uploaded %ld bytes in %.1f ms.\n", size,
+         (now_usec() - start) / 1000.0);
+
+   free(data);
+   close(s);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc >= 4 && !strcmp(argv[1], "record"))
+      return cmd_record(atoi(argv[2]), argv[3]);
+   if (argc >= 4 && !strcmp(argv[1], "synth"))
+      return cmd_synth(argv[2], atoi(argv[3]),
+            argc > 4 ? atoi(argv[4]) : 1,
+            argc > 5 ? atoi(argv[5]) : 120);
+   if (argc >= 5 && !strcmp(argv[1], "upload"))
+      return cmd_upload(argv[2], atoi(argv[3]), argv[4],
+            argc > 5 ? atoi(argv[5]) : 0);
+   if (argc >= 5 && !strcmp(argv[1], "play"))
+      return cmd_play(argv[2], atoi(argv[3]), argv[4],
+            argc > 5 ? atoi(argv[5]) : 1);
+
+   fprintf(stderr,
+         "Usage: %s record <port> <capture>\n"
+         "       %s synth <capture> <seconds> [ports] [rate]\n"
+         "       %s upload <host> <port> <file> [console]\n"
+         "       %s play <host> <port> <capture> [loops]\n",
+         argv[0], argv[0], argv[0], argv[0]);
+   return 1;
+}
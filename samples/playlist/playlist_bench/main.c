@@ -0,0 +1,487 @@
+/* public domain */
+
+/*
+ * Playlist lookup benchmark.
+ *
+ *    playlist_bench [entries] [lookups] [history]
+ *
+ * Builds a synthetic playlist of <entries> items (default 100000)
+ * the way a manual content scan does, checking
+ * playlist_entry_exists() before every playlist_push(); one in eight
+ * items refers to a file inside a zip archive. It then times
+ * <lookups> (default 10000) hits and misses through the path index
+ * against a plain scan of the entries with
+ * playlist_path_matches_entry(), which is what every lookup used
+ * to do, and checks that both agree. The playlist is written out,
+ * loaded back, sorted and has entries deleted by path on the way,
+ * which all make the next lookup rebuild the index.
+ *
+ * Loading is timed both parsing the playlist file and from the
+ * binary cache written alongside it, and both have to produce the
+ * same entries.
+ *
+ * Finally a history playlist of <history> entries (default 200) sees
+ * 1000 content launches through command_playlist_push_write(), each
+ * followed by a label update one time in four and one in sixteen
+ * launching a two ROM subsystem, which are timed
+ * against pushing and rewriting the whole playlist file the way they
+ * used to be saved. With HAVE_THREADS the journal is written on the
+ * task thread, so the time is what launching content waits for.
+ * The journal has to replay to the same entries, including after a
+ * torn record is appended to it.
+ *
+ * The content paths do not exist, so symlink resolution only costs
+ * what it costs for missing files.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdarg.h>
+
+#include "../../../playlist.c"
+
+/* The parts of RetroArch playlist.c links against,
+ * none of which are reached by the benchmark. */
+bool core_info_core_file_id_is_equal(const char *core_path_a,
+      const char *core_path_b) { return false; }
+bool core_info_find(const char *core_path, core_info_t **core_info) { return false; }
+struct string_list *file_archive_get_file_list(const char *path,
+      const char *valid_exts) { return NULL; }
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { va_list ap; va_start(ap, fmt); vfprintf(stderr, fmt, ap); va_end(ap); }
+void RARCH_ERR(const char *fmt, ...) { va_list ap; va_start(ap, fmt); vfprintf(stderr, fmt, ap); va_end(ap); }
+
+#define BENCH_PLAYLIST "playlist_bench.lpl"
+#define BENCH_HISTORY  "playlist_bench_history.lpl"
+#define BENCH_LAUNCHES 1000
+#define BENCH_CORE     "/cores/bench_libretro.so"
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static uint32_t xorshift(uint32_t *s)
+{
+   *s ^= *s << 13;
+   *s ^= *s >> 17;
+   *s ^= *s << 5;
+   return *s;
+}
+
+/* Item n of the synthetic collection; items past
+ * the end of it are lookups that miss */
+static void item_path(char *s, size_t len, unsigned n)
+{
+   if (n % 8 == 7)
+      snprintf(s, len, "/roms/system %u/pack %u.zip#Game %u (USA).bin",
+            n % 31, n / 8, n);
+   else
+      snprintf(s, len, "/roms/system %u/Game %u (USA).bin", n % 31, n);
+}
+
+/* First entry matching 'path', the way every
+ * lookup used to find it */
+static const struct playlist_entry *linear_find(playlist_t *playlist,
+      const char *path)
+{
+   size_t i;
+   const struct playlist_entry *found = NULL;
+   playlist_path_id_t *path_id        = playlist_path_id_init(path);
+
+   for (i = 0; i < RBUF_LEN(playlist->entries); i++)
+      if (playlist_path_matches_entry(path_id,
+               &playlist->entries[i], &playlist->config))
+      {
+         found = &playlist->entries[i];
+         break;
+      }
+
+   playlist_path_id_free(path_id);
+   return found;
+}
+
+static const struct playlist_entry *index_find(playlist_t *playlist,
+      const char *path)
+{
+   const struct playlist_entry *found = NULL;
+   playlist_get_index_by_path(playlist, path, &found);
+   return found;
+}
+
+/* Times 'lookups' random queries, half of them hits,
+ * and returns the average in nanoseconds. 'found'
+ * receives the results in order. */
+static bool same_string(const char *a, const char *b)
+{
+   return (!a || !*a) ? (!b || !*b) : (b && !strcmp(a, b));
+}
+
+static bool same_roms(const struct string_list *a,
+      const struct string_list *b)
+{
+   size_t i;
+   size_t size = a ? a->size : 0;
+
+   if (size != (b ? b->size : 0))
+      return false;
+   for (i = 0; i < size; i++)
+      if (!same_string(a->elems[i].data, b->elems[i].data))
+         return false;
+   return true;
+}
+
+static bool same_entries(playlist_t *a, playlist_t *b)
+{
+   size_t i;
+
+   if (playlist_size(a) != playlist_size(b))
+      return false;
+
+   for (i = 0; i < playlist_size(a); i++)
+   {
+      const struct playlist_entry *ea = &a->entries[i];
+      const struct playlist_entry *eb = &b->entries[i];
+
+      if (     !same_string(ea->path,      eb->path)
+            || !same_string(ea->label,     eb->label)
+            || !same_string(ea->core_path, eb->core_path)
+            || !same_string(ea->core_name, eb->core_name)
+            || !same_string(ea->crc32,     eb->crc32)
+            || !same_string(ea->db_name,   eb->db_name)
+            || !same_string(ea->subsystem_ident, eb->subsystem_ident)
+            || !same_string(ea->subsystem_name,  eb->subsystem_name)
+            || !same_roms(ea->subsystem_roms, eb->subsystem_roms)
+            || ea->entry_slot != eb->entry_slot)
+      {
+         fprintf(stderr, "Entry %u differs.\n", (unsigned)i);
+         return false;
+      }
+   }
+
+   return    same_string(a->default_core_path, b->default_core_path)
+          && same_string(a->default_core_name, b->default_core_name)
+          && a->sort_mode == b->sort_mode;
+}
+
+static double run_lookups(playlist_t *playlist, unsigned entries,
+      unsigned lookups, bool linear, const struct playlist_entry **found)
+{
+   char path[PATH_MAX_LENGTH];
+   unsigned i;
+   uint32_t seed = 0x12345678;
+   double total  = 0;
+
+   for (i = 0; i < lookups; i++)
+   {
+      double t;
+      unsigned n = xorshift(&seed) % entries;
+
+      item_path(path, sizeof(path), (i & 1) ? n : entries + n);
+      t          = now_us();
+      found[i]   = linear
+         ? linear_find(playlist, path) : index_find(playlist, path);
+      total     += now_us() - t;
+   }
+
+   return total * 1000.0 / lookups;
+}
+
+static bool check_lookups(const char *name, playlist_t *playlist,
+      unsigned entries, unsigned lookups,
+      const struct playlist_entry **by_index,
+      const struct playlist_entry **by_scan)
+{
+   unsigned i;
+   double index_ns = run_lookups(playlist, entries, lookups, false, by_index);
+   double scan_ns  = run_lookups(playlist, entries, lookups, true,  by_scan);
+
+   printf("%-8s index %10.0f ns/lookup   scan %12.0f ns/lookup\n",
+         name, index_ns, scan_ns);
+
+   for (i = 0; i < lookups; i++)
+      if (by_index[i] != by_scan[i])
+      {
+         fprintf(stderr, "Lookup %u disagrees after %s.\n", i, name);
+         return false;
+      }
+
+   return true;
+}
+
+static void delete_playlist(const char *path)
+{
+   playlist_delete_cache(path);
+   remove(path);
+}
+
+/* Launches content 'launches' times, either journalling
+ * the changes or rewriting the playlist file each time,
+ * and returns the average time taken per launch */
+static double run_launches(playlist_t *playlist, unsigned launches,
+      bool journal)
+{
+   char path[PATH_MAX_LENGTH];
+   char label[64];
+   struct playlist_entry entry;
+   unsigned i;
+   union string_list_elem_attr attr;
+   struct string_list *roms = NULL;
+   uint32_t seed            = 0x12345678;
+   double total             = 0;
+
+   attr.i = 0;
+
+   for (i = 0; i < launches; i++)
+   {
+      double t;
+      unsigned n = xorshift(&seed) % (playlist->config.capacity * 3 / 2);
+
+      memset(&entry, 0, sizeof(entry));
+      item_path(path, sizeof(path), n);
+      entry.path      = path;
+      entry.core_path = BENCH_CORE;
+      entry.core_name = "Bench";
+
+      if (i % 16 == 3 && (roms = string_list_new()))
+      {
+         string_list_append(roms, path, attr);
+         item_path(path, sizeof(path), n + 1);
+         string_list_append(roms, path, attr);
+         entry.subsystem_ident = "sgb";
+         entry.subsystem_name  = "Super Game Boy";
+         entry.subsystem_roms  = roms;
+      }
+
+      t = now_us();
+      if (journal)
+         command_playlist_push_write(playlist, &entry);
+      else if (playlist_push(playlist, &entry))
+         playlist_write_file(playlist);
+      total += now_us() - t;
+
+      if (i % 4 == 0)
+      {
+         memset(&entry, 0, sizeof(entry));
+         snprintf(label, sizeof(label), "Launch %u", i);
+         entry.label = label;
+
+         t = now_us();
+         if (journal)
+            command_playlist_update_write(playlist, 0, &entry);
+         else
+         {
+            playlist_update(playlist, 0, &entry);
+            playlist_write_file(playlist);
+         }
+         total += now_us() - t;
+      }
+
+      string_list_free(roms);
+      roms = NULL;
+
+#ifdef HAVE_THREADS
+      task_queue_check();
+#endif
+   }
+
+   return total / launches;
+}
+
+static bool run_history(unsigned size)
+{
+   char path[PATH_MAX_LENGTH];
+   playlist_config_t config;
+   playlist_t *history, *loaded;
+   double rewrite_us, journal_us;
+   FILE *file;
+   bool ok = true;
+
+   memset(&config, 0, sizeof(config));
+   config.capacity = size;
+   playlist_config_set_path(&config, BENCH_HISTORY);
+   delete_playlist(BENCH_HISTORY);
+
+   if (!(history = playlist_init(&config)))
+      return false;
+   rewrite_us = run_launches(history, BENCH_LAUNCHES, false);
+   playlist_free(history);
+   delete_playlist(BENCH_HISTORY);
+
+   if (!(history = playlist_init(&config)))
+      return false;
+   journal_us = run_launches(history, BENCH_LAUNCHES, true);
+
+   printf("history  %u entries, %u launches: rewrite %.1f us/launch, "
+         "journal %.1f us/launch\n",
+         size, BENCH_LAUNCHES, rewrite_us, journal_us);
+
+   /* Loading flushes the journal, then replays it */
+   loaded = playlist_init(&config);
+   ok     = loaded && same_entries(history, loaded);
+   playlist_free(loaded);
+
+   /* A torn record is ignored, and the journal
+    * compacted before anything else is appended */
+   playlist_journal_get_path(path, BENCH_HISTORY, sizeof(path));
+   if ((file = fopen(path, "ab")))
+   {
+      fwrite("\x40\0\0\0torn", 1, 8, file);
+      fclose(file);
+   }
+   loaded  = playlist_init(&config);
+   ok      = ok && loaded && same_entries(history, loaded);
+   playlist_free(history);
+   if (!(history = loaded))
+      return false;
+   run_launches(history, 8, true);
+   loaded  = playlist_init(&config);
+   ok      = ok && loaded && same_entries(history, loaded);
+   playlist_free(loaded);
+
+   playlist_free(history);
+   delete_playlist(BENCH_HISTORY);
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   char path[PATH_MAX_LENGTH];
+   playlist_config_t config;
+   struct playlist_entry entry;
+   const struct playlist_entry *found = NULL;
+   const struct playlist_entry **by_index, **by_scan;
+   playlist_t *playlist, *parsed;
+   unsigned i, deleted;
+   double t;
+   bool ok           = true;
+   unsigned entries  = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+   unsigned lookups  = argc > 2 ? strtoul(argv[2], NULL, 0) : 10000;
+   unsigned history  = argc > 3 ? strtoul(argv[3], NULL, 0) : 200;
+
+   if (!entries || !lookups || !history)
+      return 1;
+
+#ifdef HAVE_THREADS
+   task_queue_init(true, NULL);
+#endif
+   playlist_journal_init();
+
+   by_index = (const struct playlist_entry**)calloc(lookups, sizeof(*by_index));
+   by_scan  = (const struct playlist_entry**)calloc(lookups, sizeof(*by_scan));
+
+   memset(&config, 0, sizeof(config));
+   config.capacity            = entries;
+   config.fuzzy_archive_match = true;
+   remove(BENCH_PLAYLIST);
+   playlist_config_set_path(&config, BENCH_PLAYLIST);
+
+   if (!by_index || !by_scan || !(playlist = playlist_init(&config)))
+      return 1;
+
+   /* Manual scan */
+   memset(&entry, 0, sizeof(entry));
+   entry.path      = path;
+   entry.core_path = BENCH_CORE;
+   entry.core_name = "Bench";
+
+   t = now_us();
+   for (i = 0; i < entries; i++)
+   {
+      item_path(path, sizeof(path), i);
+      if (!playlist_entry_exists(playlist, path))
+         playlist_push(playlist, &entry);
+   }
+   t = now_us() - t;
+   printf("%u entries, scan %.2f us/entry (exists + push)\n",
+         (unsigned)playlist_size(playlist), t / entries);
+   ok = ok && playlist_size(playlist) == entries;
+
+   /* Pushing an entry already present bumps it to the top */
+   item_path(path, sizeof(path), entries / 2);
+   playlist_push(playlist, &entry);
+   ok = ok && index_find(playlist, path) == &playlist->entries[0];
+
+   ok = ok && check_lookups("scanned", playlist,
+         entries, lookups, by_index, by_scan);
+
+   /* Load, once parsing the playlist file (which writes
+    * the binary cache) and once from the binary cache */
+   playlist_write_file(playlist);
+   playlist_free(playlist);
+   playlist_delete_cache(BENCH_PLAYLIST);
+   t        = now_us();
+   parsed   = playlist_init(&config);
+   printf("parse    %.1f ms (including writing the cache)\n",
+         (now_us() - t) / 1000.0);
+   t        = now_us();
+   playlist = playlist_init(&config);
+   printf("load     %.1f ms from the cache%s",
+         (now_us() - t) / 1000.0,
+         (playlist->flags & CNT_PLAYLIST_FLG_MAPPED) ? " (mapped)" : "");
+   ok = ok && playlist->cache_data && same_entries(parsed, playlist);
+   playlist_free(parsed);
+   item_path(path, sizeof(path), 0);
+   t        = now_us();
+   found    = index_find(playlist, path);
+   printf(", first lookup (builds the index) %.1f ms\n",
+         (now_us() - t) / 1000.0);
+   ok = ok && found && check_lookups("loaded", playlist,
+         entries, lookups, by_index, by_scan);
+
+   /* Sort */
+   playlist_set_sort_mode(playlist, PLAYLIST_SORT_MODE_ALPHABETICAL);
+   playlist_qsort(playlist);
+   ok = ok && check_lookups("sorted", playlist,
+         entries, lookups, by_index, by_scan);
+
+   /* A bare archive path matches the entries inside it */
+   item_path(path, sizeof(path), 7);
+   *strchr(path, '#') = '\0';
+   ok = ok && index_find(playlist, path) == linear_find(playlist, path)
+      && index_find(playlist, path);
+
+   /* Delete every 16th item */
+   t       = now_us();
+   deleted = 0;
+   for (i = 0; i < entries; i += 16, deleted++)
+   {
+      item_path(path, sizeof(path), i);
+      playlist_delete_by_path(playlist, path);
+   }
+   printf("delete   %.2f us/entry\n", (now_us() - t) / deleted);
+   ok = ok && playlist_size(playlist) == entries - deleted
+      && check_lookups("deleted", playlist,
+            entries, lookups, by_index, by_scan);
+
+   /* Updated entries survive a round trip through the cache */
+   memset(&entry, 0, sizeof(entry));
+   entry.label = "Updated";
+   playlist_update(playlist, 1, &entry);
+   playlist_write_file(playlist);
+   parsed = playlist_init(&config);
+   ok = ok && parsed && parsed->cache_data
+      && same_entries(playlist, parsed)
+      && !strcmp(parsed->entries[1].label, "Updated");
+   playlist_free(parsed);
+
+   playlist_free(playlist);
+   delete_playlist(BENCH_PLAYLIST);
+   free(by_index);
+   free(by_scan);
+
+   ok = run_history(history) && ok;
+
+#ifdef HAVE_THREADS
+   task_queue_deinit();
+#endif
+   playlist_journal_deinit();
+
+   if (!ok)
+      fprintf(stderr, "FAILED\n");
+   return ok ? 0 : 1;
+}
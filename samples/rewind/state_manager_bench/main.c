@@ -0,0 +1,368 @@
+/* public domain */
+
+/*
+ * Rewind delta engine microbenchmark.
+ *
+ *    state_manager_bench synth <state_size> <frames> [dirty_permille] [buffer_mb]
+ *       generates a deterministic sequence of states where roughly
+ *       <dirty_permille>/1000 of the bytes change every frame, in runs
+ *       (default 20, i.e. 2%).
+ *
+ *    state_manager_bench file <state_size> <states_file> [buffer_mb]
+ *       replays recorded states. <states_file> is a plain concatenation
+ *       of savestates of <state_size> bytes each, e.g. dumped from
+ *       content_serialize_state_rewind() once per frame.
+ *
+ * Every sequence is pushed through the real state_manager.c ring
+ * (compiled in below), first with inline compression and, when built
+ * with HAVE_THREADS, again with the background compression thread.
+ * The rewound states are checked against the originals.
+ *
+ * Reported:
+ *    push    ns/byte spent in state_manager_push_do() on the caller's
+ *            thread (what the frame pays; with the thread this is
+ *            whatever compression did not overlap the next frame)
+ *    pop     ns/byte spent rewinding through the hot ring
+ *    cold    average time to seek to a cold tier entry
+ *    patch   average compressed delta size per frame
+ *    hot     frames that fit in the hot ring, which gets half of the
+ *            <buffer_mb> rewind buffer (default 64 MB)
+ *    history how far back rewinding got, through both tiers
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../../state_manager.c"
+
+/* The parts of RetroArch state_manager.c links against,
+ * none of which are reached by the benchmark. */
+void rarch_perf_register(struct retro_perf_counter *perf) { }
+const char *msg_hash_to_str(enum msg_hash_enums msg) { return ""; }
+bool core_info_get_current_core(core_info_t **core) { return false; }
+bool core_info_current_supports_rewind(void) { return false; }
+bool audio_driver_has_callback(void) { return false; }
+size_t content_get_serialized_size_rewind(void) { return 0; }
+bool content_serialize_state_rewind(void *buffer, size_t buffer_size) { return false; }
+bool content_deserialize_state(const void *data, size_t size) { return false; }
+void runloop_msg_queue_push(const char *msg, unsigned prio,
+      unsigned duration, bool flush, char *title,
+      enum message_queue_icon icon, enum message_queue_category category) { }
+void audio_driver_frame_is_reverse(void) { }
+void audio_driver_setup_rewind(void) { }
+void audio_driver_sample(int16_t left, int16_t right) { }
+size_t audio_driver_sample_batch(const int16_t *data, size_t frames) { return frames; }
+void audio_driver_sample_rewind(int16_t left, int16_t right) { }
+size_t audio_driver_sample_batch_rewind(const int16_t *data, size_t frames) { return frames; }
+bool retroarch_ctl(enum rarch_ctl_state state, void *data) { return false; }
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+void RARCH_ERR(const char *fmt, ...) { }
+
+typedef struct bench_source
+{
+   FILE *file;
+   uint8_t *state;
+   size_t size;
+   unsigned frames;
+   unsigned dirty_permille;
+   uint32_t seed;
+} bench_source_t;
+
+typedef struct bench_result
+{
+   double push_ns;
+   double pop_ns;
+   double cold_us;
+   uint64_t patch_bytes;
+   size_t cold_bytes;
+   unsigned patches;
+   unsigned entries;
+   unsigned ring_frames;
+   unsigned cold_entries;
+   unsigned cold_pops;
+   unsigned history;
+   unsigned verified;
+   bool wrapped;
+   bool ok;
+} bench_result_t;
+
+static double now_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t xorshift(uint32_t *s)
+{
+   *s ^= *s << 13;
+   *s ^= *s >> 17;
+   *s ^= *s << 5;
+   return *s;
+}
+
+static uint64_t fnv1a(const uint8_t *data, size_t len)
+{
+   uint64_t h = 0xcbf29ce484222325ULL;
+   size_t i;
+   for (i = 0; i < len; i++)
+   {
+      h ^= data[i];
+      h *= 0x100000001b3ULL;
+   }
+   return h;
+}
+
+static bool source_rewind(bench_source_t *src)
+{
+   if (src->file)
+      return fseek(src->file, 0, SEEK_SET) == 0;
+
+   src->seed = 0x12345678;
+   memset(src->state, 0, src->size);
+   return true;
+}
+
+/* Produces the next state into src->state. */
+static bool source_next(bench_source_t *src)
+{
+   size_t changed, target;
+
+   if (src->file)
+      return fread(src->state, 1, src->size, src->file) == src->size;
+
+   /* Mimic RAM/VRAM traffic: short runs of small values, mostly
+    * in a working set at the start of the state, plus a counter
+    * that always changes. */
+   target  = (size_t)((uint64_t)src->size * src->dirty_permille / 1000);
+   changed = 0;
+   while (changed < target)
+   {
+      size_t len  = 1 + xorshift(&src->seed) % 64;
+      size_t span = (xorshift(&src->seed) & 7) ? src->size / 64 + 1 : src->size;
+      size_t pos  = xorshift(&src->seed) % span;
+      size_t i;
+
+      if (pos + len > src->size)
+         len = src->size - pos;
+      for (i = 0; i < len; i++)
+         src->state[pos + i] = (uint8_t)(xorshift(&src->seed) & 0x1f);
+      changed += len;
+   }
+   src->state[0]++;
+   return true;
+}
+
+static void run(bench_source_t *src, size_t buffer_size,
+      bool threaded, bench_result_t *res)
+{
+   unsigned i;
+   unsigned hot_pops      = 0;
+   double push = 0, pop = 0, cold = 0;
+   uint64_t *hashes       = (uint64_t*)calloc(src->frames, sizeof(*hashes));
+   state_manager_t *state = state_manager_new(src->size, buffer_size);
+
+   memset(res, 0, sizeof(*res));
+
+   if (!state || !hashes || !source_rewind(src))
+      goto end;
+
+#ifdef HAVE_THREADS
+   if (!threaded)
+      state_manager_thread_free(state);
+   else if (!state->thread)
+      goto end;
+#endif
+
+   for (i = 0; i < src->frames; i++)
+   {
+      void *where    = NULL;
+      double t;
+      const uint8_t *head;
+
+      if (!source_next(src))
+         break;
+      hashes[i] = fnv1a(src->state, src->size);
+
+      state_manager_push_where(state, &where);
+      memcpy(where, src->state, src->size);
+
+      head = state->head;
+      t    = now_ns();
+      state_manager_push_do(state);
+      push += now_ns() - t;
+
+      /* Patch sizes are only known up front without the thread. */
+      if (!threaded && state->head != head)
+      {
+         if (state->head > head)
+            res->patch_bytes += state->head - head;
+         else
+         {
+            res->patch_bytes += state->head - state->data;
+            res->wrapped      = true;
+         }
+         res->patches++;
+      }
+   }
+   src->frames   = i;
+#ifdef HAVE_THREADS
+   state_manager_wait(state);
+#endif
+   res->push_ns      = push / ((double)src->size * src->frames);
+   res->entries      = state->entries;
+   res->cold_entries = (unsigned)state->cold_count;
+   res->cold_bytes   = state->cold_bytes;
+
+   if (res->patches)
+      res->ring_frames = (unsigned)(state->capacity /
+            (res->patch_bytes / (double)res->patches));
+
+   /* Rewind as far as both tiers go and check every state. */
+   res->ok = true;
+   for (;;)
+   {
+      const void *data = NULL;
+      bool is_cold     = !state->thisblock_valid
+         && state->head == state->tail;
+      double t         = now_ns();
+      bool popped      = state_manager_pop(state, &data);
+      double elapsed   = now_ns() - t;
+
+      if (!popped)
+         break;
+
+      if (is_cold)
+      {
+         cold += elapsed;
+         res->cold_pops++;
+      }
+      else
+      {
+         pop  += elapsed;
+         hot_pops++;
+      }
+
+      /* state->frame counts pushes from 1. */
+      i = (unsigned)state->frame - 1;
+      if (fnv1a((const uint8_t*)data, src->size) != hashes[i])
+      {
+         fprintf(stderr, "Mismatch rewinding to frame %u.\n", i);
+         res->ok = false;
+         break;
+      }
+      res->history = src->frames - i;
+      res->verified++;
+   }
+   if (hot_pops)
+      res->pop_ns  = pop / ((double)src->size * hot_pops);
+   if (res->cold_pops)
+      res->cold_us = cold / res->cold_pops / 1000.0;
+
+end:
+   if (state)
+   {
+      state_manager_free(state);
+      free(state);
+   }
+   free(hashes);
+}
+
+static void report(const char *name, const bench_result_t *res)
+{
+   printf("%-8s push %6.3f ns/B  pop %6.3f ns/B  cold %8.1f us\n",
+         name, res->push_ns, res->pop_ns, res->cold_us);
+   if (res->patches)
+      printf("         patch %8.0f B  hot %u frames%s  ",
+            res->patch_bytes / (double)res->patches,
+            res->wrapped ? res->entries : res->ring_frames,
+            res->wrapped ? "" : " (est.)");
+   else
+      printf("         ");
+   printf("cold %u entries in %u KB  history %u frames "
+         "(%u verified, %u from cold%s)\n",
+         res->cold_entries, (unsigned)(res->cold_bytes / 1024),
+         res->history, res->verified, res->cold_pops,
+         res->ok ? "" : ", FAILED");
+}
+
+int main(int argc, char *argv[])
+{
+   bench_result_t res;
+   bench_source_t src;
+   size_t buffer_size = 64 * 1024 * 1024;
+   int    buffer_arg  = 0;
+   const char *diff   =
+#if __SSE2__
+      "SSE2";
+#elif defined(STATE_MANAGER_NEON)
+      "NEON";
+#else
+      "scalar";
+#endif
+
+   memset(&src, 0, sizeof(src));
+
+   if (argc >= 4 && !strcmp(argv[1], "synth"))
+   {
+      src.size           = strtoul(argv[2], NULL, 0);
+      src.frames         = strtoul(argv[3], NULL, 0);
+      src.dirty_permille = argc > 4 ? strtoul(argv[4], NULL, 0) : 20;
+      buffer_arg         = 5;
+   }
+   else if (argc >= 4 && !strcmp(argv[1], "file"))
+   {
+      if (!(src.file = fopen(argv[3], "rb")))
+      {
+         fprintf(stderr, "Cannot open %s.\n", argv[3]);
+         return 1;
+      }
+      src.size   = strtoul(argv[2], NULL, 0);
+      fseek(src.file, 0, SEEK_END);
+      src.frames = src.size ? (unsigned)(ftell(src.file) / src.size) : 0;
+      buffer_arg = 4;
+   }
+   else
+   {
+      fprintf(stderr,
+            "Usage: %s synth <state_size> <frames> [dirty_permille] [buffer_mb]\n"
+            "       %s file <state_size> <states_file> [buffer_mb]\n",
+            argv[0], argv[0]);
+      return 1;
+   }
+
+   if (argc > buffer_arg)
+      buffer_size = strtoul(argv[buffer_arg], NULL, 0) * 1024 * 1024;
+
+   if (!src.size || !src.frames
+         || !(src.state = (uint8_t*)calloc(src.size, 1)))
+      return 1;
+
+#ifdef STATE_MANAGER_AVX2
+   if (cpu_features_get() & RETRO_SIMD_AVX2)
+      diff = "AVX2";
+#endif
+
+   printf("%u frames of %u bytes, %u MB ring, diff: %s\n",
+         src.frames, (unsigned)src.size,
+         (unsigned)(buffer_size / (1024 * 1024)), diff);
+
+   run(&src, buffer_size, false, &res);
+   report("inline", &res);
+#ifdef HAVE_THREADS
+   run(&src, buffer_size, true, &res);
+   if (res.verified)
+      report("threaded", &res);
+   else
+      printf("threaded (not used below %u byte states or on one core)\n",
+            STATE_MANAGER_THREAD_MIN_SIZE);
+#endif
+
+   if (src.file)
+      fclose(src.file);
+   free(src.state);
+   return res.ok ? 0 : 1;
+}
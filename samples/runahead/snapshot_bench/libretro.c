@@ -0,0 +1,268 @@
+/* public domain */
+
+/*
+ * Run-ahead benchmark core.
+ *
+ * Emulates a core whose whole state lives in one block of RAM that
+ * it exposes with RETRO_ENVIRONMENT_SET_MEMORY_MAPS. Every frame
+ * writes to a number of pages of that RAM, scattered over all of it,
+ * and optionally reads some of it to stand in for emulation work.
+ * retro_serialize()/retro_unserialize() copy the whole block, like a
+ * real core's savestates do.
+ *
+ * Tuned with environment variables:
+ *    SNAPSHOT_BENCH_RAM_KB   size of the RAM (default 4096)
+ *    SNAPSHOT_BENCH_PAGES    4 KB pages written per frame (default 64)
+ *    SNAPSHOT_BENCH_WORK_KB  RAM read per frame (default 0)
+ *
+ * snapshot_bench_libretro.info declares savestate_features =
+ * "snapshot"; point libretro_info_path at this directory to let
+ * run-ahead snapshot the RAM, or elsewhere to make it serialize.
+ *
+ * On unload it prints to stderr the emulated frame count, how many
+ * times retro_run() was called, the wall time per emulated frame
+ * (which includes everything run-ahead does around the calls) and a
+ * hash of the RAM, which has to come out the same with and without
+ * run-ahead for the same frame count.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libretro.h>
+
+#define BENCH_WIDTH  320
+#define BENCH_HEIGHT 240
+
+/* Lives at the start of the RAM, so it is
+ * part of what gets saved and restored */
+typedef struct bench_regs
+{
+   uint64_t frame;
+   uint32_t seed;
+} bench_regs_t;
+
+static retro_environment_t environ_cb;
+static retro_video_refresh_t video_cb;
+static retro_input_poll_t input_poll_cb;
+
+static uint8_t *ram;
+static size_t ram_size;
+static unsigned pages_per_frame;
+static size_t work_size;
+static uint16_t framebuffer[BENCH_WIDTH * BENCH_HEIGHT];
+
+static uint64_t runs;
+static double first_run;
+static double last_run;
+
+static double now_us(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static unsigned env_uint(const char *name, unsigned fallback)
+{
+   const char *value = getenv(name);
+   return value ? (unsigned)strtoul(value, NULL, 0) : fallback;
+}
+
+static uint32_t xorshift(uint32_t *s)
+{
+   *s ^= *s << 13;
+   *s ^= *s >> 17;
+   *s ^= *s << 5;
+   return *s;
+}
+
+static uint64_t fnv1a(const uint8_t *data, size_t len)
+{
+   uint64_t h = 0xcbf29ce484222325ULL;
+   size_t i;
+   for (i = 0; i < len; i++)
+   {
+      h ^= data[i];
+      h *= 0x100000001b3ULL;
+   }
+   return h;
+}
+
+void retro_set_environment(retro_environment_t cb)
+{
+   bool no_game = true;
+   environ_cb   = cb;
+   cb(RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME, &no_game);
+}
+
+void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
+void retro_set_audio_sample(retro_audio_sample_t cb) { }
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { }
+void retro_set_input_poll(retro_input_poll_t cb) { input_poll_cb = cb; }
+void retro_set_input_state(retro_input_state_t cb) { }
+
+void retro_init(void)
+{
+   ram_size        = (size_t)env_uint("SNAPSHOT_BENCH_RAM_KB", 4096) * 1024;
+   pages_per_frame = env_uint("SNAPSHOT_BENCH_PAGES", 64);
+   work_size       = (size_t)env_uint("SNAPSHOT_BENCH_WORK_KB", 0) * 1024;
+
+   if (ram_size < sizeof(bench_regs_t))
+      ram_size = sizeof(bench_regs_t);
+   if (work_size > ram_size)
+      work_size = ram_size;
+}
+
+void retro_deinit(void) { }
+
+unsigned retro_api_version(void) { return RETRO_API_VERSION; }
+
+void retro_get_system_info(struct retro_system_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->library_name     = "Snapshot Bench";
+   info->library_version  = "1.0";
+   info->need_fullpath    = false;
+   info->valid_extensions = "";
+}
+
+void retro_get_system_av_info(struct retro_system_av_info *info)
+{
+   memset(info, 0, sizeof(*info));
+   info->timing.fps            = 60.0;
+   info->timing.sample_rate    = 48000.0;
+   info->geometry.base_width   = BENCH_WIDTH;
+   info->geometry.base_height  = BENCH_HEIGHT;
+   info->geometry.max_width    = BENCH_WIDTH;
+   info->geometry.max_height   = BENCH_HEIGHT;
+   info->geometry.aspect_ratio = 4.0f / 3.0f;
+}
+
+void retro_set_controller_port_device(unsigned port, unsigned device) { }
+
+void retro_reset(void)
+{
+   bench_regs_t *regs = (bench_regs_t*)ram;
+   memset(ram, 0, ram_size);
+   regs->seed         = 0x12345678;
+}
+
+void retro_run(void)
+{
+   unsigned i;
+   bench_regs_t *regs = (bench_regs_t*)ram;
+   size_t pages       = ram_size / 4096;
+   double t           = now_us();
+
+   if (!runs++)
+      first_run = t;
+   last_run = t;
+
+   input_poll_cb();
+
+   for (i = 0; i < pages_per_frame; i++)
+   {
+      size_t pos = (xorshift(&regs->seed) % (pages ? pages : 1)) * 4096
+         + (xorshift(&regs->seed) & 4095);
+      if (pos < sizeof(*regs))
+         pos = sizeof(*regs);
+      if (pos >= ram_size)
+         pos = ram_size - 1;
+      ram[pos] += (uint8_t)regs->frame;
+   }
+
+   if (work_size)
+   {
+      uint32_t sum = 0;
+      size_t j;
+      for (j = 0; j < work_size; j += sizeof(uint32_t))
+         sum += *(const uint32_t*)(ram + j);
+      regs->seed ^= sum & 1;
+      if (!regs->seed)
+         regs->seed = 1;
+   }
+
+   regs->frame++;
+
+   memset(framebuffer, (int)(regs->frame & 0xff), sizeof(framebuffer));
+   video_cb(framebuffer, BENCH_WIDTH, BENCH_HEIGHT,
+         BENCH_WIDTH * sizeof(uint16_t));
+}
+
+size_t retro_serialize_size(void) { return ram_size; }
+
+bool retro_serialize(void *data, size_t size)
+{
+   if (size < ram_size)
+      return false;
+   memcpy(data, ram, ram_size);
+   return true;
+}
+
+bool retro_unserialize(const void *data, size_t size)
+{
+   if (size < ram_size)
+      return false;
+   memcpy(ram, data, ram_size);
+   return true;
+}
+
+void retro_cheat_reset(void) { }
+void retro_cheat_set(unsigned index, bool enabled, const char *code) { }
+
+bool retro_load_game(const struct retro_game_info *game)
+{
+   struct retro_memory_descriptor desc;
+   struct retro_memory_map mmaps;
+   enum retro_pixel_format fmt = RETRO_PIXEL_FORMAT_0RGB1555;
+
+   if (!(ram = (uint8_t*)malloc(ram_size)))
+      return false;
+   retro_reset();
+
+   memset(&desc, 0, sizeof(desc));
+   desc.ptr              = ram;
+   desc.len              = ram_size;
+   desc.flags            = RETRO_MEMDESC_SYSTEM_RAM;
+   mmaps.descriptors     = &desc;
+   mmaps.num_descriptors = 1;
+
+   environ_cb(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
+   environ_cb(RETRO_ENVIRONMENT_SET_MEMORY_MAPS, &mmaps);
+   return true;
+}
+
+bool retro_load_game_special(unsigned type,
+      const struct retro_game_info *info, size_t num) { return false; }
+
+void retro_unload_game(void)
+{
+   bench_regs_t *regs = (bench_regs_t*)ram;
+
+   fprintf(stderr, "[snapshot_bench] %u KB, %u pages/frame: "
+         "%llu frames, %llu retro_run calls, %.1f us/frame, "
+         "hash %016llx\n",
+         (unsigned)(ram_size / 1024), pages_per_frame,
+         (unsigned long long)regs->frame, (unsigned long long)runs,
+         regs->frame > 1
+         ? (last_run - first_run) / (regs->frame - 1) : 0.0,
+         (unsigned long long)fnv1a(ram, ram_size));
+
+   free(ram);
+   ram = NULL;
+}
+
+unsigned retro_get_region(void) { return RETRO_REGION_NTSC; }
+
+void *retro_get_memory_data(unsigned id)
+{
+   return id == RETRO_MEMORY_SYSTEM_RAM ? ram : NULL;
+}
+
+size_t retro_get_memory_size(unsigned id)
+{
+   return id == RETRO_MEMORY_SYSTEM_RAM ? ram_size : 0;
+}
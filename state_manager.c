@@ -26,6 +26,11 @@
 #include <retro_inline.h>
 #include <compat/strl.h>
 #include <compat/intrinsics.h>
+#include <features/features_cpu.h>
+#include <streams/trans_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "state_manager.h"
 #include "msg_hash.h"
@@ -35,6 +40,7 @@
 #include "verbosity.h"
 #include "content.h"
 #include "audio/audio_driver.h"
+#include "performance_counters.h"
 
 #ifdef HAVE_NETWORKING
 #include "network/netplay/netplay.h"
@@ -63,8 +69,51 @@
 
 #if __SSE2__
 #include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#include <arm_neon.h>
+#define STATE_MANAGER_NEON
+#endif
+
+/* The AVX2 scans are built regardless of the target flags
+ * (per-function target attribute) and only picked by
+ * state_manager_new() when the CPU reports AVX2. */
+#if __SSE2__ && defined(CPU_X86) \
+   && (defined(__clang__) || (defined(__GNUC__) \
+   && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define STATE_MANAGER_AVX2
+#define STATE_MANAGER_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#ifdef STATE_MANAGER_AVX2
+#include <immintrin.h>
+#endif
+
+/* The diff scans compare 64-byte blocks at a time; this is how far
+ * past the end sentinel they are allowed to read. */
+#define STATE_MANAGER_BLOCK_SIZE 64
+#define STATE_MANAGER_PADDING    (STATE_MANAGER_BLOCK_SIZE * 2)
+
+/* Runs of changed words longer than this are copied with memcpy(),
+ * shorter ones with a plain loop (memcpy's per-call overhead shows up
+ * on the typical 8-word run). */
+#define STATE_MANAGER_MEMCPY_THRESHOLD 32
+
+/* Every this many pushes, a copy goes to the cold tier... */
+#define STATE_MANAGER_COLD_INTERVAL 30
+/* ...where one in this many is a full keyframe. */
+#define STATE_MANAGER_COLD_GROUP    8
+/* The cold tier gets this fraction of the rewind buffer. */
+#define STATE_MANAGER_COLD_SHARE    2
+
+#ifdef HAVE_THREADS
+/* States smaller than this are compressed inline; handing them to
+ * the compression thread costs more than it saves. */
+#define STATE_MANAGER_THREAD_MIN_SIZE (256 * 1024)
 #endif
 
+static struct retro_perf_counter state_manager_perf_hot_seek;
+static struct retro_perf_counter state_manager_perf_cold_seek;
+
 /* Format per frame (pseudocode): */
 #if 0
 size nextstart;
@@ -86,8 +135,11 @@ size thisstart;
 #endif
 
 /* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
-static size_t find_change(const uint16_t *a, const uint16_t *b)
+ * std::mismatch exists, but it's not optimized at all.
+ *
+ * Unchanged regions are skipped a whole 64-byte block at a time;
+ * only the block holding the first difference is looked at closer. */
+static INLINE size_t find_change(const uint16_t *a, const uint16_t *b)
 {
 #if __SSE2__
    const __m128i *a128 = (const __m128i*)a;
@@ -95,23 +147,73 @@ static size_t find_change(const uint16_t *a, const uint16_t *b)
 
    for (;;)
    {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi8(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
-
-      if (mask != 0xffff) /* Something has changed, figure out where. */
+      __m128i c0    = _mm_cmpeq_epi8(_mm_loadu_si128(a128 + 0),
+            _mm_loadu_si128(b128 + 0));
+      __m128i c1    = _mm_cmpeq_epi8(_mm_loadu_si128(a128 + 1),
+            _mm_loadu_si128(b128 + 1));
+      __m128i c2    = _mm_cmpeq_epi8(_mm_loadu_si128(a128 + 2),
+            _mm_loadu_si128(b128 + 2));
+      __m128i c3    = _mm_cmpeq_epi8(_mm_loadu_si128(a128 + 3),
+            _mm_loadu_si128(b128 + 3));
+      __m128i c     = _mm_and_si128(_mm_and_si128(c0, c1),
+            _mm_and_si128(c2, c3));
+
+      if (_mm_movemask_epi8(c) != 0xffff)
       {
-         /* calculate the real offset to the differing byte */
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask)));
+         /* Something has changed in this block, figure out where. */
+         for (;;)
+         {
+            uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+                     _mm_loadu_si128(a128), _mm_loadu_si128(b128)));
+
+            if (mask != 0xffff)
+            {
+               /* calculate the real offset to the differing byte */
+               size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+                     (compat_ctz(~mask)));
+
+               /* and convert that to the uint16_t offset */
+               return (ret >> 1);
+            }
+
+            a128++;
+            b128++;
+         }
+      }
+
+      a128 += 4;
+      b128 += 4;
+   }
+#elif defined(STATE_MANAGER_NEON)
+   const uint8_t *a8 = (const uint8_t*)a;
+   const uint8_t *b8 = (const uint8_t*)b;
 
-         /* and convert that to the uint16_t offset */
-         return (ret >> 1);
+   for (;;)
+   {
+      uint8x16_t c0 = vceqq_u8(vld1q_u8(a8 +  0), vld1q_u8(b8 +  0));
+      uint8x16_t c1 = vceqq_u8(vld1q_u8(a8 + 16), vld1q_u8(b8 + 16));
+      uint8x16_t c2 = vceqq_u8(vld1q_u8(a8 + 32), vld1q_u8(b8 + 32));
+      uint8x16_t c3 = vceqq_u8(vld1q_u8(a8 + 48), vld1q_u8(b8 + 48));
+      uint8x16_t c  = vandq_u8(vandq_u8(c0, c1), vandq_u8(c2, c3));
+      uint32x2_t m  = vreinterpret_u32_u8(
+            vand_u8(vget_low_u8(c), vget_high_u8(c)));
+
+      if ((vget_lane_u32(m, 0) & vget_lane_u32(m, 1)) != 0xffffffff)
+      {
+         /* Something has changed in this block, figure out where. */
+         const uint16_t *a16 = (const uint16_t*)a8;
+         const uint16_t *b16 = (const uint16_t*)b8;
+
+         while (*a16 == *b16)
+         {
+            a16++;
+            b16++;
+         }
+         return a16 - a;
       }
 
-      a128++;
-      b128++;
+      a8 += STATE_MANAGER_BLOCK_SIZE;
+      b8 += STATE_MANAGER_BLOCK_SIZE;
    }
 #else
    const uint16_t *a_org = a;
@@ -145,7 +247,7 @@ static size_t find_change(const uint16_t *a, const uint16_t *b)
 #endif
 }
 
-static size_t find_same(const uint16_t *a, const uint16_t *b)
+static INLINE size_t find_same(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -168,6 +270,36 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
       const uint32_t *a_big = (const uint32_t*)a;
       const uint32_t *b_big = (const uint32_t*)b;
 
+      /* Most changed runs are short, so check a few words
+       * before paying for the vector setup. */
+      if (     a_big[0] != b_big[0]
+            && a_big[1] != b_big[1]
+            && a_big[2] != b_big[2]
+            && a_big[3] != b_big[3])
+      {
+         a_big += 4;
+         b_big += 4;
+#if __SSE2__
+         for (;;)
+         {
+            uint32_t mask = (uint32_t)_mm_movemask_ps(
+                  _mm_castsi128_ps(_mm_cmpeq_epi32(
+                        _mm_loadu_si128((const __m128i*)a_big),
+                        _mm_loadu_si128((const __m128i*)b_big))));
+
+            if (mask)
+            {
+               a_big += compat_ctz(mask);
+               b_big += compat_ctz(mask);
+               break;
+            }
+
+            a_big += 4;
+            b_big += 4;
+         }
+#endif
+      }
+
       while (*a_big != *b_big)
       {
          a_big++;
@@ -185,6 +317,95 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
    return a - a_org;
 }
 
+#ifdef STATE_MANAGER_AVX2
+/* find_change() with two 256-bit compares per 64-byte block. */
+static STATE_MANAGER_AVX2_TARGET INLINE size_t find_change_avx2(
+      const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i c0    = _mm256_cmpeq_epi8(_mm256_loadu_si256(a256),
+            _mm256_loadu_si256(b256));
+      __m256i c1    = _mm256_cmpeq_epi8(_mm256_loadu_si256(a256 + 1),
+            _mm256_loadu_si256(b256 + 1));
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(c0, c1));
+
+      if (mask != 0xffffffff) /* Something has changed, figure out where. */
+      {
+         size_t ret = (uint8_t*)a256 - (uint8_t*)a;
+         mask       = (uint32_t)_mm256_movemask_epi8(c0);
+
+         if (mask == 0xffffffff)
+         {
+            ret    += 32;
+            mask    = (uint32_t)_mm256_movemask_epi8(c1);
+         }
+
+         /* convert the differing byte to the uint16_t offset */
+         return (ret + compat_ctz(~mask)) >> 1;
+      }
+
+      a256 += 2;
+      b256 += 2;
+   }
+}
+
+/* find_same() scanning eight 32-bit words at a time.
+ * x86 only, so unaligned reads are fine. */
+static STATE_MANAGER_AVX2_TARGET INLINE size_t find_same_avx2(
+      const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+   const uint32_t *a_big = (const uint32_t*)a;
+   const uint32_t *b_big = (const uint32_t*)b;
+
+   if (     a_big[0] != b_big[0]
+         && a_big[1] != b_big[1]
+         && a_big[2] != b_big[2]
+         && a_big[3] != b_big[3])
+   {
+      a_big += 4;
+      b_big += 4;
+
+      for (;;)
+      {
+         uint32_t mask = (uint32_t)_mm256_movemask_ps(
+               _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                     _mm256_loadu_si256((const __m256i*)a_big),
+                     _mm256_loadu_si256((const __m256i*)b_big))));
+
+         if (mask)
+         {
+            a_big += compat_ctz(mask);
+            b_big += compat_ctz(mask);
+            break;
+         }
+
+         a_big += 8;
+         b_big += 8;
+      }
+   }
+
+   while (*a_big != *b_big)
+   {
+      a_big++;
+      b_big++;
+   }
+   a = (const uint16_t*)a_big;
+   b = (const uint16_t*)b_big;
+
+   if (a != a_org && a[-1] == b[-1])
+   {
+      a--;
+      b--;
+   }
+   return a - a_org;
+}
+#endif
+
 /* Returns the maximum compressed size of a savestate.
  * It is very likely to compress to far less. */
 static size_t state_manager_raw_maxsize(size_t uncomp)
@@ -206,7 +427,8 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
 static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
    size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4
+         + STATE_MANAGER_PADDING, 1);
 
    if (!ret)
       return NULL;
@@ -219,9 +441,10 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
     *
     * There is also some padding at the end. This is so we don't
     * read outside the buffer end if we're reading in large blocks;
+    * the block scans can overshoot the sentinel by up to a block.
     *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get
-    * Valgrind happy is worth it. */
+    * It doesn't make any difference to us, but sacrificing a few bytes
+    * to get Valgrind happy is worth it. */
    ret[len16/sizeof(uint16_t) + 3] = uniq;
 
    return ret;
@@ -234,9 +457,14 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
  *
  * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
  * Returns the number of bytes actually written to 'patch'.
+ *
+ * Inlined into each of the wrappers below, so
+ * 'change' and 'same' end up as direct calls.
  */
-static size_t state_manager_raw_compress(const void *src,
-      const void *dst, size_t len, void *patch)
+static INLINE size_t state_manager_raw_compress_scan(const void *src,
+      const void *dst, size_t len, void *patch,
+      size_t (*change)(const uint16_t*, const uint16_t*),
+      size_t (*same)(const uint16_t*, const uint16_t*))
 {
    const uint16_t  *old16 = (const uint16_t*)src;
    const uint16_t  *new16 = (const uint16_t*)dst;
@@ -247,7 +475,7 @@ static size_t state_manager_raw_compress(const void *src,
    while (num16s)
    {
       size_t i, changed;
-      size_t skip = find_change(old16, new16);
+      size_t skip = change(old16, new16);
 
       if (skip >= num16s)
          break;
@@ -270,15 +498,18 @@ static size_t state_manager_raw_compress(const void *src,
          continue;
       }
 
-      changed         = find_same(old16, new16);
+      changed         = same(old16, new16);
       if (changed > UINT16_MAX)
          changed = UINT16_MAX;
 
       *compressed16++ = changed;
       *compressed16++ = skip;
 
-      for (i = 0; i < changed; i++)
-         compressed16[i] = old16[i];
+      if (changed > STATE_MANAGER_MEMCPY_THRESHOLD)
+         memcpy(compressed16, old16, changed * sizeof(uint16_t));
+      else
+         for (i = 0; i < changed; i++)
+            compressed16[i] = old16[i];
 
       old16        += changed;
       new16        += changed;
@@ -293,6 +524,22 @@ static size_t state_manager_raw_compress(const void *src,
    return (uint8_t*)(compressed16 + 3) - (uint8_t*)patch;
 }
 
+static size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch)
+{
+   return state_manager_raw_compress_scan(src, dst, len, patch,
+         find_change, find_same);
+}
+
+#ifdef STATE_MANAGER_AVX2
+static STATE_MANAGER_AVX2_TARGET size_t state_manager_raw_compress_avx2(
+      const void *src, const void *dst, size_t len, void *patch)
+{
+   return state_manager_raw_compress_scan(src, dst, len, patch,
+         find_change_avx2, find_same_avx2);
+}
+#endif
+
 /*
  * Takes 'patch' from a previous call to 'state_manager_raw_compress'
  * and applies it to 'data' ('src' from that call),
@@ -317,13 +564,17 @@ static void state_manager_raw_decompress(const void *patch,
 
          out16       += *patch16++;
 
-         /* We could do memcpy, but it seems that memcpy has a
+         /* We could always do memcpy, but it seems that memcpy has a
           * constant-per-call overhead that actually shows up.
           *
           * Our average size in here seems to be 8 or something.
-          * Therefore, we do something with lower overhead. */
-         for (i = 0; i < numchanged; i++)
-            out16[i]  = patch16[i];
+          * Therefore, we do something with lower overhead, and only
+          * hand the long runs to memcpy. */
+         if (numchanged > STATE_MANAGER_MEMCPY_THRESHOLD)
+            memcpy(out16, patch16, numchanged * sizeof(uint16_t));
+         else
+            for (i = 0; i < numchanged; i++)
+               out16[i]  = patch16[i];
 
          patch16     += numchanged;
          out16       += numchanged;
@@ -375,11 +626,384 @@ static INLINE size_t read_size_t(const void *ptr)
    return ret;
 }
 
+/* Compresses the difference between 'oldb' and 'newb' into the ring,
+ * dropping the oldest entries if it doesn't fit. */
+static void state_manager_push_compress(state_manager_t *state,
+      const uint8_t *oldb, const uint8_t *newb)
+{
+   uint8_t *compressed;
+   size_t headpos, tailpos, remaining;
+
+recheckcapacity:;
+   headpos   = state->head - state->data;
+   tailpos   = state->tail - state->data;
+   remaining = (tailpos + state->capacity -
+         sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+   if (remaining <= state->maxcompsize)
+   {
+      state->tail = state->data + read_size_t(state->tail);
+      state->entries--;
+      goto recheckcapacity;
+   }
+
+   compressed        = state->head + sizeof(size_t);
+
+   compressed       += state->compress(oldb, newb,
+         state->blocksize, compressed);
+
+   if (compressed - state->data + state->maxcompsize > state->capacity)
+   {
+      compressed     = state->data;
+      if (state->tail == state->data + sizeof(size_t))
+      {
+         state->tail = state->data + read_size_t(state->tail);
+         state->entries--;
+      }
+   }
+   write_size_t(compressed, state->head-state->data);
+   compressed       += sizeof(size_t);
+   write_size_t(state->head, compressed-state->data);
+   state->head       = compressed;
+}
+
+/* The cold tier.
+ *
+ * Every STATE_MANAGER_COLD_INTERVAL pushes, the pushed state is also
+ * stored in the cold tier, compressed with a trans_stream backend
+ * (zlib if available). Cold entries come in groups: a full keyframe
+ * followed by up to STATE_MANAGER_COLD_GROUP - 1 deltas, each against
+ * the entry before it, so seeking replays at most a group's worth.
+ *
+ * The hot ring still holds every pushed frame; once it runs dry,
+ * state_manager_pop() continues with the newest cold entry older than
+ * the current state. The oldest group is dropped when the cold tier
+ * goes over its share of the rewind buffer. */
+
+/* Drops the oldest group, unless it's the one still being added to. */
+static bool state_manager_cold_drop_front(state_manager_t *state)
+{
+   size_t i;
+   size_t count = 1;
+
+   while (count < state->cold_count && !state->cold[count].keyframe)
+      count++;
+
+   if (count == state->cold_count)
+      return false;
+
+   for (i = 0; i < count; i++)
+   {
+      state->cold_bytes -= state->cold[i].size;
+      free(state->cold[i].data);
+   }
+
+   state->cold_count -= count;
+   memmove(state->cold, state->cold + count,
+         state->cold_count * sizeof(*state->cold));
+   return true;
+}
+
+/* Forgets every cold entry at or after 'frame'. */
+static void state_manager_cold_truncate(state_manager_t *state,
+      uint64_t frame)
+{
+   while (     state->cold_count
+         &&    state->cold[state->cold_count - 1].frame >= frame)
+   {
+      state_manager_cold_entry_t *entry = &state->cold[--state->cold_count];
+
+      state->cold_bytes -= entry->size;
+      free(entry->data);
+      entry->data        = NULL;
+      /* Deltas need the newest entry, start a new group. */
+      state->cold_group  = 0;
+   }
+}
+
+static bool state_manager_cold_trans(
+      const struct trans_stream_backend *backend, void **stream,
+      const uint8_t *in, size_t in_size,
+      uint8_t *out, size_t out_size, uint32_t *written)
+{
+   uint32_t rd;
+   enum trans_stream_error err = TRANS_STREAM_ERROR_NONE;
+
+   if (!*stream)
+   {
+      if (!(*stream = backend->stream_new()))
+         return false;
+      if (backend->define)
+         backend->define(*stream, "level", 1);
+   }
+
+   backend->set_in(*stream, in, (uint32_t)in_size);
+   backend->set_out(*stream, out, (uint32_t)out_size);
+
+   if (     !backend->trans(*stream, true, &rd, written, &err)
+         || err != TRANS_STREAM_ERROR_NONE)
+   {
+      /* Don't reuse a stream that's stuck halfway. */
+      backend->stream_free(*stream);
+      *stream = NULL;
+      return false;
+   }
+   return true;
+}
+
+/* Stores 'block' (the state of 'frame') in the cold tier. */
+static void state_manager_cold_push(state_manager_t *state,
+      const uint8_t *block, uint64_t frame)
+{
+   uint32_t written;
+   state_manager_cold_entry_t *entry;
+   const uint8_t *in = block;
+   size_t in_size    = state->blocksize;
+   bool keyframe     = (state->cold_group == 0);
+
+   if (!keyframe)
+   {
+      in      = state->coldpatch;
+      in_size = state->compress(block, state->coldbase,
+            state->blocksize, state->coldpatch);
+   }
+
+   if (!state_manager_cold_trans(state->cold_backend,
+            &state->cold_deflate, in, in_size,
+            state->coldout, state->coldout_size, &written))
+      return;
+
+   if (state->cold_count == state->cold_cap)
+   {
+      size_t new_cap = state->cold_cap ? state->cold_cap * 2 : 32;
+      state_manager_cold_entry_t *cold = (state_manager_cold_entry_t*)
+         realloc(state->cold, new_cap * sizeof(*cold));
+
+      if (!cold)
+         return;
+      state->cold     = cold;
+      state->cold_cap = new_cap;
+   }
+
+   entry              = &state->cold[state->cold_count];
+   if (!(entry->data  = (uint8_t*)malloc(written)))
+      return;
+   memcpy(entry->data, state->coldout, written);
+   entry->size        = written;
+   entry->frame       = frame;
+   entry->keyframe    = keyframe;
+
+   state->cold_count++;
+   state->cold_bytes += written;
+
+   memcpy(state->coldbase, block, state->blocksize);
+   state->cold_group  = (state->cold_group + 1) % STATE_MANAGER_COLD_GROUP;
+
+   while (state->cold_bytes > state->cold_budget)
+      if (!state_manager_cold_drop_front(state))
+         break;
+}
+
+static bool state_manager_cold_inflate(state_manager_t *state,
+      const state_manager_cold_entry_t *entry,
+      uint8_t *out, size_t out_size)
+{
+   uint32_t written;
+   return state_manager_cold_trans(state->cold_backend->reverse,
+         &state->cold_inflate, entry->data, entry->size,
+         out, out_size, &written);
+}
+
+/* Restores the newest cold entry older than the current state
+ * into thisblock. */
+static bool state_manager_cold_pop(state_manager_t *state)
+{
+   size_t base;
+   size_t i = state->cold_count;
+
+   while (i && state->cold[i - 1].frame >= state->frame)
+      i--;
+   if (!i--)
+      return false;
+
+   /* The oldest entry is always a keyframe. */
+   for (base = i; !state->cold[base].keyframe; base--);
+
+   if (!state_manager_cold_inflate(state, &state->cold[base],
+            state->thisblock, state->blocksize))
+      return false;
+
+   while (base++ < i)
+   {
+      if (!state_manager_cold_inflate(state, &state->cold[base],
+               state->coldpatch, state->maxcompsize))
+         return false;
+      state_manager_raw_decompress(state->coldpatch,
+            state->maxcompsize, state->thisblock, state->blocksize);
+   }
+
+   state->frame = state->cold[i].frame;
+   state_manager_cold_truncate(state, state->frame);
+   return true;
+}
+
+static void state_manager_cold_free(state_manager_t *state)
+{
+   size_t i;
+
+   for (i = 0; i < state->cold_count; i++)
+      free(state->cold[i].data);
+   if (state->cold)
+      free(state->cold);
+   if (state->coldbase)
+      free(state->coldbase);
+   if (state->coldpatch)
+      free(state->coldpatch);
+   if (state->coldout)
+      free(state->coldout);
+   if (state->cold_deflate)
+      state->cold_backend->stream_free(state->cold_deflate);
+   if (state->cold_inflate)
+      state->cold_backend->reverse->stream_free(state->cold_inflate);
+
+   state->cold         = NULL;
+   state->coldbase     = NULL;
+   state->coldpatch    = NULL;
+   state->coldout      = NULL;
+   state->cold_deflate = NULL;
+   state->cold_inflate = NULL;
+   state->cold_count   = 0;
+   state->cold_cap     = 0;
+   state->cold_bytes   = 0;
+   state->cold_budget  = 0;
+}
+
+static bool state_manager_cold_init(state_manager_t *state,
+      size_t state_size)
+{
+   if (!(state->cold_backend  = trans_stream_get_zlib_deflate_backend()))
+      state->cold_backend     = trans_stream_get_pipe_backend();
+
+   state->coldout_size        = state->maxcompsize
+      + state->maxcompsize / 8 + 1024;
+   state->coldbase            = (uint8_t*)state_manager_raw_alloc(
+         state_size, 3);
+   state->coldpatch           = (uint8_t*)malloc(state->maxcompsize);
+   state->coldout             = (uint8_t*)malloc(state->coldout_size);
+
+   return state->coldbase && state->coldpatch && state->coldout;
+}
+
+/* Bytes of the hot ring in use. */
+static size_t state_manager_hot_bytes(const state_manager_t *state)
+{
+   size_t headpos = state->head - state->data;
+   size_t tailpos = state->tail - state->data;
+
+   return (headpos + state->capacity - tailpos) % state->capacity;
+}
+
+#ifdef HAVE_THREADS
+/* Compresses the previously pushed frame while the core
+ * runs the next one. */
+static void state_manager_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->lock);
+
+   for (;;)
+   {
+      while (!state->job_pending && !state->thread_quit)
+         scond_wait(state->cond, state->lock);
+
+      if (state->thread_quit)
+         break;
+
+      slock_unlock(state->lock);
+      state_manager_push_compress(state, state->job_old, state->job_new);
+      if (state->job_cold)
+         state_manager_cold_push(state, state->job_new, state->job_frame);
+      slock_lock(state->lock);
+
+      state->job_pending = false;
+      scond_broadcast(state->cond);
+   }
+
+   slock_unlock(state->lock);
+}
+
+/* Blocks until the compression thread is done with the ring
+ * and both of the blocks it reads from. */
+static void state_manager_wait(state_manager_t *state)
+{
+   if (!state->thread)
+      return;
+
+   slock_lock(state->lock);
+   while (state->job_pending)
+      scond_wait(state->cond, state->lock);
+   slock_unlock(state->lock);
+}
+
+static void state_manager_thread_free(state_manager_t *state)
+{
+   if (state->thread)
+   {
+      slock_lock(state->lock);
+      state->thread_quit = true;
+      scond_broadcast(state->cond);
+      slock_unlock(state->lock);
+
+      sthread_join(state->thread);
+   }
+   if (state->cond)
+      scond_free(state->cond);
+   if (state->lock)
+      slock_free(state->lock);
+   if (state->spareblock)
+      free(state->spareblock);
+
+   state->thread     = NULL;
+   state->cond       = NULL;
+   state->lock       = NULL;
+   state->spareblock = NULL;
+}
+
+static void state_manager_thread_init(state_manager_t *state,
+      size_t state_size)
+{
+   if (     state_size < STATE_MANAGER_THREAD_MIN_SIZE
+         || cpu_features_get_core_amount() < 2)
+      return;
+
+   /* The core serializes into the third block while the
+    * other two are being diffed. */
+   if (!(state->spareblock = (uint8_t*)state_manager_raw_alloc(
+               state_size, 2)))
+      return;
+
+   state->lock   = slock_new();
+   state->cond   = scond_new();
+
+   if (state->lock && state->cond)
+      state->thread = sthread_create(state_manager_thread, state);
+
+   if (!state->thread)
+      state_manager_thread_free(state);
+}
+#endif
+
 static void state_manager_free(state_manager_t *state)
 {
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   state_manager_thread_free(state);
+#endif
+   state_manager_cold_free(state);
+
    if (state->data)
       free(state->data);
    if (state->thisblock)
@@ -399,7 +1023,7 @@ static void state_manager_free(state_manager_t *state)
 static state_manager_t *state_manager_new(
       size_t state_size, size_t buffer_size)
 {
-   size_t max_comp_size, block_size;
+   size_t max_comp_size, block_size, cold_budget;
    uint8_t *next_block    = NULL;
    uint8_t *this_block    = NULL;
    uint8_t *state_data    = NULL;
@@ -411,7 +1035,14 @@ static state_manager_t *state_manager_new(
    block_size         = (state_size + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
    /* the compressed data is surrounded by pointers to the other side */
    max_comp_size      = state_manager_raw_maxsize(state_size) + sizeof(size_t) * 2;
-   state_data         = (uint8_t*)malloc(buffer_size);
+
+   /* Split the buffer between the tiers, as long as the hot
+    * ring is still left with room for a couple of frames. */
+   cold_budget        = buffer_size / STATE_MANAGER_COLD_SHARE;
+   if (buffer_size - cold_budget < max_comp_size * 4)
+      cold_budget     = 0;
+
+   state_data         = (uint8_t*)malloc(buffer_size - cold_budget);
 
    if (!state_data)
       goto error;
@@ -427,7 +1058,12 @@ static state_manager_t *state_manager_new(
    state->data        = state_data;
    state->thisblock   = this_block;
    state->nextblock   = next_block;
-   state->capacity    = buffer_size;
+   state->capacity    = buffer_size - cold_budget;
+   state->compress    = state_manager_raw_compress;
+#ifdef STATE_MANAGER_AVX2
+   if (cpu_features_get() & RETRO_SIMD_AVX2)
+      state->compress = state_manager_raw_compress_avx2;
+#endif
 
    state->head        = state->data + sizeof(size_t);
    state->tail        = state->data + sizeof(size_t);
@@ -437,12 +1073,27 @@ static state_manager_t *state_manager_new(
    state->debugblock  = (uint8_t*)malloc(state_size);
 #endif
 
+   if (cold_budget)
+   {
+      if (state_manager_cold_init(state, state_size))
+         state->cold_budget = cold_budget;
+      else
+         state_manager_cold_free(state);
+   }
+
+#ifdef HAVE_THREADS
+   state_manager_thread_init(state, state_size);
+#endif
+
    return state;
 
 error:
    if (state_data)
       free(state_data);
-   state_manager_free(state);
+   if (this_block)
+      free(this_block);
+   if (next_block)
+      free(next_block);
    free(state);
 
    return NULL;
@@ -456,6 +1107,10 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = NULL;
 
+#ifdef HAVE_THREADS
+   state_manager_wait(state);
+#endif
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid    = false;
@@ -466,7 +1121,22 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = state->thisblock;
    if (state->head == state->tail)
-      return false;
+   {
+      bool ret;
+
+      if (!state->cold_count)
+         return false;
+
+      performance_counter_start_plus(state->perfcnt_enable,
+            state_manager_perf_cold_seek);
+      ret = state_manager_cold_pop(state);
+      performance_counter_stop_plus(state->perfcnt_enable,
+            state_manager_perf_cold_seek);
+      return ret;
+   }
+
+   performance_counter_start_plus(state->perfcnt_enable,
+         state_manager_perf_hot_seek);
 
    start                        = read_size_t(state->head - sizeof(size_t));
    state->head                  = state->data + start;
@@ -476,7 +1146,11 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    state_manager_raw_decompress(compressed,
          state->maxcompsize, out, state->blocksize);
 
+   performance_counter_stop_plus(state->perfcnt_enable,
+         state_manager_perf_hot_seek);
+
    state->entries--;
+   state->frame--;
    return true;
 }
 
@@ -489,7 +1163,13 @@ static void state_manager_push_where(state_manager_t *state, void **data)
    if (!state->thisblock_valid)
    {
       const void *ignored;
-      if (state_manager_pop(state, &ignored))
+
+#ifdef HAVE_THREADS
+      state_manager_wait(state);
+#endif
+      /* Only the hot ring, there's no point in restoring
+       * a cold keyframe just to diff against it. */
+      if (state->head != state->tail && state_manager_pop(state, &ignored))
       {
          state->thisblock_valid = true;
          state->entries++;
@@ -505,6 +1185,11 @@ static void state_manager_push_where(state_manager_t *state, void **data)
 static void state_manager_push_do(state_manager_t *state)
 {
    uint8_t *swap = NULL;
+   bool cold     = false;
+
+#ifdef HAVE_THREADS
+   state_manager_wait(state);
+#endif
 
 #if STRICT_BUF_SIZE
    memcpy(state->nextblock, state->debugblock, state->debugsize);
@@ -512,48 +1197,54 @@ static void state_manager_push_do(state_manager_t *state)
 
    if (state->thisblock_valid)
    {
-      const uint8_t *oldb, *newb;
-      uint8_t *compressed;
-      size_t headpos, tailpos, remaining;
       if (state->capacity < sizeof(size_t) + state->maxcompsize) {
          RARCH_ERR("State capacity insufficient\n");
          return;
       }
+   }
 
-recheckcapacity:;
-      headpos   = state->head - state->data;
-      tailpos   = state->tail - state->data;
-      remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+   /* Anything in the cold tier past this point was rewound over. */
+   state->frame++;
+   if (state->cold_budget)
+   {
+      state_manager_cold_truncate(state, state->frame);
+      cold = (state->frame % STATE_MANAGER_COLD_INTERVAL) == 0;
+   }
 
-      if (remaining <= state->maxcompsize)
+   if (state->thisblock_valid)
+   {
+#ifdef HAVE_THREADS
+      if (state->thread)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
-      }
-
-      oldb              = state->thisblock;
-      newb              = state->nextblock;
-      compressed        = state->head + sizeof(size_t);
-
-      compressed       += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed);
+         /* The thread diffs this block against the next one; the core
+          * gets the spare block to serialize the following frame into. */
+         state->entries++;
 
-      if (compressed - state->data + state->maxcompsize > state->capacity)
-      {
-         compressed     = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+         slock_lock(state->lock);
+         state->job_old     = state->thisblock;
+         state->job_new     = state->nextblock;
+         state->job_frame   = state->frame;
+         state->job_cold    = cold;
+         state->job_pending = true;
+         scond_signal(state->cond);
+         slock_unlock(state->lock);
+
+         swap               = state->thisblock;
+         state->thisblock   = state->nextblock;
+         state->nextblock   = state->spareblock;
+         state->spareblock  = swap;
+         return;
       }
-      write_size_t(compressed, state->head-state->data);
-      compressed       += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head       = compressed;
+#endif
+
+      state_manager_push_compress(state, state->thisblock, state->nextblock);
    }
    else
       state->thisblock_valid = true;
 
+   if (cold)
+      state_manager_cold_push(state, state->nextblock, state->frame);
+
    swap                      = state->thisblock;
    state->thisblock          = state->nextblock;
    state->nextblock          = swap;
@@ -637,7 +1328,23 @@ void state_manager_event_init(
          rewind_buffer_size);
 
    if (!rewind_st->state)
+   {
       RARCH_WARN("%s.\n", msg_hash_to_str(MSG_REWIND_INIT_FAILED));
+      return;
+   }
+
+   if (rewind_st->state->cold_budget)
+      RARCH_LOG("[Rewind]: Hot tier: %u KB, cold tier: %u KB (%s).\n",
+            (unsigned)(rewind_st->state->capacity / 1024),
+            (unsigned)(rewind_st->state->cold_budget / 1024),
+            rewind_st->state->cold_backend->ident);
+
+   if ((rewind_st->state->perfcnt_enable = retroarch_ctl(
+               RARCH_CTL_IS_PERFCNT_ENABLE, NULL)))
+   {
+      performance_counter_init(state_manager_perf_hot_seek,   "rewind_hot_seek");
+      performance_counter_init(state_manager_perf_cold_seek,  "rewind_cold_seek");
+   }
 
    state_manager_push_where(rewind_st->state, &state);
 
@@ -662,6 +1369,15 @@ void state_manager_event_deinit(
 
    if (rewind_st->state)
    {
+#ifdef HAVE_THREADS
+      state_manager_wait(rewind_st->state);
+#endif
+      RARCH_LOG("[Rewind]: Hot tier: %u frames in %u KB, "
+            "cold tier: %u frames in %u KB.\n",
+            rewind_st->state->entries,
+            (unsigned)(state_manager_hot_bytes(rewind_st->state) / 1024),
+            (unsigned)rewind_st->state->cold_count,
+            (unsigned)(rewind_st->state->cold_bytes / 1024));
       state_manager_free(rewind_st->state);
       free(rewind_st->state);
    }
@@ -23,6 +23,11 @@
 
 #include <boolean.h>
 #include <retro_common_api.h>
+#include <streams/trans_stream.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "dynamic.h"
 
@@ -36,6 +41,16 @@ enum state_manager_rewind_st_flags
    STATE_MGR_REWIND_ST_FLAG_HOTKEY_WAS_PRESSED    = (1 << 3)
 };
 
+typedef struct state_manager_cold_entry
+{
+   uint8_t *data;
+   size_t size;
+   /* Push count of the state it holds. */
+   uint64_t frame;
+   /* Otherwise a delta against the entry before it. */
+   bool keyframe;
+} state_manager_cold_entry_t;
+
 struct state_manager
 {
    uint8_t *data;
@@ -58,9 +73,56 @@ struct state_manager
     * (blocksize + u16 + u16) + u16 + u32 + size_t
     * (yes, the math is a bit ugly). */
    size_t maxcompsize;
+   /* Diff that turns one block into a patch,
+    * picked for the CPU's vector extensions. */
+   size_t (*compress)(const void *src, const void *dst,
+         size_t len, void *patch);
+
+   /* Cold tier, oldest first. */
+   state_manager_cold_entry_t *cold;
+   /* Uncompressed copy of the newest cold entry. */
+   uint8_t *coldbase;
+   uint8_t *coldpatch;
+   uint8_t *coldout;
+   const struct trans_stream_backend *cold_backend;
+   void *cold_deflate;
+   void *cold_inflate;
+   size_t cold_count;
+   size_t cold_cap;
+   size_t cold_bytes;
+   /* 0 if there's no cold tier. */
+   size_t cold_budget;
+   size_t coldout_size;
+
+   /* Push count of the state in thisblock. */
+   uint64_t frame;
+
+#ifdef HAVE_THREADS
+   /* Background compression of the last pushed frame;
+    * only started for large states. */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   /* Third block, rotated with thisblock/nextblock so the core
+    * can serialize the next frame while the thread still reads
+    * the previous two. */
+   uint8_t *spareblock;
+   const uint8_t *job_old;
+   const uint8_t *job_new;
+   uint64_t job_frame;
+#endif
 
    unsigned entries;
+   /* Entries in the newest cold group, 0 when the next
+    * cold entry has to be a keyframe. */
+   unsigned cold_group;
    bool thisblock_valid;
+   bool perfcnt_enable;
+#ifdef HAVE_THREADS
+   bool job_pending;
+   bool job_cold;
+   bool thread_quit;
+#endif
 };
 
 typedef struct state_manager state_manager_t;
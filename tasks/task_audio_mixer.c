@@ -547,6 +547,7 @@ bool task_push_audio_mixer_load_and_play(
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->name            = "audio_mixer";
    t->cleanup         = task_audio_mixer_load_free;
    t->user_data       = user;
 
@@ -674,6 +675,7 @@ bool task_push_audio_mixer_load(
 
    t->state                  = nbio;
    t->handler                = task_file_load_handler;
+   t->name                   = "audio_mixer";
    t->cleanup                = task_audio_mixer_load_free;
    t->user_data              = user;
 
@@ -268,6 +268,53 @@ bool content_file_override_set(
    return true;
 }
 
+static void content_file_memory_buffer_free(content_state_t *p_content)
+{
+   if (p_content->memory_content_data)
+      free(p_content->memory_content_data);
+   p_content->memory_content_data    = NULL;
+   p_content->memory_content_size    = 0;
+   p_content->memory_content_crc     = 0;
+   p_content->memory_content_path[0] = '\0';
+}
+
+bool content_set_memory_buffer(const char *path,
+      void *data, size_t size, uint32_t crc)
+{
+   content_state_t *p_content = content_state_get_ptr();
+
+   if (string_is_empty(path) || !data)
+      return false;
+
+   content_file_memory_buffer_free(p_content);
+
+   p_content->memory_content_data = data;
+   p_content->memory_content_size = size;
+   p_content->memory_content_crc  = crc;
+   strlcpy(p_content->memory_content_path, path,
+         sizeof(p_content->memory_content_path));
+
+   return true;
+}
+
+/* Takes ownership of the in-memory content buffer
+ * if it was registered for 'content_path' */
+static bool content_file_take_memory_buffer(
+      content_state_t *p_content,
+      const char *content_path,
+      uint8_t **data,
+      size_t *data_size)
+{
+   if (     !p_content->memory_content_data
+         || !string_is_equal(p_content->memory_content_path, content_path))
+      return false;
+
+   *data                          = (uint8_t*)p_content->memory_content_data;
+   *data_size                     = p_content->memory_content_size;
+   p_content->memory_content_data = NULL;
+   return true;
+}
+
 /* Frees any content data that is not flagged
  * as 'persistent'. Should be called after
  * content_file_load() */
@@ -682,6 +729,7 @@ static bool content_file_load_into_memory(
 {
    uint8_t *content_data = NULL;
    int64_t content_size  = 0;
+   bool from_memory      = false;
 
    *data                 = NULL;
    *data_size            = 0;
@@ -689,19 +737,32 @@ static bool content_file_load_into_memory(
    RARCH_LOG("[Content]: %s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), content_path);
 
-   /* Read content from file into memory buffer */
-#ifdef HAVE_COMPRESSION
-   if (content_compressed)
+   /* Use the in-memory buffer if one was handed over
+    * for this content, otherwise read content from
+    * file into memory buffer */
+   if (idx == 0)
    {
-      if (!file_archive_compressed_read(content_path,
-            (void**)&content_data, NULL, &content_size))
-         return false;
+      size_t memory_size = 0;
+      if ((from_memory = content_file_take_memory_buffer(
+            p_content, content_path, &content_data, &memory_size)))
+         content_size    = (int64_t)memory_size;
    }
-   else
+
+   if (!from_memory)
+   {
+#ifdef HAVE_COMPRESSION
+      if (content_compressed)
+      {
+         if (!file_archive_compressed_read(content_path,
+               (void**)&content_data, NULL, &content_size))
+            return false;
+      }
+      else
 #endif
-      if (!filestream_read_file(content_path,
-            (void**)&content_data, &content_size))
-         return false;
+         if (!filestream_read_file(content_path,
+               (void**)&content_data, &content_size))
+            return false;
+   }
 
    if (content_size < 0)
       return false;
@@ -745,6 +806,13 @@ static bool content_file_load_into_memory(
             RARCH_LOG("[Content]: CRC32: 0x%x.\n",
                   (unsigned)p_content->rom_crc);
          }
+         else if (from_memory)
+         {
+            /* CRC was computed while the buffer was filled */
+            p_content->rom_crc = p_content->memory_content_crc;
+            RARCH_LOG("[Content]: CRC32: 0x%x.\n",
+                  (unsigned)p_content->rom_crc);
+         }
          else
          {
             /* We don't have the content ready inside a memory buffer,
@@ -1092,10 +1160,36 @@ static bool content_file_load(
             RARCH_LOG("[Content]: %s\n", msg_hash_to_str(
                   MSG_CONTENT_LOADING_SKIPPED_IMPLEMENTATION_WILL_DO_IT));
 
+            /* Core will open the file itself: flush any
+             * in-memory buffer handed over for it to disk */
+            if (i == 0 && content_file_take_memory_buffer(
+                  p_content, content_path, &content_data, &content_size))
+            {
+               bool written = filestream_write_file(content_path,
+                     content_data, (int64_t)content_size);
+
+               free(content_data);
+               content_data = NULL;
+               content_size = 0;
+
+               if (!written)
+               {
+                  char msg[128];
+                  snprintf(msg, sizeof(msg), "%s \"%s\"\n",
+                        msg_hash_to_str(MSG_COULD_NOT_READ_CONTENT_FILE),
+                        content_path);
+                  *error_string = strdup(msg);
+                  return false;
+               }
+
+               p_content->rom_crc = (first_content_type == RARCH_CONTENT_NONE)
+                     ? p_content->memory_content_crc
+                     : 0;
+            }
             /* First content file is significant: need to
              * perform CRC calculation, but defer this
              * until value is used */
-            if (i == 0)
+            else if (i == 0)
             {
                /* If we have a media type, ignore CRC32 calculation. */
                if (first_content_type == RARCH_CONTENT_NONE)
@@ -1321,6 +1415,7 @@ static bool content_file_init(
                error_enum, error_string, special);
 
          content_file_list_free_transient_data(p_content->content_list);
+         content_file_memory_buffer_free(p_content);
          return ret;
       }
    }
@@ -16,6 +16,7 @@
  */
 
 #include <math.h>
+#include <array/rbuf.h>
 #include <compat/strcasestr.h>
 #include <compat/strl.h>
 #include <retro_miscellaneous.h>
@@ -27,6 +28,11 @@
 #include <streams/file_stream.h>
 #include <streams/chd_stream.h>
 #include <streams/interface_stream.h>
+#ifdef HAVE_THREADS
+#include <features/features_cpu.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -44,15 +50,39 @@
 #include "../verbosity.h"
 #include "task_database_cue.h"
 
+/* Content found in more places than this is
+ * matched without the database index */
+#define DB_INDEX_MAX_HITS 32
+
+#ifdef HAVE_THREADS
+/* Files hashed ahead of the one being matched, per thread */
+#define DB_SCAN_JOBS_PER_THREAD 4
+#define DB_SCAN_MAX_THREADS     8
+/* How long the handler waits for a file to be hashed
+ * before giving the task queue a chance to cancel it */
+#define DB_SCAN_WAIT_US         10000
+#endif
+
+enum db_index_status
+{
+   DB_INDEX_NOT_PROBED = 0,
+   DB_INDEX_PROBED,
+   DB_INDEX_UNUSED
+};
+
 typedef struct database_state_handle
 {
    database_info_list_t *info;
    struct string_list *list;
+   database_info_index_t *index;
    uint8_t *buf;
    size_t list_index;
    size_t entry_index;
+   size_t num_index_hits;
+   database_info_index_hit_t index_hits[DB_INDEX_MAX_HITS];
    uint32_t crc;
    uint32_t archive_crc;
+   enum db_index_status index_status;
    char archive_name[512]; /* TODO/FIXME - check size */
    char serial[4096];      /* TODO/FIXME - check size */
 } database_state_handle_t;
@@ -65,12 +95,76 @@ enum db_flags_enum
    DB_HANDLE_FLAG_SHOW_HIDDEN_FILES       = (1 << 3)
 };
 
+typedef struct db_scan_cache db_scan_cache_t;
+
+/* What a file is looked up in the databases by */
+typedef struct db_scan_file
+{
+   int64_t size;
+   int64_t mtime;
+   uint32_t hash;
+   uint32_t crc;
+   uint32_t archive_crc;
+   uint32_t cached;   /* scan cache item it came from */
+   uint32_t stale;    /* scan cache item it replaces */
+   enum database_type type;
+   char serial[4096];
+} db_scan_file_t;
+
+#ifdef HAVE_THREADS
+enum db_scan_status
+{
+   DB_SCAN_DONE = 0,
+   DB_SCAN_FAILED,
+   DB_SCAN_PENDING,
+   DB_SCAN_INLINE
+};
+
+struct db_scan_pipeline;
+
+/* One file handed to the hashing threads. A slot is in use
+ * from the time the walker fills in path until the handler
+ * has taken the result. */
+typedef struct db_scan_job
+{
+   char *path;
+   struct db_scan_pipeline *pipeline;
+   size_t list_ptr;
+   int ret;
+   bool done;
+   db_scan_file_t file;
+} db_scan_job_t;
+
+/* Scans a directory in three stages: the walker goes down the
+ * file list, pruning the tracks of cue and gdi sheets, and hands
+ * up to num_jobs files to a thread pool that works out their CRC
+ * or serial. The task handler picks the results up in list order
+ * and does the database matching and playlist updates as before.
+ * Slot n holds list entry n % num_jobs, which bounds how far the
+ * walker can get ahead of the handler. */
+typedef struct db_scan_pipeline
+{
+   tpool_t *pool;
+   slock_t *lock;
+   scond_t *cond;
+   const db_scan_cache_t *cache;
+   db_scan_job_t *jobs;
+   size_t num_jobs;
+   size_t next;     /* next list entry for the walker */
+} db_scan_pipeline_t;
+#endif
+
 typedef struct db_handle
 {
    char *playlist_directory;
    char *content_database_path;
    char *fullpath;
+   char *scan_cache_path;
    database_info_handle_t *handle;
+   db_scan_cache_t *cache;
+#ifdef HAVE_THREADS
+   db_scan_pipeline_t *scan;
+#endif
    database_state_handle_t state;
    playlist_config_t playlist_config; /* size_t alignment */
    unsigned status;
@@ -504,7 +598,7 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
 }
 
 static void task_database_cue_prune(database_info_handle_t *db,
-      const char *name)
+      const char *name, size_t start)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
@@ -518,7 +612,7 @@ static void task_database_cue_prune(database_info_handle_t *db,
 
    while (cue_next_file(fd, name, path, sizeof(path)))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -536,7 +630,8 @@ static void task_database_cue_prune(database_info_handle_t *db,
    free(fd);
 }
 
-static void gdi_prune(database_info_handle_t *db, const char *name)
+static void gdi_prune(database_info_handle_t *db, const char *name,
+      size_t start)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
@@ -550,7 +645,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
 
    while (gdi_next_file(fd, name, path, sizeof(path)))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -613,41 +708,45 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/* Works out how a file is looked up in the databases and
+ * computes what it is looked up by. Only touches its arguments,
+ * so files can be hashed on several threads at once. */
+static int task_database_hash_content(const char *name,
+      enum database_type *type, uint32_t *crc, uint32_t *archive_crc,
+      char *serial, size_t serial_len)
 {
    switch (extension_to_file_type(path_get_extension(name)))
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         db->type = DATABASE_TYPE_CRC_LOOKUP;
+         *type = DATABASE_TYPE_CRC_LOOKUP;
          /* first check crc of archive itself */
-         return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
+         if (!intfstream_file_get_crc(name, 0, SIZE_MAX, archive_crc))
+            return 0;
+         /* then of the first file in it */
+         *crc  = file_archive_get_file_crc32(name);
+         return 1;
 #else
          break;
 #endif
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial, sizeof(db_state->serial)))
-            db->type = DATABASE_TYPE_SERIAL_LOOKUP;
+         serial[0] = '\0';
+         if (task_database_cue_get_serial(name, serial, serial_len))
+            *type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            db->type = DATABASE_TYPE_CRC_LOOKUP;
-            return task_database_cue_get_crc(name, &db_state->crc);
+            *type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_cue_get_crc(name, crc);
          }
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_gdi_get_serial(name, db_state->serial, sizeof(db_state->serial)))
-            db->type = DATABASE_TYPE_SERIAL_LOOKUP;
+         serial[0] = '\0';
+         if (task_database_gdi_get_serial(name, serial, serial_len))
+            *type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            db->type = DATABASE_TYPE_CRC_LOOKUP;
-            return task_database_gdi_get_crc(name, &db_state->crc);
+            *type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_gdi_get_crc(name, crc);
          }
          break;
       /* Consider WBFS, RVZ and WIA files similar to ISO files. */
@@ -655,32 +754,659 @@ static int task_database_iterate_playlist(
       case FILE_TYPE_RVZ:
       case FILE_TYPE_WIA:
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, SIZE_MAX, db_state->serial, sizeof(db_state->serial));
-         db->type            =  DATABASE_TYPE_SERIAL_LOOKUP;
+         serial[0] = '\0';
+         intfstream_file_get_serial(name, 0, SIZE_MAX, serial, serial_len);
+         *type     = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial, sizeof(db_state->serial)))
-            db->type         = DATABASE_TYPE_SERIAL_LOOKUP;
+         serial[0] = '\0';
+         if (task_database_chd_get_serial(name, serial, serial_len))
+            *type  = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            db->type         = DATABASE_TYPE_CRC_LOOKUP;
-            return task_database_chd_get_crc(name, &db_state->crc);
+            *type  = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_chd_get_crc(name, crc);
          }
          break;
       case FILE_TYPE_LUTRO:
-         db->type            = DATABASE_TYPE_ITERATE_LUTRO;
+         *type     = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         db_state->serial[0] = '\0';
-         db->type            = DATABASE_TYPE_CRC_LOOKUP;
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         serial[0] = '\0';
+         *type     = DATABASE_TYPE_CRC_LOOKUP;
+         return intfstream_file_get_crc(name, 0, SIZE_MAX, crc);
    }
 
    return 1;
 }
 
+/* Scan cache
+ * > Remembers how each scanned file is looked up in the
+ *   databases, and by which CRC32 or serial, keyed by its path,
+ *   size and modification time
+ * > Archive members are keyed by their full path and the size
+ *   and time of the archive; cue and gdi sheets by those of the
+ *   sheet alone
+ * > Loaded when a scan starts and only read while it runs, so
+ *   the hashing threads can look files up in it; what the scan
+ *   hashed is kept aside and saved with it when the scan ends */
+
+#define DB_SCAN_CACHE_MAGIC   0x43435352 /* "RSCC" */
+#define DB_SCAN_CACHE_VERSION 1
+#define DB_SCAN_CACHE_NONE    0xFFFFFFFF
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_items;
+   uint32_t strings_size;
+} db_scan_cache_header_t;
+
+/* Followed by 'strings_size' bytes of NUL-terminated
+ * strings, which 'path' and 'serial' are offsets into */
+typedef struct
+{
+   int64_t size;
+   int64_t mtime;
+   uint32_t path;
+   uint32_t serial;    /* or DB_SCAN_CACHE_NONE */
+   uint32_t hash;      /* CRC32 of the path */
+   uint32_t type;
+   uint32_t crc;
+   uint32_t archive_crc;
+} db_scan_cache_item_t;
+
+enum db_scan_cache_mark
+{
+   DB_SCAN_CACHE_UNSEEN = 0,
+   DB_SCAN_CACHE_SEEN,
+   DB_SCAN_CACHE_STALE
+};
+
+struct db_scan_cache
+{
+   void *data;                    /* the file as loaded */
+   const db_scan_cache_item_t *items;
+   const char *strings;
+   uint8_t *marks;
+   uint32_t *buckets;
+   uint32_t *next;
+   db_scan_cache_item_t *updates; /* RBUF */
+   char *update_strings;          /* RBUF */
+   size_t num_items;
+   size_t strings_size;
+   unsigned bits;
+};
+
+static uint32_t task_database_cache_bucket(uint32_t hash, unsigned bits)
+{
+   return (hash * 0x9E3779B1) >> (32 - bits);
+}
+
+static void task_database_cache_free(db_scan_cache_t *cache)
+{
+   if (!cache)
+      return;
+
+   RBUF_FREE(cache->updates);
+   RBUF_FREE(cache->update_strings);
+   free(cache->data);
+   free(cache->marks);
+   free(cache->buckets);
+   free(cache->next);
+   free(cache);
+}
+
+static bool task_database_cache_parse(db_scan_cache_t *cache,
+      int64_t len)
+{
+   db_scan_cache_header_t header;
+   size_t i;
+
+   if ((size_t)len < sizeof(header))
+      return false;
+
+   memcpy(&header, cache->data, sizeof(header));
+   if (     header.magic   != DB_SCAN_CACHE_MAGIC
+         || header.version != DB_SCAN_CACHE_VERSION
+         || header.num_items > ((size_t)len - sizeof(header))
+            / sizeof(db_scan_cache_item_t)
+         || (size_t)len - sizeof(header) != header.num_items
+            * sizeof(db_scan_cache_item_t) + header.strings_size
+         || (header.strings_size
+            && ((const char*)cache->data)[len - 1] != '\0'))
+      return false;
+
+   cache->items        = (const db_scan_cache_item_t*)
+      ((const uint8_t*)cache->data + sizeof(header));
+   cache->strings      = (const char*)(cache->items + header.num_items);
+   cache->num_items    = header.num_items;
+   cache->strings_size = header.strings_size;
+
+   for (i = 0; i < cache->num_items; i++)
+   {
+      const db_scan_cache_item_t *item = &cache->items[i];
+      if (     item->path >= cache->strings_size
+            || (     item->serial != DB_SCAN_CACHE_NONE
+                  && item->serial >= cache->strings_size))
+         return false;
+   }
+
+   return true;
+}
+
+/* Loads the cache saved to 'path', or starts an empty
+ * one if there is none or it cannot be read. */
+static db_scan_cache_t *task_database_cache_new(const char *path)
+{
+   size_t i;
+   int64_t len            = 0;
+   db_scan_cache_t *cache = (db_scan_cache_t*)
+      calloc(1, sizeof(*cache));
+
+   if (!cache)
+      return NULL;
+
+   if (     !string_is_empty(path)
+         && path_is_valid(path)
+         && filestream_read_file(path, &cache->data, &len)
+         && !task_database_cache_parse(cache, len))
+   {
+      RARCH_WARN("[Scanner]: Ignoring invalid scan cache \"%s\".\n", path);
+      free(cache->data);
+      cache->data      = NULL;
+      cache->num_items = 0;
+   }
+
+   cache->bits = 4;
+   while (((size_t)1 << cache->bits) < cache->num_items && cache->bits < 31)
+      cache->bits++;
+
+   cache->buckets = (uint32_t*)malloc(
+         ((size_t)1 << cache->bits) * sizeof(*cache->buckets));
+   cache->next    = (uint32_t*)malloc(
+         (cache->num_items + 1) * sizeof(*cache->next));
+   cache->marks   = (uint8_t*)calloc(cache->num_items + 1,
+         sizeof(*cache->marks));
+
+   if (!cache->buckets || !cache->next || !cache->marks)
+   {
+      task_database_cache_free(cache);
+      return NULL;
+   }
+
+   memset(cache->buckets, 0xFF,
+         ((size_t)1 << cache->bits) * sizeof(*cache->buckets));
+   for (i = cache->num_items; i-- > 0; )
+   {
+      uint32_t *bucket = &cache->buckets[
+         task_database_cache_bucket(cache->items[i].hash, cache->bits)];
+      cache->next[i]   = *bucket;
+      *bucket          = (uint32_t)i;
+   }
+
+   return cache;
+}
+
+static uint32_t task_database_cache_find(const db_scan_cache_t *cache,
+      const char *path, uint32_t hash)
+{
+   uint32_t i;
+
+   for (i  = cache->buckets[task_database_cache_bucket(hash, cache->bits)];
+        i != DB_SCAN_CACHE_NONE;
+        i  = cache->next[i])
+   {
+      if (     cache->items[i].hash == hash
+            && string_is_equal(cache->strings + cache->items[i].path, path))
+         return i;
+   }
+
+   return DB_SCAN_CACHE_NONE;
+}
+
+static uint32_t task_database_cache_add_string(db_scan_cache_t *cache,
+      const char *str)
+{
+   size_t len    = strlen(str) + 1;
+   size_t offset = RBUF_LEN(cache->update_strings);
+
+   if (!RBUF_TRYFIT(cache->update_strings, offset + len))
+      return DB_SCAN_CACHE_NONE;
+   memcpy(cache->update_strings + offset, str, len);
+   RBUF_RESIZE(cache->update_strings, offset + len);
+   return (uint32_t)offset;
+}
+
+static void task_database_cache_add(db_scan_cache_t *cache,
+      const char *path, const db_scan_file_t *file)
+{
+   db_scan_cache_item_t item;
+
+   if (file->cached != DB_SCAN_CACHE_NONE)
+   {
+      cache->marks[file->cached] = DB_SCAN_CACHE_SEEN;
+      return;
+   }
+
+   if (file->size < 0 || file->mtime < 0)
+      return;
+
+   if (file->stale != DB_SCAN_CACHE_NONE)
+      cache->marks[file->stale] = DB_SCAN_CACHE_STALE;
+
+   item.size        = file->size;
+   item.mtime       = file->mtime;
+   item.hash        = file->hash;
+   item.type        = (uint32_t)file->type;
+   item.crc         = file->crc;
+   item.archive_crc = file->archive_crc;
+   item.path        = task_database_cache_add_string(cache, path);
+   item.serial      = DB_SCAN_CACHE_NONE;
+
+   if (item.path == DB_SCAN_CACHE_NONE)
+      return;
+   if (!string_is_empty(file->serial))
+      if ((item.serial = task_database_cache_add_string(cache,
+            file->serial)) == DB_SCAN_CACHE_NONE)
+         return;
+
+   if (RBUF_TRYFIT(cache->updates, RBUF_LEN(cache->updates) + 1))
+      RBUF_PUSH(cache->updates, item);
+}
+
+static bool task_database_cache_write_item(RFILE *file,
+      const db_scan_cache_item_t *item, const char *strings,
+      char **out_strings)
+{
+   db_scan_cache_item_t out = *item;
+   const char *path         = strings + item->path;
+   size_t offset            = RBUF_LEN(*out_strings);
+   size_t path_len          = strlen(path) + 1;
+   size_t serial_len        = (item->serial != DB_SCAN_CACHE_NONE)
+      ? strlen(strings + item->serial) + 1 : 0;
+
+   if (!RBUF_TRYFIT(*out_strings, offset + path_len + serial_len))
+      return false;
+
+   memcpy(*out_strings + offset, path, path_len);
+   out.path = (uint32_t)offset;
+   if (serial_len)
+   {
+      memcpy(*out_strings + offset + path_len,
+            strings + item->serial, serial_len);
+      out.serial = (uint32_t)(offset + path_len);
+   }
+   RBUF_RESIZE(*out_strings, offset + path_len + serial_len);
+
+   return filestream_write(file, &out, sizeof(out)) == sizeof(out);
+}
+
+/* Saves the cache to 'path'. Files last seen under 'dir' which
+ * a complete scan of it did not come across are left out. */
+static void task_database_cache_save(db_scan_cache_t *cache,
+      const char *path, const char *dir)
+{
+   db_scan_cache_header_t header;
+   size_t i;
+   RFILE *file         = NULL;
+   char *strings       = NULL;
+   size_t dir_len      = string_is_empty(dir) ? 0 : strlen(dir);
+   size_t num_items    = RBUF_LEN(cache->updates);
+   bool ret            = false;
+
+   /* Without the trailing slash, if any */
+   if (dir_len > 1 && (dir[dir_len - 1] == '/' || dir[dir_len - 1] == '\\'))
+      dir_len--;
+
+   for (i = 0; i < cache->num_items; i++)
+   {
+      const char *item_path = cache->strings + cache->items[i].path;
+
+      if (     cache->marks[i] == DB_SCAN_CACHE_UNSEEN
+            && dir_len
+            && !strncmp(item_path, dir, dir_len)
+            && (item_path[dir_len] == '/' || item_path[dir_len] == '\\'))
+         cache->marks[i] = DB_SCAN_CACHE_STALE;
+      if (cache->marks[i] != DB_SCAN_CACHE_STALE)
+         num_items++;
+   }
+
+   /* Nothing new, and nothing gone */
+   if (     !RBUF_LEN(cache->updates)
+         && num_items == cache->num_items)
+      return;
+
+   if (     string_is_empty(path)
+         || !(file = filestream_open(path,
+               RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   header.magic        = DB_SCAN_CACHE_MAGIC;
+   header.version      = DB_SCAN_CACHE_VERSION;
+   header.num_items    = (uint32_t)num_items;
+   header.strings_size = 0;
+
+   if (filestream_write(file, &header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   for (i = 0; i < cache->num_items; i++)
+      if (     cache->marks[i] != DB_SCAN_CACHE_STALE
+            && !task_database_cache_write_item(file, &cache->items[i],
+               cache->strings, &strings))
+         goto end;
+
+   for (i = 0; i < RBUF_LEN(cache->updates); i++)
+      if (!task_database_cache_write_item(file, &cache->updates[i],
+               cache->update_strings, &strings))
+         goto end;
+
+   if (     filestream_write(file, strings, RBUF_LEN(strings))
+            != (int64_t)RBUF_LEN(strings))
+      goto end;
+
+   header.strings_size = (uint32_t)RBUF_LEN(strings);
+   ret                 =
+         filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_START) == 0
+      && filestream_write(file, &header, sizeof(header)) == sizeof(header);
+
+end:
+   filestream_close(file);
+   if (!ret)
+      filestream_delete(path);
+   RBUF_FREE(strings);
+}
+
+/* Gets the size and modification time a file is cached by,
+ * those of the archive for archive members */
+static void task_database_stat(const char *name,
+      int64_t *size, int64_t *mtime)
+{
+   char archive_path[PATH_MAX_LENGTH];
+   const char *delim = path_get_archive_delim(name);
+
+   if (delim)
+   {
+      size_t len = (size_t)(delim - name);
+      if (len >= sizeof(archive_path))
+      {
+         *size  = -1;
+         *mtime = -1;
+         return;
+      }
+      memcpy(archive_path, name, len);
+      archive_path[len] = '\0';
+      name              = archive_path;
+   }
+
+   *size  = path_get_size(name);
+   *mtime = path_get_mtime(name);
+}
+
+/* Works out how the file 'name' is looked up, from the scan
+ * cache if it did not change since it was last hashed. Only
+ * reads 'cache', so it can run on the hashing threads. */
+static int task_database_hash_file(const db_scan_cache_t *cache,
+      const char *name, db_scan_file_t *file)
+{
+   file->type        = DATABASE_TYPE_ITERATE;
+   file->crc         = 0;
+   file->archive_crc = 0;
+   file->serial[0]   = '\0';
+   file->hash        = encoding_crc32(0, (const uint8_t*)name, strlen(name));
+   file->cached      = DB_SCAN_CACHE_NONE;
+   file->stale       = DB_SCAN_CACHE_NONE;
+
+   task_database_stat(name, &file->size, &file->mtime);
+
+   if (cache)
+   {
+      uint32_t i = task_database_cache_find(cache, name, file->hash);
+
+      if (i != DB_SCAN_CACHE_NONE)
+      {
+         const db_scan_cache_item_t *item = &cache->items[i];
+
+         if (     item->size  == file->size
+               && item->mtime == file->mtime
+               && file->mtime >= 0)
+         {
+            file->type        = (enum database_type)item->type;
+            file->crc         = item->crc;
+            file->archive_crc = item->archive_crc;
+            file->cached      = i;
+            if (item->serial != DB_SCAN_CACHE_NONE)
+               strlcpy(file->serial, cache->strings + item->serial,
+                     sizeof(file->serial));
+            return 1;
+         }
+
+         file->stale = i;
+      }
+   }
+
+   /* Archive members are looked up by the CRC
+    * the archive records for them */
+   if (path_contains_compressed_file(name))
+   {
+      file->type = DATABASE_TYPE_ITERATE_ARCHIVE;
+#ifdef HAVE_COMPRESSION
+      file->crc  = file_archive_get_file_crc32(name);
+#endif
+      return 1;
+   }
+
+   return task_database_hash_content(name, &file->type,
+         &file->crc, &file->archive_crc,
+         file->serial, sizeof(file->serial));
+}
+
+/* Hands the file the handler is on to the database lookup */
+static void task_database_use_file(db_handle_t *_db,
+      database_info_handle_t *db, database_state_handle_t *db_state,
+      const char *name, const db_scan_file_t *file, int ret)
+{
+   if (_db->cache && ret)
+      task_database_cache_add(_db->cache, name, file);
+
+   db->type              = file->type;
+   db_state->crc         = file->crc;
+   db_state->archive_crc = file->archive_crc;
+   strlcpy(db_state->serial, file->serial, sizeof(db_state->serial));
+}
+
+static int task_database_iterate_playlist(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   int ret;
+   db_scan_file_t file;
+
+   switch (extension_to_file_type(path_get_extension(name)))
+   {
+      case FILE_TYPE_CUE:
+         task_database_cue_prune(db, name, db->list_ptr);
+         break;
+      case FILE_TYPE_GDI:
+         gdi_prune(db, name, db->list_ptr);
+         break;
+      default:
+         break;
+   }
+
+   ret = task_database_hash_file(_db->cache, name, &file);
+   task_database_use_file(_db, db, db_state, name, &file, ret);
+   return ret;
+}
+
+#ifdef HAVE_THREADS
+static void task_database_scan_hash(void *data)
+{
+   db_scan_job_t       *job     = (db_scan_job_t*)data;
+   db_scan_pipeline_t *pipeline = job->pipeline;
+   int ret                      = task_database_hash_file(
+         pipeline->cache, job->path, &job->file);
+
+   slock_lock(pipeline->lock);
+   job->ret  = ret;
+   job->done = true;
+   scond_broadcast(pipeline->cond);
+   slock_unlock(pipeline->lock);
+}
+
+static void task_database_scan_free(db_scan_pipeline_t *pipeline)
+{
+   size_t i;
+
+   if (!pipeline)
+      return;
+
+   /* Drops the files still queued and waits
+    * for the ones being hashed */
+   tpool_destroy(pipeline->pool);
+
+   for (i = 0; i < pipeline->num_jobs; i++)
+      free(pipeline->jobs[i].path);
+
+   scond_free(pipeline->cond);
+   slock_free(pipeline->lock);
+   free(pipeline->jobs);
+   free(pipeline);
+}
+
+static db_scan_pipeline_t *task_database_scan_new(
+      database_info_handle_t *db, const db_scan_cache_t *cache)
+{
+   size_t i;
+   db_scan_pipeline_t *pipeline = NULL;
+   unsigned threads             = cpu_features_get_core_amount();
+
+   if (!db->list || db->list->size < 2)
+      return NULL;
+
+   /* Hashing waits on reads much of the time, so
+    * even one core gains from a second thread */
+   if (threads < 2)
+      threads = 2;
+   else if (threads > DB_SCAN_MAX_THREADS)
+      threads = DB_SCAN_MAX_THREADS;
+
+   if (!(pipeline = (db_scan_pipeline_t*)calloc(1, sizeof(*pipeline))))
+      return NULL;
+
+   pipeline->cache    = cache;
+   pipeline->num_jobs = threads * DB_SCAN_JOBS_PER_THREAD;
+   pipeline->jobs     = (db_scan_job_t*)calloc(pipeline->num_jobs,
+         sizeof(*pipeline->jobs));
+   pipeline->lock     = slock_new();
+   pipeline->cond     = scond_new();
+   pipeline->pool     = tpool_create(threads);
+
+   if (     !pipeline->jobs
+         || !pipeline->lock
+         || !pipeline->cond
+         || !pipeline->pool)
+   {
+      task_database_scan_free(pipeline);
+      return NULL;
+   }
+
+   for (i = 0; i < pipeline->num_jobs; i++)
+      pipeline->jobs[i].pipeline = pipeline;
+
+   RARCH_LOG("[Scanner]: Hashing content on %u threads.\n", threads);
+
+   return pipeline;
+}
+
+/* The walker: hands the files after the one being matched to
+ * the hashing threads, as far as there are free slots. */
+static void task_database_scan_fill(db_scan_pipeline_t *pipeline,
+      database_info_handle_t *db)
+{
+   while (     pipeline->next < db->list->size
+         &&    pipeline->next < db->list_ptr + pipeline->num_jobs)
+   {
+      size_t list_ptr    = pipeline->next;
+      const char *name   = db->list->elems[list_ptr].data;
+      db_scan_job_t *job = &pipeline->jobs[list_ptr % pipeline->num_jobs];
+
+      if (job->path)
+         break;
+
+      pipeline->next++;
+
+      /* Pruned by a cue or gdi sheet further up */
+      if (!name)
+         continue;
+
+      /* Prune right away, so that the tracks a sheet
+       * references are never hashed on their own */
+      switch (extension_to_file_type(path_get_extension(name)))
+      {
+         case FILE_TYPE_CUE:
+            task_database_cue_prune(db, name, list_ptr + 1);
+            break;
+         case FILE_TYPE_GDI:
+            gdi_prune(db, name, list_ptr + 1);
+            break;
+         default:
+            break;
+      }
+
+      job->path     = strdup(name);
+      job->list_ptr = list_ptr;
+      job->ret      = 0;
+      job->done     = false;
+
+      if (!job->path || !tpool_add_work(pipeline->pool,
+               task_database_scan_hash, job))
+      {
+         free(job->path);
+         job->path = NULL;
+      }
+   }
+}
+
+/* Takes the result for the file being matched, once it is
+ * hashed. Files the walker did not hand out are left to
+ * task_database_iterate_playlist(). */
+static enum db_scan_status task_database_scan_collect(
+      db_handle_t *_db,
+      database_info_handle_t *db,
+      database_state_handle_t *db_state)
+{
+   db_scan_job_t *job;
+   db_scan_pipeline_t *pipeline = _db->scan;
+
+   task_database_scan_fill(pipeline, db);
+
+   job = &pipeline->jobs[db->list_ptr % pipeline->num_jobs];
+   if (!job->path || job->list_ptr != db->list_ptr)
+      return DB_SCAN_INLINE;
+
+   slock_lock(pipeline->lock);
+   if (!job->done)
+      scond_wait_timeout(pipeline->cond, pipeline->lock, DB_SCAN_WAIT_US);
+   if (!job->done)
+   {
+      slock_unlock(pipeline->lock);
+      return DB_SCAN_PENDING;
+   }
+   slock_unlock(pipeline->lock);
+
+   task_database_use_file(_db, db, db_state, job->path,
+         &job->file, job->ret);
+
+   free(job->path);
+   job->path = NULL;
+
+   return job->ret ? DB_SCAN_DONE : DB_SCAN_FAILED;
+}
+#endif
+
 static int database_info_list_iterate_end_no_match(
       database_info_handle_t *db,
       database_state_handle_t *db_state,
@@ -759,6 +1485,74 @@ static int database_info_list_iterate_new(database_state_handle_t *db_state,
    return 0;
 }
 
+/* Reads the items of the current database
+ * that the database index found */
+static void database_info_list_iterate_new_indexed(
+      database_state_handle_t *db_state)
+{
+   if (db_state->info)
+   {
+      database_info_list_free(db_state->info);
+      free(db_state->info);
+   }
+   db_state->info = database_info_index_list_new(db_state->index,
+         (unsigned)db_state->list->elems[db_state->list_index].attr.i,
+         db_state->index_hits, db_state->num_index_hits);
+}
+
+/* Looks the content up in the database index the
+ * first time it is called for it, then moves on
+ * to the next database holding it.
+ *
+ * Returns true if the index is used for the content,
+ * false if the databases have to be queried. */
+static bool task_database_index_next(database_state_handle_t *db_state,
+      bool serial)
+{
+   if (!db_state->index)
+      return false;
+
+   if (db_state->index_status == DB_INDEX_NOT_PROBED)
+   {
+      size_t count;
+
+      if (serial)
+         count  = database_info_index_find_serial(db_state->index,
+               db_state->serial, db_state->index_hits, DB_INDEX_MAX_HITS);
+      else
+      {
+         count  = database_info_index_find_crc(db_state->index,
+               db_state->crc, db_state->index_hits, DB_INDEX_MAX_HITS);
+         if (     db_state->archive_crc
+               && db_state->archive_crc != db_state->crc
+               && count <= DB_INDEX_MAX_HITS)
+            count += database_info_index_find_crc(db_state->index,
+                  db_state->archive_crc, db_state->index_hits + count,
+                  DB_INDEX_MAX_HITS - count);
+      }
+
+      db_state->num_index_hits = count;
+      db_state->index_status   = (count <= DB_INDEX_MAX_HITS)
+         ? DB_INDEX_PROBED : DB_INDEX_UNUSED;
+   }
+
+   if (db_state->index_status != DB_INDEX_PROBED)
+      return false;
+
+   for (; db_state->list_index < db_state->list->size; db_state->list_index++)
+   {
+      size_t i;
+      uint32_t db = (uint32_t)
+         db_state->list->elems[db_state->list_index].attr.i;
+
+      for (i = 0; i < db_state->num_index_hits; i++)
+         if (db_state->index_hits[i].db == db)
+            return true;
+   }
+
+   return true;
+}
+
 static int database_info_list_iterate_found_match(
       db_handle_t *_db,
       database_state_handle_t *db_state,
@@ -956,6 +1750,11 @@ static int task_database_iterate_crc_lookup(
    if (db_state->entry_index == 0)
    {
       char query[50];
+      bool indexed = task_database_index_next(db_state, false);
+
+      if (db_state->list_index == db_state->list->size)
+         return database_info_list_iterate_end_no_match(db, db_state, name,
+               path_contains_compressed_file);
 
       query[0] = '\0';
 
@@ -978,11 +1777,16 @@ static int task_database_iterate_crc_lookup(
          }
       }
 
-      snprintf(query, sizeof(query),
-            "{crc:or(b\"%08lX\",b\"%08lX\")}",
-            (unsigned long)db_state->crc, (unsigned long)db_state->archive_crc);
+      if (indexed)
+         database_info_list_iterate_new_indexed(db_state);
+      else
+      {
+         snprintf(query, sizeof(query),
+               "{crc:or(b\"%08lX\",b\"%08lX\")}",
+               (unsigned long)db_state->crc, (unsigned long)db_state->archive_crc);
 
-      database_info_list_iterate_new(db_state, query);
+         database_info_list_iterate_new(db_state, query);
+      }
    }
 
    if (db_state->info)
@@ -1117,23 +1921,33 @@ static int task_database_iterate_serial_lookup(
 
    if (db_state->entry_index == 0)
    {
-      size_t _len;
-      char query[50];
-      char *serial_buf = bin_to_hex_alloc(
-            (uint8_t*)db_state->serial,
-            strlen(db_state->serial) * sizeof(uint8_t));
-
-      if (!serial_buf)
-         return 1;
-
-      _len  = strlcpy(query, "{'serial': b'", sizeof(query));
-      _len += strlcpy(query + _len, serial_buf, sizeof(query) - _len);
-      query[  _len] = '\'';
-      query[++_len] = '}';
-      query[++_len] = '\0';
-      database_info_list_iterate_new(db_state, query);
-
-      free(serial_buf);
+      if (task_database_index_next(db_state, true))
+      {
+         if (db_state->list_index == db_state->list->size)
+            return database_info_list_iterate_end_no_match(db, db_state,
+                  name, path_contains_compressed_file);
+         database_info_list_iterate_new_indexed(db_state);
+      }
+      else
+      {
+         size_t _len;
+         char query[50];
+         char *serial_buf = bin_to_hex_alloc(
+               (uint8_t*)db_state->serial,
+               strlen(db_state->serial) * sizeof(uint8_t));
+
+         if (!serial_buf)
+            return 1;
+
+         _len  = strlcpy(query, "{'serial': b'", sizeof(query));
+         _len += strlcpy(query + _len, serial_buf, sizeof(query) - _len);
+         query[  _len] = '\'';
+         query[++_len] = '}';
+         query[++_len] = '\0';
+         database_info_list_iterate_new(db_state, query);
+
+         free(serial_buf);
+      }
    }
 
    if (db_state->info)
@@ -1188,7 +2002,7 @@ static int task_database_iterate(
    switch (db->type)
    {
       case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
+         return task_database_iterate_playlist(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_ARCHIVE:
 #ifdef HAVE_COMPRESSION
          return task_database_iterate_crc_lookup(
@@ -1221,7 +2035,8 @@ static void task_database_cleanup_state(
 
    if (db_state->buf)
       free(db_state->buf);
-   db_state->buf = NULL;
+   db_state->buf          = NULL;
+   db_state->index_status = DB_INDEX_NOT_PROBED;
 }
 
 static void task_database_handler(retro_task_t *task)
@@ -1279,6 +2094,26 @@ static void task_database_handler(retro_task_t *task)
                      db->flags & DB_HANDLE_FLAG_SHOW_HIDDEN_FILES,
                      false, false);
 
+            /* Index all the databases, so the index can be saved
+             * and reused even if only one of them is scanned */
+            if (dbstate->list)
+            {
+               size_t i;
+               char index_path[PATH_MAX_LENGTH];
+
+               index_path[0] = '\0';
+               if (!string_is_empty(db->playlist_directory))
+                  fill_pathname_join_special(index_path,
+                        db->playlist_directory, FILE_PATH_DATABASE_INDEX,
+                        sizeof(index_path));
+
+               for (i = 0; i < dbstate->list->size; i++)
+                  dbstate->list->elems[i].attr.i = (int)i;
+
+               dbstate->index = database_info_index_new(dbstate->list,
+                     index_path);
+            }
+
             RARCH_LOG("[Scanner]: %s\"%s\"..\n", msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_START), db->fullpath);
             if (retroarch_override_setting_is_set(RARCH_OVERRIDE_SETTING_DATABASE_SCAN, NULL))
                printf("%s\"%s\"..\n", msg_hash_to_str(MSG_MANUAL_CONTENT_SCAN_START), db->fullpath);
@@ -1333,6 +2168,12 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+         if (!db->cache)
+            db->cache   = task_database_cache_new(db->scan_cache_path);
+#ifdef HAVE_THREADS
+         if (!db->scan)
+            db->scan    = task_database_scan_new(dbinfo, db->cache);
+#endif
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
@@ -1350,10 +2191,26 @@ static void task_database_handler(retro_task_t *task)
             if (!name)
                goto task_finished;
 
+#ifdef HAVE_THREADS
+            if (db->scan && dbinfo->type == DATABASE_TYPE_ITERATE)
+            {
+               switch (task_database_scan_collect(db, dbinfo, dbstate))
+               {
+                  case DB_SCAN_PENDING:
+                     return;
+                  case DB_SCAN_FAILED:
+                     dbinfo->status = DATABASE_STATUS_ITERATE_NEXT;
+                     dbinfo->type   = DATABASE_TYPE_ITERATE;
+                     /* fall-through */
+                  case DB_SCAN_DONE:
+                     return;
+                  case DB_SCAN_INLINE:
+                     break;
+               }
+            }
+#endif
+
             path_contains_compressed_file      = path_contains_compressed_file(name);
-            if (path_contains_compressed_file)
-               if (dbinfo->type == DATABASE_TYPE_ITERATE)
-                  dbinfo->type   = DATABASE_TYPE_ITERATE_ARCHIVE;
 
             if (task_database_iterate(db, name, dbstate, dbinfo,
                      path_contains_compressed_file) == 0)
@@ -1408,10 +2265,28 @@ task_finished:
    {
       if (dbstate->list)
          dir_list_free(dbstate->list);
+      database_info_index_free(dbstate->index);
    }
 
    if (db)
    {
+#ifdef HAVE_THREADS
+      task_database_scan_free(db->scan);
+#endif
+      if (db->cache)
+      {
+         /* Only a complete scan of a directory
+          * tells which files are gone */
+         task_database_cache_save(db->cache, db->scan_cache_path,
+               (     (db->flags & DB_HANDLE_FLAG_IS_DIRECTORY)
+                  && dbinfo
+                  && dbinfo->list
+                  && dbinfo->list_ptr >= dbinfo->list->size)
+               ? db->fullpath : NULL);
+         task_database_cache_free(db->cache);
+      }
+      if (!string_is_empty(db->scan_cache_path))
+         free(db->scan_cache_path);
       if (!string_is_empty(db->playlist_directory))
          free(db->playlist_directory);
       if (!string_is_empty(db->content_database_path))
@@ -1447,9 +2322,13 @@ bool task_push_dbscan(
       bool db_dir_show_hidden_files,
       retro_task_callback_t cb)
 {
+   char scan_cache_path[PATH_MAX_LENGTH];
    retro_task_t *t                         = task_init();
 #ifdef RARCH_INTERNAL
    settings_t *settings                    = config_get_ptr();
+   const char *cache_directory             = settings->paths.directory_cache;
+#else
+   const char *cache_directory             = NULL;
 #endif
    db_handle_t *db                         = (db_handle_t*)calloc(1, sizeof(db_handle_t));
 
@@ -1457,11 +2336,13 @@ bool task_push_dbscan(
       goto error;
 
    t->handler                              = task_database_handler;
+   t->name                                 = "database_scan";
    t->state                                = db;
    t->callback                             = cb;
    t->title                                = strdup(msg_hash_to_str(
             MSG_PREPARING_FOR_CONTENT_SCAN));
    t->flags                               |= RETRO_TASK_FLG_ALTERNATIVE_LOOK;
+   t->priority                             = TASK_PRIORITY_BACKGROUND;
 #ifdef RARCH_INTERNAL
    t->progress_cb                          = task_database_progress_cb;
    if (settings->bools.scan_without_core_match)
@@ -1484,6 +2365,10 @@ bool task_push_dbscan(
       db->flags |= DB_HANDLE_FLAG_IS_DIRECTORY;
    db->fullpath                            = strdup(fullpath);
    db->playlist_directory                  = strdup(playlist_directory);
+   fill_pathname_join_special(scan_cache_path,
+         string_is_empty(cache_directory) ? playlist_directory : cache_directory,
+         FILE_PATH_CONTENT_SCAN_CACHE, sizeof(scan_cache_path));
+   db->scan_cache_path                     = strdup(scan_cache_path);
    db->content_database_path               = strdup(content_database);
 
    task_queue_push(t);
@@ -332,6 +332,7 @@ void *task_push_decompress(
 
    t->state            = s;
    t->handler          = task_decompress_handler;
+   t->name             = "decompress";
 
    if (!string_is_empty(subdir))
    {
@@ -324,6 +324,7 @@ static void *task_push_http_transfer_generic(
       goto error;
 
    t->handler              = task_http_transfer_handler;
+   t->name                 = "http";
    t->state                = http;
    t->callback             = cb;
    t->progress_cb          = http_transfer_progress_cb;
@@ -464,9 +464,12 @@ bool task_push_image_load(const char *fullpath,
 
    t->state           = nbio;
    t->handler         = task_file_load_handler;
+   t->name            = "image";
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
+   /* Decoding only touches the task's own nbio and image handles */
+   t->flags          |= RETRO_TASK_FLG_PARALLEL;
 
    task_queue_push(t);
 
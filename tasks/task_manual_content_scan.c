@@ -611,12 +611,14 @@ bool task_push_manual_content_scan(
 
    /* > Configure task */
    task->handler                 = task_manual_content_scan_handler;
+   task->name                    = "manual_content_scan";
    task->state                   = manual_scan;
    task->title                   = strdup(task_title);
    task->progress                = 0;
    task->callback                = cb_task_manual_content_scan;
    task->cleanup                 = task_manual_content_scan_free;
    task->flags                  |= RETRO_TASK_FLG_ALTERNATIVE_LOOK;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
 
    /* > Push task */
    task_queue_push(task);
@@ -1107,6 +1107,7 @@ bool task_push_overlay_load_default(
    loader->overlay_path     = strdup(overlay_path);
 
    t->handler               = task_overlay_handler;
+   t->name                  = "overlay";
    t->cleanup               = task_overlay_free;
    t->state                 = loader;
    t->callback              = cb;
@@ -574,10 +574,12 @@ bool task_push_pl_thumbnail_download(
 
    /* Configure task */
    task->handler                 = task_pl_thumbnail_download_handler;
+   task->name                    = "playlist_thumbnails";
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->progress                = 0;
    task->flags                  |= RETRO_TASK_FLG_ALTERNATIVE_LOOK;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
 
    task_queue_push(task);
 
@@ -933,6 +935,7 @@ bool task_push_pl_entry_thumbnail_download(
 
    /* Configure task */
    task->handler                 = task_pl_entry_thumbnail_download_handler;
+   task->name                    = "entry_thumbnails";
    task->state                   = pl_thumb;
    task->title                   = strdup(system);
    task->progress                = 0;
@@ -328,6 +328,7 @@ bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config)
    strlcpy(task_title + _len, playlist_name, sizeof(task_title) - _len);
 
    task->handler                 = task_pl_manager_reset_cores_handler;
+   task->name                    = "playlist_reset_cores";
    task->state                   = pl_manager;
    task->title                   = strdup(task_title);
    task->progress                = 0;
@@ -758,6 +759,7 @@ bool task_push_pl_manager_clean_playlist(
    strlcpy(task_title + _len, playlist_name, sizeof(task_title) - _len);
 
    task->handler                 = task_pl_manager_clean_playlist_handler;
+   task->name                    = "playlist_clean";
    task->state                   = pl_manager;
    task->title                   = strdup(task_title);
    task->progress                = 0;
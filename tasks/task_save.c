@@ -638,8 +638,10 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
       state->flags              |= SAVE_TASK_FLAG_MUTE;
 
    task->type                    = TASK_TYPE_BLOCKING;
+   task->priority                = TASK_PRIORITY_INTERACTIVE;
    task->state                   = state;
    task->handler                 = task_save_handler;
+   task->name                    = "undo_save_state";
    task->callback                = undo_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_UNDOING_SAVE_STATE));
 
@@ -1196,8 +1198,10 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
       state->flags              |= SAVE_TASK_FLAG_MUTE;
 
    task->type                    = TASK_TYPE_BLOCKING;
+   task->priority                = TASK_PRIORITY_INTERACTIVE;
    task->state                   = state;
    task->handler                 = task_save_handler;
+   task->name                    = "save_state";
    task->callback                = save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_SAVING_STATE));
 
@@ -1307,7 +1311,9 @@ static void task_push_load_and_save_state(const char *path, void *data,
 
    task->state                   = state;
    task->type                    = TASK_TYPE_BLOCKING;
+   task->priority                = TASK_PRIORITY_INTERACTIVE;
    task->handler                 = task_load_handler;
+   task->name                    = "load_and_save_state";
    task->callback                = content_load_and_save_state_cb;
    task->title                   = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 
@@ -1595,8 +1601,10 @@ bool content_load_state(const char *path,
       state->flags             |= SAVE_TASK_FLAG_MUTE;
 
    task->type                   = TASK_TYPE_BLOCKING;
+   task->priority               = TASK_PRIORITY_INTERACTIVE;
    task->state                  = state;
    task->handler                = task_load_handler;
+   task->name                   = "load_state";
    task->callback               = content_load_state_cb;
    task->title                  = strdup(msg_hash_to_str(MSG_LOADING_STATE));
 